@@ -47,7 +47,7 @@ ConstrainedVariable::ConstrainedVariable(const ConstraintEngineId constraintEngi
       m_constraintEngine(constraintEngine), m_name(name), m_internal(internal),
   m_canBeSpecified(_canBeSpecified), m_specifiedFlag(false), m_specifiedValue(0),
   m_index(index), m_parent(_parent), m_deactivationRefCount(0), m_deleted(false),
-  m_listeners(), m_constraints() {
+  m_trailStamp(0), m_oldestTrailStamp(0), m_listeners(), m_constraints() {
   check_error(m_constraintEngine.isValid());
   check_error(m_index == NO_INDEX || _parent.isValid());
   m_constraintEngine->add(m_id);
@@ -79,6 +79,7 @@ ConstrainedVariable::ConstrainedVariable(const ConstraintEngineId constraintEngi
     debugMsg("ConstrainedVariable:restrictBaseDomain",
 	     toString() << " restricted from " << baseDomain().toString() << " intersecting " << dom.toString());
 
+    m_constraintEngine->invalidateTrailLevel();
     handleRestrictBaseDomain(dom);
 
     // Trigger events for propagation of this variable restriction, even if no domain restriction has occured, since it does
@@ -239,6 +240,11 @@ void ConstrainedVariable::removeConstraint(const ConstraintId constraint,
     (*it)->notifyConstraintRemoved(constraint, argIndex);
 }
 
+  void ConstrainedVariable::trail() {
+    if(m_trailStamp != m_constraintEngine->m_trailStamp)
+      m_constraintEngine->trail(m_id);
+  }
+
   bool ConstrainedVariable::isSpecified() const {
     return m_specifiedFlag;
   }
@@ -396,6 +402,7 @@ const std::string& ConstrainedVariable::getName() const {
     checkError(internal_baseDomain().isOpen(),
 	       "Attempted to close a variable but the base domain is already closed.");
 
+    m_constraintEngine->invalidateTrailLevel();
     internal_baseDomain().close();
 
     if(getCurrentDomain().isOpen())
@@ -412,6 +419,7 @@ const std::string& ConstrainedVariable::getName() const {
 
     bool needReset = internal_baseDomain().isSingleton();
 
+    m_constraintEngine->invalidateTrailLevel();
     internal_baseDomain().open();
     if(getCurrentDomain().isClosed())
       getCurrentDomain().open();
@@ -435,6 +443,7 @@ const std::string& ConstrainedVariable::getName() const {
   void ConstrainedVariable::insert(edouble value) {
     // the base domain has to be open in order for insertion to occur
     check_error(internal_baseDomain().isOpen(), "Can't insert a member into a variable with a closed base domain.");
+    m_constraintEngine->invalidateTrailLevel();
     internal_baseDomain().insert(value);
 
     // Pass on insertion to derived domain if the variable has not yet been specified
@@ -444,6 +453,7 @@ const std::string& ConstrainedVariable::getName() const {
 
   void ConstrainedVariable::remove(edouble value) {
     // Always remove from base domain
+    m_constraintEngine->invalidateTrailLevel();
     internal_baseDomain().remove(value);
 
     // Remove from derived domain
@@ -416,6 +416,14 @@ namespace EUROPA {
 
     void internalSpecify(edouble singletonValue);
 
+    /**
+     * @brief Record the current domain on the ConstraintEngine trail, if a trail level is open and the domain
+     * has not yet been recorded in it. getCurrentDomain() must call this, as must derived classes before they
+     * change the current domain by any other means.
+     * @see ConstraintEngine::pushTrailLevel()
+     */
+    void trail();
+
     friend class Constraint; /**< Grant access so that the relationships between Constraint and Variable can be constructed and validated
 			       without exposiing such methods publically. @see Constraint::Constraint(), Constraint::~Constraint() */
 
@@ -518,6 +526,8 @@ namespace EUROPA {
     const EntityId m_parent;
     unsigned int m_deactivationRefCount;/*!< The number of outstanding deactivation requests. */
     bool m_deleted; /*!< True when constraint is in the destructor. Otherwise false. */
+    unsigned int m_trailStamp; /*!< Stamp of the trail level in which the domain was last recorded. */
+    unsigned int m_oldestTrailStamp; /*!< Stamp of the outermost trail level in which the domain has been recorded. */
 
     std::set<ConstrainedVariableListenerId> m_listeners; /**< Collection of listeners to variable changes */
     ConstraintList m_constraints; /**< Holds the list of Constraint/Argument pairs. The argument indicates the
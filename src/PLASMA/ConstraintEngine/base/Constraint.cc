@@ -25,6 +25,9 @@ Constraint::Constraint(const std::string& name,
     , m_createdBy("UNKNOWN")
     , m_deactivationRefCount(0)
     , m_isRedundant(false)
+    , m_costClass(variables.size() <= 2 ? CHEAP : (variables.size() == 3 ? MODERATE : EXPENSIVE))
+    , m_wakeEvents(DomainListener::ALL_CHANGES)
+    , m_agendaBucket(-1)
 {
   check_error(m_constraintEngine.isValid());
   check_error(!m_variables.empty());
@@ -97,6 +100,16 @@ Constraint::Constraint(const std::string& name,
     m_constraintEngine->remove(m_id);
   }
 
+  void Constraint::setCostClass(CostClass costClass){
+    check_error(costClass < COST_CLASS_COUNT);
+    m_costClass = costClass;
+  }
+
+  void Constraint::setWakeEvents(DomainListener::ChangeTypeMask events){
+    checkError((events & ~DomainListener::ALL_CHANGES) == 0, "Invalid change type mask " << events);
+    m_wakeEvents = events;
+  }
+
   double Constraint::getViolation() const {
     // TODO: each constraint must eventually know whether it is being violated and it must know how to compute its
     // penalty value
@@ -48,6 +48,17 @@ namespace EUROPA {
   public:
     DECLARE_ENTITY_TYPE(Constraint);
 
+    /**
+     * @enum CostClass
+     * @brief Relative cost of executing a constraint. Propagators may use it to run cheaper constraints first.
+     * @see ConstraintAgenda
+     */
+    enum CostClass { CHEAP = 0, /**< Unary and binary constraints. */
+                     MODERATE, /**< Ternary constraints. */
+                     EXPENSIVE, /**< N-ary and global constraints. */
+                     COST_CLASS_COUNT /**< Use only for the number of classes. @note Must be last. */
+    };
+
     /**
      * @brief Constructor for NARY constraint
      * @param name The logical identifier for the constraint. Names do not have to be unique, but all instances
@@ -104,6 +115,23 @@ namespace EUROPA {
      */
     inline bool isUnary() const{return m_isUnary;}
 
+    /**
+     * @brief Accessor. Defaults from the size of the scope.
+     * @see setCostClass()
+     */
+    inline CostClass getCostClass() const {return m_costClass;}
+
+    /**
+     * @brief Test if a change of the given type to a variable in scope should wake the constraint.
+     *
+     * Checked by the ConstraintEngine before canIgnore(), which remains the place for filters that depend on
+     * the variable or its position in the scope.
+     * @see setWakeEvents()
+     */
+    inline bool wakesOn(const DomainListener::ChangeType& changeType) const {
+      return (m_wakeEvents & DomainListener::toMask(changeType)) != 0;
+    }
+
     /**
      * @brief This will turn off propagation of this constraint. Unlike deletion of a constraint, this is not
      * treated as a relaxation.
@@ -280,6 +308,20 @@ namespace EUROPA {
      */
     virtual void handleDeactivate(){}
 
+    /**
+     * @brief Override the default cost class. Takes effect the next time the constraint is placed on an agenda.
+     */
+    void setCostClass(CostClass costClass);
+
+    /**
+     * @brief Declare the change types that can wake this constraint. All of them by default.
+     *
+     * As with canIgnore(), leaving out a change type that could impact the constraint will weaken propagation.
+     * In particular, relaxations (RESET, RELAXED, OPENED) should normally be included.
+     * @param events A mask of DomainListener::toMask() values.
+     */
+    void setWakeEvents(DomainListener::ChangeTypeMask events);
+
     const std::string m_name; /**< Name used on stratup to bind to the correct factory and then present as a debugging aid. */
     const ConstraintEngineId m_constraintEngine; /**< The owner ConstraintEngine */
     std::vector<ConstrainedVariableId> m_variables; /**< The variable scope of the Constraint. */
@@ -308,6 +350,11 @@ namespace EUROPA {
     const std::string m_createdBy; /**< Populated on construction. Indicates the user that created the constraint. */
     unsigned int m_deactivationRefCount; /*!< Tracks number of outstanding deactivation calls */
     bool m_isRedundant; /*!< True of the constraint is redundant */
+    CostClass m_costClass; /*!< Agenda bucket to use when next queued */
+    DomainListener::ChangeTypeMask m_wakeEvents; /*!< Change types for which the propagator is notified */
+
+    friend class ConstraintAgenda;
+    int m_agendaBucket; /*!< Bucket of the agenda this constraint is queued on, or -1. Maintained by ConstraintAgenda */
   };
 
   std::vector<ConstrainedVariableId> makeScope(const ConstrainedVariableId arg1);
@@ -317,6 +317,12 @@ DomainListenerId ConstraintEngine::allocateVariableListener(const ConstrainedVar
     , m_autoPropagate(true)
     , m_schema(schema)
     , m_callbacks()
+    , m_trail()
+    , m_trailLevels()
+    , m_trailStamp(0)
+    , m_lastTrailStamp(0)
+    , m_restoringTrail(false)
+    , m_profiler(NULL)
   {
     m_violationMgr = new ViolationMgrImpl(0, *this);
   }
@@ -330,6 +336,10 @@ DomainListenerId ConstraintEngine::allocateVariableListener(const ConstrainedVar
     m_id.remove();
 
     delete m_violationMgr;
+    delete m_profiler;
+
+    for(std::vector<TrailEntry>::const_iterator it = m_trail.begin(); it != m_trail.end(); ++it)
+      delete it->m_domain;
   }
 
   /**
@@ -441,6 +451,7 @@ DomainListenerId ConstraintEngine::allocateVariableListener(const ConstrainedVar
   void ConstraintEngine::add(const ConstrainedVariableId variable){
     check_error(m_variables.find(variable) == m_variables.end());
     m_variables.insert(variable);
+    invalidateTrailLevel();
     publish(notifyAdded(variable));
 
     debugMsg("ConstraintEngine:add:ConstrainedVariable",
@@ -455,6 +466,13 @@ DomainListenerId ConstraintEngine::allocateVariableListener(const ConstrainedVar
     if(Entity::isPurging())
       return;
 
+    // Every level in which the variable may have recorded its domain can no longer be restored
+    invalidateTrailLevel();
+    if(variable->m_oldestTrailStamp != 0)
+      for(std::vector<TrailLevel>::iterator it = m_trailLevels.begin(); it != m_trailLevels.end(); ++it)
+        if(it->m_stamp >= variable->m_oldestTrailStamp)
+          it->m_restorable = false;
+
     if(getViolationMgr().isEmpty(variable))
       clearEmptyVariables();
 
@@ -471,6 +489,7 @@ void ConstraintEngine::add(const ConstraintId constraint, const std::string& pro
               "Propagator " + propagatorName + " has not been registered.");
 
   m_constraints.insert(constraint);
+  invalidateTrailLevel();
 
   // If constraint initially redundant, then store it.
   if(constraint->isRedundant())
@@ -499,6 +518,7 @@ void ConstraintEngine::add(const ConstraintId constraint, const std::string& pro
     if(Entity::isPurging())
       return;
 
+    invalidateTrailLevel();
     constraint->getPropagator()->removeConstraint(constraint);
 
     // If the constraint is inactive, there is no need to relax. So just worry if it is actually active
@@ -554,6 +574,7 @@ void ConstraintEngine::add(const PropagatorId propagator){
 
   void ConstraintEngine::notifyDeactivated(const ConstraintId deactivatedConstraint){
     check_error(!Entity::isPurging());
+    invalidateTrailLevel();
     check_error(deactivatedConstraint.isValid() && !deactivatedConstraint->isActive());
     deactivatedConstraint->getPropagator()->handleConstraintDeactivated(deactivatedConstraint);
     publish(notifyDeactivated(deactivatedConstraint));
@@ -564,6 +585,7 @@ void ConstraintEngine::add(const PropagatorId propagator){
 
   void ConstraintEngine::notifyActivated(const ConstraintId constraint){
     check_error(!Entity::isPurging());
+    invalidateTrailLevel();
     check_error(constraint.isValid() && constraint->isActive());
     constraint->getPropagator()->handleConstraintActivated(constraint);
     publish(notifyActivated(constraint));
@@ -587,6 +609,7 @@ void ConstraintEngine::add(const PropagatorId propagator){
 
   void ConstraintEngine::notifyDeactivated(const ConstrainedVariableId var){
     check_error(!Entity::isPurging());
+    invalidateTrailLevel();
     check_error(var.isValid() && !var->isActive());
 
     for(PropagatorSet::const_iterator it = m_propagators.begin(); it != m_propagators.end(); ++it){
@@ -602,6 +625,7 @@ void ConstraintEngine::add(const PropagatorId propagator){
 
   void ConstraintEngine::notifyActivated(const ConstrainedVariableId var){
     check_error(!Entity::isPurging());
+    invalidateTrailLevel();
     check_error(var.isValid() && var->isActive());
 
     for(PropagatorSet::const_iterator it = m_propagators.begin(); it != m_propagators.end(); ++it){
@@ -701,7 +725,11 @@ void ConstraintEngine::add(const PropagatorId propagator){
         
         debugMsg("ConstraintEngine:propagate",
                  "Executing " << activePropagator->getName() << " propagator.");
+        if(m_profiler != NULL)
+          m_profiler->beginPropagator(activePropagator);
         activePropagator->execute();
+        if(m_profiler != NULL)
+          m_profiler->endPropagator();
         activePropagator = getNextPropagator();
       }
 
@@ -776,15 +804,25 @@ void ConstraintEngine::notify(const ConstrainedVariableId source,
 
   m_dirty = true;
 
+  if(m_profiler != NULL)
+    m_profiler->notifyChanged(changeType);
+
   // If variable is inavtice, no impact.
   if(!source->isActive())
     return;
 
+  if(changeType == DomainListener::CLOSED || changeType == DomainListener::OPENED)
+    invalidateTrailLevel();
+
   if(changeType == DomainListener::EMPTIED)
     handleEmpty(source);
   else if (changeType == DomainListener::RELAXED ||
-           changeType == DomainListener::OPENED)
-    handleRelax(source);
+           changeType == DomainListener::OPENED) {
+    // When restoring a trail level, relaxations are not spread to linked variables since every
+    // domain changed within the level is put back directly.
+    if(!m_restoringTrail)
+      handleRelax(source);
+  }
   else
     handleRestrict(source);
 
@@ -796,6 +834,7 @@ void ConstraintEngine::notify(const ConstrainedVariableId source,
     unsigned int argIndex = it->second;
     if(constraint->isActive() &&
        changeType != DomainListener::EMPTIED &&
+       constraint->wakesOn(changeType) &&
        !constraint->canIgnore(source, argIndex, changeType))
       constraint->getPropagator()->handleNotification(source, argIndex, constraint, changeType);
   }
@@ -910,8 +949,17 @@ void ConstraintEngine::notify(const ConstrainedVariableId source,
 
     publish(notifyExecuted(constraint));
 
+    if(m_trailStamp != 0)
+      trail(constraint->getScope());
+
     debugMsg("ConstraintEngine:execute", "BEFORE " << constraint->toLongString());
-    constraint->execute();
+    if(m_profiler != NULL) {
+      m_profiler->beginConstraint(constraint);
+      constraint->execute();
+      m_profiler->endConstraint();
+    }
+    else
+      constraint->execute();
     debugMsg("ConstraintEngine:execute", "AFTER " << constraint->toLongString());
   }
 
@@ -925,8 +973,17 @@ void ConstraintEngine::notify(const ConstrainedVariableId source,
     check_error(constraint->isValid());
     check_error(m_propInProgress);
     publish(notifyExecuted(constraint));
+    if(m_trailStamp != 0)
+      trail(constraint->getScope());
+
     debugMsg("ConstraintEngine:execute", constraint->getName() << "(" << constraint->getKey() << ")");
-    constraint->execute(variable, argIndex, changeType);
+    if(m_profiler != NULL) {
+      m_profiler->beginConstraint(constraint);
+      constraint->execute(variable, argIndex, changeType);
+      m_profiler->endConstraint();
+    }
+    else
+      constraint->execute(variable, argIndex, changeType);
   }
 
   void ConstraintEngine::incrementCycle(){
@@ -1050,6 +1107,27 @@ const PropagatorId ConstraintEngine::getPropagatorByName(const std::string& name
       m_violationMgr->setMaxViolationsAllowed(0);
   }
 
+  bool ConstraintEngine::getPropagationProfiling() const
+  {
+    return m_profiler != NULL;
+  }
+
+  void ConstraintEngine::setPropagationProfiling(bool v)
+  {
+    checkError(!m_propInProgress, "Cannot turn profiling on or off while propagating.");
+    if(v && m_profiler == NULL)
+      m_profiler = new PropagationProfiler();
+    else if(!v) {
+      delete m_profiler;
+      m_profiler = NULL;
+    }
+  }
+
+  std::string ConstraintEngine::getPropagationProfile() const
+  {
+    return (m_profiler != NULL ? m_profiler->toString() : "");
+  }
+
   double ConstraintEngine::getViolation() const
   {
     return m_violationMgr->getViolation();
@@ -1083,6 +1161,166 @@ const PropagatorId ConstraintEngine::getPropagatorByName(const std::string& name
 
   bool ConstraintEngine::isRelaxed() const {return !m_relaxed.empty();}
 
+  void ConstraintEngine::pushTrailLevel(){
+    checkError(!m_restoringTrail, "Cannot open a trail level while restoring one.");
+    m_trailStamp = ++m_lastTrailStamp;
+    m_trailLevels.push_back(TrailLevel(m_trailStamp, m_trail.size()));
+    debugMsg("ConstraintEngine:trail", "Opened trail level " << m_trailLevels.size());
+  }
+
+  unsigned int ConstraintEngine::getTrailDepth() const {return m_trailLevels.size();}
+
+  bool ConstraintEngine::canRestoreTrailLevel() const {
+    checkError(!m_trailLevels.empty(), "No trail level is open.");
+    return m_trailLevels.back().m_restorable && !getAllowViolations();
+  }
+
+  void ConstraintEngine::beginTrailRestore(){
+    checkError(canRestoreTrailLevel(), "Cannot restore trail level " << m_trailLevels.size());
+    checkError(!m_propInProgress, "Cannot restore a trail level during propagation.");
+    m_restoringTrail = true;
+  }
+
+  void ConstraintEngine::restoreTrailLevel(){
+    checkError(m_restoringTrail, "Must begin a trail restore before restoring.");
+
+    // Any variable emptied within the level is about to be put back.
+    clearEmptyVariables();
+
+    // Work back through the level, putting each domain back and then the stamp the variable held before
+    // it was recorded, so that it is only recorded again by a level which has not yet recorded it. Anything
+    // changed while restoring is recorded in this level as usual, and so is put back too. Events raised here
+    // queue the constraints on each restored variable, which keeps propagators holding state of their own in step.
+    const unsigned int start = m_trailLevels.back().m_start;
+    debugMsg("ConstraintEngine:trail",
+             "Restoring " << m_trail.size() - start << " domains for trail level " << m_trailLevels.size());
+    while(m_trail.size() > start){
+      const TrailEntry entry = m_trail.back();
+      m_trail.pop_back();
+      checkError(entry.m_variable.isValid(), "Variable recorded in a restorable trail level has been removed.");
+
+      Domain& current = entry.m_variable->getCurrentDomain();
+      const Domain& recorded = *entry.m_domain;
+      if(current != recorded){
+        if(!current.isEmpty() && recorded.isSubsetOf(current))
+          current.intersect(recorded);
+        else if(current.isEmpty() || current.isSubsetOf(recorded))
+          current.relax(recorded);
+        else {
+          current.relax(entry.m_variable->baseDomain());
+          current.intersect(recorded);
+        }
+      }
+      entry.m_variable->m_trailStamp = entry.m_stamp;
+      delete entry.m_domain;
+    }
+    clearEmptyVariables();
+
+    m_trailLevels.pop_back();
+    m_trailStamp = (m_trailLevels.empty() ? 0 : m_trailLevels.back().m_stamp);
+    m_restoringTrail = false;
+
+    // Domains have been relaxed, if not through handleRelax, so record the repropagation for clients
+    // which cache results between relaxations.
+    incrementCycle();
+    m_mostRecentRepropagation = m_cycleCount;
+  }
+
+  void ConstraintEngine::popTrailLevel(bool keepChanges){
+    checkError(!m_trailLevels.empty(), "No trail level is open.");
+    checkError(!m_restoringTrail, "Cannot pop a trail level while restoring it.");
+
+    const unsigned int start = m_trailLevels.back().m_start;
+    // Variables recorded here may since have been removed, so their stamps are left alone. They will be
+    // recorded again the next time they change, which is safe since the earliest record is restored.
+    for(std::vector<TrailEntry>::const_iterator it = m_trail.begin() + start; it != m_trail.end(); ++it)
+      delete it->m_domain;
+    m_trail.erase(m_trail.begin() + start, m_trail.end());
+
+    m_trailLevels.pop_back();
+    m_trailStamp = (m_trailLevels.empty() ? 0 : m_trailLevels.back().m_stamp);
+    if(keepChanges)
+      invalidateTrailLevel();
+    debugMsg("ConstraintEngine:trail", "Popped trail level " << m_trailLevels.size() + 1);
+  }
+
+  void ConstraintEngine::getConflictLevels(const std::vector<ConstrainedVariableId>& variables,
+                                           std::set<unsigned int>& levels) const {
+    // Gather the variables connected to the conflict
+    std::set<ConstrainedVariableId> conflict;
+    std::vector<ConstrainedVariableId> pending(variables);
+    const ConstrainedVariableSet& emptied = getViolationMgr().getEmptyVariables();
+    pending.insert(pending.end(), emptied.begin(), emptied.end());
+    while(!pending.empty()){
+      const ConstrainedVariableId variable = pending.back();
+      pending.pop_back();
+      if(!conflict.insert(variable).second)
+        continue;
+
+      std::set<ConstraintId> constraints;
+      variable->constraints(constraints);
+      for(std::set<ConstraintId>::const_iterator it = constraints.begin(); it != constraints.end(); ++it){
+        const std::vector<ConstrainedVariableId>& scope = (*it)->getScope();
+        for(std::vector<ConstrainedVariableId>::const_iterator vit = scope.begin(); vit != scope.end(); ++vit)
+          if(conflict.find(*vit) == conflict.end())
+            pending.push_back(*vit);
+      }
+    }
+
+    unsigned int end = m_trail.size();
+    for(unsigned int level = m_trailLevels.size(); level > 0; level--){
+      const TrailLevel& trailLevel = m_trailLevels[level - 1];
+      bool contributed = !trailLevel.m_restorable;
+      for(unsigned int i = trailLevel.m_start; i < end && !contributed; i++)
+        contributed = (conflict.find(m_trail[i].m_variable) != conflict.end());
+      if(contributed)
+        levels.insert(level);
+      end = trailLevel.m_start;
+    }
+
+    debugMsg("ConstraintEngine:getConflictLevels",
+             levels.size() << " of " << m_trailLevels.size() << " trail levels contributed to a conflict over " <<
+             conflict.size() << " variables");
+  }
+
+  void ConstraintEngine::trail(const ConstrainedVariableId variable){
+    if(variable->m_deleted)
+      return;
+
+    const unsigned int previousStamp = variable->m_trailStamp;
+    variable->m_trailStamp = m_trailStamp;
+    if(m_trailStamp == 0)
+      return;
+
+    if(variable->m_oldestTrailStamp == 0 || m_trailStamp < variable->m_oldestTrailStamp)
+      variable->m_oldestTrailStamp = m_trailStamp;
+
+    // A dynamic domain may grow as well as shrink, so it is not recorded
+    const Domain& domain = variable->lastDomain();
+    if(domain.isOpen()){
+      invalidateTrailLevel();
+      return;
+    }
+
+    m_trail.push_back(TrailEntry(variable, domain.copy(), previousStamp));
+  }
+
+  void ConstraintEngine::trail(const std::vector<ConstrainedVariableId>& scope){
+    for(std::vector<ConstrainedVariableId>::const_iterator it = scope.begin(); it != scope.end(); ++it){
+      const ConstrainedVariableId variable = *it;
+      if(variable->m_trailStamp != m_trailStamp)
+        trail(variable);
+    }
+  }
+
+  void ConstraintEngine::invalidateTrailLevel(){
+    if(m_trailLevels.empty() || m_restoringTrail)
+      return;
+    condDebugMsg(m_trailLevels.back().m_restorable, "ConstraintEngine:trail",
+                 "Trail level " << m_trailLevels.size() << " can no longer be restored");
+    m_trailLevels.back().m_restorable = false;
+  }
+
   PSVariable* ConstraintEngine::getVariableByKey(PSEntityKey id)
   {
     ConstrainedVariableId entity = Entity::getEntity(id);
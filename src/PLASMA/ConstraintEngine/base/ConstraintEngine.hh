@@ -15,9 +15,11 @@
 #include "Entity.hh"
 #include "Propagator.hh"
 #include "ConstrainedVariable.hh"
+#include "PropagationProfiler.hh"
 
 #include <set>
 #include <map>
+#include <vector>
 #include <string>
 
 namespace EUROPA {
@@ -281,6 +283,28 @@ typedef Id<ConstraintEngineListener> ConstraintEngineListenerId;
      */
     virtual bool getAllowViolations() const;
 
+    /**
+     * @brief Start or stop collecting execution counts and times for constraints and propagators.
+     * Stopping discards whatever has been collected. Can not be called while propagating.
+     * @see PropagationProfiler
+     */
+    virtual void setPropagationProfiling(bool v);
+
+    /**
+     * @see setPropagationProfiling
+     */
+    virtual bool getPropagationProfiling() const;
+
+    /**
+     * @brief The profiler collecting counts, or 0 if profiling is off.
+     */
+    const PropagationProfiler* getPropagationProfiler() const {return m_profiler;}
+
+    /**
+     * @brief A report of the counts collected since profiling was turned on, with the most expensive first.
+     */
+    virtual std::string getPropagationProfile() const;
+
     /**
      * @brief returns total violation in the constraint engine
      */
@@ -306,6 +330,58 @@ typedef Id<ConstraintEngineListener> ConstraintEngineListenerId;
      */
     bool isRelaxed() const;
 
+    /**
+     * @brief Open a trail level. While it is open, the first change to the current domain of each variable
+     * records the domain held beforehand, so that the changes made since can be undone by restoreTrailLevel()
+     * without relaxing and repropagating the network.
+     * @see restoreTrailLevel, popTrailLevel
+     */
+    void pushTrailLevel();
+
+    /**
+     * @brief The number of open trail levels.
+     */
+    unsigned int getTrailDepth() const;
+
+    /**
+     * @brief Test if the innermost trail level can be restored. It can not if, since it was opened,
+     * variables or constraints have been added, removed, activated or deactivated, a base domain has been
+     * changed, or an open domain has been recorded. Nor can it if violations are allowed.
+     */
+    bool canRestoreTrailLevel() const;
+
+    /**
+     * @brief Start restoring the innermost trail level. Until restoreTrailLevel() is called, relaxations
+     * are not propagated to linked variables, since every domain changed within the level will be put back
+     * directly.
+     * @pre canRestoreTrailLevel()
+     */
+    void beginTrailRestore();
+
+    /**
+     * @brief Put every domain recorded in the innermost trail level back the way it was when the level was
+     * opened, and close the level. The constraints on restored variables are queued for propagation.
+     * @pre beginTrailRestore() has been called.
+     */
+    void restoreTrailLevel();
+
+    /**
+     * @brief Close the innermost trail level without restoring it.
+     * @param keepChanges true if the changes made within the level are to be kept, rather than having been
+     * undone by relaxation. The enclosing level can then no longer be restored either.
+     */
+    void popTrailLevel(bool keepChanges = false);
+
+    /**
+     * @brief Find the open trail levels which may have contributed to a conflict. The conflict is taken to
+     * span every variable connected through constraints to the variables emptied by propagation, if any, and
+     * to the given variables. A level contributed if it changed one of their domains, or made a change the
+     * trail can not undo, such as adding a variable or constraint.
+     * @param variables Variables in the conflict besides those emptied by propagation.
+     * @param levels Receives the depths of the contributing levels, 1 being the outermost.
+     */
+    void getConflictLevels(const std::vector<ConstrainedVariableId>& variables, std::set<unsigned int>& levels) const;
+
     const CESchemaId getCESchema() const;
 
     // PSConstraintEngine methods
@@ -488,6 +564,25 @@ typedef Id<ConstraintEngineListener> ConstraintEngineListenerId;
      */
     void remove(const ConstrainedVariableId variable);
 
+    /**
+     * @brief Called by ConstrainedVariable before its current domain is changed, when it has not yet recorded
+     * its domain in the innermost trail level.
+     * @see ConstrainedVariable::trail()
+     */
+    void trail(const ConstrainedVariableId variable);
+
+    /**
+     * @brief Record the scope of a constraint about to be executed. Constraints may hold references to the
+     * current domains of their variables, so changes made through them do not pass through the variables.
+     */
+    void trail(const std::vector<ConstrainedVariableId>& scope);
+
+    /**
+     * @brief Record that the innermost trail level has made a change that can not be restored from the trail.
+     * @see canRestoreTrailLevel()
+     */
+    void invalidateTrailLevel();
+
     /**
      * @brief Called by ConstraintEngineListener constructor.
      * @param listener The listener to add
@@ -573,6 +668,36 @@ typedef Id<ConstraintEngineListener> ConstraintEngineListenerId;
 
     const CESchemaId m_schema;
     std::list<PostPropagationCallbackId> m_callbacks; /*!< Post-propagation callbacks */
+
+    /**
+     * @brief An open trail level.
+     */
+    struct TrailLevel {
+      TrailLevel(unsigned int stamp, unsigned int start)
+        : m_stamp(stamp), m_start(start), m_restorable(true) {}
+      unsigned int m_stamp; /*!< Identifies the level to variables which have recorded a domain in it. */
+      unsigned int m_start; /*!< Position in the trail of the first domain recorded in the level. */
+      bool m_restorable; /*!< False once a change is made which the trail can not undo. */
+    };
+
+    /**
+     * @brief A domain recorded in a trail level.
+     */
+    struct TrailEntry {
+      TrailEntry(const ConstrainedVariableId variable, Domain* domain, unsigned int stamp)
+        : m_variable(variable), m_domain(domain), m_stamp(stamp) {}
+      ConstrainedVariableId m_variable;
+      Domain* m_domain; /*!< Copy of the domain before the variable was first changed in the level. */
+      unsigned int m_stamp; /*!< Stamp held by the variable before it was recorded. */
+    };
+
+    std::vector<TrailEntry> m_trail; /*!< Domains recorded, in order, across all open levels. */
+    std::vector<TrailLevel> m_trailLevels; /*!< Open trail levels, innermost last. */
+    unsigned int m_trailStamp; /*!< Stamp of the innermost level, or 0 if none is open. */
+    unsigned int m_lastTrailStamp; /*!< A monotonically increasing count of the levels opened. */
+    bool m_restoringTrail; /*!< True between beginTrailRestore() and the end of restoreTrailLevel(). */
+
+    PropagationProfiler* m_profiler; /*!< Collects counts while propagation profiling is on, 0 otherwise. */
   };
 
   /**
@@ -38,6 +38,7 @@
 #include "ConstraintEngineDefs.hh"
 #include "DomainListener.hh"
 #include "Number.hh"
+#include "SlabAllocator.hh"
 #include <list>
 #include <string>
 
@@ -99,6 +100,12 @@ class LabelStr;
      */
     virtual ~Domain();
 
+    /**
+     * @brief Domains are allocated through the SlabAllocator, alongside the variables holding them.
+     */
+    static void* operator new(size_t size) {return SlabAllocator::allocate(size);}
+    static void operator delete(void* ptr, size_t size) {SlabAllocator::deallocate(ptr, size);}
+
     /**
      * @brief Check if the domain is an enumerated set.
      */
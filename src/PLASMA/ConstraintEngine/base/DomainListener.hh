@@ -62,6 +62,18 @@ namespace EUROPA{
 
     static std::string toString(const ChangeType& changeType);
 
+    /**
+     * @brief A set of ChangeTypes, one bit per type.
+     * @see toMask()
+     */
+    typedef unsigned int ChangeTypeMask;
+
+    static const ChangeTypeMask ALL_CHANGES = (1u << EVENT_COUNT) - 1;
+
+    inline static ChangeTypeMask toMask(const ChangeType& changeType){
+      return 1u << changeType;
+    }
+
     /**
      * @brief Utility to test if an event is a restriction
      * @note Assumes that restriction events are defined earlier
@@ -29,6 +29,10 @@ namespace EUROPA {
   	  virtual bool getAllowViolations() const = 0;
   	  virtual void setAllowViolations(bool v) = 0;
 
+  	  virtual bool getPropagationProfiling() const = 0;
+  	  virtual void setPropagationProfiling(bool v) = 0;
+  	  virtual std::string getPropagationProfile() const = 0;
+
   	  virtual double getViolation() const = 0;
   	  virtual PSList<std::string> getViolationExpl() const = 0;
   	  virtual PSList<PSConstraint*> getAllViolations() const = 0;
@@ -0,0 +1,165 @@
+#include "PropagationProfiler.hh"
+#include "Constraint.hh"
+#include "Propagator.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <sys/time.h>
+#include <time.h>
+
+namespace EUROPA {
+
+  namespace {
+    double now() {
+#ifdef CLOCK_MONOTONIC
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+    }
+
+    void accumulate(PropagationProfiler::Counts& counts, double seconds, unsigned long changes, bool emptied) {
+      counts.executions++;
+      counts.seconds += seconds;
+      counts.reductions += changes;
+      if(changes == 0)
+        counts.noOps++;
+      if(emptied)
+        counts.emptied++;
+    }
+
+    template <class Key>
+    bool moreTime(const std::pair<Key, PropagationProfiler::Counts>& a,
+                  const std::pair<Key, PropagationProfiler::Counts>& b) {
+      return a.second.seconds > b.second.seconds;
+    }
+
+    template <class Key>
+    std::vector<std::pair<Key, PropagationProfiler::Counts> > byTime(const std::map<Key, PropagationProfiler::Counts>& counts) {
+      std::vector<std::pair<Key, PropagationProfiler::Counts> > result(counts.begin(), counts.end());
+      std::stable_sort(result.begin(), result.end(), moreTime<Key>);
+      return result;
+    }
+
+    void writeHeader(std::ostream& os, const std::string& title) {
+      os << title << std::endl
+         << std::setw(40) << std::left << "name" << std::right
+         << std::setw(12) << "executions"
+         << std::setw(12) << "seconds"
+         << std::setw(12) << "us/exec"
+         << std::setw(12) << "reductions"
+         << std::setw(10) << "no-op %"
+         << std::setw(10) << "emptied" << std::endl;
+    }
+
+    void writeCounts(std::ostream& os, const std::string& name, const PropagationProfiler::Counts& counts) {
+      os << std::setw(40) << std::left << name << std::right
+         << std::setw(12) << counts.executions
+         << std::setw(12) << std::fixed << std::setprecision(6) << counts.seconds
+         << std::setw(12) << std::setprecision(3) << (counts.executions > 0 ? 1e6 * counts.seconds / counts.executions : 0)
+         << std::setw(12) << counts.reductions
+         << std::setw(10) << std::setprecision(1) << (counts.executions > 0 ? 100.0 * counts.noOps / counts.executions : 0)
+         << std::setw(10) << counts.emptied << std::endl;
+    }
+  }
+
+  PropagationProfiler::PropagationProfiler()
+    : m_instance(0), m_type(0), m_constraintStart(0), m_propagatorStart(0), m_changes(0), m_propagatorChanges(0),
+      m_emptied(false), m_propagatorEmptied(false) {}
+
+  void PropagationProfiler::reset() {
+    checkError(m_instance == 0 && m_propagator.isNoId(), "Cannot reset the profiler while propagating.");
+    m_types.clear();
+    m_instances.clear();
+    m_instanceNames.clear();
+    m_propagators.clear();
+  }
+
+  void PropagationProfiler::beginConstraint(const ConstraintId constraint) {
+    checkError(m_instance == 0, "Already executing a constraint.");
+
+    // Find the entries to accumulate into now, since the constraint may be deleted as it executes
+    const eint key = constraint->getKey();
+    std::map<eint, Counts>::iterator it = m_instances.find(key);
+    if(it == m_instances.end()) {
+      it = m_instances.insert(std::make_pair(key, Counts())).first;
+      std::ostringstream name;
+      name << constraint->getName() << "(" << key << ")";
+      m_instanceNames.insert(std::make_pair(key, name.str()));
+    }
+    m_instance = &(it->second);
+    m_type = &(m_types[constraint->getName()]);
+
+    m_propagatorChanges += m_changes;
+    m_propagatorEmptied = m_propagatorEmptied || m_emptied;
+    m_changes = 0;
+    m_emptied = false;
+    m_constraintStart = now();
+  }
+
+  void PropagationProfiler::endConstraint() {
+    double seconds = now() - m_constraintStart;
+    checkError(m_instance != 0, "Not executing a constraint.");
+    accumulate(*m_type, seconds, m_changes, m_emptied);
+    accumulate(*m_instance, seconds, m_changes, m_emptied);
+
+    m_propagatorChanges += m_changes;
+    m_propagatorEmptied = m_propagatorEmptied || m_emptied;
+    m_changes = 0;
+    m_emptied = false;
+    m_instance = 0;
+    m_type = 0;
+  }
+
+  void PropagationProfiler::beginPropagator(const PropagatorId propagator) {
+    checkError(m_propagator.isNoId(), "Already in " << m_propagator->getName());
+    m_propagator = propagator;
+    m_changes = 0;
+    m_emptied = false;
+    m_propagatorChanges = 0;
+    m_propagatorEmptied = false;
+    m_propagatorStart = now();
+  }
+
+  void PropagationProfiler::endPropagator() {
+    double seconds = now() - m_propagatorStart;
+    checkError(m_propagator.isId(), "Not in a propagator.");
+    accumulate(m_propagators[m_propagator->getName()], seconds,
+               m_propagatorChanges + m_changes, m_propagatorEmptied || m_emptied);
+    m_changes = 0;
+    m_emptied = false;
+    m_propagator = PropagatorId::noId();
+  }
+
+  std::string PropagationProfiler::toString(unsigned int maxInstances) const {
+    std::ostringstream os;
+
+    writeHeader(os, "Propagators");
+    std::vector<std::pair<std::string, Counts> > propagators = byTime(m_propagators);
+    for(std::vector<std::pair<std::string, Counts> >::const_iterator it = propagators.begin(); it != propagators.end(); ++it)
+      writeCounts(os, it->first, it->second);
+
+    os << std::endl;
+    writeHeader(os, "Constraint types");
+    std::vector<std::pair<std::string, Counts> > types = byTime(m_types);
+    for(std::vector<std::pair<std::string, Counts> >::const_iterator it = types.begin(); it != types.end(); ++it)
+      writeCounts(os, it->first, it->second);
+
+    os << std::endl;
+    writeHeader(os, "Constraint instances");
+    std::vector<std::pair<eint, Counts> > instances = byTime(m_instances);
+    if(instances.size() > maxInstances)
+      instances.resize(maxInstances);
+    for(std::vector<std::pair<eint, Counts> >::const_iterator it = instances.begin(); it != instances.end(); ++it)
+      writeCounts(os, m_instanceNames.find(it->first)->second, it->second);
+
+    return os.str();
+  }
+}
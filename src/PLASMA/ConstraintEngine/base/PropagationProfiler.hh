@@ -0,0 +1,101 @@
+#ifndef H_PropagationProfiler
+#define H_PropagationProfiler
+
+/**
+ * @file PropagationProfiler.hh
+ * @brief Collects execution counts and times for constraints and propagators.
+ */
+
+#include "ConstraintEngineDefs.hh"
+#include "DomainListener.hh"
+
+#include <map>
+#include <string>
+
+namespace EUROPA {
+
+  /**
+   * @class PropagationProfiler
+   * @brief Accumulates, for each constraint type, each constraint instance and each propagator, how often
+   * it was executed, how long that took, how many domain reductions it made and how many of its executions
+   * changed nothing.
+   *
+   * The ConstraintEngine owns a profiler only while profiling is enabled, and otherwise pays a single test
+   * of a null pointer for each hook.
+   * @see ConstraintEngine::setPropagationProfiling()
+   */
+  class PropagationProfiler {
+  public:
+    /**
+     * @brief Counts accumulated for a constraint type, a constraint instance or a propagator.
+     */
+    struct Counts {
+      Counts() : executions(0), noOps(0), reductions(0), emptied(0), seconds(0) {}
+      unsigned long executions;
+      unsigned long noOps; /*!< Executions which did not change any domain. */
+      unsigned long reductions; /*!< Domain changes, other than relaxations, made while executing. */
+      unsigned long emptied; /*!< Executions which emptied a domain. */
+      double seconds; /*!< Wall time spent executing. */
+    };
+
+    PropagationProfiler();
+
+    /**
+     * @brief Discard everything collected so far.
+     */
+    void reset();
+
+    /**
+     * @brief Called by the ConstraintEngine before and after it executes a constraint.
+     */
+    void beginConstraint(const ConstraintId constraint);
+    void endConstraint();
+
+    /**
+     * @brief Called by the ConstraintEngine before and after it gives control to a propagator.
+     */
+    void beginPropagator(const PropagatorId propagator);
+    void endPropagator();
+
+    /**
+     * @brief Called by the ConstraintEngine for every domain change.
+     */
+    inline void notifyChanged(const DomainListener::ChangeType& changeType) {
+      if(changeType == DomainListener::RELAXED || changeType == DomainListener::RESET ||
+         changeType == DomainListener::OPENED || changeType == DomainListener::CLOSED)
+        return;
+      m_changes++;
+      if(changeType == DomainListener::EMPTIED)
+        m_emptied = true;
+    }
+
+    const std::map<std::string, Counts>& getConstraintTypes() const {return m_types;}
+    const std::map<eint, Counts>& getConstraintInstances() const {return m_instances;}
+    const std::map<std::string, Counts>& getPropagators() const {return m_propagators;}
+
+    /**
+     * @brief Report propagators, constraint types and the most expensive constraint instances, each
+     * in decreasing order of time spent.
+     * @param maxInstances The number of constraint instances to include.
+     */
+    std::string toString(unsigned int maxInstances = 20) const;
+
+  private:
+    std::map<std::string, Counts> m_types;
+    std::map<eint, Counts> m_instances;
+    std::map<eint, std::string> m_instanceNames;
+    std::map<std::string, Counts> m_propagators;
+
+    Counts* m_instance; /*!< Counts for the constraint being executed, if any. */
+    Counts* m_type; /*!< Counts for the type of the constraint being executed. */
+    PropagatorId m_propagator; /*!< The propagator in control, if any. */
+    double m_constraintStart;
+    double m_propagatorStart;
+    unsigned long m_changes; /*!< Reductions made by the constraint being executed. */
+    unsigned long m_propagatorChanges; /*!< Reductions made by the propagator in control, before the current constraint. */
+    bool m_emptied;
+    bool m_propagatorEmptied;
+  };
+}
+
+#endif
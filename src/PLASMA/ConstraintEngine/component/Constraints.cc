@@ -8,14 +8,241 @@
 #include "CESchema.hh"
 #include <algorithm>
 #include <cmath>
+#include <typeinfo>
 
 namespace EUROPA {
 
+  /**
+   * Kernels for constraints over plain interval domains. A constraint whose scope is all IntervalDomain or
+   * IntervalIntDomain (exactly - subclasses such as BoolDomain may change the semantics) selects one of these at
+   * construction time. Every domain call is then qualified, so it is bound statically and can be inlined, and sums are
+   * computed on the underlying doubles rather than through the checked edouble operators.
+   */
+  namespace IntervalKernels {
+
+    enum IntervalClass {
+      OTHER_DOMAIN = 0,
+      REAL_INTERVAL,
+      INT_INTERVAL
+    };
+
+    IntervalClass intervalClass(const Domain& dom) {
+      if (typeid(dom) == typeid(IntervalDomain))
+        return REAL_INTERVAL;
+      if (typeid(dom) == typeid(IntervalIntDomain))
+        return INT_INTERVAL;
+      return OTHER_DOMAIN;
+    }
+
+    /**
+     * @brief As Infinity::plus, on raw doubles.
+     */
+    inline double plus(double n1, double n2, double defaultValue) {
+      static const double sl_inf = cast_double(PLUS_INFINITY);
+      if (std::abs(n1) >= sl_inf || std::abs(n2) >= sl_inf)
+        return defaultValue;
+      double retval = n1 + n2;
+      if (std::abs(retval) >= sl_inf)
+        return defaultValue;
+      return retval;
+    }
+
+    /**
+     * @brief As Infinity::minus, on raw doubles.
+     */
+    inline double minus(double n1, double n2, double defaultValue) {
+      return plus(n1, -n2, defaultValue);
+    }
+
+    template <class X, class Y, class Z>
+    struct AddEqual {
+      static void run(Domain& xDom, Domain& yDom, Domain& zDom) {
+        X& x = static_cast<X&>(xDom);
+        Y& y = static_cast<Y&>(yDom);
+        Z& z = static_cast<Z&>(zDom);
+
+        if (x.isOpen() || y.isOpen() || z.isOpen())
+          return;
+
+        edouble bound1, bound2;
+        x.X::getBounds(bound1, bound2);
+        double xMin = cast_double(bound1), xMax = cast_double(bound2);
+        y.Y::getBounds(bound1, bound2);
+        double yMin = cast_double(bound1), yMax = cast_double(bound2);
+        z.Z::getBounds(bound1, bound2);
+        double zMin = cast_double(bound1), zMax = cast_double(bound2);
+
+        // Process Z
+        double xMax_plus_yMax = plus(xMax, yMax, zMax);
+        if (zMax > xMax_plus_yMax)
+          zMax = cast_double(z.Z::translateNumber(xMax_plus_yMax, false));
+
+        double xMin_plus_yMin = plus(xMin, yMin, zMin);
+        if (zMin < xMin_plus_yMin)
+          zMin = cast_double(z.Z::translateNumber(xMin_plus_yMin, true));
+
+        if (z.Z::intersect(zMin, zMax) && z.Z::isEmpty())
+          return;
+
+        // Process X
+        double zMax_minus_yMin = minus(zMax, yMin, xMax);
+        if (xMax > zMax_minus_yMin)
+          xMax = cast_double(x.X::translateNumber(zMax_minus_yMin, false));
+
+        double zMin_minus_yMax = minus(zMin, yMax, xMin);
+        if (xMin < zMin_minus_yMax)
+          xMin = cast_double(x.X::translateNumber(zMin_minus_yMax, true));
+
+        if (x.X::intersect(xMin, xMax) && x.X::isEmpty())
+          return;
+
+        // Process Y
+        double yMaxCandidate = minus(zMax, xMin, yMax);
+        if (yMax > yMaxCandidate)
+          yMax = cast_double(y.Y::translateNumber(yMaxCandidate, false));
+
+        double yMinCandidate = minus(zMin, xMax, yMin);
+        if (yMin < yMinCandidate)
+          yMin = cast_double(y.Y::translateNumber(yMinCandidate, true));
+
+        if (y.Y::intersect(yMin, yMax) && y.Y::isEmpty())
+          return;
+
+        // See AddEqualConstraint::handleExecute() for this rounding check
+        if (!z.Z::isMember(plus(yMax, xMin, zMin)) || !z.Z::isMember(plus(yMin, xMax, zMin)))
+          z.Z::empty();
+      }
+    };
+
+    template <class X, class Y>
+    struct LessThanEqual {
+      static void run(Domain& xDom, Domain& yDom) {
+        X& x = static_cast<X&>(xDom);
+        Y& y = static_cast<Y&>(yDom);
+
+        if (x.isOpen() || y.isOpen())
+          return;
+
+        check_error(!x.X::isEmpty() && !y.Y::isEmpty());
+
+        edouble xLb, xUb, yLb, yUb;
+        x.X::getBounds(xLb, xUb);
+        y.Y::getBounds(yLb, yUb);
+
+        // Restrict X to be no larger than Y's max
+        if (x.X::intersect(xLb, yUb) && x.X::isEmpty())
+          return;
+
+        // Restrict Y to be at least X's min
+        x.X::getBounds(xLb, xUb);
+        y.Y::getBounds(yLb, yUb);
+        y.Y::intersect(xLb, yUb);
+      }
+    };
+
+    template <class X, class Y>
+    struct LessThan {
+      static void run(Domain& xDom, Domain& yDom) {
+        X& x = static_cast<X&>(xDom);
+        Y& y = static_cast<Y&>(yDom);
+
+        if (x.isOpen() || y.isOpen())
+          return;
+
+        edouble xLb, xUb, yLb, yUb;
+        x.X::getBounds(xLb, xUb);
+        y.Y::getBounds(yLb, yUb);
+        if (xUb >= yUb && yUb < PLUS_INFINITY &&
+            x.X::intersect(xLb, yUb - x.minDelta()) &&
+            x.X::isEmpty())
+          return;
+
+        x.X::getBounds(xLb, xUb);
+        y.Y::getBounds(yLb, yUb);
+        if (yLb <= xLb && xLb > MINUS_INFINITY &&
+            y.Y::intersect(xLb + y.minDelta(), yUb) &&
+            y.Y::isEmpty())
+          return;
+
+        // Special handling for singletons, which could be infinite
+        if (x.X::isSingleton() && y.Y::isSingleton() && x.X::getSingletonValue() >= y.Y::getSingletonValue())
+          x.X::empty();
+      }
+    };
+
+    template <class X, class Y>
+    struct Equal {
+      static void run(Domain& xDom, Domain& yDom) {
+        X& x = static_cast<X&>(xDom);
+        Y& y = static_cast<Y&>(yDom);
+
+        // As IntervalDomain::equate()
+        edouble lb, ub;
+        y.Y::getBounds(lb, ub);
+        x.X::intersect(lb, ub);
+        if (!x.X::isEmpty()) {
+          x.X::getBounds(lb, ub);
+          y.Y::intersect(lb, ub);
+        }
+      }
+    };
+
+    template <template <class, class> class Kernel, class X>
+    BinaryIntervalKernel select(IntervalClass y) {
+      switch (y) {
+      case REAL_INTERVAL: return &Kernel<X, IntervalDomain>::run;
+      case INT_INTERVAL: return &Kernel<X, IntervalIntDomain>::run;
+      default: return 0;
+      }
+    }
+
+    /**
+     * @brief The kernel for the given domains, or 0 if they are not all plain intervals.
+     */
+    template <template <class, class> class Kernel>
+    BinaryIntervalKernel select(const Domain& x, const Domain& y) {
+      switch (intervalClass(x)) {
+      case REAL_INTERVAL: return select<Kernel, IntervalDomain>(intervalClass(y));
+      case INT_INTERVAL: return select<Kernel, IntervalIntDomain>(intervalClass(y));
+      default: return 0;
+      }
+    }
+
+    template <template <class, class, class> class Kernel, class X, class Y>
+    TernaryIntervalKernel select(IntervalClass z) {
+      switch (z) {
+      case REAL_INTERVAL: return &Kernel<X, Y, IntervalDomain>::run;
+      case INT_INTERVAL: return &Kernel<X, Y, IntervalIntDomain>::run;
+      default: return 0;
+      }
+    }
+
+    template <template <class, class, class> class Kernel, class X>
+    TernaryIntervalKernel select(IntervalClass y, IntervalClass z) {
+      switch (y) {
+      case REAL_INTERVAL: return select<Kernel, X, IntervalDomain>(z);
+      case INT_INTERVAL: return select<Kernel, X, IntervalIntDomain>(z);
+      default: return 0;
+      }
+    }
+
+    template <template <class, class, class> class Kernel>
+    TernaryIntervalKernel select(const Domain& x, const Domain& y, const Domain& z) {
+      switch (intervalClass(x)) {
+      case REAL_INTERVAL: return select<Kernel, IntervalDomain>(intervalClass(y), intervalClass(z));
+      case INT_INTERVAL: return select<Kernel, IntervalIntDomain>(intervalClass(y), intervalClass(z));
+      default: return 0;
+      }
+    }
+  }
+
+
   UnaryConstraint::UnaryConstraint(const Domain& dom,
 				   const ConstrainedVariableId var)
     : Constraint("UNARY", "Default", var->getConstraintEngine(), makeScope(var)),
       m_x(dom.copy()),
       m_y(static_cast<Domain*>(& (getCurrentDomain(var)))) {
+    setWakeEvents(DomainListener::toMask(DomainListener::RESET) | DomainListener::toMask(DomainListener::RELAXED));
   }
 
   UnaryConstraint::UnaryConstraint(const std::string& name,
@@ -26,6 +253,7 @@ namespace EUROPA {
       m_x(0),
       m_y(static_cast<Domain*>(& (getCurrentDomain(variables[0])))) {
     checkError(variables.size() == 1, "Invalid arg count. " << toString());
+    setWakeEvents(DomainListener::toMask(DomainListener::RESET) | DomainListener::toMask(DomainListener::RELAXED));
   }
 
   /**
@@ -72,7 +300,8 @@ namespace EUROPA {
     : Constraint(name, propagatorName, constraintEngine, variables),
       m_x(getCurrentDomain(m_variables[X])),
       m_y(getCurrentDomain(m_variables[Y])),
-      m_z(getCurrentDomain(m_variables[Z]))
+      m_z(getCurrentDomain(m_variables[Z])),
+      m_intervalKernel(IntervalKernels::select<IntervalKernels::AddEqual>(m_x, m_y, m_z))
   {
     check_error(variables.size() ==  ARG_COUNT);
   }
@@ -110,6 +339,11 @@ namespace EUROPA {
     check_error(Domain::canBeCompared(m_x, m_z));
     check_error(Domain::canBeCompared(m_z, m_y));
 
+    if (m_intervalKernel != 0) {
+      m_intervalKernel(m_x, m_y, m_z);
+      return;
+    }
+
     // Test preconditions for continued execution.
     if (m_x.isOpen() ||
         m_y.isOpen() ||
@@ -470,7 +704,11 @@ bool updateDivBounds(IntervalDomain& domZ,
 				   const std::string& propagatorName,
 				   const ConstraintEngineId constraintEngine,
 				   const std::vector<ConstrainedVariableId>& variables)
-    : Constraint(name, propagatorName, constraintEngine, variables), m_argCount(variables.size()) {}
+    : Constraint(name, propagatorName, constraintEngine, variables), m_argCount(variables.size()),
+      m_intervalKernel(m_argCount == 2 ?
+                       IntervalKernels::select<IntervalKernels::Equal>(getCurrentDomain(variables[0]),
+                                                                       getCurrentDomain(variables[1])) :
+                       0) {}
 
   /**
    * @brief Restrict all variables to the intersection of their domains.
@@ -480,6 +718,16 @@ bool updateDivBounds(IntervalDomain& domZ,
   void EqualConstraint::handleExecute() {
     check_error(isActive());
 
+    if (m_intervalKernel != 0) {
+      Domain& d1 = getCurrentDomain(m_variables[0]);
+      Domain& d2 = getCurrentDomain(m_variables[1]);
+      // Open intervals are left to equate() to diagnose
+      if (d1.isClosed() && d2.isClosed()) {
+        m_intervalKernel(d1, d2);
+        return;
+      }
+    }
+
     bool changed = false;
     for(unsigned int i = 1; i < m_argCount; i++) {
       ConstrainedVariableId v1 = m_variables[i-1];
@@ -599,14 +847,18 @@ bool SubsetOfConstraint::canIgnore(const ConstrainedVariableId,
 						   const std::vector<ConstrainedVariableId>& variables)
     : Constraint(name, propagatorName, constraintEngine, variables),
       m_x(getCurrentDomain(variables[X])),
-      m_y(getCurrentDomain(variables[Y])){
+      m_y(getCurrentDomain(variables[Y])),
+      m_intervalKernel(IntervalKernels::select<IntervalKernels::LessThanEqual>(m_x, m_y)) {
     checkError(variables.size() == ARG_COUNT, toString());
     checkError(m_x.isNumeric(), variables[X]->toString());
     checkError(m_y.isNumeric(), variables[Y]->toString());
   }
 
   void LessThanEqualConstraint::handleExecute() {
-    propagate(m_x, m_y);
+    if (m_intervalKernel != 0)
+      m_intervalKernel(m_x, m_y);
+    else
+      propagate(m_x, m_y);
   }
 
   void LessThanEqualConstraint::propagate(Domain& m_x, Domain& m_y){
@@ -730,11 +982,17 @@ bool NotEqualConstraint::canIgnore(const ConstrainedVariableId variable,
                                          const std::string& propagatorName,
                                          const ConstraintEngineId constraintEngine,
                                          const std::vector<ConstrainedVariableId>& variables)
-    : Constraint(name, propagatorName, constraintEngine, variables) {
+    : Constraint(name, propagatorName, constraintEngine, variables),
+      m_intervalKernel(IntervalKernels::select<IntervalKernels::LessThan>(getCurrentDomain(variables[X]),
+                                                                          getCurrentDomain(variables[Y]))) {
     check_error(variables.size() == ARG_COUNT);
   }
 
   void LessThanConstraint::handleExecute() {
+    if (m_intervalKernel != 0) {
+      m_intervalKernel(getCurrentDomain(m_variables[X]), getCurrentDomain(m_variables[Y]));
+      return;
+    }
     IntervalDomain& domx = static_cast<IntervalDomain&>(getCurrentDomain(m_variables[X]));
     IntervalDomain& domy = static_cast<IntervalDomain&>(getCurrentDomain(m_variables[Y]));
     propagate(domx, domy);
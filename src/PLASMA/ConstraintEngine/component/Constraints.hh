@@ -12,6 +12,13 @@
 
 namespace EUROPA {
 
+  /**
+   * @brief Propagation over a scope of plain interval domains with every domain call statically bound.
+   * Constraints select one at construction time if their scope allows it, and hold 0 otherwise.
+   */
+  typedef void (*BinaryIntervalKernel)(Domain& x, Domain& y);
+  typedef void (*TernaryIntervalKernel)(Domain& x, Domain& y, Domain& z);
+
 #define CREATE_FUNCTION_CONSTRAINT(cname)				\
   class cname##Constraint : public Constraint {				\
   public:								\
@@ -126,6 +133,7 @@ class AddEqualConstraint : public Constraint {
   Domain& m_x;
   Domain& m_y;
   Domain& m_z;
+  TernaryIntervalKernel m_intervalKernel;
 
   static const unsigned int X = 0;
   static const unsigned int Y = 1;
@@ -284,6 +292,7 @@ class LessThanEqualConstraint : public Constraint {
 
     Domain& m_x;
     Domain& m_y;
+    BinaryIntervalKernel m_intervalKernel;
     static const unsigned int X = 0;
     static const unsigned int Y = 1;
     static const unsigned int ARG_COUNT = 2;
@@ -468,6 +477,7 @@ class EqualConstraint : public Constraint {
  private:
   bool equate(const ConstrainedVariableId v1, const ConstrainedVariableId v2, bool& isEmpty);
   const unsigned long m_argCount;
+  BinaryIntervalKernel m_intervalKernel; /**< Only selected for two plain intervals */
 };
 typedef And<AtLeastNArgs<2>, Mutually<Assignable<> > > EqualCondition;
 typedef DataTypeCheck<EqualConstraint,  EqualCondition> EqualCT;
@@ -607,6 +617,7 @@ class LessThanConstraint : public Constraint {
   static void propagate(IntervalDomain& domx, IntervalDomain& domy);
 
  private:
+  BinaryIntervalKernel m_intervalKernel;
   static const unsigned int X = 0;
   static const unsigned int Y = 1;
   static const unsigned int ARG_COUNT = 2;
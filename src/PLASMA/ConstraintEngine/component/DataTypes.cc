@@ -199,6 +199,10 @@ RestrictedDT::RestrictedDT(const std::string& name, const DataTypeId baseType,
     m_baseDomain = _baseDomain.copy();
     m_baseDomain->setDataType(getId());
     setIsRestricted(true);
+
+    // Variables of the type start from copies of the base domain, so they will share its universe
+    if (m_baseDomain->isEnumerated() && m_baseDomain->isClosed())
+      static_cast<EnumeratedDomain*>(m_baseDomain)->makeDense();
 }
 
 RestrictedDT::~RestrictedDT()
@@ -31,14 +31,52 @@ namespace EUROPA {
 //     return(true);
 //   }
 
+namespace {
+  // Bit twiddling on the words of a dense EnumeratedDomain.
+  inline unsigned int popCount(unsigned long word) {
+#ifdef __GNUC__
+    return __builtin_popcountl(word);
+#else
+    unsigned int count = 0;
+    for ( ; word != 0; word &= word - 1)
+      count++;
+    return count;
+#endif
+  }
+
+  inline unsigned int lowestBit(unsigned long word) {
+#ifdef __GNUC__
+    return __builtin_ctzl(word);
+#else
+    unsigned int index = 0;
+    for ( ; (word & 1) == 0; word >>= 1)
+      index++;
+    return index;
+#endif
+  }
+
+  inline unsigned int highestBit(unsigned long word) {
+#ifdef __GNUC__
+    return sizeof(unsigned long) * 8 - 1 - __builtin_clzl(word);
+#else
+    unsigned int index = 0;
+    while (word >>= 1)
+      index++;
+    return index;
+#endif
+  }
+}
+
 EnumeratedDomain::EnumeratedDomain(const DataTypeId dt)
-    : Domain(dt,true,false), m_values()
+    : Domain(dt,true,false), m_values(), m_universe(), m_valuesCurrent(true)
 {
+  clearBits();
 }
 
 EnumeratedDomain::EnumeratedDomain(const DataTypeId dt, const std::list<edouble>& values)
-    : Domain(dt,true,false), m_values()
+    : Domain(dt,true,false), m_values(), m_universe(), m_valuesCurrent(true)
 {
+  clearBits();
   for (std::list<edouble>::const_iterator it = values.begin(); it != values.end(); ++it)
     insert(*it);
 
@@ -46,26 +84,28 @@ EnumeratedDomain::EnumeratedDomain(const DataTypeId dt, const std::list<edouble>
 }
 
 EnumeratedDomain::EnumeratedDomain(const DataTypeId dt, edouble value)
-    : Domain(dt,true,false), m_values()
+    : Domain(dt,true,false), m_values(), m_universe(), m_valuesCurrent(true)
 {
+  clearBits();
   insert(value);
   close();
 }
 
 EnumeratedDomain::EnumeratedDomain(const DataTypeId dt, double value)
-    : Domain(dt,true,false), m_values()
+    : Domain(dt,true,false), m_values(), m_universe(), m_valuesCurrent(true)
 {
+  clearBits();
   insert(value);
   close();
 }
 
 EnumeratedDomain::EnumeratedDomain(const Domain& org)
-    : Domain(org), m_values()
+    : Domain(org), m_values(), m_universe(), m_valuesCurrent(true)
 {
   check_error(org.isEnumerated(),
               "Invalid source domain " + org.getTypeName() + " for enumeration");
-  const EnumeratedDomain& enumOrg = static_cast<const EnumeratedDomain&>(org);
-  m_values = enumOrg.m_values;
+  clearBits();
+  assign(static_cast<const EnumeratedDomain&>(org));
 }
 
   bool EnumeratedDomain::isFinite() const {
@@ -73,15 +113,23 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
   }
 
   bool EnumeratedDomain::isSingleton() const {
+	  if (isDense())
+		  return(countBits() == 1);
 	  return(m_values.size() == 1);
   }
 
   bool EnumeratedDomain::isEmpty() const {
+	  if (isDense())
+		  return(firstBit() < 0);
 	  return(m_values.empty());
   }
 
   void EnumeratedDomain::empty() {
-	  m_values.clear();
+	  if (isDense()) {
+		  clearBits();
+	  }
+	  else
+		  m_values.clear();
 	  notifyChange(DomainListener::EMPTIED);
   }
 
@@ -92,12 +140,22 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
   }
 
   Domain::size_type EnumeratedDomain::getSize() const {
+	  if (isDense())
+		  return(countBits());
 	  return(m_values.size());
   }
 
   void EnumeratedDomain::insert(edouble value) {
 	  check_error(check_value(value));
 	  checkError(isOpen(), "Cannot insert into a closed domain." << toString());
+	  if (isDense()) {
+		  int index = universeIndex(value);
+		  if (index >= 0) {
+			  setBit(index);
+			  return;
+		  }
+		  makeSparse(); // Outside the universe
+	  }
 	  std::set<edouble>::iterator it = m_values.begin();
 	  for ( ; it != m_values.end(); it++) {
 		  if (compareEqual(value, *it))
@@ -117,15 +175,35 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 		  insert(*it);
   }
 
+  void EnumeratedDomain::addValue(edouble value) {
+	  if (isDense()) {
+		  int index = universeIndex(value);
+		  if (index >= 0) {
+			  setBit(index);
+			  return;
+		  }
+		  makeSparse();
+	  }
+	  m_values.insert(value);
+  }
+
   void EnumeratedDomain::remove(edouble value) {
 	  check_error(check_value(value));
-	  std::set<edouble>::iterator it = m_values.begin();
-	  for ( ; it != m_values.end(); it++)
-		  if (compareEqual(value, *it))
-			  break;
-	  if (it == m_values.end())
-		  return; // not present: no-op
-	  m_values.erase(it);
+	  if (isDense()) {
+		  int index = universeIndex(value);
+		  if (index < 0 || !testBit(index))
+			  return; // not present: no-op
+		  clearBit(index);
+	  }
+	  else {
+		  std::set<edouble>::iterator it = m_values.begin();
+		  for ( ; it != m_values.end(); it++)
+			  if (compareEqual(value, *it))
+				  break;
+		  if (it == m_values.end())
+			  return; // not present: no-op
+		  m_values.erase(it);
+	  }
 	  if (!isEmpty() || isOpen())
 		  notifyChange(DomainListener::VALUE_REMOVED);
 	  else
@@ -137,8 +215,15 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 		  close();
 
 	  if(isMember(value)){
-		  m_values.clear();
-		  m_values.insert(value);
+		  if (isDense()) {
+			  int index = universeIndex(value);
+			  clearBits();
+			  setBit(index);
+		  }
+		  else {
+			  m_values.clear();
+			  m_values.insert(value);
+		  }
 		  // Generate the notification, even if already a singleton. This is because setting a value to a singleton
 		  // is different from restricting it.
 		  notifyChange(DomainListener::SET_TO_SINGLETON);
@@ -178,43 +263,66 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  bool changed_b = false;
 	  EnumeratedDomain& l_dom = static_cast<EnumeratedDomain&>(dom);
 
-	  std::set<edouble>::iterator it_a = m_values.begin();
-	  std::set<edouble>::iterator it_b = l_dom.m_values.begin();
+	  if (isDense() || l_dom.isDense()) {
+		  // As below, nothing is restricted if either domain is already empty
+		  if (!isEmpty() && !l_dom.isEmpty()) {
+			  if (sameUniverse(l_dom)) {
+				  m_universe = l_dom.m_universe;
+				  for (unsigned int i = 0; i < DENSE_WORDS; i++) {
+					  Word both = m_bits[i] & l_dom.m_bits[i];
+					  changed_a = changed_a || both != m_bits[i];
+					  changed_b = changed_b || both != l_dom.m_bits[i];
+					  m_bits[i] = both;
+					  l_dom.m_bits[i] = both;
+				  }
+				  m_valuesCurrent = m_valuesCurrent && !changed_a;
+				  l_dom.m_valuesCurrent = l_dom.m_valuesCurrent && !changed_b;
+			  }
+			  else {
+				  changed_a = retainMembersOf(l_dom);
+				  changed_b = l_dom.retainMembersOf(*this);
+			  }
+		  }
+	  }
+	  else {
+		  std::set<edouble>::iterator it_a = m_values.begin();
+		  std::set<edouble>::iterator it_b = l_dom.m_values.begin();
+
+		  while (it_a != m_values.end() && it_b != l_dom.m_values.end()) {
+			  edouble val_a = *it_a;
+			  edouble val_b = *it_b;
 
-	  while (it_a != m_values.end() && it_b != l_dom.m_values.end()) {
-		  edouble val_a = *it_a;
-		  edouble val_b = *it_b;
+			  if (compareEqual(val_a, val_b)) {
+				  ++it_a;
+				  ++it_b;
+			  } else
+				  if (val_a < val_b) {
+					  std::set<edouble>::iterator target = m_values.lower_bound(val_b);
+					  m_values.erase(it_a, target);
+					  it_a = target;
+					  changed_a = true;
+					  check_error(!isMember(val_a));
+				  } else {
+					  std::set<edouble>::iterator target = l_dom.m_values.lower_bound(val_a);
+					  l_dom.m_values.erase(it_b, target);
+					  it_b = target;
+					  changed_b = true;
+					  check_error(!l_dom.isMember(val_b));
+				  }
+		  }
 
-		  if (compareEqual(val_a, val_b)) {
-			  ++it_a;
-			  ++it_b;
+		  if (it_a != m_values.end() && !l_dom.isEmpty()) {
+			  m_values.erase(it_a, m_values.end());
+			  changed_a = true;
+			  check_error(it_b == l_dom.m_values.end());
 		  } else
-			  if (val_a < val_b) {
-				  std::set<edouble>::iterator target = m_values.lower_bound(val_b);
-				  m_values.erase(it_a, target);
-				  it_a = target;
-				  changed_a = true;
-				  check_error(!isMember(val_a));
-			  } else {
-				  std::set<edouble>::iterator target = l_dom.m_values.lower_bound(val_a);
-				  l_dom.m_values.erase(it_b, target);
-				  it_b = target;
+			  if (it_b != l_dom.m_values.end() && !isEmpty()) {
+				  l_dom.m_values.erase(it_b, l_dom.m_values.end());
 				  changed_b = true;
-				  check_error(!l_dom.isMember(val_b));
+				  check_error(it_a == m_values.end());
 			  }
 	  }
 
-	  if (it_a != m_values.end() && !l_dom.isEmpty()) {
-		  m_values.erase(it_a, m_values.end());
-		  changed_a = true;
-		  check_error(it_b == l_dom.m_values.end());
-	  } else
-		  if (it_b != l_dom.m_values.end() && !isEmpty()) {
-			  l_dom.m_values.erase(it_b, l_dom.m_values.end());
-			  changed_b = true;
-			  check_error(it_a == m_values.end());
-		  }
-
 	  if (changed_a) {
 		  if (isEmpty())
 			  notifyChange(DomainListener::EMPTIED);
@@ -236,11 +344,15 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  }
 
 	  check_error(!isEmpty() || ! dom.isEmpty());
-	  check_error(isEmpty() || dom.isEmpty() || (l_dom.m_values == m_values));
+	  check_error(isEmpty() || dom.isEmpty() || (l_dom == *this));
 	  return(changed_a || changed_b);
   }
 
   bool EnumeratedDomain::isMember(edouble value) const {
+    if (isDense()) {
+      int index = universeIndex(value);
+      return index >= 0 && testBit(index);
+    }
     if (m_values.empty())
       return false;
     std::set<edouble>::const_iterator it = m_values.lower_bound(value);
@@ -284,14 +396,18 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
 	  if (!Domain::operator==(dom))
 		  return(false);
+	  if (isClosed() && sameUniverse(l_dom))
+		  return(std::equal(m_bits, m_bits + DENSE_WORDS, l_dom.m_bits));
 	  // If any member of either is not a member of the other, they're not equal.
 	  // Since membership is not simple (due to minDelta()), this has to be done
 	  // via a scan of both memberships, one member at a time.
-	  std::set<edouble>::const_iterator it = m_values.begin();
-	  for ( ; it != m_values.end(); it++)
+	  const std::set<edouble>& values = getValues();
+	  std::set<edouble>::const_iterator it = values.begin();
+	  for ( ; it != values.end(); it++)
 		  if (!l_dom.isMember(*it))
 			  return(false);
-	  for (it = l_dom.m_values.begin(); it != l_dom.m_values.end(); it++)
+	  const std::set<edouble>& otherValues = l_dom.getValues();
+	  for (it = otherValues.begin(); it != otherValues.end(); it++)
 		  if (!isMember(*it))
 			  return(false);
 	  return(true);
@@ -308,8 +424,7 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 		  return;
 
 	  if (isEmpty() || this->isSubsetOf(dom)){
-		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
-		  m_values = l_dom.m_values;
+		  assign(static_cast<const EnumeratedDomain&>(dom));
 		  // Open up if we are closed and need be be relaxed to an open domain
 		  if(dom.isOpen() && isClosed())
 			  open();
@@ -322,13 +437,15 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  checkError(isEmpty() || (isSingleton() && (getSingletonValue() == value)), toString());
 
 	  if (isEmpty()){
-		  m_values.insert(value);
+		  addValue(value);
 		  notifyChange(DomainListener::RELAXED);
 	  }
   }
 
   edouble EnumeratedDomain::getSingletonValue() const {
 	  checkError(isSingleton(), toString());
+	  if (isDense())
+		  return((*m_universe)[firstBit()]);
 	  return(*m_values.begin());
   }
 
@@ -336,11 +453,27 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  check_error(results.empty());
 	  check_error(isFinite());
 
+	  if (isDense()) {
+		  const Universe& universe = *m_universe;
+		  for (unsigned int i = 0; i < universe.size(); i++)
+			  if (testBit(i))
+				  results.push_back(universe[i]);
+		  return;
+	  }
+
 	  for (std::set<edouble>::const_iterator it = m_values.begin(); it != m_values.end(); ++it)
 		  results.push_back(*it);
   }
 
   const std::set<edouble>& EnumeratedDomain::getValues() const{
+	  if (isDense() && !m_valuesCurrent) {
+		  const Universe& universe = *m_universe;
+		  m_values.clear();
+		  for (unsigned int i = 0; i < universe.size(); i++)
+			  if (testBit(i))
+				  m_values.insert(m_values.end(), universe[i]);
+		  m_valuesCurrent = true;
+	  }
 	  return m_values;
   }
 
@@ -358,8 +491,14 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 
   bool EnumeratedDomain::getBounds(edouble& lb, edouble& ub) const {
 	  check_error(!isEmpty());
-	  lb = *m_values.begin();
-	  ub = *(--m_values.end());
+	  if (isDense()) {
+		  lb = (*m_universe)[firstBit()];
+		  ub = (*m_universe)[lastBit()];
+	  }
+	  else {
+		  lb = *m_values.begin();
+		  ub = *(--m_values.end());
+	  }
 	  check_error(lb <= ub);
 	  return(!isNumeric() || lb == MINUS_INFINITY || ub == PLUS_INFINITY);
   }
@@ -371,8 +510,7 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  // values in the new domain to this domain.
 	  if(isOpen() && dom.isClosed()){
 		  checkError(!dom.isInterval(), "Cannot intersect a closed interval and and open enumeration.");
-		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
-		  m_values = l_dom.m_values;
+		  assign(static_cast<const EnumeratedDomain&>(dom));
 
 		  // Only close when values are added as it will otherwise generate an empty domain event
 		  close();
@@ -385,7 +523,21 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 
 	  bool changed = false;
 
-	  if (dom.isInterval()) {
+	  if (dom.isEnumerated() && sameUniverse(static_cast<const EnumeratedDomain&>(dom))) {
+		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
+		  m_universe = l_dom.m_universe;
+		  for (unsigned int i = 0; i < DENSE_WORDS; i++) {
+			  Word both = m_bits[i] & l_dom.m_bits[i];
+			  if (both != m_bits[i]) {
+				  m_bits[i] = both;
+				  changed = true;
+			  }
+		  }
+		  m_valuesCurrent = m_valuesCurrent && !changed;
+	  }
+	  else if (isDense())
+		  changed = retainMembersOf(dom);
+	  else if (dom.isInterval()) {
 		  std::set<edouble>::iterator it = m_values.begin();
 		  while (it != m_values.end()) {
 			  edouble value = *it;
@@ -403,11 +555,11 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  } else if (dom.isOpen())
 		  return false;
 	  else {
-		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
+		  const std::set<edouble>& otherValues = static_cast<const EnumeratedDomain&>(dom).getValues();
 		  std::set<edouble>::iterator it_a = m_values.begin();
-		  std::set<edouble>::const_iterator it_b = l_dom.m_values.begin();
+		  std::set<edouble>::const_iterator it_b = otherValues.begin();
 
-		  while (it_a != m_values.end() && it_b != l_dom.m_values.end()) {
+		  while (it_a != m_values.end() && it_b != otherValues.end()) {
 			  edouble val_a = *it_a;
 			  edouble val_b = *it_b;
 
@@ -463,16 +615,39 @@ EnumeratedDomain::EnumeratedDomain(const Domain& org)
 	  // are present in dom, remove them.
 	  bool value_removed = false;
 
-	  for (std::set<edouble>::iterator it = m_values.begin(); it != m_values.end();) {
-		  edouble value = *it;
-		  if (dom.isMember(value)) {
-			  m_values.erase(it++);
-			  value_removed = true;
-		  } else
-			  ++it;
+	  if (dom.isEnumerated() && dom.isClosed() && sameUniverse(static_cast<const EnumeratedDomain&>(dom))) {
+		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
+		  m_universe = l_dom.m_universe;
+		  for (unsigned int i = 0; i < DENSE_WORDS; i++) {
+			  Word rest = m_bits[i] & ~l_dom.m_bits[i];
+			  if (rest != m_bits[i]) {
+				  m_bits[i] = rest;
+				  value_removed = true;
+			  }
+		  }
+		  m_valuesCurrent = m_valuesCurrent && !value_removed;
+	  }
+	  else if (isDense()) {
+		  const Universe& universe = *m_universe;
+		  for (unsigned int i = 0; i < universe.size(); i++) {
+			  if (testBit(i) && dom.isMember(universe[i])) {
+				  clearBit(i);
+				  value_removed = true;
+			  }
+		  }
+	  }
+	  else {
+		  for (std::set<edouble>::iterator it = m_values.begin(); it != m_values.end();) {
+			  edouble value = *it;
+			  if (dom.isMember(value)) {
+				  m_values.erase(it++);
+				  value_removed = true;
+			  } else
+				  ++it;
+		  }
 	  }
 
-	  if (m_values.empty())
+	  if (isEmpty())
 		  notifyChange(DomainListener::EMPTIED);
 	  else
 		  if (value_removed)
@@ -485,7 +660,7 @@ Domain& EnumeratedDomain::operator=(const Domain& dom) {
   safeComparison(*this, dom);
   check_error(m_listener.isNoId(), "Can only do direct assigment if not registered with a listener");
   const EnumeratedDomain& e_dom = dynamic_cast<const EnumeratedDomain&>(dom);
-  m_values = e_dom.m_values;
+  assign(e_dom);
   return *this;
 }
 
@@ -499,6 +674,22 @@ Domain& EnumeratedDomain::operator=(const Domain& dom) {
 	  else if(isOpen())
 		  return false;
 
+	  if (dom.isEnumerated() && sameUniverse(static_cast<const EnumeratedDomain&>(dom))) {
+		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
+		  for (unsigned int i = 0; i < DENSE_WORDS; i++)
+			  if ((m_bits[i] & ~l_dom.m_bits[i]) != 0)
+				  return(false);
+		  return(true);
+	  }
+
+	  if (isDense()) {
+		  const Universe& universe = *m_universe;
+		  for (unsigned int i = 0; i < universe.size(); i++)
+			  if (testBit(i) && !dom.isMember(universe[i]))
+				  return(false);
+		  return(true);
+	  }
+
 	  for (std::set<edouble>::const_iterator it = m_values.begin(); it != m_values.end(); ++it)
 		  if (!dom.isMember(*it))
 			  return(false);
@@ -511,6 +702,23 @@ Domain& EnumeratedDomain::operator=(const Domain& dom) {
 		  return true;
 
 	  safeComparison(*this, dom);
+
+	  if (dom.isEnumerated() && sameUniverse(static_cast<const EnumeratedDomain&>(dom))) {
+		  const EnumeratedDomain& l_dom = static_cast<const EnumeratedDomain&>(dom);
+		  for (unsigned int i = 0; i < DENSE_WORDS; i++)
+			  if ((m_bits[i] & l_dom.m_bits[i]) != 0)
+				  return(true);
+		  return(false);
+	  }
+
+	  if (isDense()) {
+		  const Universe& universe = *m_universe;
+		  for (unsigned int i = 0; i < universe.size(); i++)
+			  if (testBit(i) && dom.isMember(universe[i]))
+				  return(true);
+		  return(false);
+	  }
+
 	  for (std::set<edouble>::const_iterator it = m_values.begin(); it != m_values.end(); ++it)
 		  if (dom.isMember(*it))
 			  return(true);
@@ -526,7 +734,8 @@ Domain& EnumeratedDomain::operator=(const Domain& dom) {
 	  std::set<std::string> orderedSet;
 
 	  std::string comma = "";
-	  for (std::set<edouble>::const_iterator it = m_values.begin(); it != m_values.end(); ++it) {
+	  const std::set<edouble>& values = getValues();
+	  for (std::set<edouble>::const_iterator it = values.begin(); it != values.end(); ++it) {
 		  edouble valueAsDouble = *it;
 		  std::string valueAsStr = getDataType()->toString(valueAsDouble);
 
@@ -561,6 +770,119 @@ void EnumeratedDomain::testPrecision(const edouble&) const {}
 	  return(ptr);
   }
 
+  bool EnumeratedDomain::makeDense() {
+	  if (isDense())
+		  return(true);
+	  if (m_values.size() > DENSE_CAPACITY)
+		  return(false);
+	  m_universe.reset(new Universe(m_values.begin(), m_values.end()));
+	  clearBits();
+	  for (unsigned int i = 0; i < m_universe->size(); i++)
+		  setBit(i);
+	  m_valuesCurrent = true;
+	  return(true);
+  }
+
+  int EnumeratedDomain::universeIndex(edouble value) const {
+	  const Universe& universe = *m_universe;
+	  Universe::const_iterator it = std::lower_bound(universe.begin(), universe.end(), value);
+	  // As in isMember, the entry found is >= value, but the prior entry may be within epsilon
+	  if (it != universe.end() && (value == *it || compareEqual(value, *it)))
+		  return(it - universe.begin());
+	  if (it != universe.begin() && compareEqual(value, *(it - 1)))
+		  return(it - 1 - universe.begin());
+	  return(-1);
+  }
+
+  bool EnumeratedDomain::sameUniverse(const EnumeratedDomain& dom) const {
+	  return(isDense() && dom.isDense() &&
+			  (m_universe == dom.m_universe || *m_universe == *dom.m_universe));
+  }
+
+  void EnumeratedDomain::assign(const EnumeratedDomain& dom) {
+	  if (dom.isDense()) {
+		  m_universe = dom.m_universe;
+		  std::copy(dom.m_bits, dom.m_bits + DENSE_WORDS, m_bits);
+		  m_valuesCurrent = false;
+		  return;
+	  }
+
+	  // Stay dense if all the new values are in the universe
+	  if (isDense()) {
+		  clearBits();
+		  std::set<edouble>::const_iterator it = dom.m_values.begin();
+		  for ( ; it != dom.m_values.end(); ++it) {
+			  int index = universeIndex(*it);
+			  if (index < 0)
+				  break;
+			  setBit(index);
+		  }
+		  if (it == dom.m_values.end())
+			  return;
+		  m_universe.reset();
+	  }
+
+	  m_values = dom.m_values;
+	  m_valuesCurrent = true;
+  }
+
+  bool EnumeratedDomain::retainMembersOf(const Domain& dom) {
+	  bool changed = false;
+
+	  if (isDense()) {
+		  const Universe& universe = *m_universe;
+		  for (unsigned int i = 0; i < universe.size(); i++) {
+			  if (testBit(i) && !dom.isMember(universe[i])) {
+				  clearBit(i);
+				  changed = true;
+			  }
+		  }
+		  return(changed);
+	  }
+
+	  for (std::set<edouble>::iterator it = m_values.begin(); it != m_values.end();) {
+		  if (!dom.isMember(*it)) {
+			  m_values.erase(it++);
+			  changed = true;
+		  } else
+			  ++it;
+	  }
+	  return(changed);
+  }
+
+  void EnumeratedDomain::makeSparse() {
+	  if (!isDense())
+		  return;
+	  getValues();
+	  m_universe.reset();
+  }
+
+  unsigned int EnumeratedDomain::countBits() const {
+	  unsigned int count = 0;
+	  for (unsigned int i = 0; i < DENSE_WORDS; i++)
+		  count += popCount(m_bits[i]);
+	  return(count);
+  }
+
+  int EnumeratedDomain::firstBit() const {
+	  for (unsigned int i = 0; i < DENSE_WORDS; i++)
+		  if (m_bits[i] != 0)
+			  return(i * WORD_BITS + lowestBit(m_bits[i]));
+	  return(-1);
+  }
+
+  int EnumeratedDomain::lastBit() const {
+	  for (unsigned int i = DENSE_WORDS; i > 0; i--)
+		  if (m_bits[i - 1] != 0)
+			  return((i - 1) * WORD_BITS + highestBit(m_bits[i - 1]));
+	  return(-1);
+  }
+
+  void EnumeratedDomain::clearBits() {
+	  std::fill(m_bits, m_bits + DENSE_WORDS, Word(0));
+	  m_valuesCurrent = false;
+  }
+
   IntervalDomain::IntervalDomain(const DataTypeId dt)
     : Domain(dt,false,true)
     , m_ub(PLUS_INFINITY)
@@ -1006,7 +1328,7 @@ StringDomain::StringDomain(const std::list<LabelStr>& values, const DataTypeId d
     checkError(isEmpty() || isMember(value), value << " is not a member of the domain :" << toString());
 
     // Insert the value into the set as a special behavior for strings
-    m_values.insert(value);
+    addValue(value);
     EnumeratedDomain::set(value);
   }
 
@@ -1015,7 +1337,7 @@ void StringDomain::set(const LabelStr& value) {
              value << " is not a member of the domain :" << toString());
 
   // Insert the value into the set as a special behavior for strings
-  m_values.insert(value);
+  addValue(value);
   EnumeratedDomain::set(value);
 }
 
@@ -11,14 +11,20 @@
 #include "Domain.hh"
 #include "DataTypes.hh"
 
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
 namespace EUROPA {
 
   /**
    * @class EnumeratedDomain
    * @brief Declares an enumerated domain of doubles..
    *
-   * The implementation uses a sorted set of doubles which hold all the values possible in the set, and then refines membership using
-   * a bit vector.
+   * The implementation uses a sorted set of doubles which hold all the values possible in the set. A domain with a small, known
+   * universe of values (see makeDense()) instead holds a bit vector over an immutable, sorted universe shared with every domain
+   * copied from it. Operations between two domains over the same universe are then word-wise AND/ANDNOT on the bit vectors, and
+   * copies allocate nothing. The sorted set is only materialized on demand, for getValues(). A dense domain reverts to the
+   * sorted set if it acquires a value outside its universe.
    */
   class EnumeratedDomain : public Domain {
   public:
@@ -274,8 +280,32 @@ namespace EUROPA {
 	   */
 	  virtual std::string toString() const;
 
+	  /**
+	   * @brief Switch to the bit vector representation, with the current values as the universe.
+	   *
+	   * Domains subsequently copied from this one share its universe, so operations between them run on the bit vectors.
+	   * @return true if the domain is dense on return. A domain with more than DENSE_CAPACITY values stays sparse.
+	   */
+	  bool makeDense();
+
+	  /**
+	   * @brief Test if the domain is using the bit vector representation.
+	   */
+	  bool isDense() const {return m_universe.get() != 0;}
+
+	  /**
+	   * @brief The largest universe held as a bit vector.
+	   */
+	  static const unsigned int DENSE_CAPACITY = 256;
+
   protected:
 
+	  /**
+	   * @brief Add a value whether or not the domain is closed.
+	   * @note Used by StringDomain, whose closed domains may still take on literal values.
+	   */
+	  void addValue(edouble value);
+
 	  /**
 	   * @brief Enforces enumeration semantics.
 	   * @note Will be compiled out for fast version.
@@ -288,7 +318,52 @@ namespace EUROPA {
 	   */
 	  bool equateClosedEnumerations(EnumeratedDomain& dom);
 
-	  std::set<edouble> m_values; /**< Holds the contents from which the set membership is then derived. */
+  private:
+	  typedef unsigned long Word;
+	  typedef std::vector<edouble> Universe;
+
+	  static const unsigned int WORD_BITS = sizeof(Word) * 8;
+	  static const unsigned int DENSE_WORDS = DENSE_CAPACITY / WORD_BITS;
+
+	  /**
+	   * @brief Index of the given value in the universe, or -1 if it is not present.
+	   */
+	  int universeIndex(edouble value) const;
+
+	  /**
+	   * @brief True if both domains are dense over universes holding the same values.
+	   */
+	  bool sameUniverse(const EnumeratedDomain& dom) const;
+
+	  /**
+	   * @brief Copy the contents, and representation where possible, of the given domain.
+	   */
+	  void assign(const EnumeratedDomain& dom);
+
+	  /**
+	   * @brief Remove all values that are not members of the given domain. Does not notify.
+	   * @return true if any value was removed.
+	   */
+	  bool retainMembersOf(const Domain& dom);
+
+	  /**
+	   * @brief Revert to the sorted set representation.
+	   */
+	  void makeSparse();
+
+	  unsigned int countBits() const;
+	  int firstBit() const;
+	  int lastBit() const;
+	  bool testBit(unsigned int index) const {return (m_bits[index / WORD_BITS] >> (index % WORD_BITS)) & 1;}
+	  void setBit(unsigned int index) {m_bits[index / WORD_BITS] |= (Word(1) << (index % WORD_BITS)); m_valuesCurrent = false;}
+	  void clearBit(unsigned int index) {m_bits[index / WORD_BITS] &= ~(Word(1) << (index % WORD_BITS)); m_valuesCurrent = false;}
+	  void clearBits();
+
+	  mutable std::set<edouble> m_values; /**< Holds the contents from which the set membership is then derived.
+	                                           When dense, a cache of the bit vector filled in by getValues(). */
+	  boost::shared_ptr<const Universe> m_universe; /**< The sorted universe when dense, otherwise empty. */
+	  Word m_bits[DENSE_WORDS]; /**< Membership over m_universe when dense. */
+	  mutable bool m_valuesCurrent; /**< True if m_values reflects m_bits. Only meaningful when dense. */
   };
 
 
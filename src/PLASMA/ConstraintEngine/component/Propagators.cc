@@ -14,8 +14,68 @@
 #include "Domains.hh"
 #include "Debug.hh"
 
+#include <algorithm>
+
 namespace EUROPA {
 
+ConstraintAgenda::ConstraintAgenda() : m_size(0) {}
+
+  bool ConstraintAgenda::insert(const ConstraintId constraint) {
+    if(constraint->m_agendaBucket >= 0)
+      return false;
+    constraint->m_agendaBucket = constraint->getCostClass();
+    m_buckets[constraint->m_agendaBucket].push_back(constraint);
+    m_size++;
+    return true;
+  }
+
+  void ConstraintAgenda::erase(const ConstraintId constraint) {
+    if(constraint->m_agendaBucket < 0)
+      return;
+    std::deque<ConstraintId>& bucket = m_buckets[constraint->m_agendaBucket];
+    std::deque<ConstraintId>::iterator it = std::find(bucket.begin(), bucket.end(), constraint);
+    checkError(it != bucket.end(), constraint->toString() << " is marked as queued but is not on this agenda.");
+    bucket.erase(it);
+    constraint->m_agendaBucket = -1;
+    m_size--;
+  }
+
+  ConstraintId ConstraintAgenda::pop() {
+    checkError(m_size > 0, "Cannot pop from an empty agenda.");
+    unsigned int i = 0;
+    while(m_buckets[i].empty())
+      i++;
+    ConstraintId constraint = m_buckets[i].front();
+    m_buckets[i].pop_front();
+    constraint->m_agendaBucket = -1;
+    m_size--;
+    return constraint;
+  }
+
+  void ConstraintAgenda::clear() {
+    for(unsigned int i = 0; i < Constraint::COST_CLASS_COUNT; i++) {
+      for(std::deque<ConstraintId>::const_iterator it = m_buckets[i].begin(); it != m_buckets[i].end(); ++it)
+        (*it)->m_agendaBucket = -1;
+      m_buckets[i].clear();
+    }
+    m_size = 0;
+  }
+
+  bool ConstraintAgenda::isValid() const {
+    unsigned int size = 0;
+    for(unsigned int i = 0; i < Constraint::COST_CLASS_COUNT; i++) {
+      for(std::deque<ConstraintId>::const_iterator it = m_buckets[i].begin(); it != m_buckets[i].end(); ++it) {
+        ConstraintId constraint = *it;
+        checkError(constraint.isValid(), constraint);
+        checkError(constraint->m_agendaBucket == static_cast<int>(i),
+                   constraint->toString() << " is queued in bucket " << i << " but marked for " << constraint->m_agendaBucket);
+      }
+      size += m_buckets[i].size();
+    }
+    checkError(size == m_size, "Agenda size " << m_size << " does not match its contents " << size);
+    return true;
+  }
+
 DefaultPropagator::DefaultPropagator(const std::string& name, 
                                      const ConstraintEngineId constraintEngine, 
                                      int priority)
@@ -67,9 +127,7 @@ DefaultPropagator::DefaultPropagator(const std::string& name,
     check_error(m_activeConstraint == 0);
 
     if(!getConstraintEngine()->provenInconsistent()){
-      ConstraintSet::iterator it = m_agenda.begin();
-      ConstraintId constraint = *it;
-      m_agenda.erase(constraint);
+      ConstraintId constraint = m_agenda.pop();
 
       if(constraint->isActive()){
 	m_activeConstraint = constraint->getKey();
@@ -97,11 +155,7 @@ DefaultPropagator::DefaultPropagator(const std::string& name,
   }
 
   bool DefaultPropagator::isValid() const{
-    for(ConstraintSet::const_iterator it = m_agenda.begin(); it != m_agenda.end(); ++it){
-      ConstraintId constraint = *it;
-      checkError(constraint.isValid(), constraint);
-    }
-    return true;
+    return m_agenda.isValid();
   }
 
 
@@ -10,11 +10,61 @@
 
 
 #include "Propagator.hh"
+#include "Constraint.hh"
 #include "EquivalenceClassCollection.hh"
 #include <set>
+#include <deque>
 
 namespace EUROPA {
 
+  /**
+   * @class ConstraintAgenda
+   * @brief Constraints waiting to be executed, cheapest cost class first and first in, first out within a class.
+   *
+   * Membership is recorded on the Constraint itself, so insertion, including the check for a constraint that
+   * is already queued, is O(1). Erasing a queued constraint is linear in the size of its bucket, but only
+   * happens when a constraint is removed or deactivated.
+   * @see Constraint::CostClass
+   */
+  class ConstraintAgenda {
+  public:
+    ConstraintAgenda();
+
+    bool empty() const {return m_size == 0;}
+
+    unsigned int size() const {return m_size;}
+
+    /**
+     * @brief Test if the constraint is queued. A constraint belongs to a single propagator, so this is the only
+     * agenda it can be queued on.
+     */
+    bool contains(const ConstraintId constraint) const {return constraint->m_agendaBucket >= 0;}
+
+    /**
+     * @brief Queue the constraint, unless it is already queued.
+     * @return true if the constraint was added.
+     */
+    bool insert(const ConstraintId constraint);
+
+    /**
+     * @brief Remove the constraint if it is queued.
+     */
+    void erase(const ConstraintId constraint);
+
+    /**
+     * @brief Remove and return the oldest constraint in the cheapest non-empty cost class.
+     */
+    ConstraintId pop();
+
+    void clear();
+
+    bool isValid() const;
+
+  private:
+    std::deque<ConstraintId> m_buckets[Constraint::COST_CLASS_COUNT];
+    unsigned int m_size;
+  };
+
   class DefaultPropagator: public Propagator
   {
   public:
@@ -32,7 +82,7 @@ namespace EUROPA {
 				    const ConstraintId constraint,
 				    const DomainListener::ChangeType& changeType);
 
-    ConstraintSet m_agenda;
+    ConstraintAgenda m_agenda;
 
     eint m_activeConstraint;
   private:
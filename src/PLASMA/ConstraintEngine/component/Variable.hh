@@ -148,8 +148,10 @@ namespace EUROPA {
     if (!getConstraintEngine()->isPropagating() && pending())
       update();
     
-    if(provenInconsistent())
+    if(provenInconsistent()) {
+      trail();
       m_derivedDomain->empty();
+    }
     return *m_derivedDomain;
 
     // if (!provenInconsistent())
@@ -170,6 +172,7 @@ namespace EUROPA {
   template<class DomainType>
   Domain& Variable<DomainType>::getCurrentDomain() {
     check_error(validate());
+    trail();
     return(*m_derivedDomain);
   }
 
@@ -211,6 +214,7 @@ namespace EUROPA {
       return;
 
     // Apply restriction - force an event even if domain is unchanged
+    trail();
     m_derivedDomain->intersect(*m_baseDomain);
 
     // If a singleton, since it has changed, we have to set the value.
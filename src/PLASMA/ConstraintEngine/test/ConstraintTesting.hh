@@ -64,5 +64,15 @@ namespace EUROPA {
    */
   bool executeTestCases(const ConstraintEngineId engine, std::list<ConstraintTestCase>& testCases);
 
+  /**
+   * @brief An interval domain that constraints do not recognize as a plain interval, so they take the general path.
+   */
+  template <class Base>
+  class OpaqueInterval : public Base {
+  public:
+    OpaqueInterval(const Domain& org) : Base(org) {}
+    OpaqueInterval* copy() const {return new OpaqueInterval(*this);}
+  };
+
 }; /* namespace EUROPA */
 #endif // ifndef..
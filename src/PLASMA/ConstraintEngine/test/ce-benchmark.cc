@@ -0,0 +1,194 @@
+/**
+ * @file ce-benchmark.cc
+ * @brief Micro-benchmarks for ConstraintEngine domain operations and propagation.
+ *
+ * Times the common EnumeratedDomain operations used in propagation on the sorted set
+ * representation and on the dense bit vector representation (EnumeratedDomain::makeDense()),
+ * for a range of universe sizes.
+ *
+ * Also measures constraints executed per second when propagating a chain of arithmetic
+ * constraints over interval variables, once through the interval kernels and once through
+ * the general path that goes through the Domain virtuals.
+ *
+ * Usage: ConstraintEngine-benchmark [iterations]
+ */
+
+#include "Domains.hh"
+#include "DataTypes.hh"
+#include "LabelStr.hh"
+#include "CESchema.hh"
+#include "ConstraintEngine.hh"
+#include "ConstraintEngineListener.hh"
+#include "Constraints.hh"
+#include "Propagators.hh"
+#include "Variable.hh"
+#include "ConstraintTesting.hh"
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+using namespace EUROPA;
+
+namespace {
+
+  /**
+   * @brief Exercise copy, intersect, difference, isSubsetOf and equate between domains drawn from base.
+   * @return CPU seconds taken.
+   */
+  double timeOperations(const SymbolDomain& base, unsigned int iterations, unsigned int& checksum) {
+    std::list<edouble> values;
+    base.getValues(values);
+
+    // Every other value, and every third value
+    SymbolDomain evens(base);
+    SymbolDomain thirds(base);
+    unsigned int i = 0;
+    for (std::list<edouble>::const_iterator it = values.begin(); it != values.end(); ++it, ++i) {
+      if (i % 2 != 0)
+        evens.remove(*it);
+      if (i % 3 != 0)
+        thirds.remove(*it);
+    }
+
+    clock_t start = clock();
+    for (unsigned int n = 0; n < iterations; n++) {
+      SymbolDomain a(base);
+      SymbolDomain b(base);
+      a.intersect(evens);
+      b.difference(thirds);
+      checksum += a.isSubsetOf(b) ? 1 : 0;
+      a.equate(b);
+      checksum += a.getSize() + b.getSize();
+    }
+    return double(clock() - start) / CLOCKS_PER_SEC;
+  }
+
+  SymbolDomain makeUniverse(unsigned int size) {
+    std::list<edouble> values;
+    for (unsigned int i = 0; i < size; i++) {
+      std::stringstream name;
+      name << "value" << i;
+      values.push_back(LabelStr(name.str()));
+    }
+    return SymbolDomain(values);
+  }
+
+  class ExecutionCounter : public ConstraintEngineListener {
+  public:
+    ExecutionCounter(const ConstraintEngineId ce) : ConstraintEngineListener(ce), m_count(0) {}
+    void notifyExecuted(const ConstraintId) {m_count++;}
+    unsigned long getCount() const {return m_count;}
+  private:
+    unsigned long m_count;
+  };
+
+  /**
+   * @brief Propagate a chain x[i] + d[i] == x[i+1], x[i] <= x[i+1], x[i] < x[i+1] through repeated
+   * specification and reset of x[0].
+   * @return constraints executed per CPU second.
+   */
+  template <class IntDomain, class RealDomain>
+  double timePropagation(unsigned int iterations, unsigned long& executions) {
+    static const unsigned int CHAIN_LENGTH = 50;
+
+    CESchema* schema = new CESchema();
+    ConstraintEngine* ce = new ConstraintEngine(schema->getId());
+    new DefaultPropagator("Default", ce->getId());
+    ExecutionCounter* counter = new ExecutionCounter(ce->getId());
+
+    std::vector<ConstrainedVariableId> variables;
+    std::vector<ConstraintId> constraints;
+    for (unsigned int i = 0; i <= CHAIN_LENGTH; i++)
+      variables.push_back((new Variable<IntervalIntDomain>(ce->getId(), IntDomain(IntervalIntDomain(0, 10 * CHAIN_LENGTH))))->getId());
+    for (unsigned int i = 0; i < CHAIN_LENGTH; i++) {
+      ConstrainedVariableId delta = (new Variable<IntervalDomain>(ce->getId(), RealDomain(IntervalDomain(1, 2))))->getId();
+      variables.push_back(delta);
+      constraints.push_back((new AddEqualConstraint("addEq", "Default", ce->getId(),
+                                                    makeScope(variables[i], delta, variables[i + 1])))->getId());
+      constraints.push_back((new LessThanEqualConstraint("leq", "Default", ce->getId(),
+                                                         makeScope(variables[i], variables[i + 1])))->getId());
+      constraints.push_back((new LessThanConstraint("lessThan", "Default", ce->getId(),
+                                                    makeScope(variables[i], variables[i + 1])))->getId());
+    }
+    ce->propagate();
+
+    clock_t start = clock();
+    for (unsigned int n = 0; n < iterations; n++) {
+      variables[0]->specify(n % CHAIN_LENGTH);
+      ce->propagate();
+      variables[0]->reset();
+      ce->propagate();
+    }
+    double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+    executions = counter->getCount();
+
+    for (std::vector<ConstraintId>::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
+      delete (Constraint*) *it;
+    for (std::vector<ConstrainedVariableId>::const_iterator it = variables.begin(); it != variables.end(); ++it)
+      delete (ConstrainedVariable*) *it;
+    delete counter;
+    delete ce;
+    delete schema;
+
+    return (seconds > 0 ? executions / seconds : 0);
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned int iterations = (argc > 1 ? atoi(argv[1]) : 100000);
+
+  VoidDT::instance();
+  BoolDT::instance();
+  IntDT::instance();
+  FloatDT::instance();
+  StringDT::instance();
+  SymbolDT::instance();
+
+  std::cout << "Enumerated domain operations" << std::endl;
+  std::cout << std::setw(10) << "values"
+            << std::setw(14) << "set (s)"
+            << std::setw(14) << "dense (s)"
+            << std::setw(10) << "speedup" << std::endl;
+
+  unsigned int sizes[] = {4, 16, 64, 256};
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    SymbolDomain sparse = makeUniverse(sizes[i]);
+    SymbolDomain dense(sparse);
+    dense.makeDense();
+
+    unsigned int sparseChecksum = 0, denseChecksum = 0;
+    double sparseTime = timeOperations(sparse, iterations, sparseChecksum);
+    double denseTime = timeOperations(dense, iterations, denseChecksum);
+    if (sparseChecksum != denseChecksum) {
+      std::cerr << "Results differ for " << sizes[i] << " values" << std::endl;
+      return 1;
+    }
+
+    std::cout << std::setw(10) << sizes[i]
+              << std::setw(14) << std::fixed << std::setprecision(3) << sparseTime
+              << std::setw(14) << denseTime
+              << std::setw(10) << std::setprecision(1) << (denseTime > 0 ? sparseTime / denseTime : 0)
+              << std::endl;
+  }
+
+  std::cout << std::endl << "Interval propagation (constraints executed per second)" << std::endl;
+  unsigned long generalExecutions = 0, kernelExecutions = 0;
+  double general = timePropagation<OpaqueInterval<IntervalIntDomain>, OpaqueInterval<IntervalDomain> >(iterations / 100, generalExecutions);
+  double kernel = timePropagation<IntervalIntDomain, IntervalDomain>(iterations / 100, kernelExecutions);
+  if (generalExecutions != kernelExecutions) {
+    std::cerr << "Propagation differs: " << generalExecutions << " executions against " << kernelExecutions << std::endl;
+    return 1;
+  }
+  std::cout << std::setw(24) << "general"
+            << std::setw(24) << "kernel"
+            << std::setw(10) << "speedup" << std::endl;
+  std::cout << std::setw(24) << std::setprecision(0) << general
+            << std::setw(24) << kernel
+            << std::setw(10) << std::setprecision(1) << (general > 0 ? kernel / general : 0)
+            << std::endl;
+
+  return 0;
+}
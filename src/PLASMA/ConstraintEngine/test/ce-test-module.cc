@@ -334,6 +334,232 @@ public:
     EUROPA_runCETest(testVariableLookupByIndex);
     EUROPA_runCETest(testGNATS_3133);
     EUROPA_runCETest(testPostPropagation);
+    EUROPA_runCETest(testAgenda);
+    EUROPA_runCETest(testWakeEvents);
+    EUROPA_runCETest(testTrail);
+    EUROPA_runCETest(testConflictLevels);
+    EUROPA_runCETest(testProfiler);
+    return true;
+  }
+
+  static bool testAgenda() {
+    Variable<IntervalIntDomain> v0(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v1(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v2(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v3(ENGINE, IntervalIntDomain(0, 10));
+    EqualSumConstraint sum("EqualSumConstraint", "Default", ENGINE,
+                           makeScope(v0.getId(), v1.getId(), v2.getId(), v3.getId()));
+    AddEqualConstraint add("AddEqualConstraint", "Default", ENGINE, makeScope(v0.getId(), v1.getId(), v2.getId()));
+    LessThanEqualConstraint leq("LessThanEqualConstraint", "Default", ENGINE, makeScope(v0.getId(), v1.getId()));
+    CPPUNIT_ASSERT(sum.getCostClass() == Constraint::EXPENSIVE);
+    CPPUNIT_ASSERT(add.getCostClass() == Constraint::MODERATE);
+    CPPUNIT_ASSERT(leq.getCostClass() == Constraint::CHEAP);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+
+    // Cheapest class first, first in first out within a class, and no duplicates
+    ConstraintAgenda agenda;
+    CPPUNIT_ASSERT(agenda.insert(sum.getId()));
+    CPPUNIT_ASSERT(agenda.insert(add.getId()));
+    CPPUNIT_ASSERT(agenda.insert(leq.getId()));
+    CPPUNIT_ASSERT(!agenda.insert(add.getId()));
+    CPPUNIT_ASSERT(agenda.size() == 3);
+    CPPUNIT_ASSERT(agenda.contains(add.getId()));
+    agenda.erase(add.getId());
+    CPPUNIT_ASSERT(!agenda.contains(add.getId()));
+    CPPUNIT_ASSERT(agenda.size() == 2);
+    CPPUNIT_ASSERT(agenda.insert(add.getId()));
+    CPPUNIT_ASSERT(agenda.isValid());
+    CPPUNIT_ASSERT(agenda.pop() == leq.getId());
+    CPPUNIT_ASSERT(agenda.pop() == add.getId());
+    CPPUNIT_ASSERT(agenda.pop() == sum.getId());
+    CPPUNIT_ASSERT(agenda.empty());
+
+    agenda.insert(leq.getId());
+    agenda.insert(sum.getId());
+    agenda.clear();
+    CPPUNIT_ASSERT(agenda.empty());
+    CPPUNIT_ASSERT(!agenda.contains(leq.getId()) && !agenda.contains(sum.getId()));
+    return true;
+  }
+
+  static bool testWakeEvents() {
+    TestListener listener(ENGINE);
+    Variable<IntervalIntDomain> v0(ENGINE, IntervalIntDomain(-10, 10));
+    UnaryConstraint c0(IntervalDomain(4, 6), v0.getId());
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(!c0.wakesOn(DomainListener::SET_TO_SINGLETON));
+    CPPUNIT_ASSERT(c0.wakesOn(DomainListener::RESET));
+
+    // A restriction does not wake the constraint
+    listener.reset();
+    v0.specify(5);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(listener.getCount(ConstraintEngine::CONSTRAINT_EXECUTED) == 0);
+
+    // A relaxation does
+    v0.reset();
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(listener.getCount(ConstraintEngine::CONSTRAINT_EXECUTED) == 1);
+    CPPUNIT_ASSERT(v0.getDerivedDomain() == IntervalIntDomain(4, 6));
+    return true;
+  }
+
+  static bool testTrail() {
+    Variable<IntervalIntDomain> v0(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v1(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v2(ENGINE, IntervalIntDomain(0, 10));
+    LessThanConstraint c0("LessThanConstraint", "Default", ENGINE, makeScope(v0.getId(), v1.getId()));
+    LessThanConstraint c1("LessThanConstraint", "Default", ENGINE, makeScope(v1.getId(), v2.getId()));
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(ENGINE->getTrailDepth() == 0);
+
+    // Restrictions made within a level are undone by restoring it, without relaxation
+    ENGINE->pushTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->getTrailDepth() == 1);
+    v1.specify(5);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v0.getDerivedDomain() == IntervalIntDomain(0, 4));
+    CPPUNIT_ASSERT(v2.getDerivedDomain() == IntervalIntDomain(6, 10));
+    CPPUNIT_ASSERT(ENGINE->canRestoreTrailLevel());
+    ENGINE->beginTrailRestore();
+    v1.reset();
+    ENGINE->restoreTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->getTrailDepth() == 0);
+    CPPUNIT_ASSERT(!ENGINE->isRelaxed());
+    CPPUNIT_ASSERT(v0.lastDomain() == IntervalIntDomain(0, 8));
+    CPPUNIT_ASSERT(v1.lastDomain() == IntervalIntDomain(1, 9));
+    CPPUNIT_ASSERT(v2.lastDomain() == IntervalIntDomain(2, 10));
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v1.getDerivedDomain() == IntervalIntDomain(1, 9));
+
+    // Nested levels, the inner one ending in an inconsistency
+    ENGINE->pushTrailLevel();
+    v0.specify(7);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v2.getDerivedDomain() == IntervalIntDomain(9, 10));
+    ENGINE->pushTrailLevel();
+    v2.specify(5);
+    CPPUNIT_ASSERT(v2.lastDomain().isEmpty());
+    CPPUNIT_ASSERT(!ENGINE->propagate());
+    ENGINE->beginTrailRestore();
+    v2.reset();
+    ENGINE->restoreTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v1.getDerivedDomain() == IntervalIntDomain(8, 9));
+    CPPUNIT_ASSERT(v2.getDerivedDomain() == IntervalIntDomain(9, 10));
+    ENGINE->beginTrailRestore();
+    v0.reset();
+    ENGINE->restoreTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v0.getDerivedDomain() == IntervalIntDomain(0, 8));
+    CPPUNIT_ASSERT(v2.getDerivedDomain() == IntervalIntDomain(2, 10));
+
+    // A structural change can not be undone from the trail
+    ENGINE->pushTrailLevel();
+    {
+      LessThanConstraint c2("LessThanConstraint", "Default", ENGINE, makeScope(v0.getId(), v2.getId()));
+      CPPUNIT_ASSERT(!ENGINE->canRestoreTrailLevel());
+    }
+    ENGINE->popTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->getTrailDepth() == 0);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    CPPUNIT_ASSERT(v2.getDerivedDomain() == IntervalIntDomain(2, 10));
+    return true;
+  }
+
+  static bool testConflictLevels() {
+    Variable<IntervalIntDomain> v0(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v1(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v2(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v3(ENGINE, IntervalIntDomain(0, 10));
+    LessThanConstraint c0("LessThanConstraint", "Default", ENGINE, makeScope(v0.getId(), v1.getId()));
+    LessThanConstraint c1("LessThanConstraint", "Default", ENGINE, makeScope(v1.getId(), v2.getId()));
+    CPPUNIT_ASSERT(ENGINE->propagate());
+
+    // Only the levels which changed variables connected to the emptied one contributed
+    ENGINE->pushTrailLevel();
+    v3.specify(3);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    ENGINE->pushTrailLevel();
+    v0.specify(7);
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    ENGINE->pushTrailLevel();
+    v2.specify(5);
+    CPPUNIT_ASSERT(!ENGINE->propagate());
+    std::set<unsigned int> levels;
+    ENGINE->getConflictLevels(std::vector<ConstrainedVariableId>(), levels);
+    CPPUNIT_ASSERT(levels.size() == 2);
+    CPPUNIT_ASSERT(levels.count(2) == 1 && levels.count(3) == 1);
+
+    // The given variables extend the conflict
+    levels.clear();
+    ENGINE->getConflictLevels(makeScope(v3.getId()), levels);
+    CPPUNIT_ASSERT(levels.size() == 3);
+
+    ENGINE->beginTrailRestore();
+    v2.reset();
+    ENGINE->restoreTrailLevel();
+    ENGINE->beginTrailRestore();
+    v0.reset();
+    ENGINE->restoreTrailLevel();
+    ENGINE->beginTrailRestore();
+    v3.reset();
+    ENGINE->restoreTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->propagate());
+
+    // A level which changed the structure of the network always contributed
+    ENGINE->pushTrailLevel();
+    {
+      Variable<IntervalIntDomain> v4(ENGINE, IntervalIntDomain(0, 10));
+      levels.clear();
+      ENGINE->getConflictLevels(makeScope(v0.getId()), levels);
+      CPPUNIT_ASSERT(levels.size() == 1);
+    }
+    ENGINE->popTrailLevel();
+    CPPUNIT_ASSERT(ENGINE->propagate());
+    return true;
+  }
+
+  static bool testProfiler() {
+    CPPUNIT_ASSERT(!ENGINE->getPropagationProfiling());
+    CPPUNIT_ASSERT(ENGINE->getPropagationProfiler() == NULL);
+    ENGINE->setPropagationProfiling(true);
+    CPPUNIT_ASSERT(ENGINE->getPropagationProfiling());
+
+    Variable<IntervalIntDomain> v0(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v1(ENGINE, IntervalIntDomain(0, 10));
+    Variable<IntervalIntDomain> v2(ENGINE, IntervalIntDomain(0, 10));
+    LessThanConstraint c0("LessThanConstraint", "Default", ENGINE, makeScope(v0.getId(), v1.getId()));
+    LessThanConstraint c1("LessThanConstraint", "Default", ENGINE, makeScope(v1.getId(), v2.getId()));
+    CPPUNIT_ASSERT(ENGINE->propagate());
+
+    const PropagationProfiler* profiler = ENGINE->getPropagationProfiler();
+    CPPUNIT_ASSERT(profiler != NULL);
+    const PropagationProfiler::Counts& type = profiler->getConstraintTypes().find("LessThanConstraint")->second;
+    CPPUNIT_ASSERT(type.executions >= 2);
+    CPPUNIT_ASSERT(type.reductions >= 4);
+    CPPUNIT_ASSERT(profiler->getConstraintInstances().count(c0.getKey()) == 1);
+    CPPUNIT_ASSERT(profiler->getConstraintInstances().count(c1.getKey()) == 1);
+    const PropagationProfiler::Counts& propagator = profiler->getPropagators().find("Default")->second;
+    CPPUNIT_ASSERT(propagator.executions >= type.executions);
+    CPPUNIT_ASSERT(propagator.reductions == type.reductions);
+
+    // A redundant constraint executes without reducing anything
+    {
+      LessThanConstraint c2("LessThanConstraint", "Default", ENGINE, makeScope(v0.getId(), v2.getId()));
+      CPPUNIT_ASSERT(ENGINE->propagate());
+      const PropagationProfiler::Counts& instance = profiler->getConstraintInstances().find(c2.getKey())->second;
+      CPPUNIT_ASSERT(instance.executions == 1);
+      CPPUNIT_ASSERT(instance.noOps == 1);
+      CPPUNIT_ASSERT(instance.reductions == 0);
+    }
+    CPPUNIT_ASSERT(ENGINE->getPropagationProfile().find("LessThanConstraint") != std::string::npos);
+
+    ENGINE->setPropagationProfiling(false);
+    CPPUNIT_ASSERT(ENGINE->getPropagationProfiler() == NULL);
+    CPPUNIT_ASSERT(ENGINE->getPropagationProfile().empty());
+    v1.specify(5);
+    CPPUNIT_ASSERT(ENGINE->propagate());
     return true;
   }
 
@@ -829,10 +1055,91 @@ public:
     EUROPA_runCETest(testTestLessThanConstraint);
     EUROPA_runCETest(testTestLEQConstraint);
     EUROPA_runCETest(testGNATS_3075);
+    EUROPA_runCETest(testIntervalKernels);
     return(true);
   }
 
 private:
+  static std::string describe(const ConstrainedVariable& var) {
+    if (var.lastDomain().isEmpty())
+      return "empty ";
+    return var.lastDomain().toString() + " ";
+  }
+
+  template <class ConstraintType, class X, class Y>
+  static std::string propagate(const X& xDom, const Y& yDom) {
+    Variable<IntervalDomain> x(ENGINE, xDom);
+    Variable<IntervalDomain> y(ENGINE, yDom);
+    ConstraintType c("kernelTest", "Default", ENGINE, makeScope(x.getId(), y.getId()));
+    ENGINE->propagate();
+    return describe(x) + describe(y);
+  }
+
+  template <class ConstraintType, class X, class Y, class Z>
+  static std::string propagate(const X& xDom, const Y& yDom, const Z& zDom) {
+    Variable<IntervalDomain> x(ENGINE, xDom);
+    Variable<IntervalDomain> y(ENGINE, yDom);
+    Variable<IntervalDomain> z(ENGINE, zDom);
+    ConstraintType c("kernelTest", "Default", ENGINE, makeScope(x.getId(), y.getId(), z.getId()));
+    ENGINE->propagate();
+    return describe(x) + describe(y) + describe(z);
+  }
+
+  /**
+   * Constraints over exact IntervalDomain and IntervalIntDomain scopes run through statically
+   * bound kernels. Check that they reach the same domains as the general path for a spread of
+   * real, integer, infinite, singleton and disjoint bounds.
+   */
+  static bool testIntervalKernels() {
+    std::vector<IntervalDomain> reals;
+    reals.push_back(IntervalDomain(0.5, 10.5));
+    reals.push_back(IntervalDomain(-3.25, 3.25));
+    reals.push_back(IntervalDomain(2.5));
+    reals.push_back(IntervalDomain(20, PLUS_INFINITY));
+    reals.push_back(IntervalDomain(MINUS_INFINITY, edouble(-0.5)));
+    reals.push_back(IntervalDomain(MINUS_INFINITY, PLUS_INFINITY));
+
+    std::vector<IntervalIntDomain> ints;
+    ints.push_back(IntervalIntDomain(0, 10));
+    ints.push_back(IntervalIntDomain(-5, 2));
+    ints.push_back(IntervalIntDomain(3));
+    ints.push_back(IntervalIntDomain(11, PLUS_INFINITY));
+    ints.push_back(IntervalIntDomain(MINUS_INFINITY, eint(0)));
+    ints.push_back(IntervalIntDomain(MINUS_INFINITY, PLUS_INFINITY));
+
+    typedef OpaqueInterval<IntervalDomain> OpaqueReal;
+    typedef OpaqueInterval<IntervalIntDomain> OpaqueInt;
+
+    for (unsigned int i = 0; i < ints.size(); i++) {
+      for (unsigned int j = 0; j < ints.size(); j++) {
+        const IntervalIntDomain& a = ints[i];
+        const IntervalIntDomain& b = ints[j];
+        const IntervalDomain& r = reals[j];
+        const IntervalDomain& s = reals[i];
+
+        CPPUNIT_ASSERT(propagate<LessThanEqualConstraint>(a, b) == propagate<LessThanEqualConstraint>(OpaqueInt(a), OpaqueInt(b)));
+        CPPUNIT_ASSERT(propagate<LessThanEqualConstraint>(r, a) == propagate<LessThanEqualConstraint>(OpaqueReal(r), OpaqueInt(a)));
+        CPPUNIT_ASSERT(propagate<LessThanConstraint>(a, b) == propagate<LessThanConstraint>(OpaqueInt(a), OpaqueInt(b)));
+        CPPUNIT_ASSERT(propagate<LessThanConstraint>(s, r) == propagate<LessThanConstraint>(OpaqueReal(s), OpaqueReal(r)));
+        CPPUNIT_ASSERT(propagate<EqualConstraint>(a, r) == propagate<EqualConstraint>(OpaqueInt(a), OpaqueReal(r)));
+        CPPUNIT_ASSERT(propagate<EqualConstraint>(s, r) == propagate<EqualConstraint>(OpaqueReal(s), OpaqueReal(r)));
+
+        for (unsigned int k = 0; k < reals.size(); k++) {
+          const IntervalDomain& c = reals[k];
+          const IntervalIntDomain& d = ints[k];
+          CPPUNIT_ASSERT(propagate<AddEqualConstraint>(a, b, d) ==
+                         propagate<AddEqualConstraint>(OpaqueInt(a), OpaqueInt(b), OpaqueInt(d)));
+          CPPUNIT_ASSERT(propagate<AddEqualConstraint>(a, c, b) ==
+                         propagate<AddEqualConstraint>(OpaqueInt(a), OpaqueReal(c), OpaqueInt(b)));
+          CPPUNIT_ASSERT(propagate<AddEqualConstraint>(s, r, c) ==
+                         propagate<AddEqualConstraint>(OpaqueReal(s), OpaqueReal(r), OpaqueReal(c)));
+        }
+      }
+    }
+
+    return true;
+  }
+
   static bool testGNATS_3181(){
     std::list<edouble> values;
     values.push_back(1);
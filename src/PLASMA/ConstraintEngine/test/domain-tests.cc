@@ -790,6 +790,7 @@ class IntrinsicsTest {
       EUROPA_runTest(testOperatorEquals);
       EUROPA_runTest(testEmptyOnClosure);
       EUROPA_runTest(testOpenEnumerations);
+      EUROPA_runTest(testDenseRepresentation);
       return true;
     }
 
@@ -1365,6 +1366,113 @@ class IntrinsicsTest {
 
       return(true);
     }
+
+    static bool testDenseRepresentation() {
+      std::list<edouble> values;
+      values.push_back(EUROPA::LabelStr("A"));
+      values.push_back(EUROPA::LabelStr("B"));
+      values.push_back(EUROPA::LabelStr("C"));
+      values.push_back(EUROPA::LabelStr("D"));
+      values.push_back(EUROPA::LabelStr("E"));
+
+      SymbolDomain base(values);
+      CPPUNIT_ASSERT(!base.isDense());
+      CPPUNIT_ASSERT(base.makeDense());
+      CPPUNIT_ASSERT(base.isDense());
+      CPPUNIT_ASSERT(base.getSize() == 5);
+
+      // Copies share the universe, and operations between them stay dense
+      ChangeListener l_listener;
+      SymbolDomain ls0(base);
+      ls0.setListener(l_listener.getId());
+      SymbolDomain ls1(base);
+      ls1.setListener(l_listener.getId());
+      CPPUNIT_ASSERT(ls0.isDense() && ls1.isDense());
+      CPPUNIT_ASSERT(ls0 == ls1);
+
+      ls0.remove(EUROPA::LabelStr("A"));
+      ls0.remove(EUROPA::LabelStr("B"));
+      ls1.remove(EUROPA::LabelStr("E"));
+      CPPUNIT_ASSERT(ls0.getSize() == 3);
+      CPPUNIT_ASSERT(ls0.getLowerBound() == EUROPA::LabelStr("C"));
+      CPPUNIT_ASSERT(!ls0.isSubsetOf(ls1));
+      CPPUNIT_ASSERT(ls0.intersects(ls1));
+      CPPUNIT_ASSERT(ls0.equate(ls1));
+      CPPUNIT_ASSERT(ls0 == ls1);
+      CPPUNIT_ASSERT(ls0.getSize() == 2);
+      CPPUNIT_ASSERT(ls0.isSubsetOf(base));
+      CPPUNIT_ASSERT(ls0.isDense() && ls1.isDense());
+
+      // The value cache follows changes to the bits
+      CPPUNIT_ASSERT(ls1.getValues().size() == 2);
+      DomainListener::ChangeType change;
+      l_listener.checkAndClearChange(change);
+      ls1.intersect(SymbolDomain(EUROPA::LabelStr("D")));
+      CPPUNIT_ASSERT(l_listener.checkAndClearChange(change) && change == DomainListener::RESTRICT_TO_SINGLETON);
+      CPPUNIT_ASSERT(ls1.isDense());
+      CPPUNIT_ASSERT(ls1.getValues().size() == 1);
+      CPPUNIT_ASSERT(ls1.getSingletonValue() == EUROPA::LabelStr("D"));
+      CPPUNIT_ASSERT(ls0.difference(ls1));
+      CPPUNIT_ASSERT(ls0.getSingletonValue() == EUROPA::LabelStr("C"));
+      CPPUNIT_ASSERT(!ls0.intersects(ls1));
+
+      // Relaxing to values in the universe keeps the bits
+      ls1.relax(base);
+      CPPUNIT_ASSERT(ls1 == base);
+      SymbolDomain sparse(values);
+      sparse.remove(EUROPA::LabelStr("A"));
+      ls0.relax(sparse);
+      CPPUNIT_ASSERT(ls0.isDense());
+      CPPUNIT_ASSERT(ls0 == sparse);
+      CPPUNIT_ASSERT(ls1.intersect(sparse));
+      CPPUNIT_ASSERT(ls1 == sparse);
+
+      // A value outside the universe reverts to the sorted set
+      SymbolDomain open(base);
+      open.open();
+      open.insert(EUROPA::LabelStr("Z"));
+      CPPUNIT_ASSERT(!open.isDense());
+      CPPUNIT_ASSERT(open.getSize() == 6);
+      CPPUNIT_ASSERT(open.isMember(EUROPA::LabelStr("A")));
+      CPPUNIT_ASSERT(open.isMember(EUROPA::LabelStr("Z")));
+
+      // Assigning an empty domain invalidates the value cache
+      SymbolDomain cleared(base);
+      CPPUNIT_ASSERT(cleared.getValues().size() == 5);
+      std::list<edouble> noValues;
+      const Domain& none = SymbolDomain(noValues);
+      static_cast<Domain&>(cleared) = none;
+      CPPUNIT_ASSERT(cleared.isDense());
+      CPPUNIT_ASSERT(cleared.isEmpty());
+      CPPUNIT_ASSERT(cleared.getValues().empty());
+
+      // Numeric universes work with bounds
+      NumericDomain d0;
+      for (int i = 0; i < 100; i++)
+        d0.insert(i);
+      d0.close();
+      CPPUNIT_ASSERT(d0.makeDense());
+      NumericDomain d1(d0);
+      d1.intersect(10, 70.5);
+      CPPUNIT_ASSERT(d1.getSize() == 61);
+      CPPUNIT_ASSERT(d1.getLowerBound() == 10 && d1.getUpperBound() == 70);
+      CPPUNIT_ASSERT(d0.equate(d1));
+      CPPUNIT_ASSERT(d0.getSize() == 61);
+      CPPUNIT_ASSERT(d0.isMember(69.999999) && !d0.isMember(71));
+
+      // Too large a universe stays sparse
+      NumericDomain large;
+      for (unsigned int i = 0; i <= EnumeratedDomain::DENSE_CAPACITY; i++)
+        large.insert(i);
+      large.close();
+      CPPUNIT_ASSERT(!large.makeDense());
+
+      // Enumerated types hold their base domain densely
+      RestrictedDT dt("DenseType", SymbolDT::instance(), SymbolDomain(values));
+      CPPUNIT_ASSERT(static_cast<const EnumeratedDomain&>(dt.baseDomain()).isDense());
+
+      return(true);
+    }
   };
 
   // These have to be "global" (outside any class, at least) or some
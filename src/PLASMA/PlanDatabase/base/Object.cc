@@ -879,6 +879,7 @@ PSList<PSToken*> Object::getTokens() const {
       insert(object->getKey());
     }
     close();
+    makeDense();
   }
 
   ObjectDomain::ObjectDomain(const DataTypeId dt, const ObjectId initialValue)
@@ -18,7 +18,9 @@
 #include "ObjectTokenRelation.hh"
 #include "CommonAncestorConstraint.hh"
 #include "HasAncestorConstraint.hh"
+#include "TokenIntervalIndex.hh"
 #include <iostream>
+#include <algorithm>
 
 
 /**
@@ -31,6 +33,17 @@ namespace EUROPA{
 
   DEFINE_GLOBAL_CONST(std::string, g_ClassDelimiter, ":");
 
+namespace {
+  /**
+   * @brief Look up a name without interning it if it has never been seen, in which case
+   * it cannot be present.
+   */
+  template<class MAP>
+  typename MAP::const_iterator findByName(const MAP& byName, const std::string& name) {
+    return LabelStr::isString(name) ? byName.find(LabelStr(name)) : byName.end();
+  }
+}
+
   /**
    * @brief Implements a Listener to handle deletions of variables of type ObjectDomain.
    *
@@ -82,11 +95,13 @@ namespace EUROPA{
       , m_globalTokensByName()
       , m_tokensToOrder()
       , m_activeTokensByPredicate()
+      , m_activeTokenIndex(NULL)
       , m_objectVariablesByObjectType()
 
   {
       check_error(m_constraintEngine.isValid());
       check_error(m_schema.isValid());
+      m_activeTokenIndex = new TokenIntervalIndex(m_constraintEngine);
       m_client = (new DbClient(m_id))->getId();
       m_psClient = new PSPlanDatabaseClientImpl(m_client);
   }
@@ -98,6 +113,8 @@ namespace EUROPA{
       if(!isPurged())
         purge();
 
+      delete m_activeTokenIndex;
+
       if (!m_temporalAdvisor.isNoId())
         delete static_cast<TemporalAdvisor*>(m_temporalAdvisor);
 
@@ -163,20 +180,20 @@ namespace EUROPA{
     check_error(m_objects.find(object) == m_objects.end(),
                 "Object with the name " + object->getName() + " already added.");
 
-    check_error(m_objectsByName.find(object->getName()) == m_objectsByName.end(),
+    check_error(findByName(m_objectsByName, object->getName()) == m_objectsByName.end(),
                 "Object with the name " + object->getName() + " already added.");
 
     m_objects.insert(object);
 
     // Cache by name
-    m_objectsByName.insert(std::make_pair(object->getName(), object));
+    m_objectsByName.insert(std::make_pair(LabelStr(object->getName()), object));
 
     // Now cache by type
     std::string type = object->getType();
-    m_objectsByType.insert(std::make_pair(type, object));
+    m_objectsByType[LabelStr(type)].push_back(object);
     while(m_schema->hasParent(type)){
       type = m_schema->getParent(type);
-      m_objectsByType.insert(std::make_pair(type, object));
+      m_objectsByType[LabelStr(type)].push_back(object);
     }
 
     // Now we must push the insertion to any connected variables.
@@ -199,23 +216,24 @@ namespace EUROPA{
     check_error(!Entity::isPurging());
     check_error(object.isValid());
     check_error(m_objects.find(object) != m_objects.end());
-    check_error(m_objectsByName.find(object->getName()) != m_objectsByName.end());
+    check_error(findByName(m_objectsByName, object->getName()) != m_objectsByName.end());
 
     // Clean up cached values
     m_objects.erase(object);
-    m_objectsByName.erase(object->getName());
-    for(std::multimap<std::string, ObjectId>::iterator it = m_objectsByPredicate.begin(); it != m_objectsByPredicate.end();){
-      if(it->second == object)
-        m_objectsByPredicate.erase(it++);
-      else
-        ++it;
+    m_objectsByName.erase(LabelStr(object->getName()));
+    for(ObjectsByLabel::iterator it = m_objectsByPredicate.begin(); it != m_objectsByPredicate.end(); ++it){
+      std::vector<ObjectId>& objects = it->second;
+      objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
     }
 
-    for(std::multimap<std::string, ObjectId>::iterator it = m_objectsByType.begin(); it != m_objectsByType.end();){
-      if(it->second == object)
-        m_objectsByType.erase(it++);
-      else
-        ++it;
+    // The object is only cached under its type and the ancestors of it
+    std::string type = object->getType();
+    for(;;){
+      std::vector<ObjectId>& objects = m_objectsByType[LabelStr(type)];
+      objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
+      if(!m_schema->hasParent(type))
+        break;
+      type = m_schema->getParent(type);
     }
 
     // Now we must push the removal to any connected variables.
@@ -318,16 +336,16 @@ namespace EUROPA{
 bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
   check_error(m_schema->isObjectType(objectType));
 
-  std::multimap<std::string, ObjectId>::const_iterator it = m_objectsByType.find(objectType);
+  ObjectsByLabel::const_iterator it = m_objectsByType.find(LabelStr(objectType));
 
-  return (it != m_objectsByType.end() && it->first == objectType);
+  return (it != m_objectsByType.end() && !it->second.empty());
 }
 
   void PlanDatabase::registerGlobalVariable(const ConstrainedVariableId var){
     const std::string& varName = var->getName();
     checkError(!isGlobalVariable(varName), var->toString() << " is not unique.");
     m_globalVariables.insert(var);
-    m_globalVarsByName.insert(std::make_pair(varName, var));
+    m_globalVarsByName.insert(std::make_pair(LabelStr(varName), var));
 
     checkError(isGlobalVariable(varName), var->toString() << " is not registered after all. This cannot be!.");
     debugMsg("PlanDatabase:registerGlobalVariable", "Registered " << var->toString());
@@ -337,7 +355,7 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
     const std::string& varName = var->getName();
     checkError(isGlobalVariable(varName), var->toString() << " is not a global variable.");
     m_globalVariables.erase(var);
-    m_globalVarsByName.erase(varName);
+    m_globalVarsByName.erase(LabelStr(varName));
     checkError(!isGlobalVariable(varName), var->toString() << " failed to un-register.");
     debugMsg("PlanDatabase:unregisterGlobalVariable",
 	     "Un-registered " << var->toString());
@@ -350,18 +368,18 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
   const ConstrainedVariableId PlanDatabase::getGlobalVariable(const std::string& varName) const{
     checkError(isGlobalVariable(varName),
                "No variable with name='" << varName << "' is present.");
-    return m_globalVarsByName.find(varName)->second;
+    return findByName(m_globalVarsByName, varName)->second;
   }
 
   bool PlanDatabase::isGlobalVariable(const std::string& varName) const{
-    return (m_globalVarsByName.find(varName) != m_globalVarsByName.end());
+    return (findByName(m_globalVarsByName, varName) != m_globalVarsByName.end());
   }
 
   void PlanDatabase::registerGlobalToken(const TokenId t){
     const std::string& name = t->getName();
     checkError(!isGlobalToken(name), name << " is not unique. Can't register global token");
     m_globalTokens.insert(t);
-    m_globalTokensByName.insert(std::make_pair(name, t));
+    m_globalTokensByName.insert(std::make_pair(LabelStr(name), t));
 
     checkError(isGlobalToken(name), t->toLongString() << " is not registered after all. This cannot be!.");
     debugMsg("PlanDatabase:registerGlobalToken", "Registered " << name);
@@ -371,7 +389,7 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
     const std::string& name = t->getName();
     checkError(isGlobalToken(name), name << " is not a global token.");
     m_globalTokens.erase(t);
-    m_globalTokensByName.erase(name);
+    m_globalTokensByName.erase(LabelStr(name));
     checkError(!isGlobalToken(name), name << " failed to un-register.");
     debugMsg("PlanDatabase:unregisterGlobalToken",
          "Un-registered " << name);
@@ -383,11 +401,11 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
 
   const TokenId PlanDatabase::getGlobalToken(const std::string& name) const{
     checkError(isGlobalToken(name), "No global token with name='" << name << "' is registered.");
-    return m_globalTokensByName.find(name)->second;
+    return findByName(m_globalTokensByName, name)->second;
   }
 
   bool PlanDatabase::isGlobalToken(const std::string& name) const{
-    return (m_globalTokensByName.find(name) != m_globalTokensByName.end());
+    return (findByName(m_globalTokensByName, name) != m_globalTokensByName.end());
   }
 
   bool PlanDatabase::hasCompatibleTokens(const TokenId inactiveToken){
@@ -404,87 +422,18 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
     if(!m_constraintEngine->propagate())
       return;
 
-    // Draw from list of active tokens of the same predicate
-    const TokenSet& candidates = getActiveTokens(inactiveToken->getPredicateName());
+    std::vector<TokenId> candidates;
+    getMergeCandidates(inactiveToken, candidates);
 
     condDebugMsg(candidates.empty(),
 		 "PlanDatabase:getCompatibleTokens", "No candidates to evaluate for " << inactiveToken->toString());
 
-    const std::vector<ConstrainedVariableId>& inactiveTokenVariables = inactiveToken->getVariables();
-    unsigned long variableCount = inactiveTokenVariables.size();
-
     unsigned int choiceCount = 0; // Used for comparison against given limit
 
-    TemporalAdvisorId temporalAdvisor = getTemporalAdvisor();
-
-    for(TokenSet::const_iterator it = candidates.begin(); it != candidates.end(); ++it){
+    for(std::vector<TokenId>::const_iterator it = candidates.begin(); it != candidates.end(); ++it){
       TokenId candidate = *it;
 
-      debugMsg("PlanDatabase:getCompatibleTokens",
-               "Evaluating candidate token (" << candidate->getKey() << ") for token ("
-               << inactiveToken->getKey() << ")");
-
-      // Validate expectation about being active and predicate being the same
-      check_error(m_schema->isA(candidate->getPredicateName(), inactiveToken->getPredicateName()),
-                  candidate->getPredicateName() + " is not a " + inactiveToken->getPredicateName());
-
-      check_error(candidate->isActive(), "Should not be trying to merge an active token.");
-
-      const std::vector<ConstrainedVariableId>& candidateTokenVariables = candidate->getVariables();
-
-      // Check assumption that the set of variables is the same
-      checkError(candidateTokenVariables.size() == static_cast<unsigned int>(variableCount),
-		 "Candidate token (" << candidate->getKey() << ") has " <<
-		 candidateTokenVariables.size() << " variables, while inactive token (" <<
-		 inactiveToken->getKey() << ") has " << variableCount);
-
-      // Iterate and ensure there is an intersection. This could possibly be optmized based on
-      // the cost of comparing domains, or the likelihood of a variable excluding choice. Smaller domains
-      // would seem to offer better options on both counts, in general. Don't yet know if this even needs
-      // optimization
-      bool isCompatible = true;
-
-      check_error(inactiveTokenVariables[0] == inactiveToken->getState(),
-                  "We expect the first var to be the state var, which we must skip.");
-
-      for(unsigned int i=1;i<variableCount;i++){
-	const Domain& domA = inactiveTokenVariables[i]->lastDomain();
-	const Domain& domB = candidateTokenVariables[i]->lastDomain();
-
-	checkError(Domain::canBeCompared(domA, domB),
-		   domA.toString() << " cannot be compared to " << domB.toString() << ".");
-
-	if(domA.getSize() == 0 && domB.getSize() == 0)
-	  isCompatible = true;
-	else if(domA.isOpen() && domB.isOpen())
-		isCompatible = true;
-	else if(domA.getSize() < domB.getSize())
-	  isCompatible = domA.intersects(domB);
-	else
-	  isCompatible = domB.intersects(domA);
-
-	if(!isCompatible) {
-	  debugMsg("PlanDatabase:getCompatibleTokens",
-		   "EXCLUDING (" << candidate->getKey() << ")" <<
-		   "VAR=" << candidateTokenVariables[i]->getName() <<
-		   "(" << candidateTokenVariables[i]->getKey() << ") " <<
-		   "Cannot intersect " << domA.toString() << " with " << domB.toString());
-	  break;
-	}
-
-	debugMsg("PlanDatabase:getCompatibleTokens",
-		 "VAR=" << candidateTokenVariables[i]->getName() <<
-		 "(" << candidateTokenVariables[i]->getKey() << ") " <<
-		 "Can intersect " << domA.toString() << " with " << domB.toString());
-      }
-
-      // If it is still compatible, we may wish to do a double check on the
-      // Temporal Variables, since we could get more pruning from the TemporalNetwork based on
-      // temporal distance. This is because temporal propagation is insufficient to ensure that if 2 timepoints
-      // have an intersection that they can actually co-exist. For example, if a < b, then there may well
-      // be an intersection but t would be immediately inconsistent of they were required to be concurrent.
-      if (isCompatible &&
-          (!useExactTest || temporalAdvisor->canBeConcurrent(inactiveToken, candidate))){
+      if(isCompatible(inactiveToken, candidate, useExactTest)){
         results.push_back(candidate);
 
         debugMsg("PlanDatabase:getCompatibleTokens",
@@ -498,6 +447,88 @@ bool PlanDatabase::hasObjectInstances(const std::string& objectType) const {
         return;
     }
   }
+
+  void PlanDatabase::getMergeCandidates(const TokenId inactiveToken,
+                                        std::vector<TokenId>& results) {
+    checkError(m_constraintEngine->constraintConsistent(),
+               "Cannot query for merge candidates while database is not constraintConsistent.");
+
+    // Draw from the active tokens of the same predicate whose start could be the same
+    const Domain& start = inactiveToken->start()->lastDomain();
+    m_activeTokenIndex->getCandidates(LabelStr(inactiveToken->getPredicateName()),
+                                      start.getLowerBound() - start.minDelta(),
+                                      start.getUpperBound() + start.minDelta(),
+                                      results);
+  }
+
+  bool PlanDatabase::isCompatible(const TokenId inactiveToken, const TokenId candidate, bool useExactTest) {
+    debugMsg("PlanDatabase:getCompatibleTokens",
+             "Evaluating candidate token (" << candidate->getKey() << ") for token ("
+             << inactiveToken->getKey() << ")");
+
+    // Validate expectation about being active and predicate being the same
+    check_error(m_schema->isA(candidate->getPredicateName(), inactiveToken->getPredicateName()),
+                candidate->getPredicateName() + " is not a " + inactiveToken->getPredicateName());
+
+    check_error(candidate->isActive(), "Should not be trying to merge an active token.");
+
+    const std::vector<ConstrainedVariableId>& inactiveTokenVariables = inactiveToken->getVariables();
+    const std::vector<ConstrainedVariableId>& candidateTokenVariables = candidate->getVariables();
+    unsigned long variableCount = inactiveTokenVariables.size();
+
+    // Check assumption that the set of variables is the same
+    checkError(candidateTokenVariables.size() == static_cast<unsigned int>(variableCount),
+               "Candidate token (" << candidate->getKey() << ") has " <<
+               candidateTokenVariables.size() << " variables, while inactive token (" <<
+               inactiveToken->getKey() << ") has " << variableCount);
+
+    // Iterate and ensure there is an intersection. This could possibly be optmized based on
+    // the cost of comparing domains, or the likelihood of a variable excluding choice. Smaller domains
+    // would seem to offer better options on both counts, in general. Don't yet know if this even needs
+    // optimization
+    bool compatible = true;
+
+    check_error(inactiveTokenVariables[0] == inactiveToken->getState(),
+                "We expect the first var to be the state var, which we must skip.");
+
+    for(unsigned int i=1;i<variableCount;i++){
+      const Domain& domA = inactiveTokenVariables[i]->lastDomain();
+      const Domain& domB = candidateTokenVariables[i]->lastDomain();
+
+      checkError(Domain::canBeCompared(domA, domB),
+                 domA.toString() << " cannot be compared to " << domB.toString() << ".");
+
+      if(domA.getSize() == 0 && domB.getSize() == 0)
+        compatible = true;
+      else if(domA.isOpen() && domB.isOpen())
+        compatible = true;
+      else if(domA.getSize() < domB.getSize())
+        compatible = domA.intersects(domB);
+      else
+        compatible = domB.intersects(domA);
+
+      if(!compatible) {
+        debugMsg("PlanDatabase:getCompatibleTokens",
+                 "EXCLUDING (" << candidate->getKey() << ")" <<
+                 "VAR=" << candidateTokenVariables[i]->getName() <<
+                 "(" << candidateTokenVariables[i]->getKey() << ") " <<
+                 "Cannot intersect " << domA.toString() << " with " << domB.toString());
+        return false;
+      }
+
+      debugMsg("PlanDatabase:getCompatibleTokens",
+               "VAR=" << candidateTokenVariables[i]->getName() <<
+               "(" << candidateTokenVariables[i]->getKey() << ") " <<
+               "Can intersect " << domA.toString() << " with " << domB.toString());
+    }
+
+    // If it is still compatible, we may wish to do a double check on the
+    // Temporal Variables, since we could get more pruning from the TemporalNetwork based on
+    // temporal distance. This is because temporal propagation is insufficient to ensure that if 2 timepoints
+    // have an intersection that they can actually co-exist. For example, if a < b, then there may well
+    // be an intersection but t would be immediately inconsistent of they were required to be concurrent.
+    return !useExactTest || getTemporalAdvisor()->canBeConcurrent(inactiveToken, candidate);
+  }
   
 //   void PlanDatabase::getCompatibleTokens(const TokenId inactiveToken,
 //                                          std::vector<TokenId>& results,
@@ -604,11 +635,8 @@ void PlanDatabase::getObjectsByPredicate(const std::string& predicate,
   check_error(m_schema->isPredicate(predicate));
 
   // First try a cache hit.
-  for(std::multimap<std::string, ObjectId>::const_iterator it = m_objectsByPredicate.find(predicate);
-      (it != m_objectsByPredicate.end() && it->first == predicate);
-      ++it){
-    results.push_back(it->second);
-  }
+  std::vector<ObjectId>& objects = m_objectsByPredicate[LabelStr(predicate)];
+  results.insert(results.end(), objects.begin(), objects.end());
 
   if(results.empty()){ // We do not have a hit, so we must construct the set by iterating over all objects and checking with the schema
     for (ObjectSet::const_iterator it = m_objects.begin(); it != m_objects.end(); ++it){
@@ -616,16 +644,17 @@ void PlanDatabase::getObjectsByPredicate(const std::string& predicate,
       check_error(object.isValid());
       if(m_schema->canBeAssigned(object->getType(), predicate)){
         results.push_back(object);
-        m_objectsByPredicate.insert(std::make_pair(predicate, object));
+        objects.push_back(object);
       }
     }
   }
 }
 
   const ObjectId PlanDatabase::getObject(const std::string& name) const{
-    if (m_objectsByName.find(name) == m_objectsByName.end())
+    boost::unordered_map<LabelStr, ObjectId>::const_iterator it = findByName(m_objectsByName, name);
+    if (it == m_objectsByName.end())
       return ObjectId::noId();
-    return m_objectsByName.find(name)->second;
+    return it->second;
   }
 
   const TokenSet& PlanDatabase::getTokens() const {
@@ -635,8 +664,8 @@ void PlanDatabase::getObjectsByPredicate(const std::string& predicate,
 
 const TokenSet& PlanDatabase::getActiveTokens(const std::string& predicate) const {
   static const TokenSet sl_noTokens;
-  std::map<std::string, TokenSet>::const_iterator it =
-      m_activeTokensByPredicate.find(predicate);
+  boost::unordered_map<LabelStr, TokenSet>::const_iterator it =
+      findByName(m_activeTokensByPredicate, predicate);
   if(it != m_activeTokensByPredicate.end())
     return it->second;
   else
@@ -956,16 +985,10 @@ void PlanDatabase::insertActiveToken(const TokenId token){
   debugMsg("PlanDatabase:insertActiveToken", token->toString());
 
   while(getSchema()->isPredicate(predicate)){
-    std::map<std::string, TokenSet>::iterator it = m_activeTokensByPredicate.find(predicate);
-    if(it == m_activeTokensByPredicate.end()){
-      static const TokenSet emptySet;
-      std::pair<std::string, TokenSet > entry(predicate, emptySet);
-      m_activeTokensByPredicate.insert(entry);
-      it = m_activeTokensByPredicate.find(predicate);
-    }
-
-    TokenSet& activeTokens = it->second;
+    const LabelStr predicateLabel(predicate);
+    TokenSet& activeTokens = m_activeTokensByPredicate[predicateLabel];
     activeTokens.insert(token);
+    m_activeTokenIndex->insert(token, predicateLabel);
     debugMsg("PlanDatabase:insertActiveToken", token->toString() << " added for " << predicate);
 
     // Break if we hit a built in class
@@ -989,7 +1012,7 @@ void PlanDatabase::insertActiveToken(const TokenId token){
     debugMsg("PlanDatabase:removeActiveToken", token->toString());
 
     while(getSchema()->isPredicate(predicate)){
-      std::map<std::string, TokenSet>::iterator it = m_activeTokensByPredicate.find(predicate);
+      boost::unordered_map<LabelStr, TokenSet>::iterator it = m_activeTokensByPredicate.find(LabelStr(predicate));
       checkError(it != m_activeTokensByPredicate.end(), token->toString() << " must be present but isn't.")
       TokenSet& activeTokens = it->second;
       activeTokens.erase(token);
@@ -1005,6 +1028,8 @@ void PlanDatabase::insertActiveToken(const TokenId token){
 
       predicate = predStr;
     }
+
+    m_activeTokenIndex->remove(token);
   }
 
   // PSPlanDatabase methods
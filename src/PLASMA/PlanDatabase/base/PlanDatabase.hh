@@ -16,16 +16,19 @@
 #include "Schema.hh"
 #include "DbClient.hh"
 #include "Engine.hh"
+#include "LabelStr.hh"
 
 #include <set>
 #include <map>
 #include <list>
 #include <vector>
 #include <typeinfo>
+#include <boost/unordered_map.hpp>
 
 namespace EUROPA {
 
 	class ObjectVariableListener;
+	class TokenIntervalIndex;
 
   /**
    * @brief The main mediator for interaction with entities of the plan and managing their relationships.
@@ -167,6 +170,24 @@ namespace EUROPA {
 // 			     eint limit,
 // 			     bool useExactTest);
 
+    /**
+     * @brief Retrieves the active tokens that may be compatible with the given token, in the order
+     * getCompatibleTokens considers them, without testing them. Database must be constraintConsistent.
+     * @param inactiveToken The token to drive the search. It must be inActive().
+     * @param results A (initially empty) collection to be populated with the candidates.
+     * @see isCompatible
+     */
+    void getMergeCandidates(const TokenId inactiveToken,
+			    std::vector<TokenId>& results);
+
+    /**
+     * @brief Test if a candidate obtained from getMergeCandidates is compatible with the given token.
+     * Database must be constraintConsistent.
+     * @param useExactTest If true, use a much more expensive but more rigorous comparison of timepoints.
+     * @see getCompatibleTokens
+     */
+    bool isCompatible(const TokenId inactiveToken, const TokenId candidate, bool useExactTest);
+
     /**
      * @brief Returns a count of compatible tokens up to the given limit
      * @see getCompatibleTokens
@@ -439,17 +460,19 @@ namespace EUROPA {
     std::vector<PlanDatabaseListenerId> m_listeners;
 
     /* In the data structures below, the key is a LabelStr representation of a name */
-    std::map<std::string, ObjectId> m_objectsByName; /*!< Object names are unique. Holds all objects m_objectsByName.size() == m_objects.size(). */
-    std::multimap<std::string, ObjectId> m_objectsByPredicate; /*!< May be updated every time we add a Token, or remove an object. */
-    std::multimap<std::string, ObjectId> m_objectsByType; /*!< May be updated every time we add a Token, or remove an object. */
+    typedef boost::unordered_map<LabelStr, std::vector<ObjectId> > ObjectsByLabel;
+    boost::unordered_map<LabelStr, ObjectId> m_objectsByName; /*!< Object names are unique. Holds all objects m_objectsByName.size() == m_objects.size(). */
+    ObjectsByLabel m_objectsByPredicate; /*!< May be updated every time we add a Token, or remove an object. */
+    ObjectsByLabel m_objectsByType; /*!< May be updated every time we add a Token, or remove an object. In order of addition. */
     std::set<std::string> m_closedObjectTypes; /*!< The set of explicitly closed object types.
 					     If present here, it cannot be present in m_objectVariablesByType */
-    std::map<std::string, ConstrainedVariableId> m_globalVarsByName;
-    std::map<std::string, TokenId> m_globalTokensByName;
+    boost::unordered_map<LabelStr, ConstrainedVariableId> m_globalVarsByName;
+    boost::unordered_map<LabelStr, TokenId> m_globalTokensByName;
     std::map<eint, std::pair<TokenId, ObjectSet> > m_tokensToOrder; /*!< All tokens to order, with the object
 								     inducing the requirement stored in the set */
 
-    std::map<std::string, TokenSet > m_activeTokensByPredicate; /*!< All active tokens sorted by predicate */
+    boost::unordered_map<LabelStr, TokenSet> m_activeTokensByPredicate; /*!< All active tokens sorted by predicate */
+    TokenIntervalIndex* m_activeTokenIndex; /*!< The same tokens by the bounds of their start, to find merge candidates */
 
     // All this to store variables (and their listeners) for Open Object Types
     typedef std::multimap<std::string, std::pair<ConstrainedVariableId, ConstrainedVariableListenerId> > ObjVarsByObjType;
@@ -468,14 +491,17 @@ void PlanDatabase::getObjectsByType(const std::string& type, std::list<ID>& resu
   checkError(m_schema->isObjectType(type),
              "Is not an object type in the plan database: " + type);
     
-  for (std::multimap<std::string, ObjectId>::const_iterator it = m_objectsByType.find(type);
-       it != m_objectsByType.end() && it->first == type; ++it) {
+  ObjectsByLabel::const_iterator objects = m_objectsByType.find(LabelStr(type));
+  if (objects == m_objectsByType.end())
+    return;
+  for (std::vector<ObjectId>::const_iterator it = objects->second.begin();
+       it != objects->second.end(); ++it) {
     debugMsg("PlanDatabase:getObjectsByType",
-             "Adding object '" << it->second->getName() << "' of type '" <<
-             it->second->getType() << "' for type '" << type << "'");
-    const Object& o = *(it->second);
+             "Adding object '" << (*it)->getName() << "' of type '" <<
+             (*it)->getType() << "' for type '" << type << "'");
+    const Object& o = **it;
     debugMsg("PlanDatabase:getObjectsByType", "Typeid for object: " << typeid(o).name());
-    results.push_back(ID(it->second));
+    results.push_back(ID(*it));
   }
 }
 }
@@ -22,12 +22,26 @@
 
 namespace EUROPA{
 
+  namespace {
+    // Every token has a state variable, so all StateDomains are copied from this one and share its dense universe.
+    EnumeratedDomain makeAllStates() {
+      EnumeratedDomain states(SymbolDT::instance());
+      states.insert(Token::ACTIVE);
+      states.insert(Token::MERGED);
+      states.insert(Token::REJECTED);
+      states.makeDense();
+      return states;
+    }
+
+    const EnumeratedDomain& allStates() {
+      static const EnumeratedDomain sl_states(makeAllStates());
+      return sl_states;
+    }
+  }
+
   StateDomain::StateDomain()
-    : EnumeratedDomain(SymbolDT::instance())
+    : EnumeratedDomain(allStates())
   {
-      insert(Token::ACTIVE);
-      insert(Token::MERGED);
-      insert(Token::REJECTED);
   }
 
   StateDomain::StateDomain(const Domain& org)
@@ -45,7 +59,8 @@ void StateDomain::operator>>(ostream&os) const {
   // First construct a lexicographic ordering for the set of values.
   std::set<std::string> orderedSet;
 
-  for (std::set<edouble>::const_iterator it = m_values.begin(); it != m_values.end(); ++it) {
+  const std::set<edouble>& values = getValues();
+  for (std::set<edouble>::const_iterator it = values.begin(); it != values.end(); ++it) {
     LabelStr value = *it;
     orderedSet.insert(value.toString());
   }
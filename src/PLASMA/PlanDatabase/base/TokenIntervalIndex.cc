@@ -0,0 +1,239 @@
+#include "TokenIntervalIndex.hh"
+#include "Token.hh"
+#include "TokenVariable.hh"
+#include "Domains.hh"
+#include "Debug.hh"
+#include "Error.hh"
+
+#include <algorithm>
+
+namespace EUROPA {
+
+  /**
+   * @class TokenIntervalIndex::Tree
+   * @brief A treap of tokens ordered by the lower bound of their start, where each node also holds the
+   * greatest upper bound below it, so subtrees that cannot overlap a query are skipped.
+   */
+  class TokenIntervalIndex::Tree {
+  public:
+    Tree() : m_root(NULL), m_seed(1) {}
+
+    ~Tree() {destroy(m_root);}
+
+    void insert(edouble lb, edouble ub, const TokenId token) {
+      m_seed = m_seed * 1103515245 + 12345;
+      m_root = insert(m_root, new Node(lb, ub, token, m_seed));
+    }
+
+    void remove(edouble lb, const TokenId token) {
+      m_root = remove(m_root, lb, token->getKey());
+    }
+
+    void query(edouble lb, edouble ub, std::vector<TokenId>& results) const {
+      query(m_root, lb, ub, results);
+    }
+
+  private:
+    struct Node {
+      Node(edouble _lb, edouble _ub, const TokenId _token, unsigned long _priority)
+        : lb(_lb), ub(_ub), maxUb(_ub), key(_token->getKey()), token(_token), priority(_priority),
+          left(NULL), right(NULL) {}
+      edouble lb;
+      edouble ub;
+      edouble maxUb; /**< The greatest ub in this subtree */
+      eint key;
+      TokenId token;
+      unsigned long priority;
+      Node* left;
+      Node* right;
+    };
+
+    static bool before(edouble lb, eint key, const Node* node) {
+      return lb < node->lb || (lb == node->lb && key < node->key);
+    }
+
+    static void update(Node* node) {
+      node->maxUb = node->ub;
+      if (node->left != NULL && node->left->maxUb > node->maxUb)
+        node->maxUb = node->left->maxUb;
+      if (node->right != NULL && node->right->maxUb > node->maxUb)
+        node->maxUb = node->right->maxUb;
+    }
+
+    static Node* rotateRight(Node* node) {
+      Node* left = node->left;
+      node->left = left->right;
+      left->right = node;
+      update(node);
+      update(left);
+      return left;
+    }
+
+    static Node* rotateLeft(Node* node) {
+      Node* right = node->right;
+      node->right = right->left;
+      right->left = node;
+      update(node);
+      update(right);
+      return right;
+    }
+
+    static Node* insert(Node* root, Node* node) {
+      if (root == NULL)
+        return node;
+      if (before(node->lb, node->key, root)) {
+        root->left = insert(root->left, node);
+        if (root->left->priority > root->priority)
+          return rotateRight(root);
+      }
+      else {
+        root->right = insert(root->right, node);
+        if (root->right->priority > root->priority)
+          return rotateLeft(root);
+      }
+      update(root);
+      return root;
+    }
+
+    static Node* merge(Node* left, Node* right) {
+      if (left == NULL)
+        return right;
+      if (right == NULL)
+        return left;
+      if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+      }
+      right->left = merge(left, right->left);
+      update(right);
+      return right;
+    }
+
+    static Node* remove(Node* root, edouble lb, eint key) {
+      checkError(root != NULL, "Token (" << key << ") is not filed under a start lower bound of " << lb);
+      if (root->key == key) {
+        Node* merged = merge(root->left, root->right);
+        delete root;
+        return merged;
+      }
+      if (before(lb, key, root))
+        root->left = remove(root->left, lb, key);
+      else
+        root->right = remove(root->right, lb, key);
+      update(root);
+      return root;
+    }
+
+    static void query(const Node* node, edouble lb, edouble ub, std::vector<TokenId>& results) {
+      if (node == NULL || node->maxUb < lb)
+        return;
+      query(node->left, lb, ub, results);
+      // Everything to the right starts no earlier than this
+      if (node->lb > ub)
+        return;
+      if (node->ub >= lb)
+        results.push_back(node->token);
+      query(node->right, lb, ub, results);
+    }
+
+    static void destroy(Node* node) {
+      if (node == NULL)
+        return;
+      destroy(node->left);
+      destroy(node->right);
+      delete node;
+    }
+
+    Node* m_root;
+    unsigned long m_seed;
+  };
+
+  TokenIntervalIndex::TokenIntervalIndex(const ConstraintEngineId constraintEngine)
+    : ConstraintEngineListener(constraintEngine), m_trees(), m_entries(), m_tokensByStart(), m_dirty() {}
+
+  TokenIntervalIndex::~TokenIntervalIndex() {
+    for (boost::unordered_map<LabelStr, Tree*>::const_iterator it = m_trees.begin(); it != m_trees.end(); ++it)
+      delete it->second;
+  }
+
+  void TokenIntervalIndex::insert(const TokenId token, const LabelStr& predicate) {
+    Tree*& tree = m_trees[predicate];
+    if (tree == NULL)
+      tree = new Tree();
+
+    std::pair<boost::unordered_map<const Token*, Entry>::iterator, bool> inserted =
+      m_entries.insert(std::make_pair(static_cast<const Token*>(token), Entry()));
+    Entry& entry = inserted.first->second;
+    if (inserted.second) {
+      entry.token = token;
+      entry.start = token->start();
+      m_tokensByStart.insert(std::make_pair(entry.start, inserted.first->first));
+      entry.lb = token->start()->lastDomain().getLowerBound();
+      entry.ub = token->start()->lastDomain().getUpperBound();
+      entry.dirty = false;
+    }
+    entry.trees.push_back(tree);
+    tree->insert(entry.lb, entry.ub, token);
+  }
+
+  void TokenIntervalIndex::remove(const TokenId token) {
+    // Keyed so as not to ask the token for its start, since it may be part way through deletion
+    boost::unordered_map<const Token*, Entry>::iterator it = m_entries.find(static_cast<const Token*>(token));
+    if (it == m_entries.end())
+      return;
+    const Entry& entry = it->second;
+    for (std::vector<Tree*>::const_iterator tree = entry.trees.begin(); tree != entry.trees.end(); ++tree)
+      (*tree)->remove(entry.lb, token);
+    m_tokensByStart.erase(entry.start);
+    m_entries.erase(it);
+  }
+
+  void TokenIntervalIndex::getCandidates(const LabelStr& predicate, edouble lb, edouble ub,
+                                         std::vector<TokenId>& results) {
+    update();
+    boost::unordered_map<LabelStr, Tree*>::const_iterator it = m_trees.find(predicate);
+    if (it == m_trees.end())
+      return;
+    it->second->query(lb, ub, results);
+    std::sort(results.begin(), results.end(), EntityComparator<TokenId>());
+    debugMsg("TokenIntervalIndex:getCandidates",
+             results.size() << " " << predicate.toString() << " tokens start within [" << lb << " " << ub << "]");
+  }
+
+  void TokenIntervalIndex::notifyChanged(const ConstrainedVariableId variable,
+                                         const DomainListener::ChangeType&) {
+    if (m_entries.empty())
+      return;
+    boost::unordered_map<const ConstrainedVariable*, const Token*>::const_iterator token =
+      m_tokensByStart.find(static_cast<const ConstrainedVariable*>(variable));
+    if (token == m_tokensByStart.end())
+      return;
+    Entry& entry = m_entries.find(token->second)->second;
+    if (!entry.dirty) {
+      entry.dirty = true;
+      m_dirty.push_back(token->second);
+    }
+  }
+
+  void TokenIntervalIndex::update() {
+    for (std::vector<const Token*>::const_iterator token = m_dirty.begin(); token != m_dirty.end(); ++token) {
+      // Tokens removed since, or already refiled, are passed over
+      boost::unordered_map<const Token*, Entry>::iterator it = m_entries.find(*token);
+      if (it == m_entries.end() || !it->second.dirty)
+        continue;
+      Entry& entry = it->second;
+      entry.dirty = false;
+      const Domain& start = entry.token->start()->lastDomain();
+      if (start.getLowerBound() == entry.lb && start.getUpperBound() == entry.ub)
+        continue;
+      for (std::vector<Tree*>::const_iterator tree = entry.trees.begin(); tree != entry.trees.end(); ++tree) {
+        (*tree)->remove(entry.lb, entry.token);
+        (*tree)->insert(start.getLowerBound(), start.getUpperBound(), entry.token);
+      }
+      entry.lb = start.getLowerBound();
+      entry.ub = start.getUpperBound();
+    }
+    m_dirty.clear();
+  }
+}
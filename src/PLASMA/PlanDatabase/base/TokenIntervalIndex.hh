@@ -0,0 +1,78 @@
+#ifndef H_TokenIntervalIndex
+#define H_TokenIntervalIndex
+
+/**
+ * @file TokenIntervalIndex.hh
+ * @brief An index of active tokens by the bounds of their start, for finding merge candidates.
+ * @ingroup PlanDatabase
+ */
+
+#include "PlanDatabaseDefs.hh"
+#include "ConstraintEngineListener.hh"
+#include "LabelStr.hh"
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace EUROPA {
+
+  /**
+   * @class TokenIntervalIndex
+   * @brief Active tokens by predicate, each kept in an interval tree over the bounds of their start.
+   *
+   * A token can only be merged with one whose start intersects its own, so candidates are the tokens
+   * of the predicate whose start interval overlaps the query, found in time logarithmic in the number of
+   * tokens plus the number found. Tokens whose start bounds change are noted as they change and moved in
+   * the trees on the next query, once propagation has settled them.
+   */
+  class TokenIntervalIndex : public ConstraintEngineListener {
+  public:
+    TokenIntervalIndex(const ConstraintEngineId constraintEngine);
+
+    ~TokenIntervalIndex();
+
+    /**
+     * @brief Index an active token under a predicate it can be merged as.
+     */
+    void insert(const TokenId token, const LabelStr& predicate);
+
+    /**
+     * @brief Remove a token from every predicate it was indexed under.
+     */
+    void remove(const TokenId token);
+
+    /**
+     * @brief Get the tokens indexed under the predicate whose start bounds overlap [lb, ub], in key order.
+     */
+    void getCandidates(const LabelStr& predicate, edouble lb, edouble ub, std::vector<TokenId>& results);
+
+  private:
+    class Tree;
+
+    struct Entry {
+      TokenId token;
+      const ConstrainedVariable* start;
+      edouble lb; /**< The start bounds the token is filed under in its trees */
+      edouble ub;
+      std::vector<Tree*> trees;
+      bool dirty;
+    };
+
+    void notifyChanged(const ConstrainedVariableId variable, const DomainListener::ChangeType& changeType);
+
+    /**
+     * @brief Refile the tokens whose start bounds have changed since the last query.
+     */
+    void update();
+
+    boost::unordered_map<LabelStr, Tree*> m_trees;
+    boost::unordered_map<const Token*, Entry> m_entries;
+    boost::unordered_map<const ConstrainedVariable*, const Token*> m_tokensByStart;
+    std::vector<const Token*> m_dirty;
+
+    TokenIntervalIndex(const TokenIntervalIndex&);
+    TokenIntervalIndex& operator=(const TokenIntervalIndex&);
+  };
+}
+
+#endif
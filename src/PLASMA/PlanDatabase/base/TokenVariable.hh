@@ -181,6 +181,7 @@ TokenVariable<DomainType>::TokenVariable(const TokenId _parent,
   template <class DomainType>
   void TokenVariable<DomainType>::handleBase(const Domain& domain){
     this->m_integratedBaseDomain->intersect(domain);
+    this->trail();
     this->m_derivedDomain->intersect(domain);
   }
 
@@ -212,6 +213,7 @@ TokenVariable<DomainType>::TokenVariable(const TokenId _parent,
       // The integrated base domain reflects the updated domain which includes the original base domain and this there is
       // no reason to relax twice.
       //this->m_derivedDomain->relax(*(this->m_baseDomain));
+      this->trail();
       this->m_derivedDomain->relax(*(this->m_integratedBaseDomain));
     }
   }
@@ -286,8 +288,10 @@ TokenVariable<DomainType>::TokenVariable(const TokenId _parent,
   void TokenVariable<DomainType>::relax() {
     Variable<DomainType>::relax();
 
-    if(!(this->isSpecified()))
+    if(!(this->isSpecified())) {
+    	this->trail();
     	this->m_derivedDomain->relax(*m_integratedBaseDomain);
+    }
   }
 
 }
@@ -23,16 +23,36 @@
 
 namespace EUROPA {
 
+namespace {
+  /** Orders sequenced tokens by their latest start */
+  class LatestStartBefore {
+  public:
+    bool operator()(const TokenId token, const edouble bound) const {
+      return token->start()->lastDomain().getUpperBound() < bound;
+    }
+  };
+
+  /** Orders sequenced tokens by their earliest end */
+  class EarliestEndAfter {
+  public:
+    bool operator()(const edouble bound, const TokenId token) const {
+      return bound < token->end()->lastDomain().getLowerBound();
+    }
+  };
+}
+
   /** TIMELINE IMPLEMENTATION **/
 
 Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type, 
                    const std::string& name, bool open)
-    : Object(planDatabase, type, name, true), m_tokenSequence(), m_tokenIndex() 
+    : Object(planDatabase, type, name, true), m_tokenSequence(), m_tokenIndex(),
+      m_sequencePositions(), m_sequencePositionsValid(true)
 {commonInit(open);}
 
   Timeline::Timeline(const ObjectId parent, const std::string& type, 
                      const std::string& localName, bool open)
-      : Object(parent, type, localName, true), m_tokenSequence(), m_tokenIndex() 
+      : Object(parent, type, localName, true), m_tokenSequence(), m_tokenIndex(),
+        m_sequencePositions(), m_sequencePositionsValid(true)
 {commonInit(open);}
 
   Timeline::~Timeline(){
@@ -81,37 +101,53 @@ Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type,
     unsigned int choiceCount = 0;
 
     TemporalAdvisorId temporalAdvisor = getPlanDatabase()->getTemporalAdvisor();
+    const std::vector<TokenId>& sequence = getSequencePositions();
+    const unsigned long size = sequence.size();
+
+    // The token cannot precede a token that must start before it can end, nor follow one that
+    // must end after it must start, whatever the advisor. Since latest starts and earliest ends
+    // are ordered along the sequence, that narrows the positions the advisor is asked about to
+    // a window, found by binary search.
+    const unsigned long firstSuccessor =
+        std::lower_bound(sequence.begin(), sequence.end(),
+                         token->end()->lastDomain().getLowerBound(), LatestStartBefore()) -
+        sequence.begin();
+    const unsigned long lastPredecessor =
+        std::upper_bound(sequence.begin(), sequence.end(),
+                         token->start()->lastDomain().getUpperBound(), EarliestEndAfter()) -
+        sequence.begin();
+    debugMsg("Timeline:getOrderingChoices",
+             "Successors from position " << firstSuccessor << " and predecessors before position " <<
+             lastPredecessor << " of " << size);
 
     // Alternatively, we can go through the sequence till we find something that we can precede.
-    std::list<TokenId>::iterator current = m_tokenSequence.begin(); // Start at first token in the sequence
-    const std::list<TokenId>::iterator& last = m_tokenSequence.end(); // For termination criteria
+    unsigned long current = firstSuccessor;
 
     // Move forward until we find a Token we can precede
-    while (current != last) {
-      TokenId successor = *current;
+    while (current < size) {
+      TokenId successor = sequence[current];
       if (temporalAdvisor->canPrecede(token, successor)) {
 	debugMsg("Timeline:getOrderingChoices:canPrecede",
-		 "At first position: " << token->toString() << " precedes " << (*current)->toString());
+		 "At first position: " << token->toString() << " precedes " << successor->toString());
         break;
       }
       else {
-	debugMsg("Timeline:getOrderingChoices:canPrecede"," at first position: " << token->toString() << " cannot precede " << (*current)->toString());      }
+	debugMsg("Timeline:getOrderingChoices:canPrecede"," at first position: " << token->toString() << " cannot precede " << successor->toString());      }
       ++current;
     }
 
     // If it can precede the first one, we do not have to test for fitting between
     // token in the sequence, thus, we should push it back and move on.
-    if (current == m_tokenSequence.begin()) {
+    if (current == 0) {
       debugMsg("Timeline:getOrderingChoices:canPrecede", " precedes the beginning token ");
-      results.push_back(std::make_pair(token, *current));
+      results.push_back(std::make_pair(token, sequence[current]));
       current++;
       choiceCount++;
     }
 
     // Stopping criteria: At the end or at a point where the token cannot come after the current token
-    TokenId lastToken = m_tokenSequence.back();
     bool foundLastPredecessor = false;
-    bool foundLastToken = (current == last);
+    bool foundLastToken = (current == size);
 
     // Now we have to consider the distance between tokens, so need the previous position also.
     // Step back to start the predecessor and current at the right locations
@@ -119,14 +155,14 @@ Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type,
 
     while (!foundLastToken && !foundLastPredecessor && choiceCount < limit) {
       // Prune if the token cannot fit between tokens
-      TokenId predecessor = *(current++);
-      TokenId successor = *current;
+      TokenId predecessor = sequence[current++];
+      TokenId successor = sequence[current];
       check_error(predecessor.isValid() && predecessor->isActive());
       check_error(successor.isValid() && successor->isActive());
 
       // we still need to check that the predecessor can precede the token,
       // otherwise we'll return bogus successors (see PlanDatabse::module-tests::testNoChoicesThatFit
-      if (!temporalAdvisor->canPrecede(predecessor,token)) {
+      if (current > lastPredecessor || !temporalAdvisor->canPrecede(predecessor,token)) {
 	debugMsg("Timeline:getOrderingChoices:canPrecede",predecessor->toString() << " cannot precede " << token->toString());
 	foundLastPredecessor = true;
       }
@@ -143,25 +179,33 @@ Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type,
 	}
       }
 
-      foundLastToken = (successor == lastToken);
+      foundLastToken = (current == size - 1);
     }
 
     // Special case, the token could be placed at the end, which can't precede anything. This
     // results in an ordering choice w.r.t. oneself. For this to be possible, we cannot have already
     // found the last predecessor of the token, but rather we must have come to the end
     if (choiceCount < limit && !foundLastPredecessor){
-      if(temporalAdvisor->canPrecede(m_tokenSequence.back(),token)) {
+      if(size <= lastPredecessor && temporalAdvisor->canPrecede(sequence.back(),token)) {
 	debugMsg("Timeline:getOrderingChoices:canPrecede",
-		 "last entry " << m_tokenSequence.back()->toString() << " precedes " << token->toString());
-	results.push_back(std::make_pair(m_tokenSequence.back(), token));
+		 "last entry " << sequence.back()->toString() << " precedes " << token->toString());
+	results.push_back(std::make_pair(sequence.back(), token));
       }
       else{
 	debugMsg("Timeline:getOrderingChoices:canPrecede",
-		 "last entry " << m_tokenSequence.back()->toString() << " cannot precede " << token->toString());
+		 "last entry " << sequence.back()->toString() << " cannot precede " << token->toString());
       }
     }
   }
 
+  const std::vector<TokenId>& Timeline::getSequencePositions() {
+    if (!m_sequencePositionsValid) {
+      m_sequencePositions.assign(m_tokenSequence.begin(), m_tokenSequence.end());
+      m_sequencePositionsValid = true;
+    }
+    return m_sequencePositions;
+  }
+
   void Timeline::getTokensToOrder(std::vector<TokenId>& results) {
     check_error(results.empty());
 
@@ -315,6 +359,7 @@ Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type,
     // Erase the current token from the sequence and index
     m_tokenSequence.erase(token_it->second);
     m_tokenIndex.erase(token_it);
+    m_sequencePositionsValid = false;
 
     // May have to post a constraint between earlier and later if none exists already in the case
     // where the token is surrounded
@@ -504,10 +549,12 @@ Timeline::Timeline(const PlanDatabaseId planDatabase, const std::string& type,
   void Timeline::insertToIndex(const TokenId token, const std::list<TokenId>::iterator& position){
     // Remove the cache entry for this token as it is now inserted
     m_tokenIndex.insert(std::make_pair(token->getKey(), position));
+    m_sequencePositionsValid = false;
   }
 
   void Timeline::removeFromIndex(const TokenId token){
     m_tokenIndex.erase(token->getKey());
+    m_sequencePositionsValid = false;
     notifyOrderingRequired(token);
   }
 
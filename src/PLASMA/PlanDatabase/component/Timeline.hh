@@ -71,6 +71,11 @@ namespace EUROPA {
     void add(const ObjectId object) {Object::add(object);}
     void remove(const ObjectId object) {Object::remove(object);}
 
+    /**
+     * @brief The sequence as a vector, rebuilt when the sequence has changed, for binary search.
+     */
+    const std::vector<TokenId>& getSequencePositions();
+
     void insertToIndex(const TokenId token, const std::list<TokenId>::iterator& position);
     void removeFromIndex(const TokenId token);
     bool orderingRequired(const TokenId token);
@@ -106,6 +111,14 @@ namespace EUROPA {
     /** Index to find position in sequence by Token */
     std::map<eint, std::list<TokenId>::iterator > m_tokenIndex;
 
+    /**
+     * The sequence by position. Along it, both the latest starts and the earliest ends of the
+     * tokens are non-decreasing, as long as we are constraint consistent, so the positions a
+     * token could be ordered at are found by binary search on them.
+     */
+    std::vector<TokenId> m_sequencePositions;
+    bool m_sequencePositionsValid;
+
     static const bool CLEANING_UP = true;
   };
 
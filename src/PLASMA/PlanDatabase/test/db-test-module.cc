@@ -9,6 +9,7 @@
 #include "EventToken.hh"
 #include "TokenVariable.hh"
 #include "Timeline.hh"
+#include "TemporalAdvisor.hh"
 #include "CommonAncestorConstraint.hh"
 #include "HasAncestorConstraint.hh"
 #include "DbClientTransactionLog.hh"
@@ -689,9 +690,24 @@ private:
     CPPUNIT_ASSERT(ancestors.front() == id3);
     CPPUNIT_ASSERT(ancestors.back() == id1);
 
+    // Lookups by name and type
+    CPPUNIT_ASSERT(db->getObject("id1.id3") == id3);
+    CPPUNIT_ASSERT(db->getObject("o1") == o1.getId());
+    CPPUNIT_ASSERT(db->getObject("noSuchObjectEverNamed").isNoId());
+    CPPUNIT_ASSERT(!LabelStr::isString("noSuchObjectEverNamed"));
+    std::list<ObjectId> objects;
+    db->getObjectsByType(DEFAULT_OBJECT_TYPE, objects);
+    CPPUNIT_ASSERT(objects.size() == 7);
+    CPPUNIT_ASSERT(objects.front() == o1.getId());
+
     // Force cascaded delete
     delete static_cast<Object*>(id1);
     CPPUNIT_ASSERT(db->getObjects().size() == 3);
+    CPPUNIT_ASSERT(db->getObject("id1.id3").isNoId());
+    objects.clear();
+    db->getObjectsByType(DEFAULT_OBJECT_TYPE, objects);
+    CPPUNIT_ASSERT(objects.size() == 3);
+    CPPUNIT_ASSERT(db->hasObjectInstances(DEFAULT_OBJECT_TYPE));
 
     // Now allocate dynamically and allow the plan database to clean it up when it deallocates
     ObjectId id5 = ((new Object(db, LabelStr(DEFAULT_OBJECT_TYPE), "id5"))->getId());
@@ -1190,6 +1206,7 @@ public:
     EUROPA_runTest(testOpenMerge);
     EUROPA_runTest(testGNATS_3086);
     EUROPA_runTest(testCompatCacheReset);
+    EUROPA_runTest(testCompatibleTokenIndex);
     EUROPA_runTest(testAssignemnt);
     EUROPA_runTest(testDeleteMasterAndPreserveSlave);
     EUROPA_runTest(testPreserveMergeWithNonChronSplit);
@@ -2535,6 +2552,116 @@ private:
     return true;
   }
 
+  /**
+   * Compatible tokens found by testing every active token of the predicate.
+   */
+  static void scanCompatibleTokens(const PlanDatabaseId& db, const TokenId& token, std::vector<TokenId>& results){
+    const TokenSet& candidates = db->getActiveTokens(token->getPredicateName());
+    for(TokenSet::const_iterator it = candidates.begin(); it != candidates.end(); ++it){
+      bool isCompatible = true;
+      for(unsigned int i = 1; i < token->getVariables().size() && isCompatible; i++)
+        isCompatible = token->getVariables()[i]->lastDomain().intersects((*it)->getVariables()[i]->lastDomain());
+      if(isCompatible)
+        results.push_back(*it);
+    }
+  }
+
+  static bool checkCompatibleTokens(const PlanDatabaseId& db, const TokenId& token){
+    std::vector<TokenId> results, expected;
+    db->getCompatibleTokens(token, results);
+    scanCompatibleTokens(db, token, expected);
+    return results == expected;
+  }
+
+  static bool testCompatibleTokenIndex() {
+    DEFAULT_SETUP(ce, db, false);
+    Timeline timeline(db, LabelStr(DEFAULT_OBJECT_TYPE), "o2");
+    db->close();
+
+    const int COUNT = 200;
+    std::vector<TokenId> tokens;
+    for (int i = 0; i < COUNT; i++){
+      TokenId token = (new IntervalToken(db,
+                                         LabelStr(DEFAULT_PREDICATE),
+                                         true,
+                                         false,
+                                         IntervalIntDomain(i*5, i*5 + 20),
+                                         IntervalIntDomain(),
+                                         IntervalIntDomain(1, 10)))->getId();
+      token->activate();
+      tokens.push_back(token);
+    }
+
+    TokenId token = (new IntervalToken(db,
+                                       LabelStr(DEFAULT_PREDICATE),
+                                       true,
+                                       false,
+                                       IntervalIntDomain(300, 340),
+                                       IntervalIntDomain(),
+                                       IntervalIntDomain(1, 10)))->getId();
+    CPPUNIT_ASSERT(ce->propagate());
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+
+    std::vector<TokenId> results;
+    db->getCompatibleTokens(token, results);
+    CPPUNIT_ASSERT(results.size() == 13);
+    results.clear();
+    db->getCompatibleTokens(token, results, 3, false);
+    CPPUNIT_ASSERT(results.size() == 3);
+    CPPUNIT_ASSERT(results.front() == tokens[56]);
+
+    // Tokens moving out of the window and back
+    tokens[58]->start()->specify(290);
+    tokens[60]->start()->specify(305);
+    tokens[67]->start()->specify(350);
+    CPPUNIT_ASSERT(ce->propagate());
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+    results.clear();
+    db->getCompatibleTokens(token, results);
+    CPPUNIT_ASSERT(results.size() == 11);
+    tokens[58]->start()->reset();
+    tokens[67]->start()->reset();
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+
+    // Tokens leaving and rejoining the active set
+    tokens[62]->cancel();
+    tokens[0]->cancel();
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+    tokens[62]->activate();
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+
+    // Other variables still count
+    token->duration()->restrictBaseDomain(IntervalIntDomain(10, 10));
+    tokens[65]->duration()->restrictBaseDomain(IntervalIntDomain(1, 2));
+    CPPUNIT_ASSERT(ce->propagate());
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+
+    // Testing candidates one at a time yields the same tokens in the same order
+    std::vector<TokenId> candidates;
+    db->getMergeCandidates(token, candidates);
+    std::vector<TokenId> compatible;
+    for (std::vector<TokenId>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+      if (db->isCompatible(token, *it, false))
+        compatible.push_back(*it);
+    results.clear();
+    db->getCompatibleTokens(token, results);
+    CPPUNIT_ASSERT(compatible == results);
+    CPPUNIT_ASSERT(std::find(candidates.begin(), candidates.end(), tokens[65]) != candidates.end());
+    CPPUNIT_ASSERT(std::find(results.begin(), results.end(), tokens[65]) == results.end());
+
+    // Deleting active tokens
+    delete (Token*) tokens[64];
+    tokens.erase(tokens.begin() + 64);
+    CPPUNIT_ASSERT(checkCompatibleTokens(db, token));
+
+    delete (Token*) token;
+    for (unsigned int i = 0; i < tokens.size(); i++)
+      delete (Token*) tokens[i];
+
+    DEFAULT_TEARDOWN();
+    return true;
+  }
+
   static bool testCompatCacheReset() {
       DEFAULT_SETUP(ce, db, false);
       unused(ObjectId timeline) = (new Timeline(db, LabelStr(DEFAULT_OBJECT_TYPE), "o2"))->getId();
@@ -2877,6 +3004,7 @@ public:
     EUROPA_runTest(testTokenOrderQuery);
     EUROPA_runTest(testEventTokenInsertion);
     EUROPA_runTest(testNoChoicesThatFit);
+    EUROPA_runTest(testOrderingChoiceWindow);
     EUROPA_runTest(testAssignment);
     EUROPA_runTest(testFreeAndConstrain);
     EUROPA_runTest(testRemovalOfMasterAndSlave);
@@ -3429,6 +3557,111 @@ private:
     return true;
   }
 
+  /**
+   * Ordering choices found by walking the whole sequence, asking the advisor at every position.
+   */
+  static void scanOrderingChoices(const TimelineId& timeline, const TokenId& token, unsigned long limit,
+                                  std::vector<std::pair<TokenId, TokenId> >& results){
+    TemporalAdvisorId advisor = timeline->getPlanDatabase()->getTemporalAdvisor();
+    const std::list<TokenId>& sequence = timeline->getTokenSequence();
+    std::list<TokenId>::const_iterator it = sequence.begin();
+    if(advisor->canPrecede(token, *it)){
+      results.push_back(std::make_pair(token, *it));
+      if(results.size() == limit)
+        return;
+    }
+    for(std::list<TokenId>::const_iterator next = ++sequence.begin(); next != sequence.end(); ++it, ++next){
+      if(!advisor->canPrecede(*it, token))
+        return;
+      if(advisor->canPrecede(token, *next) && advisor->canFitBetween(token, *it, *next)){
+        results.push_back(std::make_pair(token, *next));
+        if(results.size() == limit)
+          return;
+      }
+    }
+    if(advisor->canPrecede(sequence.back(), token))
+      results.push_back(std::make_pair(sequence.back(), token));
+  }
+
+  static bool testOrderingChoiceWindow(){
+    DEFAULT_SETUP(ce, db, false);
+    Timeline timeline(db, LabelStr(DEFAULT_OBJECT_TYPE), "o2");
+    db->close();
+
+    const int COUNT = 50;
+    const int DURATION = 10;
+
+    // A sequence with a little slack between tokens
+    std::vector<TokenId> tokens;
+    for (int i = 0; i < COUNT; i++){
+      TokenId token = (new IntervalToken(db,
+                                         LabelStr(DEFAULT_PREDICATE),
+                                         true,
+                                         false,
+                                         IntervalIntDomain(i*20, i*20 + 5),
+                                         IntervalIntDomain(),
+                                         IntervalIntDomain(DURATION, DURATION)))->getId();
+      token->activate();
+      if(tokens.empty())
+        timeline.constrain(token, token);
+      else
+        timeline.constrain(tokens.back(), token);
+      tokens.push_back(token);
+    }
+    CPPUNIT_ASSERT(ce->propagate());
+
+    // Tokens fitting nowhere, in the middle, anywhere, and only at either end
+    IntervalIntDomain starts[] = {IntervalIntDomain(300, 305), IntervalIntDomain(295, 400),
+                                  IntervalIntDomain(), IntervalIntDomain(-100, -10),
+                                  IntervalIntDomain(2000, 3000)};
+    unsigned long limits[] = {1, 3, std::numeric_limits<unsigned long>::max()};
+    for (unsigned int i = 0; i < 5; i++){
+      TokenId token = (new IntervalToken(db,
+                                         LabelStr(DEFAULT_PREDICATE),
+                                         true,
+                                         false,
+                                         starts[i],
+                                         IntervalIntDomain(),
+                                         IntervalIntDomain(DURATION, DURATION)))->getId();
+      token->activate();
+      for (unsigned int j = 0; j < 3; j++){
+        std::vector<std::pair<TokenId, TokenId> > choices, expected;
+        timeline.getOrderingChoices(token, choices, limits[j]);
+        scanOrderingChoices(timeline.getId(), token, limits[j], expected);
+        CPPUNIT_ASSERT(choices == expected);
+        CPPUNIT_ASSERT(i != 0 || choices.empty());
+        CPPUNIT_ASSERT(i != 2 || choices.size() == std::min<unsigned long>(limits[j], COUNT + 1));
+      }
+      delete (Token*) token;
+    }
+
+    // The positions follow changes to the sequence
+    timeline.free(tokens[24], tokens[25]);
+    timeline.free(tokens[25], tokens[26]);
+    CPPUNIT_ASSERT(ce->propagate());
+    std::vector<std::pair<TokenId, TokenId> > choices, expected;
+    timeline.getOrderingChoices(tokens[25], choices);
+    scanOrderingChoices(timeline.getId(), tokens[25], std::numeric_limits<unsigned long>::max(), expected);
+    CPPUNIT_ASSERT(choices == expected);
+    CPPUNIT_ASSERT(!choices.empty());
+
+    // Including deletion of a sequenced token
+    delete (Token*) tokens[10];
+    tokens.erase(tokens.begin() + 10);
+    CPPUNIT_ASSERT(ce->propagate());
+    choices.clear();
+    expected.clear();
+    timeline.getOrderingChoices(tokens[24], choices);
+    scanOrderingChoices(timeline.getId(), tokens[24], std::numeric_limits<unsigned long>::max(), expected);
+    CPPUNIT_ASSERT(choices == expected);
+
+    for (unsigned int i = 0; i < tokens.size(); i++)
+      delete (Token*) tokens[i];
+
+    DEFAULT_TEARDOWN();
+    return true;
+  }
+
   static bool testAssignment(){
       DEFAULT_SETUP(ce, db, false);
     Timeline o1(db, LabelStr(DEFAULT_OBJECT_TYPE), "tl1");
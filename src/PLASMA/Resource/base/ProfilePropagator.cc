@@ -54,9 +54,7 @@ void ProfilePropagator::execute() {
   check_error(m_activeConstraint == 0);
 
   while(!m_agenda.empty() && !getConstraintEngine()->provenInconsistent()) {
-    ConstraintSet::iterator it = m_agenda.begin();
-    ConstraintId constraint = *it;
-    m_agenda.erase(constraint);
+    ConstraintId constraint = m_agenda.pop();
     if(constraint->isActive()) {
       m_activeConstraint = constraint->getKey();
       execute(constraint);
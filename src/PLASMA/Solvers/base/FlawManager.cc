@@ -4,9 +4,13 @@
 #include "FlawFilter.hh"
 #include "FlawHandler.hh"
 #include "Token.hh"
+#include "RuleInstance.hh"
 #include "Debug.hh"
 #include "ConstraintEngineListener.hh"
+#include "tinyxml.h"
 
+#include <cstring>
+#include <sstream>
 #include <boost/smart_ptr/make_shared.hpp>
 
 /**
@@ -28,6 +32,46 @@ using HASH_NS::hash_map;
 namespace EUROPA {
 namespace SOLVERS {
 
+namespace {
+  /**
+   * @brief The token an entity belongs to: the entity itself, or the token of the variable or of
+   * the rule instance the variable belongs to.
+   */
+  TokenId owningToken(const EntityId entity) {
+    if(TokenId::convertable(entity))
+      return entity;
+    if(!ConstrainedVariableId::convertable(entity))
+      return TokenId::noId();
+
+    EntityId parent = ConstrainedVariableId(entity)->parent();
+    if(parent.isNoId())
+      return TokenId::noId();
+    if(RuleInstanceId::convertable(parent))
+      return RuleInstanceId(parent)->getToken();
+    if(TokenId::convertable(parent))
+      return parent;
+    return TokenId::noId();
+  }
+
+  void writeTokenName(const TokenId token, std::ostream& os) {
+    TokenId master = token->master();
+    if(master.isNoId()) {
+      os << token->getKey();
+      return;
+    }
+
+    unsigned int occurrence = 0;
+    const TokenSet& siblings = master->slaves();
+    for(TokenSet::const_iterator it = siblings.begin(); it != siblings.end() && *it != token; ++it) {
+      if((*it)->getRelation() == token->getRelation() && (*it)->getPredicateName() == token->getPredicateName())
+        occurrence++;
+    }
+
+    writeTokenName(master, os);
+    os << "/" << token->getRelation() << " " << token->getPredicateName() << "#" << occurrence;
+  }
+}
+
 class FlawManager::Listener : public ConstraintEngineListener {
  public:
   //TODO: investigate why this can't be a reference
@@ -37,13 +81,21 @@ class FlawManager::Listener : public ConstraintEngineListener {
   void notifyChanged(const ConstrainedVariableId variable,
                      const DomainListener::ChangeType&) {
     m_flawManager->updateGuards(*variable);
+    m_flawManager->readmitFlaws(variable);
+  }
+  void notifyRemoved(const ConstrainedVariableId variable) {ConstraintEngineListener::notifyRemoved(variable);}
+  void notifyRemoved(const ConstraintId constraint) {
+    // Removing a constraint may admit a variable the guard filter excluded
+    const std::vector<ConstrainedVariableId>& scope = constraint->getScope();
+    for(std::vector<ConstrainedVariableId>::const_iterator it = scope.begin(); it != scope.end(); ++it)
+      m_flawManager->readmitFlaws((*it)->getKey());
   }
  private:
   FlawManager* m_flawManager;
 };
 
   
-FlawManager::FlawManager(const TiXmlElement& configData)
+FlawManager::FlawManager(const TiXmlElement& configData, bool queueFlaws)
     : Component(configData) 
     , m_db()
     , m_parent()
@@ -56,7 +108,19 @@ FlawManager::FlawManager(const TiXmlElement& configData)
     , m_timestamp(0)
     , m_context()
     , m_ceListener()
+    , m_queueFlaws(queueFlaws)
+    , m_flawQueue()
+    , m_flawPriorities()
+    , m_unprioritizedFlaws()
+    , m_excludedFlaws()
+    , m_exclusionWatches()
+    , m_randomTieBreaking(false)
+    , m_random()
+    , m_conflictCounts(NULL)
 {
+  const char* queueFlawsData = configData.Attribute("queueFlaws");
+  if(queueFlawsData != NULL && strcmp(queueFlawsData, "false") == 0)
+    m_queueFlaws = false;
 }
 
     FlawManager::~FlawManager()
@@ -224,6 +288,8 @@ FlawManager::FlawManager(const TiXmlElement& configData)
       condDebugMsg(m_dynamicFiltersByKey.find(var->getKey()) != m_dynamicFiltersByKey.end(), "FlawManager:erase:dynamic", " [" << __FILE__ << ":" << __LINE__ << "] removing entries with key " << var->getKey() << " from m_dynamicFiltersByKey");
       m_dynamicFiltersByKey.erase(var->getKey());
 
+      dequeueFlaw(var);
+
       // Handle a guard variable getting removed before the flawed variable does.
       for(std::multimap<eint, boost::shared_ptr<FlawHandler::VariableListener> >::iterator it = m_flawHandlerGuards.begin(); it != m_flawHandlerGuards.end();) {
         debugMsg("FlawManager:notifyRemoved", "Removing from a guard in m_flawHandlerGuards.");
@@ -250,6 +316,7 @@ FlawManager::FlawManager(const TiXmlElement& configData)
                 }
               }
             }
+            requeueFlaw(listener->getTarget());
             m_flawHandlerGuards.erase(it++);
           }
           else
@@ -287,6 +354,8 @@ FlawManager::FlawManager(const TiXmlElement& configData)
 
         condDebugMsg(m_dynamicFiltersByKey.find(var->parent()->getKey()) != m_dynamicFiltersByKey.end(), "FlawManager:erase:dynamic", " [" << __FILE__ << ":" << __LINE__ << "] removing entries with key " << var->parent()->getKey() << " from m_dynamicFiltersByKey");
         m_dynamicFiltersByKey.erase(var->parent()->getKey());
+
+        dequeueFlaw(var->parent());
       }
       condDebugMsg(!isValid(), "FlawManager:isValid", "Invalid datastructures in flaw manger.");
     }
@@ -322,6 +391,8 @@ FlawManager::FlawManager(const TiXmlElement& configData)
       condDebugMsg(m_dynamicFiltersByKey.find(token->getKey()) != m_dynamicFiltersByKey.end(), "FlawManager:erase:dynamic", " [" << __FILE__ << ":" << __LINE__ << "] removing entries with key " << token->getKey() << " from m_dynamicFiltersByKey");
       m_dynamicFiltersByKey.erase(token->getKey());
 
+      dequeueFlaw(token);
+
       condDebugMsg(!isValid(), "FlawManager:isValid", getId() << " Invalid datastructures in flaw manager.");
     }
 
@@ -338,59 +409,52 @@ FlawManager::FlawManager(const TiXmlElement& configData)
 
       // Initialize the prority to beat
       Priority bestP =  bestPriority - (2 * cast_double(EPSILON));
-      IteratorId it = createIterator();
 
       std::string explanation = "unknown";
-      // Now go through the candidates
-      while(!it->done()){
+      unsigned int ties = 0;
+      if(m_queueFlaws){
+        prioritizeFlaws();
+        synchronize();
 
-        // Get the next flaw candidate
-        const EntityId candidate = it->next();
-        checkError(candidate.isValid(), "Iterator bug returning a noId");
-        checkError(!dynamicMatch(candidate), "Iterator bug allowing " << candidate->toString());
+        // Candidates come in order of priority, so none past the first that is worse than the
+        // best so far can replace it.
+        FlawQueue::iterator it = m_flawQueue.begin();
+        while(it != m_flawQueue.end()){
+          const Priority priority = it->first.first;
+          if(priority - bestP >= EPSILON)
+            break;
 
-        debugMsg("FlawManager:next", "Evaluating " << candidate->toString() << " to beat " << bestP);
+          const EntityId candidate = it->second;
+          checkError(candidate.isValid(), "Invalid flaw in the queue for key " << it->first.second);
+          if(dynamicMatch(candidate)){
+            m_flawPriorities.erase(it->first.second);
+            m_flawQueue.erase(it++);
+            excludeFlaw(candidate);
+            continue;
+          }
 
-        Priority priority = getPriority(candidate);
+          if(!evaluateCandidate(candidate, priority, bestP, flawToResolve, ties, explanation))
+            break;
+          ++it;
+        }
+      }
+      else {
+        IteratorId it = createIterator();
 
-        // >= +EPSILON if priority < bestP
-        // <= -EPSILON if priority > bestP
-        // > -EPSILON && < EPSILON if priority == bestP
-        Priority priorityDiff = bestP - priority; 
+        // Now go through the candidates
+        while(!it->done()){
 
-        debugMsg("FlawManager:next", "Got priority " << priority);
-        // If we have a better candidate
+          // Get the next flaw candidate
+          const EntityId candidate = it->next();
+          checkError(candidate.isValid(), "Iterator bug returning a noId");
+          checkError(!dynamicMatch(candidate), "Iterator bug allowing " << candidate->toString());
 
-        //is this a bug?
-        if(priorityDiff >= EPSILON){
-          debugMsg("FlawManager:next", "Updating because priority " << priority << 
-                   " is better than old best (" << bestP << ")");          
-          flawToResolve = candidate;
-          bestP = priority;
-          explanation = "priority";
-          debugMsg("FlawManager:next", "Updating flaw to resolve " << candidate->getKey() << ") " << candidate->toString());          
-          if(bestP == getBestCasePriority())
+          if(!evaluateCandidate(candidate, getPriority(candidate), bestP, flawToResolve, ties, explanation))
             break;
         }
-        else if((std::abs(priorityDiff) < EPSILON && betterThan(candidate, flawToResolve, explanation))){
-          debugMsg("FlawManager:next",
-                   "Updating because candidate is judged better than old candidate.");
-          flawToResolve = candidate;
-          bestP = priority;
-          //explanation = "preference";
-          debugMsg("FlawManager:next", "Updating flaw to resolve (" << candidate->getKey() << ") " << candidate->toString());          
-          if(bestP == getBestCasePriority())
-            break;
-        }
-        
-        //         condDebugMsg(priorityDiff <= -EPSILON || std::abs(priorityDiff) < EPSILON, "FlawManager:next", "Priority for " << candidate->toString() << " (" << 
-        //                      priority << ") is not better than the current best (" << bestP << ")");
-        //         condDebugMsg(std::abs(priorityDiff) < EPSILON && !betterThan(candidate, flawToResolve), "FlawManager:next", "Candidate " <<
-        //                      candidate->toString() << " isn't better than the current best flaw (" << 
-        //                      flawToResolve->toString() << ")");
-      }
 
-      delete static_cast<Iterator*>(it);
+        delete static_cast<Iterator*>(it);
+      }
 
       DecisionPointId decision;
       if(flawToResolve.isId()){
@@ -402,6 +466,259 @@ FlawManager::FlawManager(const TiXmlElement& configData)
       return decision;
     }
 
+    /**
+     * @brief Make the candidate the flaw to resolve if it beats the best so far.
+     * @return false if the best case priority has been reached, so there is no need to look further.
+     */
+    bool FlawManager::evaluateCandidate(const EntityId candidate, const Priority priority, Priority& bestP,
+                                        EntityId& flawToResolve, unsigned int& ties, std::string& explanation){
+      debugMsg("FlawManager:next", "Evaluating " << candidate->toString() << " to beat " << bestP);
+
+      // >= +EPSILON if priority < bestP
+      // <= -EPSILON if priority > bestP
+      // > -EPSILON && < EPSILON if priority == bestP
+      Priority priorityDiff = bestP - priority; 
+
+      debugMsg("FlawManager:next", "Got priority " << priority);
+      // If we have a better candidate
+
+      //is this a bug?
+      if(priorityDiff >= EPSILON){
+        debugMsg("FlawManager:next", "Updating because priority " << priority << 
+                 " is better than old best (" << bestP << ")");          
+        flawToResolve = candidate;
+        bestP = priority;
+        ties = 1;
+        explanation = "priority";
+        debugMsg("FlawManager:next", "Updating flaw to resolve " << candidate->getKey() << ") " << candidate->toString());          
+      }
+      else if((std::abs(priorityDiff) < EPSILON && breakTie(candidate, flawToResolve, ties, explanation))){
+        debugMsg("FlawManager:next",
+                 "Updating because candidate is judged better than old candidate.");
+        flawToResolve = candidate;
+        bestP = priority;
+        //explanation = "preference";
+        debugMsg("FlawManager:next", "Updating flaw to resolve (" << candidate->getKey() << ") " << candidate->toString());          
+      }
+      else
+        return true;
+
+      return bestP != getBestCasePriority();
+    }
+
+    /**
+     * @brief Decide between a candidate and the flaw to resolve so far, which have the same priority.
+     * With random tie breaking, a candidate still tied with the ties before it replaces them with
+     * probability 1/ties, so each is equally likely to be chosen in the end.
+     */
+    bool FlawManager::breakTie(const EntityId candidate, const EntityId flawToResolve, unsigned int& ties,
+                               std::string& explanation){
+      if(!m_randomTieBreaking || flawToResolve.isNoId()){
+        ties = 1;
+        return betterThan(candidate, flawToResolve, explanation);
+      }
+
+      std::string unused;
+      if(betterThan(candidate, flawToResolve, explanation)){
+        ties = 1;
+        return true;
+      }
+      if(betterThan(flawToResolve, candidate, unused))
+        return false;
+
+      unsigned int candidateConflicts = getConflictCount(candidate);
+      unsigned int bestConflicts = getConflictCount(flawToResolve);
+      if(candidateConflicts != bestConflicts){
+        if(candidateConflicts < bestConflicts)
+          return false;
+        ties = 1;
+        explanation = "conflicts";
+        return true;
+      }
+
+      ties++;
+      if(m_random() % ties != 0)
+        return false;
+      explanation = "random";
+      return true;
+    }
+
+    unsigned int FlawManager::getConflictCount(const EntityId entity) const {
+      if(m_conflictCounts->empty())
+        return 0;
+      ConflictCounts::const_iterator it = m_conflictCounts->find(getConflictKey(entity));
+      return (it == m_conflictCounts->end() ? 0 : it->second);
+    }
+
+    std::string FlawManager::getConflictKey(const EntityId entity) {
+      std::ostringstream os;
+      if(TokenId::convertable(entity))
+        writeTokenName(entity, os);
+      else if(ConstrainedVariableId::convertable(entity)) {
+        ConstrainedVariableId variable(entity);
+        EntityId parent = variable->parent();
+        if(parent.isId() && TokenId::convertable(parent)) {
+          writeTokenName(parent, os);
+          os << ".";
+        }
+        else if(parent.isId() && RuleInstanceId::convertable(parent)) {
+          writeTokenName(RuleInstanceId(parent)->getToken(), os);
+          os << ":";
+        }
+        os << variable->getName();
+      }
+      else
+        os << "#" << entity->getKey();
+      return os.str();
+    }
+
+    void FlawManager::setTieBreaking(unsigned int seed, const ConflictCounts& conflictCounts){
+      m_randomTieBreaking = true;
+      m_random.seed(seed);
+      m_conflictCounts = &conflictCounts;
+    }
+
+    void FlawManager::enqueueFlaw(const EntityId entity){
+      if(!m_queueFlaws)
+        return;
+
+      eint key = entity->getKey();
+      if(m_flawPriorities.find(key) == m_flawPriorities.end()){
+        removeExclusion(key);
+        m_unprioritizedFlaws.insert(std::make_pair(key, entity));
+      }
+    }
+
+    void FlawManager::dequeueFlaw(const EntityId entity){
+      eint key = entity->getKey();
+      std::map<eint, Priority>::iterator it = m_flawPriorities.find(key);
+      if(it != m_flawPriorities.end()){
+        m_flawQueue.erase(std::make_pair(it->second, key));
+        m_flawPriorities.erase(it);
+      }
+      m_unprioritizedFlaws.erase(key);
+      removeExclusion(key);
+    }
+
+    /**
+     * The flaw handlers for a queued flaw have changed, so its priority must be computed again.
+     */
+    void FlawManager::requeueFlaw(const EntityId entity){
+      std::map<eint, Priority>::iterator it = m_flawPriorities.find(entity->getKey());
+      if(it == m_flawPriorities.end())
+        return;
+
+      debugMsg("FlawManager:requeueFlaw", "Requeueing " << entity->getKey() << " held under priority " << it->second);
+      m_flawQueue.erase(std::make_pair(it->second, entity->getKey()));
+      m_flawPriorities.erase(it);
+      m_unprioritizedFlaws.insert(std::make_pair(entity->getKey(), entity));
+    }
+
+    /**
+     * Flaws are only prioritized once they pass the dynamic filters, since that is when their flaw
+     * handlers would first be loaded by a full scan. Those that fail are set aside until they may
+     * pass again. Loading a handler may propagate, which may in turn queue, requeue or readmit other
+     * flaws, so keep going until none are left.
+     */
+    void FlawManager::prioritizeFlaws(){
+      while(!m_unprioritizedFlaws.empty()){
+        std::map<eint, EntityId>::iterator it = m_unprioritizedFlaws.begin();
+        eint key = it->first;
+        EntityId flaw = it->second;
+        m_unprioritizedFlaws.erase(it);
+
+        if(dynamicMatch(flaw)){
+          excludeFlaw(flaw);
+          continue;
+        }
+
+        Priority priority = getPriority(flaw);
+        debugMsg("FlawManager:prioritizeFlaws", "Queueing " << key << " with priority " << priority);
+        m_flawQueue.insert(std::make_pair(std::make_pair(priority, key), flaw));
+        m_flawPriorities.insert(std::make_pair(key, priority));
+      }
+    }
+
+    /**
+     * The dynamic filters test a flaw's own domain, the state and timepoints of its token and
+     * whether the token's master is assigned. So a flaw they exclude is watched under its own key,
+     * its token's and its master's, and readmitted when a variable of any of them changes.
+     */
+    void FlawManager::excludeFlaw(const EntityId entity){
+      eint key = entity->getKey();
+      std::vector<eint> watches(1, key);
+      TokenId token = owningToken(entity);
+      if(token.isId()){
+        if(token->getKey() != key)
+          watches.push_back(token->getKey());
+        if(token->master().isId())
+          watches.push_back(token->master()->getKey());
+      }
+
+      debugMsg("FlawManager:excludeFlaw", "Setting aside " << key << " until it may pass the dynamic filters");
+      checkError(m_excludedFlaws.find(key) == m_excludedFlaws.end(), "Already excluded " << key);
+      for(std::vector<eint>::const_iterator it = watches.begin(); it != watches.end(); ++it)
+        m_exclusionWatches.insert(std::make_pair(*it, key));
+      m_excludedFlaws.insert(std::make_pair(key, std::make_pair(entity, watches)));
+    }
+
+    bool FlawManager::removeExclusion(const eint key){
+      ExcludedFlaws::iterator it = m_excludedFlaws.find(key);
+      if(it == m_excludedFlaws.end())
+        return false;
+
+      const std::vector<eint>& watches = it->second.second;
+      for(std::vector<eint>::const_iterator watchIt = watches.begin(); watchIt != watches.end(); ++watchIt){
+        std::multimap<eint, eint>::iterator entryIt = m_exclusionWatches.lower_bound(*watchIt);
+        while(entryIt != m_exclusionWatches.end() && entryIt->first == *watchIt){
+          if(entryIt->second == key)
+            m_exclusionWatches.erase(entryIt++);
+          else
+            ++entryIt;
+        }
+      }
+      m_excludedFlaws.erase(it);
+      return true;
+    }
+
+    /**
+     * Readmitted flaws are tested against the dynamic filters again when next is called.
+     */
+    void FlawManager::readmitFlaws(const eint watchKey){
+      std::vector<eint> keys;
+      for(std::multimap<eint, eint>::const_iterator it = m_exclusionWatches.lower_bound(watchKey);
+          it != m_exclusionWatches.end() && it->first == watchKey; ++it)
+        keys.push_back(it->second);
+
+      for(std::vector<eint>::const_iterator it = keys.begin(); it != keys.end(); ++it){
+        ExcludedFlaws::const_iterator flawIt = m_excludedFlaws.find(*it);
+        if(flawIt == m_excludedFlaws.end())
+          continue;
+        EntityId flaw = flawIt->second.first;
+        debugMsg("FlawManager:readmitFlaws", "Readmitting " << *it << " on a change to " << watchKey);
+        removeExclusion(*it);
+        m_unprioritizedFlaws.insert(std::make_pair(*it, flaw));
+      }
+    }
+
+    void FlawManager::readmitAll(){
+      debugMsg("FlawManager:readmitAll", "Readmitting " << m_excludedFlaws.size() << " flaws");
+      for(ExcludedFlaws::const_iterator it = m_excludedFlaws.begin(); it != m_excludedFlaws.end(); ++it)
+        m_unprioritizedFlaws.insert(std::make_pair(it->first, it->second.first));
+      m_excludedFlaws.clear();
+      m_exclusionWatches.clear();
+    }
+
+    void FlawManager::readmitFlaws(const ConstrainedVariableId variable){
+      if(m_excludedFlaws.empty())
+        return;
+
+      readmitFlaws(variable->getKey());
+      TokenId token = owningToken(variable);
+      if(token.isId())
+        readmitFlaws(token->getKey());
+    }
+
     bool FlawManager::inScope(const EntityId entity) {
       checkError(m_db->getConstraintEngine()->constraintConsistent(), 
                  "Assumes the database is constraint consistent but it is not.");
@@ -639,6 +956,7 @@ FlawManager::FlawManager(const TiXmlElement& configData)
                  "We should have at least one entry for a standard handler for entity " << target->getKey() << " handler " << flawHandler->toString());
       FlawHandlerEntry& entry = it->second;
       entry.insert(std::pair<double, FlawHandlerId>(flawHandler->getWeight(),flawHandler ));
+      requeueFlaw(target);
       debugMsg("FlawManager:notifyActivated", "Added active FlawHandler " << flawHandler->toString() << std::endl << " for entity " << target->getKey());
       condDebugMsg(!isValid(), "FlawManager:isValid", "Invalid datastructures in flaw manger.");
     }
@@ -654,6 +972,7 @@ FlawManager::FlawManager(const TiXmlElement& configData)
       for(FlawHandlerEntry::iterator handlerIt = entry.begin(); handlerIt != entry.end(); ++handlerIt){
         if(handlerIt->second == flawHandler){
           entry.erase(handlerIt);
+          requeueFlaw(target);
           condDebugMsg(!isValid(), "FlawManager:isValid", "Invalid datastructures in flaw manger.");
           return;
         }
@@ -661,6 +980,9 @@ FlawManager::FlawManager(const TiXmlElement& configData)
     }
 
     bool FlawManager::betterThan(const EntityId a, const EntityId b, std::string& explanation){
+      // Keys leave no ties, so they do not order flaws when ties are broken at random
+      if(a.isId() && b.isId() && m_randomTieBreaking)
+        return false;
       if(a.isId() && b.isId()) {
         explanation = "higherKey";
         return (a->getKey() > b->getKey());
@@ -16,6 +16,7 @@
 #include "FlawHandler.hh"
 
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/random/mersenne_twister.hpp>
 
 #if 0
 #ifdef _MSC_VER
@@ -45,6 +46,7 @@ class ConstraintEngineListener;
 
 //   typedef hash_map<eint, std::vector<FlawFilterId>, EintHash > Eint2FlawFilterVectorMap; 
     typedef std::map<eint, std::vector<FlawFilterId> > Eint2FlawFilterVectorMap; 
+    typedef std::map<std::string, unsigned int> ConflictCounts; /*!< Failed decisions by conflict key of the flawed entity */
 
     /**
      * @brief Provides access to a set of flaws in priority order.
@@ -103,6 +105,32 @@ class ConstraintEngineListener;
        */
       virtual DecisionPointId next(Priority& bestPriority);
 
+      /**
+       * @brief Break ties between flaws of equal priority, which betterThan does not order, in favor of
+       * the flaw that has failed more often and then at random.
+       * @param seed Seeds the random choice among flaws that are still tied.
+       * @param conflictCounts Failed decisions by flaw, kept by the caller across restarts.
+       */
+      void setTieBreaking(unsigned int seed, const ConflictCounts& conflictCounts);
+
+      /**
+       * @brief Names a flawed entity by its place in the plan rather than by its key, since a restart
+       * retracts the decisions that created slaves and their variables, which are recreated with new keys.
+       * A token is named by the key of its root token and, for each slave on the way down, the relation,
+       * predicate and order among its master's slaves of that relation and predicate. A variable is
+       * named by its token or rule instance and its own name. Slaves are told apart by creation order,
+       * so a token may take the name of a sibling if the rules of its master fire in another order.
+       * Other entities are named by key.
+       */
+      static std::string getConflictKey(const EntityId entity);
+
+      /**
+       * @brief Test every flaw the dynamic filters set aside against them again on the next call to next().
+       * Excluded flaws are otherwise readmitted only on changes to their variables and tokens, so this is
+       * needed after changes the flaw manager cannot see, such as to the horizon held in the context.
+       */
+      void readmitAll();
+
       /**
        * @brief Get an iterator for the set of Flaws
        * @return A Flaw iterator.  
@@ -163,7 +191,28 @@ class ConstraintEngineListener;
 
     protected:
 
-      FlawManager(const TiXmlElement& configData);
+      /**
+       * @param queueFlaws True if the derived class enqueues and dequeues its candidate flaws as they
+       * change, so that next can select from the priority queue rather than iterating over them all.
+       * Setting queueFlaws="false" in the configuration selects the full iteration instead. Queueing
+       * assumes that the dynamic filters depend only on the flaw, its token and the token's master,
+       * and the constraints on the flaw; a filter depending on anything else sees a flaw it once
+       * excluded again only when one of those changes.
+       */
+      FlawManager(const TiXmlElement& configData, bool queueFlaws = false);
+
+      /**
+       * @brief Add a candidate flaw to the priority queue, if not already there. Its priority is
+       * computed when next is called, since its flaw handler can only be loaded when the database
+       * is consistent. Queued priorities are only recomputed when flaw handlers are activated or
+       * deactivated for the flaw.
+       */
+      void enqueueFlaw(const EntityId entity);
+
+      /**
+       * @brief Remove a candidate flaw from the priority queue.
+       */
+      void dequeueFlaw(const EntityId entity);
 
       /**
        * @brief Factory method to allocate instance for selected decision point
@@ -184,6 +233,20 @@ class ConstraintEngineListener;
       void updateGuards(const ConstrainedVariable& variable);
       bool staticallyExcluded(const EntityId entity) const;
       bool isValid() const;
+      void requeueFlaw(const EntityId entity);
+      void prioritizeFlaws();
+      void excludeFlaw(const EntityId entity);
+      bool removeExclusion(const eint key);
+      void readmitFlaws(const eint watchKey);
+      void readmitFlaws(const ConstrainedVariableId variable);
+      bool evaluateCandidate(const EntityId candidate, const Priority priority, Priority& bestP,
+                             EntityId& flawToResolve, unsigned int& ties, std::string& explanation);
+      bool breakTie(const EntityId candidate, const EntityId flawToResolve, unsigned int& ties,
+                    std::string& explanation);
+      unsigned int getConflictCount(const EntityId entity) const;
+
+      typedef std::map<std::pair<Priority, eint>, EntityId> FlawQueue;
+      typedef std::map<eint, std::pair<EntityId, std::vector<eint> > > ExcludedFlaws;
 
       FlawManagerId m_parent;
       MatchingEngineId m_flawFilters;
@@ -196,6 +259,15 @@ class ConstraintEngineListener;
       unsigned int m_timestamp; /*!< Used for testing for stale iterators */
       ContextId m_context;
       boost::shared_ptr<ConstraintEngineListener> m_ceListener;
+      bool m_queueFlaws;
+      FlawQueue m_flawQueue; /*!< Prioritized candidate flaws, in order of priority and then key */
+      std::map<eint, Priority> m_flawPriorities; /*!< The priority each flaw in the queue is held under */
+      std::map<eint, EntityId> m_unprioritizedFlaws; /*!< Candidate flaws whose priority is yet to be computed */
+      ExcludedFlaws m_excludedFlaws; /*!< Candidate flaws the dynamic filters exclude, with the keys they are watched under */
+      std::multimap<eint, eint> m_exclusionWatches; /*!< Keys of excluded flaws, by the key of each entity whose changes may readmit them */
+      bool m_randomTieBreaking;
+      boost::mt19937 m_random;
+      const ConflictCounts* m_conflictCounts; /*!< Owned by the Solver, so counts outlive the decisions they record */
       //static const Priority BEST_CASE_PRIORITY = 0;
     };
 
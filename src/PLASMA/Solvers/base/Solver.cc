@@ -12,6 +12,9 @@
 #include "Context.hh"
 #include "tinyxml.h"
 #include <bitset>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 
 /**
  * @file Solver.cc
@@ -67,6 +70,16 @@ Solver::Solver(const PlanDatabaseId db, const TiXmlElement& configData)
   m_decisionStack(),
   m_lastExecutedDecision(),
   m_listeners(),
+  m_trailing(false),
+  m_restartPolicy(NO_RESTARTS),
+  m_restartLimit(100),
+  m_restartFactor(1.5),
+  m_restartCount(0),
+  m_failureCount(0),
+  m_randomTieBreaking(false),
+  m_conflictCounts(),
+  m_backjumping(false),
+  m_culprits(),
   m_ceListener(db->getConstraintEngine(), *this),
       m_dbListener(db, *this) {
   checkError(strcmp(configData.Value(), "Solver") == 0,
@@ -75,6 +88,41 @@ Solver::Solver(const PlanDatabaseId db, const TiXmlElement& configData)
   // Extract the name of the Solver
   m_name = extractData(configData, "name");
 
+  // Optionally undo decisions by restoring domains from the trail rather than by relaxation
+  const char* trailing = configData.Attribute("trailing");
+  m_trailing = (trailing != NULL && strcmp(trailing, "true") == 0);
+
+  // Optionally backjump over decisions that failures do not depend on, which are found from the trail
+  const char* backjumping = configData.Attribute("backjumping");
+  m_backjumping = (backjumping != NULL && strcmp(backjumping, "true") == 0);
+  m_trailing = m_trailing || m_backjumping;
+
+  // Optionally restart the search when it fails too often
+  const char* restarts = configData.Attribute("restarts");
+  if(restarts != NULL) {
+    if(strcmp(restarts, "luby") == 0)
+      m_restartPolicy = LUBY_RESTARTS;
+    else if(strcmp(restarts, "geometric") == 0)
+      m_restartPolicy = GEOMETRIC_RESTARTS;
+    else
+      checkError(strcmp(restarts, "none") == 0,
+                 "Configuration file error. Expected restarts to be luby, geometric or none but found " << restarts);
+  }
+  if(configData.Attribute("restartLimit") != NULL)
+    m_restartLimit = static_cast<unsigned int>(atof(configData.Attribute("restartLimit")));
+  if(configData.Attribute("restartFactor") != NULL)
+    m_restartFactor = atof(configData.Attribute("restartFactor"));
+  checkRuntimeError(m_restartLimit > 0,
+                    "Configuration file error. Restarts need a positive restartLimit.");
+  checkRuntimeError(m_restartPolicy != GEOMETRIC_RESTARTS || m_restartFactor > 1,
+                    "Configuration file error. Geometric restarts need a restartFactor greater than 1 but found "
+                    << m_restartFactor);
+
+  // Restarting would repeat the same search unless ties are broken at random
+  const char* seed = configData.Attribute("seed");
+  m_randomTieBreaking = (seed != NULL || m_restartPolicy != NO_RESTARTS);
+  unsigned int seedValue = (seed != NULL ? static_cast<unsigned int>(atof(seed)) : 1);
+
   m_context = ((new Context(m_name + "Context"))->getId());
   // Initialize the common filter
   m_masterFlawFilter.initialize(configData, m_db, m_context);
@@ -98,6 +146,8 @@ Solver::Solver(const PlanDatabaseId db, const TiXmlElement& configData)
       FlawManagerId flawManager = cfm->createComponentInstance(*child);
       debugMsg("Solver:Solver", "Created FlawManager with id " << flawManager);
       flawManager->initialize(*child, m_db, m_context, m_masterFlawFilter.getId());
+      if(m_randomTieBreaking)
+        flawManager->setTieBreaking(seedValue + m_flawManagers.size(), m_conflictCounts);
       m_flawManagers.push_back(flawManager);
     }
   }
@@ -134,6 +184,9 @@ Solver::~Solver(){
       m_noFlawsFound = false;
       m_timedOut = false;
 
+      // The horizon may have moved since flaws were last filtered
+      readmitFlaws();
+
       while(!m_timedOut && !m_exhausted && !m_noFlawsFound) step();
 
       checkError(!m_exhausted || m_decisionStack.empty(),
@@ -147,12 +200,19 @@ Solver::~Solver(){
 
     const SolverId Solver::getId() const{ return m_id;}
 
+    void Solver::readmitFlaws(){
+      for(FlawManagers::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->readmitAll();
+    }
+
 const std::string& Solver::getName() const { return m_name;}
 
     unsigned long Solver::getDepth() const {return m_decisionStack.size();}
 
     unsigned int Solver::getStepCount() const {return m_stepCount;}
 
+    unsigned int Solver::getRestartCount() const {return m_restartCount;}
+
     std::string Solver::getLastExecutedDecision() const {return m_lastExecutedDecision;}
 
     bool Solver::noMoreFlaws() {
@@ -315,9 +375,14 @@ const std::string& Solver::getName() const { return m_name;}
       m_noFlawsFound = false;
 
       // If we have no active decision to work on, we get one
-      if(m_activeDecision.isNoId())
+      if(m_activeDecision.isNoId()){
         allocateNewDecisionPoint();
 
+        // A new decision at this depth has yet to fail
+        if(m_backjumping)
+          getCulprits(getDepth()).clear();
+      }
+
       if(m_activeDecision.isNoId()){
         m_noFlawsFound = true;
         publish(notifyCompleted);
@@ -340,6 +405,8 @@ const std::string& Solver::getName() const { return m_name;}
 
       if(!m_activeDecision->cut() && m_activeDecision->hasNext()){
         m_lastExecutedDecision = m_activeDecision->toString();
+        if(m_trailing)
+          m_db->getConstraintEngine()->pushTrailLevel();
         m_activeDecision->execute();
         m_db->getClient()->propagate();
         m_stepCount++;
@@ -361,9 +428,25 @@ const std::string& Solver::getName() const { return m_name;}
         debugMsg("Solver:backtrack", "Backtracking because " << m_activeDecision->toString() << " has no available choices.");
       }
 
+      if(m_backjumping)
+        recordConflict();
+
+      // Remember the flaw that failed, to prefer it after a restart
+      if(m_randomTieBreaking) {
+        EntityId flawedEntity = Entity::getEntity(m_activeDecision->getFlawedEntityKey());
+        if(flawedEntity.isId())
+          m_conflictCounts[FlawManager::getConflictKey(flawedEntity)]++;
+      }
+
       // If we get here then we must have to backtrack. so do it!
       m_exhausted = backtrack();
 
+      m_failureCount++;
+      if(!m_exhausted && m_restartPolicy != NO_RESTARTS && m_failureCount >= getFailureLimit()) {
+        restart();
+        return;
+      }
+
       // If still left in a backtrack state, the deicion stack must be exhausted
       if(m_exhausted) {
         checkError(m_decisionStack.empty(), "Must be exhausted if we failed to backtrack out.");
@@ -396,7 +479,7 @@ const std::string& Solver::getName() const { return m_name;}
 
         // If the active decision is executed, undo it
         if(m_activeDecision->isExecuted()) {
-          m_activeDecision->undo();
+          undo(m_activeDecision);
           publish(notifyUndone,m_activeDecision);
           //debugMsg("Solver:printPlan", std::endl << PlanDatabaseWriter::toString(m_db));
         }
@@ -404,12 +487,27 @@ const std::string& Solver::getName() const { return m_name;}
         // If there are available choices to take, we can quit and resume normal search
         backtracking = m_activeDecision->cut() || !m_activeDecision->hasNext();
 
+        // Restoring from the trail queues the constraints on every restored variable, which can prove
+        // inconsistent a state that was not known to be when the decision was made. No remaining choice
+        // can then succeed, so keep going.
+        if(!backtracking && m_trailing && !m_db->getClient()->propagate()) {
+          backtracking = true;
+          if(m_backjumping) {
+            std::set<unsigned long>& culprits = getCulprits(getDepth());
+            for(unsigned long depth = 0; depth < getDepth(); depth++)
+              culprits.insert(depth);
+          }
+        }
+
         // If still retracting, we must discard the active decision
         if(backtracking){
           publish(notifyRetractNotDone,m_activeDecision);
           publish(notifyDeleted,m_activeDecision);
           delete static_cast<DecisionPoint*>(m_activeDecision);
           m_activeDecision = DecisionPointId::noId();
+
+          if(m_backjumping)
+            jumpToCulprit(getDepth());
         }
         else {
           publish(notifyRetractSucceeded,m_activeDecision);
@@ -418,6 +516,120 @@ const std::string& Solver::getName() const { return m_name;}
       return backtracking;
     }
 
+    namespace {
+      /**
+       * @brief The term of the Luby sequence 1, 1, 2, 1, 1, 2, 4, ... at the given index, counting from 0.
+       */
+      unsigned long luby(unsigned long index){
+        // Find the smallest complete subsequence, of 2^k - 1 terms ending in 2^(k-1), that holds the index
+        unsigned long size = 1;
+        unsigned long term = 1;
+        while(size < index + 1){
+          size = 2 * size + 1;
+          term *= 2;
+        }
+        // The first half of each subsequence repeats the one before it, as does the second
+        while(size - 1 != index){
+          size = (size - 1) / 2;
+          term /= 2;
+          index = index % size;
+        }
+        return term;
+      }
+    }
+
+    unsigned long Solver::getFailureLimit() const {
+      if(m_restartPolicy == LUBY_RESTARTS)
+        return m_restartLimit * luby(m_restartCount);
+
+      double limit = m_restartLimit * std::pow(m_restartFactor, static_cast<double>(m_restartCount));
+      if(limit >= std::numeric_limits<unsigned long>::max())
+        return std::numeric_limits<unsigned long>::max();
+      return static_cast<unsigned long>(limit);
+    }
+
+    void Solver::restart(){
+      debugMsg("Solver:restart", "Restarting after " << m_failureCount << " failures at step " << m_stepCount);
+
+      unsigned int stepCount = m_stepCount;
+      unsigned int restartCount = m_restartCount;
+      reset(getDepth() > m_depthFloor ? getDepth() - m_depthFloor : 0);
+      m_stepCount = stepCount;
+      m_restartCount = restartCount + 1;
+    }
+
+    std::set<unsigned long>& Solver::getCulprits(unsigned long depth){
+      if(m_culprits.size() <= depth)
+        m_culprits.resize(depth + 1);
+      return m_culprits[depth];
+    }
+
+    void Solver::recordConflict(){
+      const unsigned long depth = getDepth();
+      std::set<unsigned long>& culprits = getCulprits(depth);
+
+      // The choices for a flawed variable come from its domain, so a variable out of choices is explained like
+      // any conflict. Other dead ends and cut decisions are not, and depend on every earlier decision.
+      std::vector<ConstrainedVariableId> variables;
+      EntityId entity = Entity::getEntity(m_activeDecision->getFlawedEntityKey());
+      bool explained = entity.isId() && !m_activeDecision->cut();
+      if(explained && ConstrainedVariableId::convertable(entity))
+        variables.push_back(entity);
+      else if(explained && m_activeDecision->isExecuted() && TokenId::convertable(entity))
+        variables = TokenId(entity)->getVariables();
+      else
+        explained = false;
+
+      if(!explained){
+        for(unsigned long i = 0; i < depth; i++)
+          culprits.insert(i);
+        debugMsg("Solver:backjump", "Failure of " << m_activeDecision->toString() << " depends on all " << depth << " decisions");
+        return;
+      }
+
+      // Each executed decision has opened one trail level
+      ConstraintEngineId ce = m_db->getConstraintEngine();
+      checkError(ce->getTrailDepth() >= depth + (m_activeDecision->isExecuted() ? 1 : 0),
+                 "Expected a trail level for each of " << depth << " decisions, but found " << ce->getTrailDepth());
+      const unsigned long base = ce->getTrailDepth() - depth - (m_activeDecision->isExecuted() ? 1 : 0);
+      std::set<unsigned int> levels;
+      ce->getConflictLevels(variables, levels);
+      for(std::set<unsigned int>::const_iterator it = levels.begin(); it != levels.end(); ++it)
+        if(*it > base && *it - base - 1 < depth)
+          culprits.insert(*it - base - 1);
+
+      debugMsg("Solver:backjump", "Failure of " << m_activeDecision->toString() << " depends on " <<
+               culprits.size() << " of " << depth << " decisions");
+    }
+
+    void Solver::jumpToCulprit(unsigned long depth){
+      std::set<unsigned long> culprits;
+      culprits.swap(getCulprits(depth));
+
+      // With no culprit, the failure depends on no decision and the search space is exhausted
+      unsigned long keep = 0;
+      if(!culprits.empty()){
+        const unsigned long latest = *culprits.rbegin();
+        culprits.erase(latest);
+        getCulprits(latest).insert(culprits.begin(), culprits.end());
+        keep = latest + 1;
+      }
+
+      condDebugMsg(m_decisionStack.size() > keep, "Solver:backjump",
+                   "Jumping back " << m_decisionStack.size() - keep << " decisions from depth " << depth);
+
+      while(m_decisionStack.size() > keep){
+        DecisionPointId node = m_decisionStack.back();
+        m_decisionStack.pop_back();
+        if(node->isExecuted()) {
+          undo(node);
+          publish(notifyUndone,node);
+        }
+        publish(notifyDeleted,node);
+        delete static_cast<DecisionPoint*>(node);
+      }
+    }
+
     void Solver::reset(){
       reset(m_decisionStack.size());
     }
@@ -428,8 +640,10 @@ const std::string& Solver::getName() const { return m_name;}
       if(m_activeDecision.isId()){
         if(m_activeDecision->canUndo()) {
           publish(notifyUndone,m_activeDecision);
-          m_activeDecision->undo();
+          undo(m_activeDecision);
         }
+        else
+          release(m_activeDecision);
 
         delete static_cast<DecisionPoint*>(m_activeDecision);
         m_activeDecision = DecisionPointId::noId();
@@ -454,8 +668,10 @@ const std::string& Solver::getName() const { return m_name;}
 
         if(node->canUndo()) {
           publish(notifyUndone,node);
-          node->undo();
+          undo(node);
         }
+        else
+          release(node);
 
         publish(notifyDeleted,node);
         delete static_cast<DecisionPoint*>(node);
@@ -463,6 +679,8 @@ const std::string& Solver::getName() const { return m_name;}
       }
 
       m_stepCount = 0;
+      m_restartCount = 0;
+      m_failureCount = 0;
       m_noFlawsFound = false;
       m_exhausted = false;
       m_timedOut = false;
@@ -473,8 +691,10 @@ const std::string& Solver::getName() const { return m_name;}
       if(m_activeDecision.isId()){
         if(m_activeDecision->canUndo()) {
           publish(notifyUndone,m_activeDecision);
-          m_activeDecision->undo();
+          undo(m_activeDecision);
         }
+        else
+          release(m_activeDecision);
 
         delete static_cast<DecisionPoint*>(m_activeDecision);
         m_activeDecision = DecisionPointId::noId();
@@ -499,6 +719,8 @@ const std::string& Solver::getName() const { return m_name;}
 
     void Solver::clear(){
       m_stepCount = 0;
+      m_restartCount = 0;
+      m_failureCount = 0;
       m_stepCountFloor = 0;
       m_depthFloor = 0;
       m_noFlawsFound = false;
@@ -510,13 +732,42 @@ const std::string& Solver::getName() const { return m_name;}
 
     void Solver::cleanupDecisions(){
       if(m_activeDecision.isId()){
+        release(m_activeDecision);
         delete static_cast<DecisionPoint*>(m_activeDecision);
         m_activeDecision = DecisionPointId::noId();
       }
 
+      for(DecisionStack::const_reverse_iterator it = m_decisionStack.rbegin(); it != m_decisionStack.rend(); ++it)
+        release(*it);
+
       cleanup(m_decisionStack);
     }
 
+    void Solver::undo(const DecisionPointId decision){
+      if(!m_trailing){
+        decision->undo();
+        return;
+      }
+
+      ConstraintEngineId ce = m_db->getConstraintEngine();
+      checkError(ce->getTrailDepth() > 0, "No trail level for " << decision->toString());
+      if(ce->canRestoreTrailLevel()){
+        debugMsg("Solver:undo", "Restoring trail level " << ce->getTrailDepth());
+        ce->beginTrailRestore();
+        decision->undo();
+        ce->restoreTrailLevel();
+      }
+      else {
+        decision->undo();
+        ce->popTrailLevel();
+      }
+    }
+
+    void Solver::release(const DecisionPointId decision){
+      if(m_trailing && decision->isExecuted() && !Entity::isPurging())
+        m_db->getConstraintEngine()->popTrailLevel(true);
+    }
+
     void Solver::cleanup(DecisionStack& decisionStack){
       for(DecisionStack::const_iterator it = decisionStack.begin(); it != decisionStack.end(); ++it){
         DecisionPointId node = *it;
@@ -25,6 +25,22 @@ namespace SOLVERS {
  * A solver may or may not do planning i.e. goal decomposition. Most generally, it will process a set of flaws in a partial plan until
  * there are no more in scope.The Solver is a mediator between Flaw Managers and Decision Points. This solver provides a chronological backtracking search.
  *
+ * The search may be restarted when it has failed too often, given these attributes of the Solver element:
+ * @li restarts: "luby" or "geometric". The failures allowed before a restart follow the Luby sequence
+ * (1, 1, 2, 1, 1, 2, 4, ...) or grow by restartFactor with each restart.
+ * @li restartLimit: The failures allowed before the first restart, and the unit of the Luby sequence. Defaults to 100.
+ * @li restartFactor: The growth of the limit for geometric restarts, which must be greater than 1. Defaults to 1.5.
+ * @li seed: Seeds the random choice between flaws of equal priority. Defaults to 1 when restarting.
+ *
+ * With a seed or restarts, flaws of equal priority are ordered by how often decisions on them have failed, and
+ * then at random. Failure counts are kept across restarts, so each run starts from the flaws earlier runs found hard.
+ * They are kept by FlawManager::getConflictKey, since slaves recreated after a restart have new keys.
+ *
+ * With backjumping="true", which implies trailing, a decision that runs out of choices jumps back to the latest decision
+ * its failures depend on, retracting the decisions in between without trying their remaining choices. A failure depends
+ * on the decisions whose trail levels changed variables connected through constraints to the emptied variables or to the
+ * flawed entity, and on every decision which changed the structure of the network. Failures which can not be explained
+ * this way, such as flaws with no choices at all, depend on every earlier decision.
  * @see FlawManager, DecisionPoint
  */
 class Solver {
@@ -112,6 +128,11 @@ class Solver {
    */
   unsigned int getStepCount() const;
 
+  /**
+   * @brief The number of times the search has been restarted since the Solver was previously cleared.
+   */
+  unsigned int getRestartCount() const;
+
   /**
    * @brief Tests if we have concluded there are no more flaws.
    */
@@ -183,6 +204,12 @@ class Solver {
    */
   ContextId getContext() const {return m_context;}
 
+  /**
+   * @brief Have the flaw managers test again the flaws their dynamic filters set aside. Called by solve(),
+   * and needed before step() once the context has changed, as when the horizon is moved.
+   */
+  void readmitFlaws();
+
   /**
    * @brief Verify that the state of the Solver is consistent with our expectaions.
    */
@@ -211,6 +238,11 @@ class Solver {
 
   void doStep();
   bool conflictLevelOk();
+
+  /**
+   * @brief Retract the decisions made in this call to solve, keeping the step count, to begin the search again.
+   */
+  void restart();
   double m_baseConflictLevel;  // Keeps track of initial conflict level before a solver step is taken
 
   static void cleanup(DecisionStack& decisionStack);
@@ -223,6 +255,19 @@ class Solver {
    */
   void cleanupDecisions();
 
+  /**
+   * @brief Undo an executed decision. When trailing, the domains changed since it was executed are restored
+   * from the ConstraintEngine trail, unless the decision made changes the trail can not undo, in which case
+   * the network is relaxed as usual.
+   * @see ConstraintEngine::pushTrailLevel()
+   */
+  void undo(const DecisionPointId decision);
+
+  /**
+   * @brief Release the trail level of an executed decision which is being discarded without being undone.
+   */
+  void release(const DecisionPointId decision);
+
   void notifyAdded(const TokenId token);
 
   void notifyRemoved(const TokenId token);
@@ -231,6 +276,27 @@ class Solver {
 
   bool hasDecidedParameter(const TokenId token);
 
+  /**
+   * @brief The failures allowed before the next restart.
+   */
+  unsigned long getFailureLimit() const;
+
+  /**
+   * @brief The depths of the earlier decisions which the failures of the decision at the given depth depend on.
+   */
+  std::set<unsigned long>& getCulprits(unsigned long depth);
+
+  /**
+   * @brief Record the earlier decisions which the latest failure of the active decision depends on.
+   */
+  void recordConflict();
+
+  /**
+   * @brief Having discarded the exhausted decision at the given depth, retract the decisions after its latest
+   * culprit, and pass its other culprits on to that one.
+   */
+  void jumpToCulprit(unsigned long depth);
+
   /**
    * @brief Used to enforce scope restrictions for common filters across all flaw managers
    */
@@ -272,6 +338,20 @@ class Solver {
   DecisionStack m_decisionStack; /*!< Stack of decisions made */
   std::string m_lastExecutedDecision; /*!< Kept for debugging and UI purposes */
   std::list<SearchListenerId> m_listeners; /*!< The set of listeners for the search */
+  bool m_trailing; /*!< True if a trail level is opened for each decision executed, so it can be undone without relaxation. */
+
+  enum RestartPolicy {NO_RESTARTS, LUBY_RESTARTS, GEOMETRIC_RESTARTS};
+  RestartPolicy m_restartPolicy;
+  unsigned int m_restartLimit; /*!< Failures allowed before the first restart, and the unit of the Luby sequence. */
+  double m_restartFactor; /*!< Growth in the failures allowed with each geometric restart. */
+  unsigned int m_restartCount;
+  unsigned long m_failureCount; /*!< Failures since the search last started. */
+  bool m_randomTieBreaking; /*!< True if flaws of equal priority are ordered by conflict counts and then at random. */
+  ConflictCounts m_conflictCounts; /*!< Failed decisions by conflict key of the flawed entity, kept across restarts. */
+
+  bool m_backjumping; /*!< True if a decision out of choices jumps back to the latest decision its failures depend on. */
+  std::vector<std::set<unsigned long> > m_culprits; /*!< For the decision at each depth, the depths of earlier decisions
+                                                      its failures depend on. */
 
   class FlawIterator : public Iterator {
    public:
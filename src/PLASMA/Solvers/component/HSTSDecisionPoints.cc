@@ -375,6 +375,8 @@ ThreatDecisionPoint::ThreatDecisionPoint(const DbClientId client, const TokenId
 
 void ThreatDecisionPoint::handleInitialize() {
   SOLVERS::ThreatDecisionPoint::handleInitialize();
+  // The heuristic orders choices across objects, so draw them from every object up front
+  while(addObjectChoices());
   //first order choices by object key
   // 	ObjectComparator cmp;
   // 	std::sort<std::vector<std::pair<ObjectId, std::pair<TokenId, TokenId> > >::iterator, ObjectComparator&>(m_choices.begin(), m_choices.end(), cmp);
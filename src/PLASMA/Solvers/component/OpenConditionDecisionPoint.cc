@@ -4,16 +4,44 @@
 #include "TokenVariable.hh"
 #include "ConstrainedVariable.hh"
 
-// TODO: move this to the appropriate place
-#ifdef _MSC_VER
-#define EUROPA_UINT_MAX UINT_MAX
-#else
-#define EUROPA_UINT_MAX std::numeric_limits<unsigned int>::max()
-#endif //_MSC_VER
-
 namespace EUROPA {
 namespace SOLVERS {
 
+namespace {
+/**
+ * Test merge candidates from the given position on until one is compatible with the token, and add it
+ * to the compatible tokens. The database must be as it was when the candidates were drawn from it, which
+ * holds whenever the decision is initialized or executed.
+ */
+bool findCompatibleToken(const TokenId token,
+                         const std::vector<TokenId>& candidates,
+                         unsigned long& candidateIndex,
+                         std::vector<TokenId>& compatibleTokens) {
+  const PlanDatabaseId db = token->getPlanDatabase();
+  if(candidateIndex < candidates.size() && !db->getConstraintEngine()->propagate())
+    candidateIndex = candidates.size();
+
+  while(candidateIndex < candidates.size()){
+    TokenId candidate = candidates[candidateIndex++];
+    // Use exact test in this case
+    if(db->isCompatible(token, candidate, true)){
+      compatibleTokens.push_back(candidate);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Draw the tokens the given token may merge with from the database.
+ */
+void getMergeCandidates(const TokenId token, std::vector<TokenId>& candidates) {
+  const PlanDatabaseId db = token->getPlanDatabase();
+  if(db->getConstraintEngine()->propagate())
+    db->getMergeCandidates(token, candidates);
+}
+}
+
 bool OpenConditionDecisionPoint::test(const EntityId entity){
   return(TokenId::convertable(entity) || TokenId(entity)->isInactive());
 }
@@ -26,6 +54,8 @@ OpenConditionDecisionPoint::OpenConditionDecisionPoint(const DbClientId client,
       m_flawedToken(flawedToken),
       m_choices(),
       m_compatibleTokens(),
+      m_mergeCandidates(),
+      m_candidateIndex(0),
       m_mergeCount(0),
       m_choiceCount(0),
       m_mergeIndex(0),
@@ -47,12 +77,9 @@ void OpenConditionDecisionPoint::handleInitialize(){
 
   // Next merge choices if there are any.
   if(stateDomain.isMember(Token::MERGED)){
-    // Use exact test in this case
-    m_flawedToken->getPlanDatabase()->getCompatibleTokens(
-        m_flawedToken,
-        m_compatibleTokens,
-        EUROPA_UINT_MAX,
-        true);
+    // Only look as far as the first compatible token. Later ones are found as each merge is tried.
+    getMergeCandidates(m_flawedToken, m_mergeCandidates);
+    findCompatibleToken(m_flawedToken, m_mergeCandidates, m_candidateIndex, m_compatibleTokens);
     m_mergeCount = m_compatibleTokens.size();
     if(m_mergeCount > 0) {
       m_choices.push_back(Token::MERGED);
@@ -110,6 +137,13 @@ void OpenConditionDecisionPoint::handleExecute() {
   else if(m_choices[m_choiceIndex] == Token::MERGED) {
     checkError(m_mergeIndex < m_mergeCount, "Tried to merge past available compatible tokens.");
     TokenId activeToken = m_compatibleTokens[m_mergeIndex];
+
+    // Find the next merge choice, if any, before this one changes the database
+    if(m_mergeIndex + 1 == m_mergeCount){
+      findCompatibleToken(m_flawedToken, m_mergeCandidates, m_candidateIndex, m_compatibleTokens);
+      m_mergeCount = m_compatibleTokens.size();
+    }
+
     debugMsg("SolverDecisionPoint:handleExecute", "For " << m_flawedToken->getPredicateName() << "(" <<
              m_flawedToken->getKey() << "), assigning MERGED onto " << activeToken->getPredicateName() <<
              "(" << activeToken->getKey() << ").");
@@ -180,6 +214,8 @@ std::string OpenConditionDecisionPoint::toString() const{
       TokenId token = *it;
       strStream << " " << token->getKey() << " ";
     }
+    if(m_candidateIndex < m_mergeCandidates.size())
+      strStream << " (" << m_mergeCandidates.size() - m_candidateIndex << " candidates untested) ";
     strStream << "}";
   }
 
@@ -258,17 +294,15 @@ void SupportedOCDecisionPoint::handleInitialize()
   const StateDomain stateDomain(m_flawedToken->getState()->lastDomain());
 
   if(stateDomain.isMember(Token::MERGED)){
-    std::vector<TokenId> compatibleTokens;
-
-    m_flawedToken->getPlanDatabase()->getCompatibleTokens(
-        m_flawedToken,
-        compatibleTokens,
-        EUROPA_UINT_MAX,
-        true);
+    std::vector<TokenId> mergeCandidates;
+    getMergeCandidates(m_flawedToken, mergeCandidates);
 
     // TODO: if flawed token is a fact, make sure we only look at other facts
-    if (compatibleTokens.size() > 0)
-      m_choices.push_back(new MergeToken(m_client,m_flawedToken,compatibleTokens));
+    MergeToken* merge = new MergeToken(m_client,m_flawedToken,mergeCandidates);
+    if (merge->hasNext())
+      m_choices.push_back(merge);
+    else
+      delete merge;
   }
 
   if(stateDomain.isMember(Token::ACTIVE)) {
@@ -350,11 +384,15 @@ std::string ActivateToken::toString()
   return "ACTIVATE";
 }
 
-MergeToken::MergeToken(const DbClientId dbClient, const TokenId token, const std::vector<TokenId>& compatibleTokens)
+MergeToken::MergeToken(const DbClientId dbClient, const TokenId token, const std::vector<TokenId>& mergeCandidates)
     : ChangeTokenState(dbClient,token)
-    , m_compatibleTokens(compatibleTokens)
+    , m_mergeCandidates(mergeCandidates)
+    , m_candidateIndex(0)
+    , m_compatibleTokens()
     , m_currentChoice(0)
 {
+  findCompatibleToken(m_token, m_mergeCandidates, m_candidateIndex, m_compatibleTokens);
+  m_isExecuted = m_compatibleTokens.empty();
 }
 
 MergeToken::~MergeToken()
@@ -364,6 +402,11 @@ MergeToken::~MergeToken()
 void MergeToken::execute()
 {
   TokenId activeToken = m_compatibleTokens[m_currentChoice++];
+
+  // Find the next merge choice, if any, before this one changes the database
+  if (m_currentChoice == m_compatibleTokens.size())
+    findCompatibleToken(m_token, m_mergeCandidates, m_candidateIndex, m_compatibleTokens);
+
   m_dbClient->merge(m_token,activeToken);
   m_isExecuted=(m_currentChoice >= m_compatibleTokens.size());
 }
@@ -67,7 +67,9 @@ namespace EUROPA {
 
       const TokenId m_flawedToken; /*!< The token to be resolved. */
       std::vector<LabelStr> m_choices; /*!< The sequences list of states to choose. */
-      std::vector<TokenId> m_compatibleTokens; /*!< A possibly empty collection of tokens to merge with. */
+      std::vector<TokenId> m_compatibleTokens; /*!< A possibly empty collection of tokens to merge with, found so far. */
+      std::vector<TokenId> m_mergeCandidates; /*!< Tokens that may be compatible, tested only as choices are needed. */
+      unsigned long m_candidateIndex; /*!< The position of the next candidate to test in m_mergeCandidates. */
       unsigned long m_mergeCount; /*!< The size of m_compatibleTokens */
       unsigned long m_choiceCount; /*!< The size of m_choices. */
       unsigned long m_mergeIndex; /*!< The position of the next choice in m_compatibleTokens. */
@@ -156,7 +158,10 @@ private:
     class MergeToken : public ChangeTokenState
     {
     public:
-    	MergeToken(const DbClientId dbClient, const TokenId token, const std::vector<TokenId>& compatibleTokens);
+    	/**
+    	 * @param mergeCandidates Tokens that may be compatible. They are tested only as choices are needed.
+    	 */
+    	MergeToken(const DbClientId dbClient, const TokenId token, const std::vector<TokenId>& mergeCandidates);
     	virtual ~MergeToken();
 
     	virtual void execute();
@@ -164,6 +169,8 @@ private:
 
 
     protected:
+    	std::vector<TokenId> m_mergeCandidates;
+    	unsigned long m_candidateIndex;
     	std::vector<TokenId> m_compatibleTokens;
     	unsigned int m_currentChoice;
     };
@@ -15,7 +15,7 @@ namespace EUROPA {
 namespace SOLVERS {
 
 OpenConditionManager::OpenConditionManager(const TiXmlElement& configData)
-    : FlawManager(configData), m_flawCandidates() {}
+    : FlawManager(configData, true), m_flawCandidates() {}
 
     void OpenConditionManager::handleInitialize(){
       // FILL UP TOKENS
@@ -43,12 +43,14 @@ OpenConditionManager::OpenConditionManager(const TiXmlElement& configData)
 	debugMsg("OpenConditionManager:addFlaw",
 		 "Adding " << token->toString() << " as a candidate flaw.");
 	m_flawCandidates.insert(token);
+	enqueueFlaw(token);
       }
     }
 
     void OpenConditionManager::removeFlaw(const TokenId token){
       condDebugMsg(m_flawCandidates.find(token) != m_flawCandidates.end(), "OpenConditionManager:removeFlaw", "Removing " << token->toString() << " as a flaw.");
       m_flawCandidates.erase(token);
+      dequeueFlaw(token);
     }
 
     void OpenConditionManager::notifyRemoved(const ConstrainedVariableId variable){
@@ -136,6 +136,7 @@ bool PSSolverImpl::solve(int maxSteps, int maxDepth) {
     check_runtime_error(horizonStart <= horizonEnd);
     m_solver->getContext()->put("horizonStart", static_cast<double>(horizonStart));
     m_solver->getContext()->put("horizonEnd", static_cast<double>(horizonEnd));
+    m_solver->readmitFlaws();
   }
 
 }
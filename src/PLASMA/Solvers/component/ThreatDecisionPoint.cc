@@ -23,7 +23,8 @@ namespace EUROPA {
                                            const TiXmlElement&,
                                            const std::string& explanation)
       : DecisionPoint(client, tokenToOrder->getKey(), explanation),
-        m_tokenToOrder(tokenToOrder), m_choices(), m_choiceCount(0), m_index(0) {
+        m_tokenToOrder(tokenToOrder), m_choices(), m_choiceCount(0), m_index(0),
+        m_objects(), m_objectIndex(0) {
       // Here is where we would look for custom processing for configuration of the decision point
     }
 
@@ -38,6 +39,10 @@ namespace EUROPA {
 		 "Given token must be part of assignment." 
 		 << m_tokenToOrder->toString() << ";" << predecessor->toString() << "; " << successor->toString());
 
+      // Find the next choice, if any, before this one changes the database
+      if(m_index + 1 == m_choiceCount)
+        addObjectChoices();
+
       debugMsg("SolverDecisionPoint:handleExecute", "For " << m_tokenToOrder->getPredicateName() << "(" <<
                m_tokenToOrder->getKey() << "), assigning " << predecessor->getPredicateName() << "(" <<
                predecessor->getKey() << ") to be before " << successor->getPredicateName() << "(" <<
@@ -64,25 +69,49 @@ namespace EUROPA {
       return m_index < m_choiceCount;
     }
 
-    class ObjectComparator {
-    public:
-      bool operator() (const std::pair<ObjectId, std::pair<TokenId, TokenId> >& p1,
-		       const std::pair<ObjectId, std::pair<TokenId, TokenId> >& p2) const {
-	ObjectId o1 = p1.first;
-	ObjectId o2 = p2.first;
-	return o1->getKey() < o2->getKey();
-      }
-      bool operator==(const ObjectComparator&){return true;}
-    };
-
     /**
-     * @brief populate over all objects in the tokens object domain. Should customize to change the ordering.
+     * @brief populate over all objects in the tokens object domain, in order of object key. Choices are drawn
+     * from the next object only when those of the previous ones have been used. Should customize to change the ordering.
      */
     void ThreatDecisionPoint::handleInitialize() {
-      m_tokenToOrder->getPlanDatabase()->getOrderingChoices(m_tokenToOrder, m_choices);
-      ObjectComparator cmp;
-      std::sort<std::vector<std::pair<ObjectId, std::pair<TokenId, TokenId> > >::iterator, ObjectComparator&>(m_choices.begin(), m_choices.end(), cmp);
-      m_choiceCount = m_choices.size();
+      const PlanDatabaseId db = m_tokenToOrder->getPlanDatabase();
+      if(!db->getConstraintEngine()->propagate())
+        return;
+
+      const std::map<eint, std::pair<TokenId, ObjectSet> >& tokensToOrder = db->getTokensToOrder();
+      std::map<eint, std::pair<TokenId, ObjectSet> >::const_iterator it = tokensToOrder.find(m_tokenToOrder->getKey());
+      checkError(it != tokensToOrder.end(),
+                 "Should not be calling this method if it is not a token in need of ordering. " << m_tokenToOrder->toString());
+
+      const ObjectSet& objects = it->second.second;
+      checkError(!objects.empty(), "There should be at least one source of induced constraint on the token." << m_tokenToOrder->toString());
+      m_objects.assign(objects.begin(), objects.end());
+      addObjectChoices();
+    }
+
+    /**
+     * The database must be as it was when the decision was initialized, which holds whenever the decision is
+     * initialized or executed.
+     */
+    bool ThreatDecisionPoint::addObjectChoices() {
+      if(m_objectIndex < m_objects.size() && !m_tokenToOrder->getPlanDatabase()->getConstraintEngine()->propagate())
+        m_objectIndex = m_objects.size();
+
+      while(m_objectIndex < m_objects.size()){
+        ObjectId object = m_objects[m_objectIndex++];
+        check_error(object.isValid());
+        std::vector<std::pair<TokenId, TokenId> > choices;
+        object->getOrderingChoices(m_tokenToOrder, choices);
+
+        for(std::vector<std::pair<TokenId, TokenId> >::const_iterator it = choices.begin(); it != choices.end(); ++it)
+          m_choices.push_back(std::make_pair(object, *it));
+        m_choiceCount = m_choices.size();
+
+        if(!choices.empty())
+          return true;
+      }
+
+      return false;
     }
 
     std::string ThreatDecisionPoint::toShortString() const {
@@ -39,13 +39,21 @@ class ThreatDecisionPoint: public DecisionPoint {
   void extractParts(unsigned long index, ObjectId& object, TokenId& predecessor,
                     TokenId& successor) const;
 
+  /**
+   * @brief Add the ordering choices on the next object that has any.
+   * @return false if no object with choices remains.
+   */
+  bool addObjectChoices();
+
   /** Main Interface for the solver **/
   bool hasNext() const;
 
   const TokenId m_tokenToOrder; /*!< The token that must be ordered */
-  std::vector< std::pair<ObjectId, std::pair<TokenId, TokenId> > > m_choices; /*!< Choices across all objects */
+  std::vector< std::pair<ObjectId, std::pair<TokenId, TokenId> > > m_choices; /*!< Choices across the objects drawn from so far */
   unsigned long m_choiceCount; /*!< Stored choice count - size of m_orderingChoices */
   unsigned long m_index; /*!< Current choice position in m_orderingChoices */
+  std::vector<ObjectId> m_objects; /*!< Objects inducing the ordering requirement, in key order */
+  unsigned long m_objectIndex; /*!< The position of the next object to draw choices from */
 
  private:
   virtual void handleExecute();
@@ -27,7 +27,7 @@ namespace SOLVERS {
  * @see ComponentFactory
  */
 UnboundVariableManager::UnboundVariableManager(const TiXmlElement& configData)
-    : FlawManager(configData), m_flawCandidates() {}
+    : FlawManager(configData, true), m_flawCandidates() {}
 
     void UnboundVariableManager::handleInitialize(){
 
@@ -81,13 +81,13 @@ UnboundVariableManager::UnboundVariableManager(const TiXmlElement& configData)
      */
     void UnboundVariableManager::updateFlaw(const ConstrainedVariableId var){
       debugMsg("UnboundVariableManager:updateFlaw", var->toLongString());
-      m_flawCandidates.erase(var);
 
       if(variableOfNonActiveToken(var) || !var->canBeSpecified() || var->isSpecified() || staticMatch(var)){
         debugMsg("UnboundVariableManager:updateFlaw", "Excluding  " << var->toLongString());
         condDebugMsg(variableOfNonActiveToken(var), "UnboundVariableManager:updateFlaw", "Parent is not active.");
         condDebugMsg(!var->canBeSpecified(), "UnboundVariableManager:updateFlaw", "Variable can't be specified.");
         condDebugMsg(var->isSpecified(), "UnboundVariableManager:updateFlaw", "Variable is already specified.");
+        removeFlaw(var);
         return;
       }
 
@@ -95,6 +95,7 @@ UnboundVariableManager::UnboundVariableManager(const TiXmlElement& configData)
 	       "Including " << var->getKey() << ". " << var->toString() << " as a candidate flaw.");
 
       m_flawCandidates.insert(var);
+      enqueueFlaw(var);
     }
 
     void UnboundVariableManager::removeFlaw(const ConstrainedVariableId var){
@@ -103,6 +104,7 @@ UnboundVariableManager::UnboundVariableManager(const TiXmlElement& configData)
 		   "Removing " << var->getKey() << ". " << var->toString() << " as a flaw.");
 
       m_flawCandidates.erase(var);
+      dequeueFlaw(var);
     }
 
     bool UnboundVariableManager::variableOfNonActiveToken(const ConstrainedVariableId var){
@@ -584,6 +584,9 @@ public:
     EUROPA_runTest(testPriorities);
     EUROPA_runTest(testGuards);
     EUROPA_runTest(testDynamicFlawManagement);
+    EUROPA_runTest(testQueuedFlawSelection);
+    EUROPA_runTest(testConflictKeys);
+    EUROPA_runTest(testHorizonWidening);
     EUROPA_runTest(testDefaultVariableOrdering);
     EUROPA_runTest(testHeuristicVariableOrdering);
     EUROPA_runTest(testTokenComparators);
@@ -852,6 +855,239 @@ private:
     return true;
   }
 
+  /**
+   * @brief Forwards database events to flaw managers, as a Solver does.
+   */
+  class FlawManagerFeed : public ConstraintEngineListener, public PlanDatabaseListener {
+  public:
+    FlawManagerFeed(const PlanDatabaseId db, const std::vector<FlawManager*>& flawManagers)
+      : ConstraintEngineListener(db->getConstraintEngine()), PlanDatabaseListener(db), m_flawManagers(flawManagers) {}
+
+    void notifyRemoved(const ConstrainedVariableId variable) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyRemoved(variable);
+    }
+    void notifyChanged(const ConstrainedVariableId variable, const DomainListener::ChangeType& changeType) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyChanged(variable, changeType);
+    }
+    void notifyAdded(const ConstraintId constraint) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyAdded(constraint);
+    }
+    void notifyRemoved(const ConstraintId constraint) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyRemoved(constraint);
+    }
+    void notifyAdded(const TokenId token) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyAdded(token);
+    }
+    void notifyRemoved(const TokenId token) {
+      for(std::vector<FlawManager*>::const_iterator it = m_flawManagers.begin(); it != m_flawManagers.end(); ++it)
+        (*it)->notifyRemoved(token);
+    }
+    void notifyAdded(const ConstrainedVariableId variable) {ConstraintEngineListener::notifyAdded(variable);}
+    void notifyAdded(const ObjectId object) {PlanDatabaseListener::notifyAdded(object);}
+    void notifyRemoved(const ObjectId object) {PlanDatabaseListener::notifyRemoved(object);}
+    void notifyAdded(const ObjectId object, const TokenId token) {PlanDatabaseListener::notifyAdded(object, token);}
+    void notifyRemoved(const ObjectId object, const TokenId token) {PlanDatabaseListener::notifyRemoved(object, token);}
+
+  private:
+    std::vector<FlawManager*> m_flawManagers;
+  };
+
+  /**
+   * @brief Select the best decision from a token and a variable flaw manager, as a Solver does.
+   */
+  static DecisionPointId nextDecision(FlawManager& tokens, FlawManager& variables) {
+    Priority priority = getWorstCasePriority() + 1;
+    DecisionPointId decision = tokens.next(priority);
+    DecisionPointId candidate = variables.next(priority);
+    if(candidate.isId()){
+      if(decision.isId())
+        delete static_cast<DecisionPoint*>(decision);
+      decision = candidate;
+    }
+    return decision;
+  }
+
+  /**
+   * @brief Check that queued and scanning flaw managers select the same flaw, and return the decision
+   * for it from the queued ones.
+   */
+  static DecisionPointId nextSameDecision(FlawManager& queuedTokens, FlawManager& queuedVariables,
+                                          FlawManager& scannedTokens, FlawManager& scannedVariables) {
+    DecisionPointId queued = nextDecision(queuedTokens, queuedVariables);
+    DecisionPointId scanned = nextDecision(scannedTokens, scannedVariables);
+    CPPUNIT_ASSERT(queued.isId() == scanned.isId());
+    if(scanned.isId()){
+      CPPUNIT_ASSERT_MESSAGE(queued->toString() + " selected rather than " + scanned->toString(),
+                             queued->getFlawedEntityKey() == scanned->getFlawedEntityKey());
+      delete static_cast<DecisionPoint*>(scanned);
+    }
+    return queued;
+  }
+
+  static bool testQueuedFlawSelection(){
+    TestEngine testEngine(true);
+    boost::scoped_ptr<TiXmlElement> root(initXml( (getTestLoadLibraryPath() + "/FlawHandlerTests.xml").c_str(), "TestQueuedFlaws"));
+    TiXmlElement* variablesConfig = root->FirstChildElement()->FirstChildElement("UnboundVariableManager");
+    TiXmlElement* tokensConfig = root->FirstChildElement()->FirstChildElement("OpenConditionManager");
+    TiXmlElement scannedVariablesConfig(*variablesConfig);
+    scannedVariablesConfig.SetAttribute("queueFlaws", "false");
+    TiXmlElement scannedTokensConfig(*tokensConfig);
+    scannedTokensConfig.SetAttribute("queueFlaws", "false");
+
+    PlanDatabaseId db = testEngine.getPlanDatabase();
+    Object o1(db, "D", "o1");
+    Object o2(db, "E", "o2");
+    Object o3(db, "B", "o3");
+    db->close();
+
+    Context ctx("");
+    ctx.put("horizonStart", 0);
+    ctx.put("horizonEnd", 1000);
+    UnboundVariableManager queuedVariables(*variablesConfig);
+    OpenConditionManager queuedTokens(*tokensConfig);
+    UnboundVariableManager scannedVariables(scannedVariablesConfig);
+    OpenConditionManager scannedTokens(scannedTokensConfig);
+    queuedVariables.initialize(*variablesConfig, db, ctx.getId());
+    queuedTokens.initialize(*tokensConfig, db, ctx.getId());
+    scannedVariables.initialize(scannedVariablesConfig, db, ctx.getId());
+    scannedTokens.initialize(scannedTokensConfig, db, ctx.getId());
+    std::vector<FlawManager*> flawManagers;
+    flawManagers.push_back(&queuedVariables);
+    flawManagers.push_back(&queuedTokens);
+    flawManagers.push_back(&scannedVariables);
+    flawManagers.push_back(&scannedTokens);
+    FlawManagerFeed feed(db, flawManagers);
+
+    std::vector<DecisionPointId> decisions;
+    TokenId master = db->getClient()->createToken("D.predicateF", "", false);
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+
+    // The master is outside the horizon, so neither selects anything
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+    CPPUNIT_ASSERT(decisions.back().isNoId());
+    decisions.pop_back();
+
+    // Bounding its extent admits it again
+    master->start()->restrictBaseDomain(IntervalIntDomain(0, 100));
+    master->end()->restrictBaseDomain(IntervalIntDomain(1, 200));
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+    CPPUNIT_ASSERT(decisions.back().isId());
+    CPPUNIT_ASSERT(decisions.back()->getFlawedEntityKey() == master->getKey());
+    delete static_cast<DecisionPoint*>(decisions.back());
+    decisions.pop_back();
+
+    master->activate();
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    TokenId slave = master->getSlave(1);
+    CPPUNIT_ASSERT_MESSAGE(slave->getPredicateName(), slave->getPredicateName() == "D.predicateC");
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+    slave->start()->restrictBaseDomain(IntervalIntDomain(0, 20));
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+
+    // Setting the guard activates the flaw handler of priority 1 for the slave, so it is requeued
+    slave->start()->specify(10);
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    CPPUNIT_ASSERT(queuedTokens.getFlawHandler(slave)->getPriority() == 1);
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+    CPPUNIT_ASSERT(decisions.back()->getFlawedEntityKey() == slave->getKey());
+
+    // Resetting it deactivates the handler, and the slave is requeued again
+    slave->start()->reset();
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    CPPUNIT_ASSERT(queuedTokens.getFlawHandler(slave)->getPriority() != 1);
+    decisions.push_back(nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables));
+
+    // Resolve the remaining flaws in turn
+    bool resolved = false;
+    for(unsigned int i = 0; i < 50 && !resolved; i++){
+      DecisionPointId decision = nextSameDecision(queuedTokens, queuedVariables, scannedTokens, scannedVariables);
+      resolved = decision.isNoId();
+      if(resolved)
+        break;
+      decisions.push_back(decision);
+      decision->initialize();
+      CPPUNIT_ASSERT(decision->hasNext());
+      decision->execute();
+      CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    }
+    CPPUNIT_ASSERT(resolved);
+
+    for(std::vector<DecisionPointId>::const_reverse_iterator it = decisions.rbegin(); it != decisions.rend(); ++it){
+      if(it->isId())
+        delete static_cast<DecisionPoint*>(*it);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Conflict keys must survive the retraction and recreation of slaves, as a restart does.
+   */
+  static bool testConflictKeys(){
+    TestEngine testEngine(true);
+    PlanDatabaseId db = testEngine.getPlanDatabase();
+    Object o1(db, "D", "o1");
+    Object o2(db, "E", "o2");
+    Object o3(db, "B", "o3");
+    db->close();
+
+    TokenId master = db->getClient()->createToken("D.predicateF", "", false);
+    master->activate();
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    TokenId slave = master->getSlave(1);
+    eint slaveKey = slave->getKey();
+    std::string tokenKey = FlawManager::getConflictKey(slave);
+    std::string variableKey = FlawManager::getConflictKey(slave->start());
+    CPPUNIT_ASSERT_MESSAGE(tokenKey, tokenKey != FlawManager::getConflictKey(master->getSlave(0)));
+    CPPUNIT_ASSERT_MESSAGE(variableKey, variableKey != FlawManager::getConflictKey(slave->end()));
+
+    master->cancel();
+    master->activate();
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+    slave = master->getSlave(1);
+    CPPUNIT_ASSERT(slave->getKey() != slaveKey);
+    CPPUNIT_ASSERT_MESSAGE(FlawManager::getConflictKey(slave), FlawManager::getConflictKey(slave) == tokenKey);
+    CPPUNIT_ASSERT_MESSAGE(FlawManager::getConflictKey(slave->start()),
+                           FlawManager::getConflictKey(slave->start()) == variableKey);
+    return true;
+  }
+
+  /**
+   * @brief Flaws set aside as outside the horizon must be found again by a later solve over a wider horizon.
+   */
+  static bool testHorizonWidening(){
+    TestEngine testEngine(true);
+    boost::scoped_ptr<TiXmlElement> root(initXml( (getTestLoadLibraryPath() + "/FlawHandlerTests.xml").c_str(), "TestQueuedFlaws"));
+    PlanDatabaseId db = testEngine.getPlanDatabase();
+    Object o1(db, "D", "o1");
+    Object o2(db, "E", "o2");
+    Object o3(db, "B", "o3");
+    db->close();
+
+    TokenId master = db->getClient()->createToken("D.predicateF", "", false);
+    master->start()->restrictBaseDomain(IntervalIntDomain(500, 600));
+    master->end()->restrictBaseDomain(IntervalIntDomain(501, 700));
+    CPPUNIT_ASSERT(db->getConstraintEngine()->propagate());
+
+    Solver solver(db, *root->FirstChildElement());
+    solver.getContext()->put("horizonStart", 0);
+    solver.getContext()->put("horizonEnd", 100);
+    CPPUNIT_ASSERT(solver.solve());
+    CPPUNIT_ASSERT(master->isInactive());
+
+    solver.getContext()->put("horizonEnd", 1000);
+    CPPUNIT_ASSERT(solver.solve());
+    CPPUNIT_ASSERT(master->isActive());
+    solver.reset();
+    return true;
+  }
+
   static bool testDefaultVariableOrdering(){
     TestEngine testEngine;
     boost::scoped_ptr<TiXmlElement> root(initXml( (getTestLoadLibraryPath() + "/FlawHandlerTests.xml").c_str(), "DefaultVariableOrdering"));
@@ -1609,6 +1845,9 @@ public:
     EUROPA_runTest(testMinValuesSimpleCSP);
     EUROPA_runTest(testSuccessfulSearch);
     EUROPA_runTest(testExhaustiveSearch);
+    EUROPA_runTest(testTrailedSearch);
+    EUROPA_runTest(testRestartedSearch);
+    EUROPA_runTest(testBackjumpingSearch);
     EUROPA_runTest(testSimpleActivation);
     EUROPA_runTest(testSimpleRejection);
     EUROPA_runTest(testMultipleSearch);
@@ -1744,6 +1983,96 @@ private:
     return true;
   }
 
+  /**
+   * @brief Undoing decisions from the trail must reach the same result as undoing them by relaxation, in no more steps.
+   */
+  static bool testTrailedSearch(){
+    TestEngine testEngine;
+    TiXmlElement* root = initXml((getTestLoadLibraryPath() + "/SolverTests.xml").c_str(), "SimpleCSPSolver");
+    TiXmlElement* child = root->FirstChildElement();
+    CPPUNIT_ASSERT(testEngine.playTransactions((getTestLoadLibraryPath() + "/ExhaustiveSearch.nddl").c_str()));
+    ConstraintEngineId ce = testEngine.getPlanDatabase()->getConstraintEngine();
+
+    unsigned int stepCount = 0;
+    {
+      Solver solver(testEngine.getPlanDatabase(), *child);
+      CPPUNIT_ASSERT(!solver.solve());
+      stepCount = solver.getStepCount();
+    }
+
+    child->SetAttribute("trailing", "true");
+    {
+      Solver solver(testEngine.getPlanDatabase(), *child);
+      CPPUNIT_ASSERT(!solver.solve());
+      CPPUNIT_ASSERT_MESSAGE(toString(solver.getStepCount()), solver.getStepCount() <= stepCount);
+      CPPUNIT_ASSERT(ce->getTrailDepth() == 0);
+      CPPUNIT_ASSERT(ce->propagate());
+    }
+    return true;
+  }
+
+  /**
+   * @brief Restarts must neither lose a solution nor prevent the search space being exhausted.
+   */
+  static bool testRestartedSearch(){
+    TiXmlElement* root = initXml((getTestLoadLibraryPath() + "/SolverTests.xml").c_str(), "SimpleCSPSolver");
+    TiXmlElement* child = root->FirstChildElement();
+    child->SetAttribute("restarts", "luby");
+    child->SetAttribute("restartLimit", "1");
+    child->SetAttribute("seed", "7");
+    {
+      TestEngine testEngine;
+      CPPUNIT_ASSERT(testEngine.playTransactions((getTestLoadLibraryPath() + "/ExhaustiveSearch.nddl").c_str()));
+      Solver solver(testEngine.getPlanDatabase(), *child);
+      CPPUNIT_ASSERT(!solver.solve());
+      CPPUNIT_ASSERT(solver.getRestartCount() > 0);
+      CPPUNIT_ASSERT(solver.getDepth() == 0);
+    }
+
+    child->SetAttribute("restarts", "geometric");
+    child->SetAttribute("restartFactor", "2");
+    {
+      TestEngine testEngine;
+      CPPUNIT_ASSERT(testEngine.playTransactions((getTestLoadLibraryPath() + "/SuccessfulSearch.nddl").c_str()));
+      Solver solver(testEngine.getPlanDatabase(), *child);
+      CPPUNIT_ASSERT(solver.solve());
+    }
+    return true;
+  }
+
+  /**
+   * @brief Backjumping must reach the same result as chronological backtracking, in no more steps.
+   */
+  static bool testBackjumpingSearch(){
+    TiXmlElement* root = initXml((getTestLoadLibraryPath() + "/SolverTests.xml").c_str(), "SimpleCSPSolver");
+    TiXmlElement* child = root->FirstChildElement();
+    const char* problems[] = {"/ExhaustiveSearch.nddl", "/SuccessfulSearch.nddl"};
+    for(unsigned int i = 0; i < 2; i++) {
+      TestEngine testEngine;
+      CPPUNIT_ASSERT(testEngine.playTransactions((getTestLoadLibraryPath() + problems[i]).c_str()));
+
+      child->SetAttribute("backjumping", "false");
+      bool solved = false;
+      unsigned int stepCount = 0;
+      {
+        Solver solver(testEngine.getPlanDatabase(), *child);
+        solved = solver.solve();
+        stepCount = solver.getStepCount();
+        solver.reset();
+      }
+
+      child->SetAttribute("backjumping", "true");
+      {
+        Solver solver(testEngine.getPlanDatabase(), *child);
+        CPPUNIT_ASSERT(solver.solve() == solved);
+        CPPUNIT_ASSERT_MESSAGE(toString(solver.getStepCount()), solver.getStepCount() <= stepCount);
+        solver.reset();
+        CPPUNIT_ASSERT(testEngine.getPlanDatabase()->getConstraintEngine()->getTrailDepth() == 0);
+      }
+    }
+    return true;
+  }
+
   static bool testSimpleActivation() {
     TestEngine testEngine;
     TiXmlElement* root = initXml((getTestLoadLibraryPath() + "/SolverTests.xml").c_str(), "SimpleActivationSolver");
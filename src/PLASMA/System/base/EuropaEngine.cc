@@ -21,7 +21,23 @@
 #include "Filters.hh"
 #include "PlanDatabaseWriter.hh"
 
+// Portfolio support
+#include "DbClient.hh"
+#include "DbClientTransactionLog.hh"
+#include "DbClientTransactionPlayer.hh"
+
 #include <boost/cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cerrno>
+#include <iostream>
+#include <sstream>
+
+#ifndef _MSC_VER
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 namespace EUROPA {
 //namespace System { //TODO: mcr
@@ -105,6 +121,14 @@ const RulesEngine*      EuropaEngine::getRulesEnginePtr()      const { return st
       if(!playTransactions(txSource, language))
         return false;
 
+      bool retval = solve(solver);
+
+      delete static_cast<SOLVERS::Solver*>(solver);
+
+      return retval;
+    }
+
+    bool EuropaEngine::solve(const SOLVERS::SolverId solver){
       debugMsg("EuropaEngine:plan", "Initial state: " << std::endl << PlanDatabaseWriter::toString(getPlanDatabase()))
       //LOGGER << Logger::DEBUG << "plan: Initial state: " << Logger::eol << PlanDatabaseWriter::toString(getPlanDatabase());
       LOGGER_DEBUG_MSG( DEBUG, "Initial state: " << LOGGER_ENDL << PlanDatabaseWriter::toString(getPlanDatabase()) )
@@ -146,11 +170,182 @@ const RulesEngine*      EuropaEngine::getRulesEnginePtr()      const { return st
       m_totalNodes = solver->getStepCount();
       m_finalDepth = solver->getDepth();
 
-      delete static_cast<SOLVERS::Solver*>(solver);
-
       return retval;
     }
 
+#ifdef _MSC_VER
+    int EuropaEngine::planPortfolio(const char*, const std::vector<std::string>&, const char*){
+      checkRuntimeError(ALWAYS_FAIL, "Portfolio planning requires fork(), which is not available on this platform.");
+      return -1;
+    }
+
+    void EuropaEngine::runPortfolioWorker(const TiXmlElement&, int) {}
+#else
+    int EuropaEngine::planPortfolio(const char* txSource, const std::vector<std::string>& configs,
+                                    const char* language){
+      check_error(!configs.empty(), "No planner configurations provided.");
+
+      // Load every configuration up front, so a bad one is reported here rather than in a worker
+      std::vector<boost::shared_ptr<TiXmlDocument> > docs;
+      for(std::vector<std::string>::const_iterator it = configs.begin(); it != configs.end(); ++it) {
+        boost::shared_ptr<TiXmlDocument> doc(new TiXmlDocument(it->c_str()));
+        doc->LoadFile();
+        checkRuntimeError(doc->RootElement() != NULL, "Failed to load planner configuration " << *it);
+        docs.push_back(doc);
+      }
+
+      // Workers refer to tokens by path, which are only kept while logging is enabled
+      DbClientId client = getPlanDatabase()->getClient();
+      if(!client->isTransactionLoggingEnabled())
+        client->enableTransactionLogging();
+
+      if(!playTransactions(txSource, language))
+        return -1;
+
+      // Anything left buffered would otherwise be written once by every worker
+      std::cout.flush();
+      std::cerr.flush();
+
+      std::vector<pid_t> workers;
+      std::vector<int> pipes;
+      for(unsigned int i = 0; i < docs.size(); i++) {
+        int fds[2];
+        checkRuntimeError(pipe(fds) == 0, "Failed to create a pipe for portfolio worker " << i);
+        pid_t pid = fork();
+        checkRuntimeError(pid >= 0, "Failed to fork portfolio worker " << i);
+        if(pid == 0) {
+          close(fds[0]);
+          for(unsigned int j = 0; j < pipes.size(); j++)
+            close(pipes[j]);
+          runPortfolioWorker(*docs[i]->RootElement(), fds[1]);
+        }
+        close(fds[1]);
+        workers.push_back(pid);
+        pipes.push_back(fds[0]);
+        debugMsg("EuropaEngine:planPortfolio", "Started worker " << pid << " with " << configs[i]);
+      }
+
+      // Gather output until a worker reports a plan or all of them have finished
+      std::vector<std::string> results(pipes.size());
+      std::vector<bool> open(pipes.size(), true);
+      unsigned int running = pipes.size();
+      int winner = -1;
+      while(winner < 0 && running > 0) {
+        std::vector<struct pollfd> fds;
+        std::vector<unsigned int> indices;
+        for(unsigned int i = 0; i < pipes.size(); i++) {
+          if(!open[i])
+            continue;
+          struct pollfd fd;
+          fd.fd = pipes[i];
+          fd.events = POLLIN;
+          fd.revents = 0;
+          fds.push_back(fd);
+          indices.push_back(i);
+        }
+
+        if(poll(&fds[0], fds.size(), -1) < 0) {
+          if(errno == EINTR)
+            continue;
+          break;
+        }
+
+        for(unsigned int k = 0; k < fds.size() && winner < 0; k++) {
+          if(fds[k].revents == 0)
+            continue;
+          unsigned int i = indices[k];
+          char buffer[4096];
+          ssize_t bytes = ::read(pipes[i], buffer, sizeof(buffer));
+          if(bytes > 0) {
+            results[i].append(buffer, bytes);
+            continue;
+          }
+          if(bytes < 0 && errno == EINTR)
+            continue;
+          close(pipes[i]);
+          open[i] = false;
+          running--;
+          condDebugMsg(results[i].empty(), "EuropaEngine:planPortfolio",
+                       "Worker " << workers[i] << " with " << configs[i] << " exited without reporting");
+          if(!results[i].empty() && results[i][0] == '1')
+            winner = i;
+        }
+      }
+
+      for(unsigned int i = 0; i < workers.size(); i++) {
+        if(open[i]) {
+          kill(workers[i], SIGKILL);
+          close(pipes[i]);
+        }
+        int status = 0;
+        while(waitpid(workers[i], &status, 0) < 0 && errno == EINTR) {}
+      }
+
+      if(winner < 0) {
+        debugMsg("EuropaEngine:planPortfolio", "No worker found a plan");
+        return -1;
+      }
+
+      debugMsg("EuropaEngine:planPortfolio", "Using the plan found with " << configs[winner]);
+
+      // The worker's outcome, steps and depth are on the first line, followed by its decisions
+      std::istringstream is(results[winner]);
+      int found = 0;
+      is >> found >> m_totalNodes >> m_finalDepth;
+      is.ignore();
+      if(is.peek() != std::char_traits<char>::eof()) {
+        DbClientTransactionPlayer player(client);
+        player.play(is);
+      }
+      // Derived domains are left as the worker's plan left them
+      getConstraintEngine()->propagate();
+
+      return winner;
+    }
+
+    void EuropaEngine::runPortfolioWorker(const TiXmlElement& config, int fd) {
+      std::string result("0 0 0\n");
+      try {
+        DbClientTransactionLog txLog(getPlanDatabase()->getClient());
+        SOLVERS::SolverId solver = (new SOLVERS::Solver(getPlanDatabase(), config))->getId();
+        bool found = solve(solver);
+        std::ostringstream os;
+        os << (found ? 1 : 0) << " " << m_totalNodes << " " << m_finalDepth << std::endl;
+        if(found)
+          txLog.flush(os);
+        result = os.str();
+      }
+      // Reported as no plan found, but explained here since the parent cannot see why
+      catch(const Error& e) {
+        std::cerr << "Portfolio worker failed: ";
+        e.print(std::cerr);
+        std::cerr << std::endl;
+      }
+      catch(const std::exception& e) {
+        std::cerr << "Portfolio worker failed: " << e.what() << std::endl;
+      }
+      catch(...) {
+        std::cerr << "Portfolio worker failed with an unknown exception" << std::endl;
+      }
+
+      const char* data = result.data();
+      std::string::size_type remaining = result.size();
+      while(remaining > 0) {
+        ssize_t bytes = ::write(fd, data, remaining);
+        if(bytes < 0 && errno == EINTR)
+          continue;
+        if(bytes <= 0)
+          break;
+        data += bytes;
+        remaining -= bytes;
+      }
+      close(fd);
+
+      // Skip destructors and exit handlers, which belong to the parent
+      _exit(0);
+    }
+#endif
+
     unsigned long EuropaEngine::getTotalNodesSearched() const { return m_totalNodes; }
 
     unsigned long EuropaEngine::getDepthReached() const { return m_finalDepth; }
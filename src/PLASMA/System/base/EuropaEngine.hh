@@ -8,6 +8,10 @@
 #include "RulesEngineDefs.hh"
 #include "tinyxml.h"
 #include "Logger.hh"
+#include "SolverDefs.hh"
+
+#include <string>
+#include <vector>
 
 namespace EUROPA {
 //namespace System { //TODO: mcr
@@ -32,6 +36,20 @@ namespace EUROPA {
         // TODO: remains of the old Assemblies, these are only used by test code, should be dropped, eventually.
         virtual bool playTransactions(const char* txSource, const char* language="nddl-xml-txn");
         virtual bool plan(const char* txSource, const char* config, const char* language="nddl-xml-txn");
+
+        /**
+         * @brief Plan with several solver configurations at once, keeping the first plan found.
+         *
+         * The initial state is loaded once, then a worker process is forked for each configuration,
+         * sharing the loaded database copy-on-write. Configurations may differ in their flaw handlers
+         * or in their random seeds. The first worker to find a plan sends back the decisions it made as
+         * a transaction log over a pipe, the other workers are killed and the log is replayed here.
+         * Transaction logging is enabled on the client, since decisions are replayed by token path.
+         * A worker that throws writes the error to stderr and counts as having found no plan.
+         * @return The index of the configuration that found the plan, or -1 if none did.
+         */
+        virtual int planPortfolio(const char* txSource, const std::vector<std::string>& configs,
+                                  const char* language="nddl-xml-txn");
         virtual void write(std::ostream& os) const;
         virtual unsigned long getTotalNodesSearched() const;
         virtual unsigned long getDepthReached() const;
@@ -41,6 +59,16 @@ namespace EUROPA {
         virtual void initializeModules();
     	virtual void createModules();
 
+        /**
+         * @brief Configure the solver from the PlannerConfig in the initial state, and solve.
+         */
+        bool solve(const SOLVERS::SolverId solver);
+
+        /**
+         * @brief Solve in a forked worker, write the outcome to fd and exit.
+         */
+        void runPortfolioWorker(const TiXmlElement& config, int fd);
+
         unsigned long m_totalNodes;
         unsigned long m_finalDepth;
   };
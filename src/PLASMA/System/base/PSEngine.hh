@@ -57,6 +57,10 @@ namespace EUROPA {
       virtual PSList<std::string> getViolationExpl() const = 0;
       virtual PSList<PSConstraint*> getAllViolations() const = 0;
 
+      virtual bool getPropagationProfiling() const = 0;
+      virtual void setPropagationProfiling(bool v) = 0;
+      virtual std::string getPropagationProfile() const = 0;
+
       // Plan Database methods
     virtual PSList<PSObject*> getObjects() = 0;
       virtual PSList<PSObject*> getObjectsByType(const std::string& objectType) = 0;
@@ -319,6 +319,10 @@ namespace EUROPA {
     PSList<std::string> getViolationExpl() const;
 	PSList<PSConstraint*> getAllViolations() const;
 
+    bool getPropagationProfiling() const;
+    void setPropagationProfiling(bool v);
+    std::string getPropagationProfile() const;
+
     PSSolver* createSolver(const std::string& configurationFile);
   };
 
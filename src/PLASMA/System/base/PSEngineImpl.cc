@@ -187,6 +187,21 @@ PSEngineImpl::PSEngineImpl() : m_started(false) {}
 	  return getConstraintEnginePtr()->getAllViolations();
   }
 
+  bool PSEngineImpl::getPropagationProfiling() const
+  {
+    return getConstraintEnginePtr()->getPropagationProfiling();
+  }
+
+  void PSEngineImpl::setPropagationProfiling(bool v)
+  {
+    getConstraintEngine()->setPropagationProfiling(v);
+  }
+
+  std::string PSEngineImpl::getPropagationProfile() const
+  {
+    return getConstraintEnginePtr()->getPropagationProfile();
+  }
+
   // Solver methods
   PSSolver* PSEngineImpl::createSolver(const std::string& configurationFile)
   {
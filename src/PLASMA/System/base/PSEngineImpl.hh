@@ -39,6 +39,10 @@ namespace EUROPA {
     virtual PSList<std::string> getViolationExpl() const;
     virtual PSList<PSConstraint*> getAllViolations() const;
 
+    virtual bool getPropagationProfiling() const;
+    virtual void setPropagationProfiling(bool v);
+    virtual std::string getPropagationProfile() const;
+
     // Plan Database methods
     virtual PSList<PSObject*> getObjects();
     virtual PSList<PSObject*> getObjectsByType(const std::string& objectType);
@@ -0,0 +1,109 @@
+#!/usr/bin/perl -w
+
+# Compare the output of runBenchmark against a stored baseline.
+#
+# usage: benchmark-compare.pl [--threshold <percent>] <baseline json> <current json>
+#
+# Medians are compared problem by problem. Wall time, peak RSS and allocations are
+# regressions when they grow by more than the threshold (10% by default). A problem
+# which is no longer solved, or which no longer completes, is always a regression.
+# Changes in steps, depth, constraints executed and propagation cycles are reported,
+# since they show that the search itself has changed, but are not failures. The 90th
+# percentile and maximum wall time and steps, the tail of the time to solution, are
+# reported where both files have them.
+#
+# Exits with 1 if there are any regressions.
+
+use warnings qw/all/;
+use strict;
+
+use Getopt::Long;
+use JSON::PP;
+
+my $threshold = 10;
+GetOptions("threshold=f" => \$threshold) && @ARGV == 2
+  or die "usage: benchmark-compare.pl [--threshold <percent>] <baseline json> <current json>\n";
+
+exit(benchmark_compare($ARGV[0], $ARGV[1]));
+
+sub benchmark_compare {
+  my $baseline = get_problems(shift);
+  my $current = get_problems(shift);
+
+  my @timed = qw/wallSeconds peakRssKb allocations/;
+  my @counted = qw/steps depth constraintsExecuted propagationCycles/;
+  my $regressions = 0;
+
+  printf("%-45s %-20s %14s %14s %9s\n", "problem", "measure", "baseline", "current", "change");
+  foreach my $key (sort keys %$baseline) {
+    my $before = $baseline->{$key};
+    my $after = $current->{$key};
+    if(!defined($after)) {
+      print "$key: missing from current results\n";
+      next;
+    }
+    if(!defined($after->{median}) || $after->{completed} < $after->{runs}) {
+      print "$key: REGRESSION: only $after->{completed} of $after->{runs} runs completed\n";
+      $regressions++;
+      next;
+    }
+    next if(!defined($before->{median}));
+
+    my $m0 = $before->{median};
+    my $m1 = $after->{median};
+    if($m0->{solved} && !$m1->{solved}) {
+      print "$key: REGRESSION: no longer solved\n";
+      $regressions++;
+    }
+    foreach my $measure (@timed) {
+      my $change = percent($m0->{$measure}, $m1->{$measure});
+      my $flag = "";
+      if($change > $threshold) {
+        $flag = " REGRESSION";
+        $regressions++;
+      }
+      printf("%-45s %-20s %14s %14s %8.1f%%%s\n", $key, $measure, $m0->{$measure}, $m1->{$measure}, $change, $flag);
+    }
+    foreach my $measure (@counted) {
+      next if($m0->{$measure} == $m1->{$measure});
+      printf("%-45s %-20s %14s %14s %8.1f%% search changed\n", $key, $measure, $m0->{$measure}, $m1->{$measure},
+             percent($m0->{$measure}, $m1->{$measure}));
+    }
+    foreach my $tail (qw/p90 max/) {
+      next if(!defined($before->{$tail}) || !defined($after->{$tail}));
+      foreach my $measure (qw/wallSeconds steps/) {
+        my $t0 = $before->{$tail}->{$measure};
+        my $t1 = $after->{$tail}->{$measure};
+        printf("%-45s %-20s %14s %14s %8.1f%%\n", $key, "$tail $measure", $t0, $t1, percent($t0, $t1));
+      }
+    }
+  }
+  foreach my $key (sort keys %$current) {
+    print "$key: not in baseline\n" if(!defined($baseline->{$key}));
+  }
+
+  print "$regressions regression(s) beyond ${threshold}%\n";
+  return ($regressions > 0 ? 1 : 0);
+}
+
+sub percent {
+  my ($before, $after) = @_;
+  return 0 if($before == $after);
+  return 100 if($before == 0);
+  return 100 * ($after - $before) / $before;
+}
+
+# Read a runBenchmark file into a hash of problems keyed by model and config.
+sub get_problems {
+  my $file = shift;
+  open(my $fh, "<", $file) or die "Cannot read $file: $!\n";
+  local $/;
+  my $results = decode_json(<$fh>);
+  close($fh);
+
+  my %problems = ();
+  foreach my $problem (@{$results->{problems}}) {
+    $problems{"$problem->{model} $problem->{config}"} = $problem;
+  }
+  return \%problems;
+}
@@ -0,0 +1,458 @@
+/**
+ * @file runBenchmark.cc
+ * @brief Plans System test problems repeatedly and writes performance measurements as JSON.
+ *
+ * Each problem is given as a model and a planner configuration, as for runProblem. Every run
+ * takes place in a child process of its own, so that peak RSS and allocation counts belong
+ * to that run alone and no state is carried from one run to the next. For each run the
+ * following are recorded:
+ *
+ * - wallSeconds: elapsed time to load the model and plan.
+ * - steps, depth: as reported by the Solver.
+ * - constraintsExecuted, propagationCycles: as published by the ConstraintEngine.
+ * - peakRssKb: peak resident set size of the run.
+ * - allocations, allocatedBytes: calls to and bytes requested from operator new.
+ *
+ * The median, 90th percentile and maximum of each measurement are written for each problem, the last
+ * two giving the tail of the time to solution. Use benchmark-compare.pl to compare the output against a
+ * stored baseline.
+ *
+ * Engine configuration properties given with -p are set before the engine starts, for instance
+ * -p TemporalNetwork.queue=radix to compare temporal propagation with the radix heap.
+ *
+ * Attributes given with -a are set on the Solver element of each planner configuration, for instance
+ * -a restarts=luby to restart the search. With -s, each run is given its own seed for the Solver, counting
+ * up from the one given, so that runs differ where the Solver breaks ties at random.
+ *
+ * Usage: runBenchmark [-n runs] [-o output file] [-p name=value ...] [-a name=value ...] [-s seed]
+ *                     <model> <planner config>
+ *                     [<model> <planner config> ...]
+ */
+
+#include "Debug.hh"
+#include "Utils.hh"
+#include "PlanDatabase.hh"
+#include "ConstraintEngine.hh"
+#include "ConstraintEngineListener.hh"
+#include "EuropaEngine.hh"
+#include "NddlInterpreter.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace EUROPA;
+
+namespace {
+  unsigned long sl_allocations = 0;
+  unsigned long sl_allocatedBytes = 0;
+}
+
+// Count allocations made through operator new. Only the child process running a problem reads the counts.
+void* operator new(size_t size) {
+  sl_allocations++;
+  sl_allocatedBytes += size;
+  void* p = malloc(size == 0 ? 1 : size);
+  if(p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+namespace {
+
+  typedef std::map<std::string, std::string> Properties;
+  typedef std::map<std::string, std::string> Attributes;
+
+  class BenchmarkEngine : public EuropaEngine
+  {
+  public:
+    BenchmarkEngine(const Properties& properties)
+    {
+      m_config->setProperty("nddl.includePath","../../NDDL/test/nddl:../../NDDL/base:../../NDDL/nddl:../../NDDL:../../Resource/component/NDDL:../../Resource");
+      for(Properties::const_iterator it = properties.begin(); it != properties.end(); ++it)
+        m_config->setProperty(it->first, it->second);
+      doStart();
+    }
+
+    ~BenchmarkEngine()
+    {
+      doShutdown();
+    }
+  };
+
+  class PropagationCounter : public ConstraintEngineListener {
+  public:
+    PropagationCounter(const ConstraintEngineId ce)
+      : ConstraintEngineListener(ce), m_executed(0), m_cycles(0) {}
+    void notifyExecuted(const ConstraintId) {m_executed++;}
+    void notifyPropagationCommenced() {m_cycles++;}
+    unsigned long getExecuted() const {return m_executed;}
+    unsigned long getCycles() const {return m_cycles;}
+  private:
+    unsigned long m_executed;
+    unsigned long m_cycles;
+  };
+
+  /**
+   * @brief The measurements for one run of a problem. Written as is from the child process to its parent.
+   */
+  struct Sample {
+    bool completed; /*!< False if the run failed to load the model or crashed. */
+    bool solved;
+    double wallSeconds;
+    unsigned long steps;
+    unsigned long depth;
+    unsigned long constraintsExecuted;
+    unsigned long propagationCycles;
+    unsigned long allocations;
+    unsigned long allocatedBytes;
+    long peakRssKb;
+  };
+
+  double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+  }
+
+  /**
+   * @brief Plan a problem in this process.
+   */
+  Sample plan(const char* model, const char* config, const Properties& properties, const Attributes& attributes) {
+    Sample sample;
+    memset(&sample, 0, sizeof(sample));
+
+    // Plan with a copy of the configuration carrying the given Solver attributes
+    char configCopy[] = "/tmp/runBenchmarkXXXXXX";
+    if(!attributes.empty()) {
+      TiXmlDocument doc(config);
+      int fd = mkstemp(configCopy);
+      if(!doc.LoadFile() || doc.RootElement() == NULL || fd < 0) {
+        std::cerr << "Cannot copy " << config << std::endl;
+        return sample;
+      }
+      close(fd);
+      for(Attributes::const_iterator it = attributes.begin(); it != attributes.end(); ++it)
+        doc.RootElement()->SetAttribute(it->first.c_str(), it->second.c_str());
+      doc.SaveFile(configCopy);
+      config = configCopy;
+    }
+
+    BenchmarkEngine engine(properties);
+    PropagationCounter* counter = new PropagationCounter(engine.getPlanDatabase()->getConstraintEngine());
+
+    unsigned long allocations = sl_allocations;
+    unsigned long allocatedBytes = sl_allocatedBytes;
+    double start = now();
+    try {
+      sample.solved = engine.plan(model, config, "nddl");
+      sample.completed = true;
+    }
+    catch(PSLanguageExceptionList errors) {
+      for(int i = 0; i < errors.getExceptionCount(); ++i) {
+        const PSLanguageException& error = errors.getException(i);
+        std::cerr << error.getFileName() << ":" << error.getLine() << ":" <<
+            error.getOffset() << ":  " << error.getMessage() << std::endl;
+      }
+    }
+    sample.wallSeconds = now() - start;
+    sample.allocations = sl_allocations - allocations;
+    sample.allocatedBytes = sl_allocatedBytes - allocatedBytes;
+    sample.steps = engine.getTotalNodesSearched();
+    sample.depth = engine.getDepthReached();
+    sample.constraintsExecuted = counter->getExecuted();
+    sample.propagationCycles = counter->getCycles();
+
+    delete counter;
+    if(!attributes.empty())
+      unlink(configCopy);
+    return sample;
+  }
+
+  /**
+   * @brief Plan a problem in a child process, and collect its measurements and peak RSS.
+   */
+  Sample run(const char* model, const char* config, const Properties& properties, const Attributes& attributes) {
+    Sample sample;
+    memset(&sample, 0, sizeof(sample));
+
+    int fds[2];
+    if(pipe(fds) != 0) {
+      perror("pipe");
+      return sample;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0) {
+      perror("fork");
+      close(fds[0]);
+      close(fds[1]);
+      return sample;
+    }
+
+    if(pid == 0) {
+      close(fds[0]);
+      Sample result = plan(model, config, properties, attributes);
+      ssize_t written = write(fds[1], &result, sizeof(result));
+      close(fds[1]);
+      _exit(written == sizeof(result) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t bytes = read(fds[0], &sample, sizeof(sample));
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    if(bytes != sizeof(sample) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      memset(&sample, 0, sizeof(sample));
+      return sample;
+    }
+
+#ifdef __APPLE__
+    sample.peakRssKb = usage.ru_maxrss / 1024;
+#else
+    sample.peakRssKb = usage.ru_maxrss;
+#endif
+    return sample;
+  }
+
+  double median(std::vector<double> values) {
+    if(values.empty())
+      return 0;
+    std::sort(values.begin(), values.end());
+    unsigned int mid = values.size() / 2;
+    return (values.size() % 2 != 0 ? values[mid] : (values[mid - 1] + values[mid]) / 2);
+  }
+
+  /**
+   * @brief The 90th percentile, by nearest rank.
+   */
+  double percentile90(std::vector<double> values) {
+    if(values.empty())
+      return 0;
+    std::sort(values.begin(), values.end());
+    unsigned int rank = (values.size() * 9 + 9) / 10;
+    return values[rank - 1];
+  }
+
+  double maximum(std::vector<double> values) {
+    return (values.empty() ? 0 : *std::max_element(values.begin(), values.end()));
+  }
+
+  std::string quote(const std::string& s) {
+    std::string result("\"");
+    for(std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+      if(*it == '"' || *it == '\\')
+        result += '\\';
+      result += *it;
+    }
+    return result + "\"";
+  }
+
+  void writeSample(std::ostream& os, const Sample& sample) {
+    os << "{\"solved\": " << (sample.solved ? "true" : "false")
+       << ", \"wallSeconds\": " << std::fixed << std::setprecision(6) << sample.wallSeconds
+       << ", \"steps\": " << sample.steps
+       << ", \"depth\": " << sample.depth
+       << ", \"constraintsExecuted\": " << sample.constraintsExecuted
+       << ", \"propagationCycles\": " << sample.propagationCycles
+       << ", \"peakRssKb\": " << sample.peakRssKb
+       << ", \"allocations\": " << sample.allocations
+       << ", \"allocatedBytes\": " << sample.allocatedBytes << "}";
+  }
+
+  /**
+   * @brief Summarize each measurement over the given samples with a statistic, such as the median.
+   */
+  Sample summarize(const std::vector<Sample>& samples, double (*statistic)(std::vector<double>)) {
+    std::vector<double> wallSeconds, steps, depth, executed, cycles, rss, allocations, allocatedBytes;
+    bool solved = true;
+    for(std::vector<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+      solved = solved && it->solved;
+      wallSeconds.push_back(it->wallSeconds);
+      steps.push_back(it->steps);
+      depth.push_back(it->depth);
+      executed.push_back(it->constraintsExecuted);
+      cycles.push_back(it->propagationCycles);
+      rss.push_back(it->peakRssKb);
+      allocations.push_back(it->allocations);
+      allocatedBytes.push_back(it->allocatedBytes);
+    }
+
+    Sample summary;
+    summary.completed = true;
+    summary.solved = solved;
+    summary.wallSeconds = statistic(wallSeconds);
+    summary.steps = static_cast<unsigned long>(statistic(steps));
+    summary.depth = static_cast<unsigned long>(statistic(depth));
+    summary.constraintsExecuted = static_cast<unsigned long>(statistic(executed));
+    summary.propagationCycles = static_cast<unsigned long>(statistic(cycles));
+    summary.peakRssKb = static_cast<long>(statistic(rss));
+    summary.allocations = static_cast<unsigned long>(statistic(allocations));
+    summary.allocatedBytes = static_cast<unsigned long>(statistic(allocatedBytes));
+    return summary;
+  }
+
+  /**
+   * @brief Write the runs of one problem, with the median, 90th percentile and maximum of each measurement
+   * over the runs that completed.
+   */
+  void writeProblem(std::ostream& os, const char* model, const char* config, const std::vector<Sample>& samples) {
+    std::vector<Sample> completed;
+    unsigned int solved = 0;
+    for(std::vector<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+      if(it->completed)
+        completed.push_back(*it);
+      if(it->completed && it->solved)
+        solved++;
+    }
+
+    os << "    {" << std::endl
+       << "      \"model\": " << quote(model) << "," << std::endl
+       << "      \"config\": " << quote(config) << "," << std::endl
+       << "      \"runs\": " << samples.size() << "," << std::endl
+       << "      \"completed\": " << completed.size() << "," << std::endl
+       << "      \"solvedRuns\": " << solved << "," << std::endl;
+
+    if(!completed.empty()) {
+      os << "      \"median\": ";
+      writeSample(os, summarize(completed, median));
+      os << "," << std::endl << "      \"p90\": ";
+      writeSample(os, summarize(completed, percentile90));
+      os << "," << std::endl << "      \"max\": ";
+      writeSample(os, summarize(completed, maximum));
+      os << "," << std::endl;
+    }
+
+    os << "      \"samples\": [";
+    bool first = true;
+    for(std::vector<Sample>::const_iterator it = completed.begin(); it != completed.end(); ++it) {
+      os << (first ? "" : ",") << std::endl << "        ";
+      writeSample(os, *it);
+      first = false;
+    }
+    os << std::endl << "      ]" << std::endl << "    }";
+  }
+
+  int usage() {
+    std::cout << "usage: runBenchmark [-n <runs>] [-o <output file>] [-p <name>=<value> ...] "
+              << "[-a <name>=<value> ...] [-s <seed>] <model file> <planner config file> "
+              << "[<model file> <planner config file> ...]" << std::endl;
+    return 1;
+  }
+}
+
+int main(int argc, const char** argv)
+{
+  unsigned int runs = 5;
+  const char* outputFile = NULL;
+  Properties properties;
+  Attributes attributes;
+  bool seeded = false;
+  unsigned long seed = 0;
+
+  int i = 1;
+  for( ; i < argc && argv[i][0] == '-'; i++) {
+    if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      runs = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      outputFile = argv[++i];
+    else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc && strchr(argv[i + 1], '=') != NULL) {
+      std::string property(argv[++i]);
+      std::string::size_type equals = property.find('=');
+      properties[property.substr(0, equals)] = property.substr(equals + 1);
+    }
+    else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc && strchr(argv[i + 1], '=') != NULL) {
+      std::string attribute(argv[++i]);
+      std::string::size_type equals = attribute.find('=');
+      attributes[attribute.substr(0, equals)] = attribute.substr(equals + 1);
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      seeded = true;
+      seed = strtoul(argv[++i], NULL, 10);
+    }
+    else
+      return usage();
+  }
+  if(i == argc || (argc - i) % 2 != 0 || runs == 0)
+    return usage();
+
+  // Init data types so that id counts don't fail
+  VoidDT::instance();
+  BoolDT::instance();
+  IntDT::instance();
+  FloatDT::instance();
+  StringDT::instance();
+  SymbolDT::instance();
+
+  std::ofstream file;
+  if(outputFile != NULL) {
+    file.open(outputFile);
+    if(!file) {
+      std::cerr << "Cannot write " << outputFile << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& os = (outputFile != NULL ? file : std::cout);
+
+  bool allCompleted = true;
+  os << "{" << std::endl << "  \"problems\": [";
+  for( ; i < argc; i += 2) {
+    const char* model = argv[i];
+    const char* config = argv[i + 1];
+
+    std::vector<Sample> samples;
+    for(unsigned int n = 0; n < runs; n++) {
+      Attributes runAttributes(attributes);
+      if(seeded) {
+        std::ostringstream runSeed;
+        runSeed << seed + n;
+        runAttributes["seed"] = runSeed.str();
+      }
+      Sample sample = run(model, config, properties, runAttributes);
+      std::cerr << model << " run " << n + 1 << "/" << runs << ": ";
+      if(sample.completed)
+        std::cerr << sample.wallSeconds << "s, " << sample.steps << " steps" << std::endl;
+      else
+        std::cerr << "failed" << std::endl;
+      allCompleted = allCompleted && sample.completed;
+      samples.push_back(sample);
+    }
+
+    os << std::endl;
+    writeProblem(os, model, config, samples);
+    if(i + 2 < argc)
+      os << ",";
+  }
+  os << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+  return (allCompleted ? 0 : 1);
+}
@@ -1,6 +1,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <stdlib.h>
 #include "Debug.hh"
 #include "Utils.hh"
@@ -102,6 +104,55 @@ bool runPlanner(const char* modelFile,
   return true;
 }
 
+/**
+   Plans with a portfolio of a configuration that cannot solve the problem and one that can,
+   and checks that the plan kept is the one plan() finds with the second configuration.
+ */
+bool runPortfolio(const char* modelFile,
+                  const char* failingConfig,
+                  const char* plannerConfig,
+                  const char* language)
+{
+  {
+    TestEngine engine;
+    if(engine.plan(modelFile, failingConfig, language)) {
+      std::cout << failingConfig << " is expected not to solve " << modelFile << std::endl;
+      return false;
+    }
+  }
+
+  std::string expected;
+  {
+    TestEngine engine;
+    if(!engine.plan(modelFile, plannerConfig, language)) {
+      std::cout << plannerConfig << " is expected to solve " << modelFile << std::endl;
+      return false;
+    }
+    expected = PlanDatabaseWriter::toString(engine.getPlanDatabase(), false);
+  }
+
+  TestEngine engine;
+  std::vector<std::string> configs;
+  configs.push_back(failingConfig);
+  configs.push_back(plannerConfig);
+  int winner = engine.planPortfolio(modelFile, configs, language);
+  if(winner != 1) {
+    std::cout << "Portfolio planning kept configuration " << winner << ", expected 1" << std::endl;
+    return false;
+  }
+
+  std::string found = PlanDatabaseWriter::toString(engine.getPlanDatabase(), false);
+  if(found != expected) {
+    std::cout << "Portfolio plan differs from the plan found by plan()" << std::endl
+              << "Expected" << std::endl << expected << std::endl
+              << "Found" << std::endl << found << std::endl;
+    return false;
+  }
+
+  debugMsg("Main:runPortfolio", "Found a plan at depth "
+           << engine.getDepthReached() << " after " << engine.getTotalNodesSearched());
+  return true;
+}
 
 bool copyFromFile(const char* language){
   // Populate plan database from transaction log
@@ -132,15 +183,17 @@ bool copyFromFile(const char* language){
 #define MODEL_INDEX 1
 #define PCONF_INDEX 2
 #define LANG_INDEX 3
+#define FAILING_PCONF_INDEX 4
 
 int main(int argc, const char** argv)
 {
-    if(argc != ARGC) {
+    if(argc != ARGC && argc != ARGC + 1) {
       std::cout << "usage: "
                 << "runProblem "
                 << "<model file> "
                 << "<planner config file> "
                 << "<language to interpret> "
+                << "[<planner config file that fails, to plan with both as a portfolio>] "
                 << std::endl;
       return 1;
     }
@@ -158,6 +211,13 @@ int main(int argc, const char** argv)
     StringDT::instance();
     SymbolDT::instance();
 
+    if(argc == ARGC + 1) {
+      if(!runPortfolio(modelFile, argv[FAILING_PCONF_INDEX], plannerConfig, language))
+        return 1;
+      std::cout << "Finished" << std::endl;
+      return 0;
+    }
+
     const char* performanceTest = getenv("EUROPA_PERFORMANCE");
 
     if (performanceTest != NULL && strcmp(performanceTest, "1") == 0) {
@@ -9,6 +9,7 @@
 #include "CESchema.hh"
 
 #include <boost/cast.hpp>
+#include <cstdlib>
 
 namespace EUROPA {
 
@@ -44,7 +45,15 @@ void ModuleTemporalNetwork::initialize(EngineId engine) {
 
   PropagatorId temporalPropagator;
   if (engine->getConfig()->getProperty("TemporalNetwork.useTemporalPropagator") != "N") {
-    temporalPropagator = (new TemporalPropagator("Temporal", ce->getId()))->getId();
+    bool flatAdjacency =
+        engine->getConfig()->getProperty("TemporalNetwork.flatAdjacency") == "true";
+    QueueImplementation queue =
+        (engine->getConfig()->getProperty("TemporalNetwork.queue") == "radix") ?
+        RADIX_HEAP_QUEUE : BINARY_HEAP_QUEUE;
+    int threads = atoi(engine->getConfig()->getProperty("TemporalNetwork.threads").c_str());
+    temporalPropagator =
+        (new TemporalPropagator("Temporal", ce->getId(), flatAdjacency, queue,
+                                static_cast<unsigned int>(threads > 1 ? threads : 1)))->getId();
     pdb->setTemporalAdvisor((new STNTemporalAdvisor(temporalPropagator))->getId());
   }
   else {
@@ -40,6 +40,17 @@ typedef TemporalPropagator* TemporalPropagatorId;
 class TemporalNetworkListener;
 typedef TemporalNetworkListener* TemporalNetworkListenerId;
 
+/**
+ * @brief The priority queues the BucketQueue can be built on.
+ */
+enum QueueImplementation {
+  BINARY_HEAP_QUEUE,  // A binary heap. Keys may be inserted in any order.
+  RADIX_HEAP_QUEUE    // A radix heap. Near constant time while keys inserted are
+                      // no less than the last key popped, as in Dijkstra with
+                      // Johnson potentials. Otherwise it becomes a binary heap
+                      // until it is next reset.
+};
+
 //TODO: figure out why this has to be here.
 //why the remove call isn't picking up operator==
 template<typename T>
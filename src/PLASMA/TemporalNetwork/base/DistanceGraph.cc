@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <sstream>
+#include <algorithm>
+#include <functional>
 
 #include "DistanceGraph.hh"
 #include "Error.hh"
@@ -51,9 +53,12 @@ void deleteIfEqual(std::vector<ELEMENT>& elements, ELEMENT element){
 // Global value overridden only for Rax-derived system test.
 // Bool IsOkToRemoveConstraintTwice = false;
 
-DistanceGraph::DistanceGraph() : edges(), dijkstraGeneration(0), nodes(),
-                                 dqueue(new Dqueue()),
-                                 bqueue(new BucketQueue(100)), edgeNogoodList()
+DistanceGraph::DistanceGraph(bool flatAdjacency)
+  : edges(), dijkstraGeneration(0), edgeGeneration(0), nodeTable(), freeSlots(),
+    flat(flatAdjacency), flatOut(), flatIn(), flatPotential(), flatDistance(),
+    flatGeneration(), flatDepth(), flatHeap(), nodes(),
+    dqueue(new Dqueue()),
+    bqueue(new BucketQueue(100)), edgeNogoodList()
 {
 }
 
@@ -65,7 +70,132 @@ DistanceGraph::~DistanceGraph()
 void DistanceGraph::addNode(DnodeId node) {
   node->potential = 0;
   this->nodes.push_back(node);
-  
+
+  if (freeSlots.empty()) {
+    node->slot = static_cast<Int>(nodeTable.size());
+    nodeTable.push_back(node.get());
+  }
+  else {
+    node->slot = freeSlots.back();
+    freeSlots.pop_back();
+    nodeTable[node->slot] = node.get();
+  }
+
+  if (flat) {
+    if (static_cast<unsigned long>(node->slot) == flatPotential.size()) {
+      flatOut.blocks.push_back(EdgeBlock());
+      flatIn.blocks.push_back(EdgeBlock());
+      flatPotential.push_back(0);
+      flatDistance.push_back(0);
+      flatGeneration.push_back(0);
+      flatDepth.push_back(0);
+    }
+    else {
+      flatPotential[node->slot] = 0;
+      flatGeneration[node->slot] = 0;
+    }
+  }
+}
+
+Void DistanceGraph::setPotential(Dnode& node, Time potential)
+{
+  node.potential = potential;
+  if (flat)
+    flatPotential[node.slot] = potential;
+}
+
+Void DistanceGraph::setLength(Dedge& edge, Time length)
+{
+  edge.length = length;
+  edgeGeneration++;
+  if (flat) {
+    flatOut.entries[edge.outEntry].length = length;
+    flatIn.entries[edge.inEntry].length = length;
+  }
+}
+
+Int DistanceGraph::addFlatEdge(FlatEdges& flatEdges, Int slot, Int node, Time length,
+                               Dedge* edge, bool out)
+{
+  EdgeBlock& block = flatEdges.blocks[slot];
+  if (block.size == block.capacity) {
+    if (block.dead > 0)
+      compactFlatBlock(flatEdges, block, block.begin, out);
+    else if (2 * flatEdges.garbage > static_cast<Int>(flatEdges.entries.size()))
+      compactFlatEdges(flatEdges, out);
+  }
+  if (block.size == block.capacity) {
+    // Move the block to the end, with room to grow
+    Int begin = static_cast<Int>(flatEdges.entries.size());
+    Int capacity = std::max(4, 2 * block.capacity);
+    flatEdges.entries.resize(begin + capacity, FlatEdge(-1, 0, NULL));
+    flatEdges.garbage += block.capacity;
+    compactFlatBlock(flatEdges, block, begin, out);
+    block.capacity = capacity;
+  }
+  Int entry = block.begin + block.size++;
+  flatEdges.entries[entry] = FlatEdge(node, length, edge);
+  return entry;
+}
+
+Void DistanceGraph::removeFlatEdge(FlatEdges& flatEdges, Int slot, Int entry)
+{
+  EdgeBlock& block = flatEdges.blocks[slot];
+  flatEdges.entries[entry].node = -1;
+  flatEdges.entries[entry].edge = NULL;
+  block.dead++;
+  // Edges are mostly removed in the reverse of the order they were added,
+  // as search backtracks, so tombstones at the end are simply dropped.
+  while (block.size > 0 && flatEdges.entries[block.begin + block.size - 1].node < 0) {
+    block.size--;
+    block.dead--;
+  }
+}
+
+Void DistanceGraph::compactFlatBlock(FlatEdges& flatEdges, EdgeBlock& block, Int begin, bool out)
+{
+  Int to = begin;
+  for (Int from = block.begin; from < block.begin + block.size; from++) {
+    FlatEdge flatEdge = flatEdges.entries[from];
+    if (flatEdge.node < 0)
+      continue;
+    flatEdges.entries[to] = flatEdge;
+    if (out)
+      flatEdge.edge->outEntry = to;
+    else
+      flatEdge.edge->inEntry = to;
+    to++;
+  }
+  block.begin = begin;
+  block.size = to - begin;
+  block.dead = 0;
+}
+
+Void DistanceGraph::compactFlatEdges(FlatEdges& flatEdges, bool out)
+{
+  std::vector<FlatEdge> entries;
+  entries.reserve(flatEdges.entries.size() - flatEdges.garbage);
+  for (unsigned long slot = 0; slot < flatEdges.blocks.size(); slot++) {
+    EdgeBlock& block = flatEdges.blocks[slot];
+    Int begin = static_cast<Int>(entries.size());
+    for (Int i = block.begin; i < block.begin + block.size; i++) {
+      const FlatEdge& flatEdge = flatEdges.entries[i];
+      if (flatEdge.node < 0)
+        continue;
+      if (out)
+        flatEdge.edge->outEntry = static_cast<Int>(entries.size());
+      else
+        flatEdge.edge->inEntry = static_cast<Int>(entries.size());
+      entries.push_back(flatEdge);
+    }
+    block.begin = begin;
+    block.size = static_cast<Int>(entries.size()) - begin;
+    block.capacity = block.size + block.size / 2;
+    block.dead = 0;
+    entries.resize(begin + block.capacity, FlatEdge(-1, 0, NULL));
+  }
+  flatEdges.entries.swap(entries);
+  flatEdges.garbage = 0;
 }
 
 DnodeId DistanceGraph::makeNode()
@@ -117,6 +247,17 @@ Void DistanceGraph::deleteNode(Dnode& node)
   }
   node.inCount = node.outCount = 0;
   node.potential = 99;  // A clue for debugging purposes
+  edgeGeneration++;
+
+  if (flat) {
+    flatOut.garbage += flatOut.blocks[node.slot].capacity;
+    flatIn.garbage += flatIn.blocks[node.slot].capacity;
+    flatOut.blocks[node.slot] = EdgeBlock();
+    flatIn.blocks[node.slot] = EdgeBlock();
+  }
+  nodeTable[node.slot] = NULL;
+  freeSlots.push_back(node.slot);
+  node.slot = -1;
   nodes.erase(std::remove_if(nodes.begin(), nodes.end(), ptr_compare<Dnode>(&node)),
               nodes.end());
 }
@@ -154,7 +295,12 @@ Dedge* DistanceGraph::createEdge(Dnode& from, Dnode& to, Time length) {
               TempNetErr::TempNetMemoryError());
 
   edge->length = length;
-  this->edges.insert(edge);
+  edgeGeneration++;
+  this->edges.insert(std::make_pair(edge.get(), edge));
+  if (flat) {
+    edge->outEntry = addFlatEdge(flatOut, from.slot, to.slot, length, edge.get(), true);
+    edge->inEntry = addFlatEdge(flatIn, to.slot, from.slot, length, edge.get(), false);
+  }
   attachEdge (from.outArray, from.outArraySize, from.outCount, *edge.get());
   attachEdge (to.inArray, to.inArraySize, to.inCount, *edge.get());
   from.edgemap[&to] = edge.get();
@@ -177,7 +323,12 @@ Void DistanceGraph::eraseEdge(Dedge& edge)
 
   // edges.erase(edge);
   edge.length = 99;  // A clue for debugging purposes
-  edges.erase(std::find_if(edges.begin(), edges.end(), ptr_compare<Dedge>(&edge)));
+  edgeGeneration++;
+  if (flat) {
+    removeFlatEdge(flatOut, edge.from.slot, edge.outEntry);
+    removeFlatEdge(flatIn, edge.to.slot, edge.inEntry);
+  }
+  edges.erase(&edge);
 }
 
 Void DistanceGraph::addEdgeSpec(Dnode& from, Dnode& to, Time length)
@@ -192,7 +343,7 @@ Void DistanceGraph::addEdgeSpec(Dnode& from, Dnode& to, Time length)
     edge = createEdge(from,to,length);
   edge->lengthSpecs.push_back(length);
   if (length < edge->length)
-    edge->length = length;
+    setLength(*edge, length);
 }
 
 Void DistanceGraph::removeEdgeSpec(Dnode& from, Dnode& to, Time length)
@@ -216,8 +367,10 @@ Void DistanceGraph::removeEdgeSpec(Dnode& from, Dnode& to, Time length)
   if (lengthSpecs.empty())
     deleteEdge(*edge);
   else {
-    edge->length = *std::min_element(lengthSpecs.begin(), lengthSpecs.end());
-  }  
+    Time newLength = *std::min_element(lengthSpecs.begin(), lengthSpecs.end());
+    if (newLength != edge->length)
+      setLength(*edge, newLength);
+  }
 }
 
 Bool DistanceGraph::bellmanFord()
@@ -228,7 +381,7 @@ Bool DistanceGraph::bellmanFord()
     Time oldPotential = node->potential;
     // Cache beginning potential in distance field.
     node->distance = oldPotential;
-    node->potential = 0;
+    setPotential(*node, 0);
     node->depth = 0;
     // Use diff from oldPotential as priority ordering.  This
     // minimizes the amount of wasted superseded propagations.
@@ -240,17 +393,36 @@ Bool DistanceGraph::bellmanFord()
     if (node == NULL)
       break;
     // Cache node vars -- Chucko 22 Apr 2002
-    Int nodeOutCount = node->outCount;
-    if (nodeOutCount > 0) {
+    Int first = 0;
+    Int last = node->outCount;
+    if (flat) {
+      first = flatOut.blocks[node->slot].begin;
+      last = first + flatOut.blocks[node->slot].size;
+    }
+    if (last > first) {
       std::vector<Dedge*>& nodeOutArray = node->outArray;
       Time nodePotential = node->potential;
-      for (Int i=0; i< nodeOutCount; i++) {
-	Dedge* edge = nodeOutArray[i];
+      for (Int i=first; i< last; i++) {
+	Dedge* edge;
+	Time potential;
+	if (flat) {
+	  // Only dereference the edge once it is known to improve the potential
+	  const FlatEdge& flatEdge = flatOut.entries[i];
+	  if (flatEdge.node < 0)
+	    continue;
+	  potential = nodePotential + flatEdge.length;
+	  if (!(potential < flatPotential[flatEdge.node]))
+	    continue;
+	  edge = flatEdge.edge;
+	}
+	else {
+	  edge = nodeOutArray[i];
+	  potential = nodePotential + edge->length;
+	}
 	check_error(edge); 
 	Dnode& next = edge->to;
-	Time potential = nodePotential + edge->length;
 	if (potential < next.potential) {
-	  next.potential = potential;
+	  setPotential(next, potential);
 	  next.predecessor = edge;
 	  handleNodeUpdate(next);
 	  // In following cycleDetected() is a no-op hook to allow
@@ -285,15 +457,33 @@ Bool DistanceGraph::incBellmanFord()
     if (node == NULL)
       break;
     // Cache node vars -- Chucko 22 Apr 2002
-    Int nodeOutCount = node->outCount;
-    if (nodeOutCount > 0) {
+    Int first = 0;
+    Int last = node->outCount;
+    if (flat) {
+      first = flatOut.blocks[node->slot].begin;
+      last = first + flatOut.blocks[node->slot].size;
+    }
+    if (last > first) {
       std::vector<Dedge*>& nodeOutArray = node->outArray;
       Time nodePotential = node->potential;
-      for (Int i=0; i< nodeOutCount; i++) {
-	Dedge* edge = nodeOutArray[i];
+      for (Int i=first; i< last; i++) {
+	Dedge* edge;
+	Time potential;
+	if (flat) {
+	  const FlatEdge& flatEdge = flatOut.entries[i];
+	  if (flatEdge.node < 0)
+	    continue;
+	  potential = nodePotential + flatEdge.length;
+	  if (!(potential < flatPotential[flatEdge.node]))
+	    continue;
+	  edge = flatEdge.edge;
+	}
+	else {
+	  edge = nodeOutArray[i];
+	  potential = nodePotential + edge->length;
+	}
 	check_error(edge);
 	Dnode& next = edge->to;
-	Time potential = nodePotential + edge->length;
 
 	if (potential < next.potential) {
   check_error(!(potential < MIN_DISTANCE),
@@ -307,7 +497,7 @@ Bool DistanceGraph::incBellmanFord()
           }
           Time oldPotential = next.distance;
    
-	  next.potential = potential;
+	  setPotential(next, potential);
 	  next.predecessor = edge;
 	  handleNodeUpdate(next);
 
@@ -330,7 +520,7 @@ Bool DistanceGraph::incBellmanFord()
   return true;
 }
 
-Void DistanceGraph::dijkstra(Dnode& source, Dnode* destination)
+Void DistanceGraph::directedDijkstra(Dnode& source, Dnode* destination, int direction)
 {
  check_error(isValid(source), "node is not defined in this graph");
 
@@ -343,13 +533,17 @@ Void DistanceGraph::dijkstra(Dnode& source, Dnode* destination)
              "node is not null or defined in this graph");
 
  //debugMsg("DistanceGraph:dijkstra", "from " << source << " to " << destination);
+  if (flat) {
+    flatDijkstra(source, destination, direction);
+    return;
+  }
   source.distance = 0;
   source.depth=0;
   preventGenerationOverflow();
   Int generation = ++(this->dijkstraGeneration);
   source.generation = generation;
   BucketQueue& queue = initializeBqueue();
-  queue.insertInQueue(&source);
+  queue.insertInQueue(&source, (direction == -1) ? source.potential : - source.potential);
 #ifndef EUROPA_FAST
   Int BFbound = static_cast<Int>(this->nodes.size());
 #endif
@@ -359,13 +553,13 @@ Void DistanceGraph::dijkstra(Dnode& source, Dnode* destination)
     if (node == NULL || node == destination)
       return;
     // Cache node vars -- Chucko 22 Apr 2002
-    Int nodeOutCount = node->outCount;
-    if (nodeOutCount > 0) {
-      std::vector<Dedge*>& nodeOutArray = node->outArray;
+    Int nodeCount = (direction == -1) ? node->inCount : node->outCount;
+    if (nodeCount > 0) {
+      std::vector<Dedge*>& nodeArray = (direction == -1) ? node->inArray : node->outArray;
       Time nodeDistance = node->distance;
-      for (Int i=0; i< nodeOutCount; i++) {
-	Dedge* edge = nodeOutArray[i];
-	Dnode& next = edge->to;
+      for (Int i=0; i< nodeCount; i++) {
+	Dedge* edge = nodeArray[i];
+	Dnode& next = (direction == -1) ? edge->from : edge->to;
 	Time newDistance = nodeDistance + edge->length;
 	/*
 	condDebugMsg(next->generation >= generation, 
@@ -387,7 +581,10 @@ Void DistanceGraph::dijkstra(Dnode& source, Dnode* destination)
                 TempNetErr::TempNetInternalError());
 	  next.distance = newDistance;
 	  next.predecessor = edge;
-	  queue.insertInQueue (&next);
+	  // Keys are reduced by the potentials, which are consistent with the edge lengths
+	  // in both directions, so they never decrease as the search proceeds.
+	  queue.insertInQueue (&next, (direction == -1) ? newDistance + next.potential
+                                                        : newDistance - next.potential);
 	  //debugMsg("DistanceGraph:dijkstra", "New distance of " << newDistance << " through node " << next);
 	  handleNodeUpdate(next);
 	}
@@ -396,9 +593,64 @@ Void DistanceGraph::dijkstra(Dnode& source, Dnode* destination)
   }
 }
 
+Void DistanceGraph::flatDijkstra(Dnode& source, Dnode* destination, int direction)
+{
+  preventGenerationOverflow();
+  Int generation = ++(this->dijkstraGeneration);
+  Int dest = (destination == NULL) ? -1 : destination->slot;
+  const FlatEdges& flatEdges = (direction == -1) ? flatIn : flatOut;
+  flatDistance[source.slot] = 0;
+  flatDepth[source.slot] = 0;
+  flatGeneration[source.slot] = generation;
+  flatHeap.clear();
+  flatHeap.push_back(std::make_pair(-direction * flatPotential[source.slot], source.slot));
+  check_error_variable(Int BFbound = static_cast<Int>(this->nodes.size()));
+  while (!flatHeap.empty()) {
+    std::pop_heap(flatHeap.begin(), flatHeap.end(), std::greater<std::pair<Time, Int> >());
+    std::pair<Time, Int> top = flatHeap.back();
+    flatHeap.pop_back();
+    Int slot = top.second;
+    Time nodeDistance = flatDistance[slot];
+    // Skip entries superseded by a shorter distance found later
+    if (top.first != nodeDistance - direction * flatPotential[slot])
+      continue;
+    if (slot == dest)
+      return;
+    const EdgeBlock& block = flatEdges.blocks[slot];
+    for (Int i = block.begin; i < block.begin + block.size; i++) {
+      const FlatEdge& flatEdge = flatEdges.entries[i];
+      Int next = flatEdge.node;
+      if (next < 0)
+        continue;
+      Time newDistance = nodeDistance + flatEdge.length;
+      if (newDistance > MAX_DISTANCE)
+        continue;
+      if (flatGeneration[next] < generation || newDistance < flatDistance[next]) {
+        flatGeneration[next] = generation;
+        check_error(!(newDistance < MIN_DISTANCE),
+                    "Potential underflow during distance propagation",
+                    TempNetErr::TimeOutOfBoundsError());
+        // Next check is a failsafe to prevent infinite propagation.
+        check_error(!((flatDepth[next] = flatDepth[slot] + 1) > BFbound),
+                    "Dijkstra propagation in inconsistent network",
+                    TempNetErr::TempNetInternalError());
+        flatDistance[next] = newDistance;
+        Dnode& nextNode = *nodeTable[next];
+        nextNode.predecessor = flatEdge.edge;
+        flatHeap.push_back(std::make_pair(newDistance - direction * flatPotential[next], next));
+        std::push_heap(flatHeap.begin(), flatHeap.end(), std::greater<std::pair<Time, Int> >());
+        handleNodeUpdate(nextNode);
+      }
+    }
+  }
+}
+
 Time DistanceGraph::getDistance(const Dnode& node)
 {
   check_error(isValid(node), "node is not defined in this graph");
+  // Each sweep has its own generation, so whichever layout it wrote to is current
+  if (flat && flatGeneration[node.slot] == this->dijkstraGeneration)
+    return flatDistance[node.slot];
   if (node.generation == this->dijkstraGeneration)
     return node.distance;
   else
@@ -572,6 +824,7 @@ Void DistanceGraph::preventGenerationOverflow()
     unsigned long nodeCount = this->nodes.size();
     for (unsigned long i=0; i< nodeCount; i++)
       this->nodes[i]->generation = 0;
+    std::fill(flatGeneration.begin(), flatGeneration.end(), 0);
     this->dijkstraGeneration = 0;
   }
 }
@@ -591,16 +844,27 @@ BucketQueue& DistanceGraph::initializeBqueue()
   return *bqueue;
 }
 
+Void DistanceGraph::setQueueImplementation(QueueImplementation implementation)
+{
+  bqueue->reset();
+  bqueue->setImplementation(implementation);
+}
+
+QueueImplementation DistanceGraph::getQueueImplementation() const
+{
+  return bqueue->getImplementation();
+}
+
 bool DistanceGraph::hasNode(const Dnode& node) const {
-  return std::find_if(nodes.begin(), nodes.end(), ptr_compare<Dnode>(&node)) !=
-      nodes.end();
+  return node.slot >= 0 && static_cast<unsigned long>(node.slot) < nodeTable.size() &&
+      nodeTable[node.slot] == &node;
 }
 
 std::string DistanceGraph::toString() const {
  std::stringstream sstr;
 
- for (std::set<DedgeId>::const_iterator it = edges.begin(); it != edges.end(); ++it){
-   DedgeId edge = *it;
+ for (std::map<Dedge*, DedgeId>::const_iterator it = edges.begin(); it != edges.end(); ++it){
+   DedgeId edge = it->second;
    sstr << &edge->from << " " << &edge->to << " " << edge->length << std::endl;
  }
 
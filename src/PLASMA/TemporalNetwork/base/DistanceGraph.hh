@@ -21,6 +21,7 @@
 #include <climits>
 #include <vector>
 #include <list>
+#include <map>
 #include <queue>
 #include <string>
 #include <limits>
@@ -90,12 +91,69 @@ class BucketQueue;    // For use in Dijkstra algorithm.
      *  directed graph. Dijkstra's algorithum solves this if all weights are nonnegative.
      *  The Bellman-Ford algorithum handles any weights.
      *
+     *  A graph may be constructed with a flat adjacency, for large networks
+     *  where propagation is bound by memory access. Each node then also has
+     *  a slot number, and edges are mirrored into contiguous per-node blocks
+     *  of (slot, length) entries, with removed edges left as tombstones until
+     *  the block is next compacted. The distances, potentials and generations
+     *  read while scanning edges are kept in arrays indexed by slot, so that
+     *  Dijkstra and Bellman-Ford only touch a Dnode when they improve it.
+     *  The Dnode edge arrays are maintained in either case.
+     *
      * @ingroup TemporalNetwork
     */
 
 class DistanceGraph {
-  std::set<DedgeId> edges;
+  std::map<Dedge*, DedgeId> edges;
   Int dijkstraGeneration;
+  unsigned long edgeGeneration; // Changes whenever an edge or node is added, removed or changes length.
+
+  // Table of nodes by slot, with NULL for the slots of deleted nodes.
+  std::vector<Dnode*> nodeTable;
+  std::vector<Int> freeSlots;
+
+  /**
+   * @brief An edge in a flat adjacency block. The node is the slot of the
+   * node at the other end of the edge, or -1 for a removed edge.
+   */
+  struct FlatEdge {
+    FlatEdge(Int n, Time l, Dedge* e) : node(n), length(l), edge(e) {}
+    Int node;
+    Time length;
+    Dedge* edge;
+  };
+
+  /**
+   * @brief The entries for one node's edges, in one direction, are those in
+   * [begin, begin + size) with room for capacity before another block is needed.
+   */
+  struct EdgeBlock {
+    EdgeBlock() : begin(0), size(0), capacity(0), dead(0) {}
+    Int begin;
+    Int size;
+    Int capacity;
+    Int dead;       // Tombstones within size.
+  };
+
+  /**
+   * @brief Flat adjacency in one direction.
+   */
+  struct FlatEdges {
+    FlatEdges() : blocks(), entries(), garbage(0) {}
+    std::vector<EdgeBlock> blocks;   // By node slot.
+    std::vector<FlatEdge> entries;
+    Int garbage;                     // Entries in abandoned blocks.
+  };
+
+  bool flat;
+  FlatEdges flatOut;
+  FlatEdges flatIn;
+  std::vector<Time> flatPotential;    // Mirrors Dnode::potential, by slot.
+  std::vector<Time> flatDistance;     // Dijkstra distances, by slot.
+  std::vector<Int> flatGeneration;    // Dijkstra generations, by slot.
+  std::vector<Int> flatDepth;         // Dijkstra depths, by slot.
+  std::vector<std::pair<Time, Int> > flatHeap; // Dijkstra queue of (key, slot).
+
 protected:
   std::vector<DnodeId> nodes; //TODO: should this be a ptr_container instead?
   boost::scoped_ptr<Dqueue> dqueue;
@@ -146,8 +204,22 @@ public:
 
  /**
   * @brief Constructor
+  * @param flatAdjacency if true also keep the flat adjacency, and use it for propagation.
+  */
+  DistanceGraph (bool flatAdjacency = false);
+
+ /**
+  * @brief Test if the graph keeps a flat adjacency.
   */
-  DistanceGraph ();
+  bool hasFlatAdjacency() const { return flat; }
+
+ /**
+  * @brief Choose the priority queue used by Dijkstra and Bellman-Ford.
+  * The default is BINARY_HEAP_QUEUE.
+  */
+  Void setQueueImplementation(QueueImplementation implementation);
+
+  QueueImplementation getQueueImplementation() const;
 
  /**
   * @brief Destructor
@@ -183,7 +255,19 @@ public:
    * @param source start node
    * @param destination terminal node (optional)
    */
-  Void dijkstra(Dnode& source, Dnode* destination = NULL);
+  Void dijkstra(Dnode& source, Dnode* destination = NULL) {
+    directedDijkstra(source, destination, +1);
+  }
+
+   /**
+   * @brief As dijkstra(), but following edges backwards, so finding the shortest paths to source
+   *        from all other nodes.
+   * @param source end node of the paths
+   * @param destination start node of the paths (optional)
+   */
+  Void dijkstraBackward(Dnode& source, Dnode* destination = NULL) {
+    directedDijkstra(source, destination, -1);
+  }
 
    /**
    * @brief Incremental version of Dijkstra's algorithum
@@ -207,6 +291,8 @@ public:
     boundedDijkstra (source, bound, maxPotential, -1);
   }
 private:
+  Void directedDijkstra(Dnode& source, Dnode* destination, int direction);
+  Void flatDijkstra(Dnode& source, Dnode* destination, int direction);
   Void boundedDijkstra (Dnode& source,
                         Time bound,
                         Time destPotential,
@@ -229,6 +315,12 @@ public:
    Bool isDistanceLessThan (Dnode& from, Dnode& to, Time bound);
 
 
+   /**
+   * @brief Identify the current state of the edges in the graph. Any result
+   *        calculated from the edges remains valid while this is unchanged.
+   */
+  unsigned long getEdgeGeneration() const { return edgeGeneration; }
+
    /**
    * @brief test if node is a member of the network.
    * @return true iff node is valid, false otherwise.
@@ -252,6 +344,12 @@ protected:
    */
   Dedge* findEdge(Dnode& from, Dnode& to);
 
+  /**
+   * @brief Set the potential of a node. Subclasses must use this rather than
+   * assign Dnode::potential, so that the flat adjacency's copy is kept in step.
+   */
+  Void setPotential(Dnode& node, Time potential);
+
   /**
    * @brief test if network contain node
    * @param node to test membership
@@ -290,6 +388,12 @@ protected:
    */
   virtual void handleNodeUpdate(const Dnode& node);
 
+  /**
+   * @brief Collect the negative cycle through the predecessors of a node
+   * into the edge nogood list.
+   */
+  Void updateNogoodList(Dnode& start);
+
 private:
   
   DistanceGraph(const DistanceGraph&);
@@ -298,9 +402,14 @@ private:
   Void eraseEdge(Dedge& edge);
   Void preventNodeMarkOverflow();
   Void preventGenerationOverflow();
-  Void updateNogoodList(Dnode&);
   Bool isAllZeroPropagationPath(Dnode& node, Dnode& targ, Time potential);
   Bool isPropagationPath(Dnode& node, Dnode& targ, Time potential);
+
+  Void setLength(Dedge& edge, Time length);
+  Int addFlatEdge(FlatEdges& flatEdges, Int slot, Int node, Time length, Dedge* edge, bool out);
+  Void removeFlatEdge(FlatEdges& flatEdges, Int slot, Int entry);
+  Void compactFlatBlock(FlatEdges& flatEdges, EdgeBlock& block, Int begin, bool out);
+  Void compactFlatEdges(FlatEdges& flatEdges, bool out);
 };
 
 
@@ -345,11 +454,12 @@ private:
   Int markLocal;               // Used for obsoletable marking of nodes.
   static Int markGlobal;       // Global obsolescence number for marks.
   Int generation;     // Used for obsoleting Dijkstra-calculated distances.
+  Int slot;           // Position in the graph's node table.
 public:
 
   Dnode() : inArray(), inArraySize(0), inCount(0), outArray(),
             outArraySize(0), outCount(0), edgemap(), distance(0), potential(0), depth(0),
-            key(0), link(), predecessor(), markLocal(0), generation(0) {
+            key(0), link(), predecessor(), markLocal(0), generation(0), slot(-1) {
   }
   virtual ~Dnode() {
   }
@@ -379,6 +489,8 @@ public:
 class Dedge {
   friend class DistanceGraph;
   std::vector<Time> lengthSpecs;
+  Int outEntry;   // Position in the flat adjacency of from's out edges, if any.
+  Int inEntry;    // Position in the flat adjacency of to's in edges, if any.
 
 public:
   Dnode& from;
@@ -387,7 +499,7 @@ public:
   /**
    * @brief constructor
    */
-  Dedge (Dnode& _from, Dnode& _to):lengthSpecs(), from(_from), to(_to), length(0) {}
+  Dedge (Dnode& _from, Dnode& _to):lengthSpecs(), outEntry(-1), inEntry(-1), from(_from), to(_to), length(0) {}
   /**
    * @brief destructor
    */
@@ -439,12 +551,36 @@ private:
   BucketQueue(const BucketQueue&);
   BucketQueue& operator=(const BucketQueue&);
   DnodePriorityQueue buckets;
+
+  // Radix heap. Keys are mapped to unsigned values preserving their order,
+  // and radix[i] holds the entries whose key first differs from radixLast,
+  // the last key popped, in bit i-1; radix[0] holds those equal to it.
+  // A key less than radixLast, as in Bellman-Ford, moves the entries to the
+  // binary heap, which is used until the next reset.
+  static const int RADIX_BUCKETS = 65;
+  QueueImplementation implementation;
+  bool radixActive;
+  std::vector<std::vector<Bucket> > radix;
+  unsigned long radixLast;
+  unsigned long radixSize;
+
+  Void insertInRadix(const Bucket& bucket);
+  Dnode* popMinFromRadix();
+  Void spillRadix();
 public:
 
   /**
    * @brief constructor
+   * @param implementation the priority queue to build on
    */
-  BucketQueue (Int n);
+  BucketQueue (Int n, QueueImplementation implementation = BINARY_HEAP_QUEUE);
+
+  /**
+   * @brief Change the priority queue. The queue must be empty.
+   */
+  Void setImplementation(QueueImplementation implementation);
+
+  QueueImplementation getImplementation() const { return implementation; }
 
   /**
    * @brief deconstructor
@@ -15,13 +15,31 @@
 #include "Domains.hh"
 #include "TemporalNetwork.hh"
 #include "Debug.hh"
+#include "Mutex.hh"
 
 #include <boost/cast.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/ref.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <map>
+
 namespace EUROPA {
 
+namespace {
+  // Matches the batched edges to or from a timepoint.
+  class BatchEdgeOf {
+  public:
+    BatchEdgeOf(const Timepoint* node) : m_node(node) {}
+    bool operator()(const std::pair<Timepoint*, Timepoint*>& edge) const {
+      return edge.first == m_node || edge.second == m_node;
+    }
+  private:
+    const Timepoint* m_node;
+  };
+}
+
 Bool TemporalNetwork::isValidId(const Timepoint* const id){
   return (id &&
           id->owner == this && hasNode(*id));
@@ -47,10 +65,14 @@ bool TemporalNetwork::hasEdgeToOrigin(Timepoint& timepoint) {
   return edgeToTheOrigin != NULL;
 }
 
-TemporalNetwork::TemporalNetwork() : consistent(true), 
+TemporalNetwork::TemporalNetwork(bool flatAdjacency)
+                                   : DistanceGraph(flatAdjacency), consistent(true),
                                      hasDeletions(false), nodeCounter(0),
                                      incrementalSource(), m_constraints(), m_id(this),
-                                     m_refpoint(), m_updatedTimepoints() {
+                                     m_refpoint(), m_distanceCache(),
+                                     m_distanceCacheGeneration(0), m_threads(1),
+                                     m_componentsValid(true), m_batchDepth(0), m_batch(),
+                                     m_updatedTimepoints() {
 
   addTimepoint();
   fullPropagate();
@@ -202,13 +224,14 @@ Bool TemporalNetwork::isDistancePossiblyLessThan (const Timepoint& src,
 
       // More efficient test: (hasDeletions && (!consistent || hasAdditions))
       // but need to set up hasAdditions cache.  For now, just propagate...
-      bool fullyPropagated = !this->hasDeletions;
+      bool fullyPropagated = !this->hasDeletions && m_batch.empty();
 
       return !fullyPropagated;
   }
 
   Bool TemporalNetwork::propagate()
   {
+    flushBatch();
     if (updateRequired())
       fullPropagate(); // Otherwise changes have been incrementally propagated
 
@@ -252,51 +275,98 @@ Void TemporalNetwork::calcDistanceBounds(Timepoint& src, Timepoint& targ,
   }
 
   // Otherwise calculate from two single-source propagations
-  dijkstra(src,&targ);
-  ub = getDistance(targ);
-  dijkstra(targ,&src);
-  lb = - getDistance(src);
+  ub = calcDistance(src, targ);
+  lb = - calcDistance(targ, src);
 }
 
-Void TemporalNetwork::propagateBoundsFrom (Timepoint& src) {
-  for(std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it){
-    const TimepointId node = boost::dynamic_pointer_cast<Timepoint>(*it);
-    node->upperBound = POS_INFINITY;
-    node->lowerBound = NEG_INFINITY;
+void TemporalNetwork::validateDistanceCache() {
+  if (m_distanceCacheGeneration != getEdgeGeneration()) {
+    m_distanceCache.clear();
+    m_distanceCacheGeneration = getEdgeGeneration();
+  }
+}
+
+Time TemporalNetwork::calcDistance(Timepoint& src, Timepoint& targ) {
+  propagate();
+
+  check_error(this->consistent,
+              "TemporalNetwork: Calculating distance in inconsistent network",
+              TempNetErr::TempNetInconsistentError());
+
+  validateDistanceCache();
+  std::pair<DistanceCache::iterator, bool> entry =
+      m_distanceCache.insert(std::make_pair(std::make_pair(&src, &targ), Time(0)));
+  if (entry.second) {
+    dijkstra(src, &targ);
+    entry.first->second = getDistance(targ);
+  }
+  return entry.first->second;
+}
+
+Void TemporalNetwork::calcDistancesFrom(Timepoint& src, const std::vector<Timepoint*>& targs,
+                                        std::vector<Time>& distances) {
+  calcDistances(src, targs, distances, true);
+}
+
+Void TemporalNetwork::calcDistancesTo(Timepoint& targ, const std::vector<Timepoint*>& srcs,
+                                      std::vector<Time>& distances) {
+  calcDistances(targ, srcs, distances, false);
+}
+
+Void TemporalNetwork::calcDistances(Timepoint& node, const std::vector<Timepoint*>& others,
+                                    std::vector<Time>& distances, bool forward) {
+  propagate();
+
+  check_error(this->consistent,
+              "TemporalNetwork: Calculating distances in inconsistent network",
+              TempNetErr::TempNetInconsistentError());
+
+  validateDistanceCache();
+  distances.assign(others.size(), POS_INFINITY);
+
+  // Answer what we can from the cache, and note the rest
+  std::vector<unsigned int> missing;
+  for (unsigned int i = 0; i < others.size(); i++) {
+    DistanceCache::const_iterator it =
+        m_distanceCache.find(forward ? std::make_pair(&node, others[i]) : std::make_pair(others[i], &node));
+    if (it != m_distanceCache.end())
+      distances[i] = it->second;
+    else
+      missing.push_back(i);
+  }
+
+  if (missing.empty())
+    return;
+
+  if (forward)
+    dijkstra(node);
+  else
+    dijkstraBackward(node);
+
+  for (std::vector<unsigned int>::const_iterator it = missing.begin(); it != missing.end(); ++it) {
+    Timepoint* other = others[*it];
+    distances[*it] = getDistance(*other);
+    m_distanceCache.insert(std::make_pair(forward ? std::make_pair(&node, other) : std::make_pair(other, &node),
+                                          distances[*it]));
   }
-  src.upperBound = 0;
-  src.lowerBound = 0;
-  src.depth = 0;
-  BucketQueue& queue = initializeBqueue();
-  queue.insertInQueue(&src);
-  incDijkstraForward();
-  queue.insertInQueue(&src);
-  incDijkstraBackward();
 }
 
 Void TemporalNetwork::calcDistanceBounds(Timepoint& src,
                                          const std::vector<Timepoint*>& targs,
                                          std::vector<Time>& lbs,
                                          std::vector<Time>& ubs) {
-  // Method: Calculate lower/upper bounds as if src was the origin.
-  // Afterwards restore the proper bounds.  Requires only four
-  // dijkstras instead of 2*n dijkstras.
+  // Method: one forward and one backward Dijkstra sweep from src give
+  // the upper and lower bounds to every targ, less any already cached.
 
   propagate();
 
   checkError(this->consistent, "TemporalNetwork: calcDistanceBounds from inconsistent network");
 
-  propagateBoundsFrom(src);
-
-  lbs.clear();
-  ubs.clear();
-
-  for (unsigned i=0; i<targs.size(); i++) {
-    lbs.push_back(targs[i]->lowerBound);
-    ubs.push_back(targs[i]->upperBound);
-  }
+  calcDistancesFrom(src, targs, ubs);
+  calcDistancesTo(src, targs, lbs);
 
-  propagateBoundsFrom(*getOriginNode());
+  for (unsigned i=0; i<lbs.size(); i++)
+    lbs[i] = - lbs[i];
 
   return;
 }
@@ -441,9 +511,15 @@ TemporalConstraint* TemporalNetwork::addTemporalConstraint(Timepoint& src,
 
   m_constraints.insert(spec);
 
+  if (m_componentsValid)
+    joinComponents(src, targ);
+
   // As long as propagation is not turned off, we can process this constraint
   if (_propagate){
-    incPropagate(src, targ);
+    if (m_batchDepth > 0)
+      m_batch.push_back(std::make_pair(&src, &targ));
+    else
+      incPropagate(src, targ);
   }
 
   return(spec.get());
@@ -492,7 +568,11 @@ Void TemporalNetwork::narrowTemporalConstraint(TemporalConstraint& spec,
 
   checkError(spec.m_edgeCount <= 2, "Invalied edge count" <<  spec.m_edgeCount);
 
-  if(!this->hasDeletions)
+  if (this->hasDeletions)
+    return;
+  if (m_batchDepth > 0)
+    m_batch.push_back(std::make_pair(&src, &targ));
+  else
     incPropagate(src, targ);
 }
 
@@ -514,6 +594,8 @@ Void TemporalNetwork::removeTemporalConstraint(TemporalConstraint& spec,
   if (lb >= MIN_LENGTH)
     removeEdgeSpec(targ, src, -lb);
   this->hasDeletions = this->hasDeletions || markDeleted;
+  if (&src != getOriginNode() && &targ != getOriginNode())
+    m_componentsValid = false;
   m_constraints.erase(std::find_if(m_constraints.begin(), m_constraints.end(),
                                    ptr_compare<TemporalConstraint>(&spec)));
 }
@@ -541,6 +623,10 @@ Void TemporalNetwork::deleteTimepoint(Timepoint& node) {
   cleanupTEQ(node);
 
   m_updatedTimepoints.erase(&node);
+  if (!m_batch.empty())
+    m_batch.erase(std::remove_if(m_batch.begin(), m_batch.end(), BatchEdgeOf(&node)), m_batch.end());
+  // Other timepoints may refer to it in the union-find
+  m_componentsValid = false;
 
   // Note: following causes all constraints involving
   // the node to be removed before removing the node.
@@ -583,30 +669,39 @@ Void TemporalNetwork::fullPropagate() {
   debugMsg("TemporalNetwork:fullPropagate", "fullPropagate started");
   m_updatedTimepoints.clear();
   this->incrementalSource = NULL;   // Not applicable to a full prop.
-  setConsistency(bellmanFord());
+
+  std::vector<std::vector<Timepoint*> > components;
+  if (m_threads > 1)
+    getComponents(components);
+  if (components.size() > 1)
+    setConsistency(propagateComponents(components));  // Which also sets the bounds
+  else
+    setConsistency(bellmanFord());
   this->hasDeletions = false;
   if (this->consistent == false)
     return;
 
-  // We also need to do specialized Dijkstras in the forward
-  // and backward directions to update the lower/upper bounds.
-  // Note: these could be done lazily on request for bounds.
-  for(std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it){
-    TimepointId node = boost::dynamic_pointer_cast<Timepoint>(*it);
-    node->upperBound = POS_INFINITY;
-    node->lowerBound = NEG_INFINITY;
-  }
+  if (components.size() <= 1) {
+    // We also need to do specialized Dijkstras in the forward
+    // and backward directions to update the lower/upper bounds.
+    // Note: these could be done lazily on request for bounds.
+    for(std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it){
+      TimepointId node = boost::dynamic_pointer_cast<Timepoint>(*it);
+      node->upperBound = POS_INFINITY;
+      node->lowerBound = NEG_INFINITY;
+    }
 
-  Timepoint* origin = getOriginNode();
-  origin->upperBound = 0;
-  origin->lowerBound = 0;
-  origin->depth = 0;
+    Timepoint* origin = getOriginNode();
+    origin->upperBound = 0;
+    origin->lowerBound = 0;
+    origin->depth = 0;
 
-  BucketQueue& queue = initializeBqueue();
-  queue.insertInQueue(origin);
-  incDijkstraForward();
-  queue.insertInQueue(origin);
-  incDijkstraBackward();
+    BucketQueue& queue = initializeBqueue();
+    queue.insertInQueue(origin);
+    incDijkstraForward();
+    queue.insertInQueue(origin);
+    incDijkstraBackward();
+  }
 
   // PHM 6/29/2010 Changes to support reftime calculations
   if (m_refpoint) {
@@ -623,6 +718,7 @@ Void TemporalNetwork::fullPropagate() {
     }
     m_refpoint->reftime = 0;
     m_refpoint->depth = 0;
+    BucketQueue& queue = initializeBqueue();
     queue.insertInQueue(m_refpoint);
 
     if (m_refpoint->inCount == 0)
@@ -634,7 +730,30 @@ Void TemporalNetwork::fullPropagate() {
   debugMsg("TemporalNetwork:fullPropagate", "fullPropagate done");
 }
 
+void TemporalNetwork::beginBatch() {
+  m_batchDepth++;
+}
+
+void TemporalNetwork::commitBatch() {
+  check_error(m_batchDepth > 0, "commitBatch without beginBatch");
+  if (--m_batchDepth == 0)
+    flushBatch();
+}
+
+Void TemporalNetwork::flushBatch() {
+  if (m_batch.empty())
+    return;
+  std::vector<std::pair<Timepoint*, Timepoint*> > batch;
+  batch.swap(m_batch);
+  incPropagate(batch);
+}
+
 Void TemporalNetwork::incPropagate(Timepoint& src, Timepoint& targ)
+{
+  incPropagate(std::vector<std::pair<Timepoint*, Timepoint*> >(1, std::make_pair(&src, &targ)));
+}
+
+Void TemporalNetwork::incPropagate(const std::vector<std::pair<Timepoint*, Timepoint*> >& edges)
 {
 
   // Do nothing if network inconsistent or there are deletions.
@@ -642,22 +761,40 @@ Void TemporalNetwork::incPropagate(Timepoint& src, Timepoint& targ)
   if (this->hasDeletions || this->consistent == false)
     return;
 
-  check_error(isValidId(src));
-  check_error(isValidId(targ));
-
+  typedef std::vector<std::pair<Timepoint*, Timepoint*> >::const_iterator EdgeIterator;
   BucketQueue& queue = initializeBqueue();
   Timepoint* next;
-
-  next = dynamic_cast<Timepoint*>(startNode(src, src.potential,
-                                            targ, targ.potential));
-  if (next != NULL) {
-    Timepoint& start = (&src == next) ? targ : src;
-    incrementalSource = &start;  // Used in specialized cycle detection
-    next->predecessor = findEdge(start, *next);  // Used to trace nogood
-    handleNodeUpdate(*next);
-    queue.insertInQueue(next);
-    setConsistency(incBellmanFord());
+  bool started = false;
+
+  // Propagation from a single edge has a cycle if it gets back to its start.
+  // From several, cycles are left to the Bellman-Ford bound.
+  this->incrementalSource = NULL;
+  for (EdgeIterator it = edges.begin(); it != edges.end(); ++it) {
+    Timepoint& src = *it->first;
+    Timepoint& targ = *it->second;
+    check_error(isValidId(src));
+    check_error(isValidId(targ));
+
+    Time srcPotential = src.potential;
+    Time targPotential = targ.potential;
+    next = dynamic_cast<Timepoint*>(startNode(src, src.potential,
+                                              targ, targ.potential));
+    if (next != NULL) {
+      // startNode() assigned the potential directly
+      setPotential(*next, next->potential);
+      Time oldPotential = (&src == next) ? srcPotential : targPotential;
+      Timepoint& start = (&src == next) ? targ : src;
+      if (edges.size() == 1)
+        incrementalSource = &start;  // Used in specialized cycle detection
+      next->predecessor = findEdge(start, *next);  // Used to trace nogood
+      handleNodeUpdate(*next);
+      // As in incBellmanFord(), give priority to the stronger propagations
+      queue.insertInQueue(next, next->potential - oldPotential);
+      started = true;
+    }
   }
+  if (started)
+    setConsistency(incBellmanFord());
 
   // Can't do Dijkstra if network is now inconsistent.
   if (this->consistent == false)
@@ -668,59 +805,85 @@ Void TemporalNetwork::incPropagate(Timepoint& src, Timepoint& targ)
 
   BucketQueue& queue1 = initializeBqueue();
 
-  next = dynamic_cast<Timepoint*>(startNode(src, src.upperBound,
-                                            targ, targ.upperBound));
-  if (next != NULL) {
-    queue1.insertInQueue(next);
-    handleNodeUpdate(*next);
-    incDijkstraForward();
+  started = false;
+  for (EdgeIterator it = edges.begin(); it != edges.end(); ++it) {
+    Timepoint& src = *it->first;
+    Timepoint& targ = *it->second;
+    next = dynamic_cast<Timepoint*>(startNode(src, src.upperBound,
+                                              targ, targ.upperBound));
+    if (next != NULL) {
+      // The keys of incDijkstraForward()
+      queue1.insertInQueue(next, next->upperBound - next->potential);
+      handleNodeUpdate(*next);
+      started = true;
+    }
   }
+  if (started)
+    incDijkstraForward();
 
   // For lower-bound propagation we need to do some finagling (Irish
   // word) to get the right effect from startNode().
 
-  // Can't pass a negative as a reference value, so use locals
-  Time headDistance = -(src.lowerBound);
-  Time footDistance = -(targ.lowerBound);
+  started = false;
+  for (EdgeIterator it = edges.begin(); it != edges.end(); ++it) {
+    Timepoint& src = *it->first;
+    Timepoint& targ = *it->second;
 
-  // Backwards propagation, so call with "forward" flag false.
-  next = dynamic_cast<Timepoint*>(startNode(src, headDistance,
-                                            targ, footDistance, false));
-  if (next != NULL) {
+    // Can't pass a negative as a reference value, so use locals
+    Time headDistance = -(src.lowerBound);
+    Time footDistance = -(targ.lowerBound);
 
-    // Store propagated locals back to proper locations
-    src.lowerBound = -(headDistance);
-    targ.lowerBound = -(footDistance);
+    // Backwards propagation, so call with "forward" flag false.
+    next = dynamic_cast<Timepoint*>(startNode(src, headDistance,
+                                              targ, footDistance, false));
+    if (next != NULL) {
 
-    queue1.insertInQueue(next);
-    handleNodeUpdate(*next);
-    incDijkstraBackward();
+      // Store propagated locals back to proper locations
+      src.lowerBound = -(headDistance);
+      targ.lowerBound = -(footDistance);
+
+      // The keys of incDijkstraBackward()
+      queue1.insertInQueue(next, -(next->lowerBound) + next->potential);
+      handleNodeUpdate(*next);
+      started = true;
+    }
   }
+  if (started)
+    incDijkstraBackward();
 
   // PHM Support for reftime calculations
   // Adjust to either case of all lb or all ub constraints.
   if (m_refpoint) {
-    if (m_refpoint->inCount == 0) { // all ub constraints
-      next = dynamic_cast<Timepoint*>(startNode(src, src.reftime,
-                                                targ, targ.reftime));
+    started = false;
+    for (EdgeIterator it = edges.begin(); it != edges.end(); ++it) {
+      Timepoint& src = *it->first;
+      Timepoint& targ = *it->second;
+      if (m_refpoint->inCount == 0) { // all ub constraints
+        next = dynamic_cast<Timepoint*>(startNode(src, src.reftime,
+                                                  targ, targ.reftime));
+      }
+      else { // all lb constraints
+        Time headDistance = -(src.reftime);
+        Time footDistance = -(targ.reftime);
+        next = dynamic_cast<Timepoint*>(startNode(src, headDistance,
+                                                  targ, footDistance, false));
+        if (next != NULL) {
+          src.reftime = -(headDistance);
+          targ.reftime = -(footDistance);
+        }
+      }
       if (next != NULL) {
-        queue1.insertInQueue(next);
+        queue1.insertInQueue(next, (m_refpoint->inCount == 0) ? next->reftime - next->potential :
+                             -(next->reftime) + next->potential);
         handleNodeUpdate(*next);
-        incDijkstraReftime();
+        started = true;
       }
     }
-    else { // all lb constraints
-      headDistance = -(src.reftime);
-      footDistance = -(targ.reftime);
-      next = dynamic_cast<Timepoint*>(startNode(src, headDistance,
-                                                targ, footDistance, false));
-      if (next != NULL) {
-        src.reftime = -(headDistance);
-        targ.reftime = -(footDistance);
-        queue1.insertInQueue(next);
-        handleNodeUpdate(*next);
+    if (started) {
+      if (m_refpoint->inCount == 0)
+        incDijkstraReftime();
+      else
         incDijkstraRefBack(); // Backwards propagation
-      }
     }
   }
 }
@@ -829,6 +992,277 @@ Void TemporalNetwork::incDijkstraBackward() {
   }
 }
 
+struct TemporalNetwork::ComponentResult {
+  std::vector<Time> potentials;       // By position in the component, with the origin at 0.
+  std::vector<Dedge*> predecessors;
+  std::vector<Time> upperBounds;
+  std::vector<Time> lowerBounds;
+  Int failed;                         // Position of a node on a negative cycle, or -1.
+};
+
+struct TemporalNetwork::ComponentWork {
+  Timepoint* origin;
+  const std::vector<std::vector<Timepoint*> >* components;
+  std::vector<unsigned long> order;   // Largest components first, to balance the threads.
+  std::vector<ComponentResult> results;
+  unsigned long next;
+  pthread_mutex_t mutex;
+};
+
+namespace {
+  class ComponentSizeComparator {
+  public:
+    ComponentSizeComparator(const std::vector<std::vector<Timepoint*> >& components)
+      : m_components(components) {}
+    bool operator()(unsigned long a, unsigned long b) const {
+      return m_components[a].size() > m_components[b].size();
+    }
+  private:
+    const std::vector<std::vector<Timepoint*> >& m_components;
+  };
+}
+
+void TemporalNetwork::setThreads(unsigned int threads) {
+  check_error(threads > 0, "TemporalNetwork needs at least one thread");
+  m_threads = threads;
+}
+
+Timepoint* TemporalNetwork::findComponent(Timepoint& node) {
+  Timepoint* root = &node;
+  while (root->componentParent != root) {
+    // Path halving
+    root->componentParent = root->componentParent->componentParent;
+    root = root->componentParent;
+  }
+  return root;
+}
+
+Void TemporalNetwork::joinComponents(Timepoint& src, Timepoint& targ) {
+  Timepoint* origin = getOriginNode();
+  if (&src == origin || &targ == origin)
+    return;
+  Timepoint* a = findComponent(src);
+  Timepoint* b = findComponent(targ);
+  if (a == b)
+    return;
+  if (a->componentSize < b->componentSize)
+    std::swap(a, b);
+  b->componentParent = a;
+  a->componentSize += b->componentSize;
+}
+
+Void TemporalNetwork::getComponents(std::vector<std::vector<Timepoint*> >& components) {
+  Timepoint* origin = getOriginNode();
+  if (!m_componentsValid) {
+    for (std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+      Timepoint* node = static_cast<Timepoint*>(it->get());
+      node->componentParent = node;
+      node->componentSize = 1;
+    }
+    for (std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+      Timepoint* node = static_cast<Timepoint*>(it->get());
+      for (Int i = 0; i < node->outCount; i++)
+        joinComponents(*node, static_cast<Timepoint&>(node->outArray[i]->to));
+    }
+    m_componentsValid = true;
+  }
+
+  std::map<Timepoint*, unsigned long> componentOf;
+  for (std::vector<DnodeId>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+    Timepoint* node = static_cast<Timepoint*>(it->get());
+    if (node == origin)
+      continue;
+    std::pair<std::map<Timepoint*, unsigned long>::iterator, bool> entry =
+        componentOf.insert(std::make_pair(findComponent(*node), components.size()));
+    if (entry.second)
+      components.push_back(std::vector<Timepoint*>());
+    components[entry.first->second].push_back(node);
+  }
+}
+
+Bool TemporalNetwork::propagateComponents(const std::vector<std::vector<Timepoint*> >& components) {
+  Timepoint* origin = getOriginNode();
+  origin->componentIndex = 0;
+  for (unsigned long c = 0; c < components.size(); c++)
+    for (unsigned long i = 0; i < components[c].size(); i++)
+      components[c][i]->componentIndex = static_cast<Int>(i + 1);
+
+  ComponentWork work;
+  work.origin = origin;
+  work.components = &components;
+  for (unsigned long c = 0; c < components.size(); c++)
+    work.order.push_back(c);
+  std::sort(work.order.begin(), work.order.end(), ComponentSizeComparator(components));
+  work.results.resize(components.size());
+  work.next = 0;
+  pthread_mutex_init(&work.mutex, NULL);
+
+  // This thread takes its share of the components too
+  std::vector<pthread_t> threads;
+  for (unsigned long i = 1; i < std::min<unsigned long>(m_threads, components.size()); i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, propagateComponentsThread, &work) != 0)
+      break;
+    threads.push_back(thread);
+  }
+  propagateComponentsThread(&work);
+  for (std::vector<pthread_t>::const_iterator it = threads.begin(); it != threads.end(); ++it)
+    pthread_join(*it, NULL);
+  pthread_mutex_destroy(&work.mutex);
+
+  for (unsigned long c = 0; c < components.size(); c++) {
+    const ComponentResult& result = work.results[c];
+    if (result.failed < 0)
+      continue;
+    // Restore the predecessors, which lead round the negative cycle
+    origin->predecessor = result.predecessors[0];
+    for (unsigned long i = 0; i < components[c].size(); i++)
+      components[c][i]->predecessor = result.predecessors[i + 1];
+    updateNogoodList(result.failed == 0 ? *origin : *components[c][result.failed - 1]);
+    return false;
+  }
+
+  // Each component's potentials are a solution for the component and the origin, and remain
+  // one when shifted, so shift them to agree on the least potential found for the origin.
+  Time originPotential = 0;
+  for (unsigned long c = 0; c < components.size(); c++)
+    originPotential = std::min(originPotential, work.results[c].potentials[0]);
+  setPotential(*origin, originPotential);
+  origin->upperBound = 0;
+  origin->lowerBound = 0;
+  origin->depth = 0;
+  for (unsigned long c = 0; c < components.size(); c++) {
+    const ComponentResult& result = work.results[c];
+    Time shift = originPotential - result.potentials[0];
+    for (unsigned long i = 0; i < components[c].size(); i++) {
+      Timepoint& node = *components[c][i];
+      setPotential(node, result.potentials[i + 1] + shift);
+      node.upperBound = result.upperBounds[i + 1];
+      node.lowerBound = result.lowerBounds[i + 1];
+      if (result.potentials[i + 1] < 0 || node.upperBound != POS_INFINITY ||
+          node.lowerBound != NEG_INFINITY)
+        handleNodeUpdate(node);
+    }
+  }
+  return true;
+}
+
+void* TemporalNetwork::propagateComponentsThread(void* arg) {
+  ComponentWork& work = *static_cast<ComponentWork*>(arg);
+  while (true) {
+    unsigned long next;
+    {
+      MutexGrabber grabber(work.mutex);
+      next = work.next++;
+    }
+    if (next >= work.order.size())
+      return NULL;
+    unsigned long c = work.order[next];
+    propagateComponent(*work.origin, (*work.components)[c], work.results[c]);
+  }
+}
+
+// Runs on the propagation threads, so it only reads the graph, and writes the result.
+Void TemporalNetwork::propagateComponent(Timepoint& origin, const std::vector<Timepoint*>& component,
+                                         ComponentResult& result) {
+  Int count = static_cast<Int>(component.size()) + 1;
+  // The origin's edges to and from the component
+  std::vector<Dedge*> originOut, originIn;
+  for (unsigned long i = 0; i < component.size(); i++) {
+    const Timepoint& node = *component[i];
+    for (Int j = 0; j < node.inCount; j++)
+      if (&node.inArray[j]->from == &origin)
+        originOut.push_back(node.inArray[j]);
+    for (Int j = 0; j < node.outCount; j++)
+      if (&node.outArray[j]->to == &origin)
+        originIn.push_back(node.outArray[j]);
+  }
+
+  // Bellman-Ford, as DistanceGraph::bellmanFord(), from potentials of 0 and with the change in
+  // potential as the priority.
+  std::vector<Time>& potentials = result.potentials;
+  std::vector<Time> oldPotentials(count);
+  std::vector<Int> depths(count, 0);
+  potentials.assign(count, 0);
+  result.predecessors.assign(count, NULL);
+  result.failed = -1;
+  std::vector<std::pair<Time, Int> > queue;
+  for (Int i = 0; i < count; i++) {
+    oldPotentials[i] = (i == 0 ? origin.potential : component[i - 1]->potential);
+    queue.push_back(std::make_pair(-oldPotentials[i], i));
+  }
+  std::make_heap(queue.begin(), queue.end(), std::greater<std::pair<Time, Int> >());
+  while (!queue.empty()) {
+    std::pop_heap(queue.begin(), queue.end(), std::greater<std::pair<Time, Int> >());
+    Time key = queue.back().first;
+    Int i = queue.back().second;
+    queue.pop_back();
+    if (key != potentials[i] - oldPotentials[i])
+      continue;  // Superseded
+    const Timepoint& node = (i == 0 ? origin : *component[i - 1]);
+    const std::vector<Dedge*>& edges = (i == 0 ? originOut : node.outArray);
+    Int edgeCount = (i == 0 ? static_cast<Int>(originOut.size()) : node.outCount);
+    for (Int j = 0; j < edgeCount; j++) {
+      Dedge* edge = edges[j];
+      Int next = static_cast<const Timepoint&>(edge->to).componentIndex;
+      Time potential = potentials[i] + edge->length;
+      if (potential < potentials[next]) {
+        potentials[next] = potential;
+        result.predecessors[next] = edge;
+        if ((depths[next] = depths[i] + 1) > count) {
+          result.failed = next;
+          return;
+        }
+        queue.push_back(std::make_pair(potential - oldPotentials[next], next));
+        std::push_heap(queue.begin(), queue.end(), std::greater<std::pair<Time, Int> >());
+      }
+    }
+  }
+
+  std::vector<Time> distances;
+  componentDijkstra(origin, component, originOut, true, potentials, distances);
+  result.upperBounds.swap(distances);
+  componentDijkstra(origin, component, originIn, false, potentials, distances);
+  result.lowerBounds.resize(count);
+  for (Int i = 0; i < count; i++)
+    result.lowerBounds[i] = -distances[i];
+}
+
+// Distances from the origin to the component if forward, else from the component to the origin.
+Void TemporalNetwork::componentDijkstra(Timepoint& origin, const std::vector<Timepoint*>& component,
+                                        const std::vector<Dedge*>& originEdges, bool forward,
+                                        const std::vector<Time>& potentials,
+                                        std::vector<Time>& distances) {
+  Int count = static_cast<Int>(potentials.size());
+  distances.assign(count, POS_INFINITY);
+  distances[0] = 0;
+  std::vector<std::pair<Time, Int> > queue(1, std::make_pair(forward ? -potentials[0] : potentials[0], 0));
+  while (!queue.empty()) {
+    std::pop_heap(queue.begin(), queue.end(), std::greater<std::pair<Time, Int> >());
+    Time key = queue.back().first;
+    Int i = queue.back().second;
+    queue.pop_back();
+    // Appropriate priority key as derived from Johnson's algorithm
+    if (key != (forward ? distances[i] - potentials[i] : distances[i] + potentials[i]))
+      continue;  // Superseded
+    const Timepoint& node = (i == 0 ? origin : *component[i - 1]);
+    const std::vector<Dedge*>& edges = (i == 0 ? originEdges : forward ? node.outArray : node.inArray);
+    Int edgeCount = (i == 0 ? static_cast<Int>(originEdges.size()) :
+                     forward ? node.outCount : node.inCount);
+    for (Int j = 0; j < edgeCount; j++) {
+      Dedge* edge = edges[j];
+      Int next = static_cast<const Timepoint&>(forward ? edge->to : edge->from).componentIndex;
+      Time distance = distances[i] + edge->length;
+      if (distance < distances[next]) {
+        distances[next] = distance;
+        queue.push_back(std::make_pair(forward ? distance - potentials[next] : distance + potentials[next],
+                                       next));
+        std::push_heap(queue.begin(), queue.end(), std::greater<std::pair<Time, Int> >());
+      }
+    }
+  }
+}
+
   Void TemporalNetwork::incDijkstraReftime()
   {
     // PHM New function to support reftime calculations
@@ -1030,7 +1464,8 @@ void TemporalNetwork::handleNodeUpdate(const Dnode& node) {
 
 Tnode::Tnode(TemporalNetwork* t) :
     Dnode(), lowerBound(NEG_INFINITY), upperBound(POS_INFINITY), reftime(0),
-    prev_reftime(0), ordinal(0), m_baseDomainConstraint(), m_deletionMarker(true),
+    prev_reftime(0), ordinal(0), componentParent(this), componentSize(1), componentIndex(0),
+    m_baseDomainConstraint(), m_deletionMarker(true),
     index(0), ringLeader(), ringFollowers(), owner(t) {}
 
   Tnode::~Tnode(){
@@ -17,6 +17,7 @@
 #include "DistanceGraph.hh"
 #include "Error.hh"
 #include <list>
+#include <map>
 
 namespace EUROPA {
 
@@ -171,6 +172,35 @@ namespace EUROPA {
                             const std::vector<Timepoint*>& targs,
                             std::vector<Time>& lbs, std::vector<Time>& ubs);
 
+    /**
+     * @brief Calculate the exact length of the shortest path from one timepoint to another.
+     * Results are cached by pair of timepoints until an edge of the network changes.
+     * @param src the start node in the network.
+     * @param targ the end node in the network.
+     * @return The distance, or POS_INFINITY if there is no path.
+     */
+    Time calcDistance(Timepoint& src, Timepoint& targ);
+
+    /**
+     * @brief Calculate the exact distances from one timepoint to many. Any not already cached are
+     * found by a single Dijkstra sweep from src, and cached.
+     * @param src the start node in the network.
+     * @param targs the end nodes in the network.
+     * @param distances returns the distance to each of targs, or POS_INFINITY if there is no path.
+     */
+    Void calcDistancesFrom(Timepoint& src, const std::vector<Timepoint*>& targs,
+                           std::vector<Time>& distances);
+
+    /**
+     * @brief Calculate the exact distances to one timepoint from many, as for calcDistancesFrom(),
+     * with a single backward sweep from targ.
+     * @param targ the end node in the network.
+     * @param srcs the start nodes in the network.
+     * @param distances returns the distance from each of srcs, or POS_INFINITY if there is no path.
+     */
+    Void calcDistancesTo(Timepoint& targ, const std::vector<Timepoint*>& srcs,
+                         std::vector<Time>& distances);
+
      /**
      * @brief Similar to many-targ version of calcDistanceBounds
      * but only the signs of the "bounds" (that indicate precedences)
@@ -341,8 +371,10 @@ namespace EUROPA {
 
     /**
      * @brief Constructor creates and empty STN
+     * @param flatAdjacency If true, propagate over the flat adjacency layout.
+     * @see DistanceGraph
      */
-    TemporalNetwork();
+    TemporalNetwork(bool flatAdjacency = false);
 
     /**
      * @brief Destructor
@@ -356,8 +388,33 @@ namespace EUROPA {
      */
     void setReferenceTimepoint (Timepoint* refpoint = NULL);
     Timepoint* getReferenceTimepoint () { return m_refpoint; }
+
+    /**
+     * @brief Set the number of threads used by full propagation. With more than
+     * one, each connected component of the network, ignoring the edges to and
+     * from the origin, is propagated separately on its own thread. Default is 1.
+     */
+    void setThreads(unsigned int threads);
+    unsigned int getThreads() const { return m_threads; }
+
+    /**
+     * @brief Start a batch of additions. Until the matching commitBatch(), added
+     * and narrowed constraints are not propagated one at a time, but together,
+     * by a single incremental propagation from all of them. Batches nest, and
+     * propagate() also propagates the batch so far.
+     */
+    void beginBatch();
+
+    /**
+     * @brief End a batch, propagating it if it is the outermost.
+     */
+    void commitBatch();
+
+    bool isBatching() const { return m_batchDepth > 0; }
  
   private:
+    struct ComponentResult;
+    struct ComponentWork;
     /**
      * @brief Get the origin of the STN
      * @return  origin timepointId in the STN
@@ -376,6 +433,46 @@ namespace EUROPA {
      */
     Void incPropagate(Timepoint& src, Timepoint& targ);
 
+    /**
+     * @brief propagate the edges between several pairs of points together
+     */
+    Void incPropagate(const std::vector<std::pair<Timepoint*, Timepoint*> >& edges);
+
+    /**
+     * @brief propagate the constraints batched so far
+     */
+    Void flushBatch();
+
+    /**
+     * @brief Get the connected components of the network, ignoring the edges to
+     * and from the origin, each with its timepoints in the order of the graph.
+     */
+    Void getComponents(std::vector<std::vector<Timepoint*> >& components);
+
+    /**
+     * @brief Union-find over the components, kept up to date as constraints are
+     * added. Removals may split a component, so they leave it to be rebuilt
+     * by the next getComponents().
+     */
+    Timepoint* findComponent(Timepoint& node);
+    Void joinComponents(Timepoint& src, Timepoint& targ);
+
+    /**
+     * @brief Bellman-Ford and bound propagation of each component, together
+     * with the origin, on up to m_threads threads. The potentials of each
+     * component are shifted to agree on the origin and, with the bounds,
+     * written back to the timepoints.
+     * @return false iff some component has a negative cycle.
+     */
+    Bool propagateComponents(const std::vector<std::vector<Timepoint*> >& components);
+    static void* propagateComponentsThread(void* work);
+    static Void propagateComponent(Timepoint& origin, const std::vector<Timepoint*>& component,
+                                   ComponentResult& result);
+    static Void componentDijkstra(Timepoint& origin, const std::vector<Timepoint*>& component,
+                                  const std::vector<Dedge*>& originEdges, bool forward,
+                                  const std::vector<Time>& potentials,
+                                  std::vector<Time>& distances);
+
     /**
      * @brief For incremental propagation, determines whether a propagation
      *        should be tried from head to foot or vice versa, and does first propagation
@@ -415,12 +512,6 @@ namespace EUROPA {
     Void incDijkstraReftime();
     Void incDijkstraRefBack();
 
-    /**
-     * @brief Propagates lower/upper distance bounds from src
-     * using backward and forward Dijkstra propagations.
-     */
-    Void propagateBoundsFrom (Timepoint& src);
-
     Void maintainTEQ (Time lb, Time ub, Timepoint& src, Timepoint& targ);
 
     Void cleanupTEQ(Timepoint& tpt);
@@ -443,6 +534,17 @@ namespace EUROPA {
      */
     void setConsistency(bool c);
 
+    /**
+     * @brief Discard the cached distances if an edge has changed since they were calculated.
+     */
+    void validateDistanceCache();
+
+    /**
+     * @brief Look up and calculate distances for calcDistancesFrom() and calcDistancesTo().
+     */
+    Void calcDistances(Timepoint& node, const std::vector<Timepoint*>& others,
+                       std::vector<Time>& distances, bool forward);
+
     /**
      * @brief set of constraints in the temporal network
      */
@@ -461,6 +563,21 @@ namespace EUROPA {
      */
     Timepoint* m_refpoint;
 
+    typedef std::map<std::pair<const Timepoint*, const Timepoint*>, Time> DistanceCache;
+
+    /**
+     * @brief Exact distances calculated since the edge generation m_distanceCacheGeneration, keyed by
+     * (from, to).
+     */
+    DistanceCache m_distanceCache;
+    unsigned long m_distanceCacheGeneration;
+
+    unsigned int m_threads;
+    bool m_componentsValid; // False once a removal may have split a component.
+
+    unsigned int m_batchDepth;
+    std::vector<std::pair<Timepoint*, Timepoint*> > m_batch; // (source, target) of batched constraints
+
    protected:                          // Overridden virtual functions
 
    /**
@@ -503,6 +620,9 @@ private:
     Time prev_reftime;
   private:
     Int ordinal;
+    Timepoint* componentParent; // Union-find over the components, ignoring the origin.
+    Int componentSize;
+    Int componentIndex;         // Position in the component during propagateComponents().
     TemporalConstraint* m_baseDomainConstraint; /*!< Constraint used to enforce timepoint bounds input.*/
     bool m_deletionMarker;
     void handleDiscard();
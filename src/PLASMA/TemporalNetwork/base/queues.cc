@@ -26,8 +26,12 @@ Notes:
 **************************************************************************/
 
 #include "DistanceGraph.hh"
+#include "Error.hh"
 //#include "Debug.hh"
 
+#include <algorithm>
+#include <limits>
+
 namespace EUROPA {
 
 /* Dqueue functions */
@@ -73,21 +77,116 @@ Bool Dqueue::isEmpty()
 /* BucketQueue functions */
 
 
-BucketQueue::BucketQueue (int) : buckets() {
+namespace {
+  // Map a key to an unsigned value with the same ordering.
+  inline unsigned long radixKey(Time key) {
+    return static_cast<unsigned long>(key) ^ (1UL << (std::numeric_limits<unsigned long>::digits - 1));
+  }
+
+  // The radix bucket for a key, given the last key popped.
+  inline int radixBucket(unsigned long key, unsigned long last) {
+    unsigned long diff = key ^ last;
+#ifdef __GNUC__
+    return (diff == 0) ? 0 : std::numeric_limits<unsigned long>::digits - __builtin_clzl(diff);
+#else
+    int bucket = 0;
+    while (diff != 0) {
+      diff >>= 1;
+      bucket++;
+    }
+    return bucket;
+#endif
+  }
+}
+
+BucketQueue::BucketQueue (int, QueueImplementation impl)
+  : buckets(), implementation(impl), radixActive(impl == RADIX_HEAP_QUEUE),
+    radix(RADIX_BUCKETS), radixLast(0), radixSize(0) {
 }
 
 BucketQueue::~BucketQueue ()
 {
 }
 
+void BucketQueue::setImplementation(QueueImplementation impl)
+{
+  check_error(buckets.empty() && radixSize == 0,
+              "Cannot change the implementation of a queue in use");
+  implementation = impl;
+  radixActive = (impl == RADIX_HEAP_QUEUE);
+}
+
 void BucketQueue::reset()
 {
+  if (radixSize > 0) {
+    // Keep the buckets' storage for the next search
+    for (int i = 0; i < RADIX_BUCKETS; i++)
+      radix[i].clear();
+    radixSize = 0;
+  }
+  radixLast = 0;
+  radixActive = (implementation == RADIX_HEAP_QUEUE);
   buckets = DnodePriorityQueue();
   Dnode::unmarkAll();
 }
 
+void BucketQueue::insertInRadix(const Bucket& bucket)
+{
+  unsigned long key = radixKey(bucket.key);
+  if (key < radixLast) {
+    spillRadix();
+    buckets.push(Bucket(bucket.node, -bucket.key));
+    return;
+  }
+  radix[radixBucket(key, radixLast)].push_back(bucket);
+  radixSize++;
+}
+
+void BucketQueue::spillRadix()
+{
+  for (int i = 0; i < RADIX_BUCKETS; i++) {
+    for (unsigned long j = 0; j < radix[i].size(); j++)
+      buckets.push(Bucket(radix[i][j].node, -radix[i][j].key));
+    radix[i].clear();
+  }
+  radixSize = 0;
+  radixActive = false;
+}
+
+Dnode* BucketQueue::popMinFromRadix()
+{
+  while (radixSize > 0) {
+    if (radix[0].empty()) {
+      // Make the least key in the first non-empty bucket the last key,
+      // which spreads that bucket's entries over the buckets below it.
+      int i = 1;
+      while (radix[i].empty())
+        i++;
+      std::vector<Bucket>& entries = radix[i];
+      unsigned long least = radixKey(entries[0].key);
+      for (unsigned long j = 1; j < entries.size(); j++)
+        least = std::min(least, radixKey(entries[j].key));
+      radixLast = least;
+      for (unsigned long j = 0; j < entries.size(); j++)
+        radix[radixBucket(radixKey(entries[j].key), radixLast)].push_back(entries[j]);
+      entries.clear();
+    }
+    Dnode* node = const_cast<Dnode*>(radix[0].back().node);
+    radix[0].pop_back();
+    radixSize--;
+    if (node->isMarked()) {
+      node->unmark();
+      return node;
+    }
+  }
+  return NULL;
+}
+
 Dnode* BucketQueue::popMinFromQueue()
 {
+  if (radixActive)
+    return popMinFromRadix();
+
   Dnode* node = NULL;
 	
   while (!buckets.empty()){
@@ -114,6 +213,10 @@ void BucketQueue::insertInQueue(Dnode* node, eint::basis_type key)
 
 	node->setKey(-key); // Reverse since we want effective lowest priority first
 	node->mark();
+	if (radixActive) {
+	  insertInRadix(Bucket(node, key));
+	  return;
+	}
 	Bucket b(node,-key);
 	this->buckets.push(b);
 
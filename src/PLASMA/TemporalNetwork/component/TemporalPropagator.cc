@@ -38,11 +38,17 @@ namespace EUROPA {
 #endif
 
 TemporalPropagator::TemporalPropagator(const std::string& name, 
-                                       const ConstraintEngineId constraintEngine)
-    : Propagator(name, constraintEngine), m_tnet((new TemporalNetwork())->getId()),
+                                       const ConstraintEngineId constraintEngine,
+                                       bool flatAdjacency,
+                                       QueueImplementation queue,
+                                       unsigned int threads)
+    : Propagator(name, constraintEngine), m_tnet((new TemporalNetwork(flatAdjacency))->getId()),
       m_activeVariables(), m_changedVariables(), m_changedConstraints(),
       m_constraintsForDeletion(), m_variablesForDeletion(),
-      m_listeners(), m_mostRecentRepropagation(1){}
+      m_listeners(), m_mostRecentRepropagation(1) {
+  m_tnet->setQueueImplementation(queue);
+  m_tnet->setThreads(threads);
+}
 
   TemporalPropagator::~TemporalPropagator() {
     handleDiscard();
@@ -557,6 +563,9 @@ void TemporalPropagator::processConstraintChanges() {
       if(!m_constraintsForDeletion.empty() || !m_variablesForDeletion.empty())
           m_mostRecentRepropagation = getConstraintEngine()->mostRecentRepropagation();
 
+      // Propagate the additions together rather than one at a time
+      m_tnet->beginBatch();
+
       // Process constraints for deletion
       processConstraintDeletions();
 
@@ -568,6 +577,8 @@ void TemporalPropagator::processConstraintChanges() {
 
       // Process constraints that have changed, or been added
       processConstraintChanges();
+
+      m_tnet->commitBatch();
   }
 
 
@@ -695,7 +706,8 @@ void TemporalPropagator::updateCnet() {
       return false;
     }
 
-    bool result=m_tnet->isDistanceLessThan(*fir,*sec,0);
+    // Exact and cached, since ordering choices ask about the same pairs repeatedly
+    bool result = m_tnet->calcDistance(*fir,*sec) < 0;
     condDebugMsg(result, "TemporalPropagator:canPrecede", " calculated distance between first and second < 0");
     condDebugMsg(!result, "TemporalPropagator:canPrecede", " calculated distance between first and second >= 0");
     return !result;
@@ -726,14 +738,15 @@ void TemporalPropagator::updateCnet() {
 
     Time minDuration = elb-sub;
 
-    if (m_tnet->isDistanceLessThan(*pend,*sstart,minDuration))
+    Time slot = m_tnet->calcDistance(*pend,*sstart);
+    if (slot < minDuration)
       return false;
 
     m_tnet->getTimepointBounds(*tstart, slb, sub);
     m_tnet->getTimepointBounds(*tend, elb, eub);
     minDuration = elb-sub;
 
-    return (!m_tnet->isDistanceLessThan(*pend,*sstart,minDuration));
+    return !(slot < minDuration);
   }
 
   bool TemporalPropagator::canBeConcurrent(const ConstrainedVariableId first, const ConstrainedVariableId second) {
@@ -990,6 +1003,14 @@ TemporalConstraint* TemporalPropagator::updateConstraint(const ConstrainedVariab
       m_changedVariables.insert(std::make_pair(var->getKey(),var));
   }
 
+  void TemporalPropagator::beginBatch() {
+    m_tnet->beginBatch();
+  }
+
+  void TemporalPropagator::commitBatch() {
+    m_tnet->commitBatch();
+  }
+
   void TemporalPropagator::addListener(const TemporalNetworkListenerId listener) {
     m_listeners.insert(listener);
   }
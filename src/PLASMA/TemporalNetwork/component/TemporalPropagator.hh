@@ -20,7 +20,15 @@ namespace EUROPA {
   class TemporalPropagator: public Propagator
   {
   public:
-    TemporalPropagator(const std::string& name, const ConstraintEngineId constraintEngine);
+    /**
+     * @param flatAdjacency If true, the TemporalNetwork uses the flat adjacency layout.
+     * @param queue The priority queue the TemporalNetwork propagates with.
+     * @param threads The number of threads for full propagation of the TemporalNetwork.
+     */
+    TemporalPropagator(const std::string& name, const ConstraintEngineId constraintEngine,
+                       bool flatAdjacency = false,
+                       QueueImplementation queue = BINARY_HEAP_QUEUE,
+                       unsigned int threads = 1);
     virtual ~TemporalPropagator();
     void execute();
     void execute(const ConstraintId constr) {Propagator::execute(constr);}
@@ -101,6 +109,14 @@ namespace EUROPA {
 
     void addListener(const TemporalNetworkListenerId listener);
 
+    /**
+     * @brief Batch the changes moved into the TemporalNetwork until the matching
+     * commitBatch(), so that they are propagated together.
+     * @see TemporalNetwork::beginBatch
+     */
+    void beginBatch();
+    void commitBatch();
+
   protected:
     void handleDiscard();
     void handleConstraintAdded(const ConstraintId constraint);
@@ -0,0 +1,233 @@
+/**
+ * @file tn-benchmark.cc
+ * @brief Times propagation over large random STNs with each queue implementation and adjacency layout.
+ *
+ * A random schedule is drawn for the timepoints, and every constraint admits it, so the networks are
+ * always consistent. For each configuration the same network is built and then timed in four phases:
+ *
+ * - build: adding the timepoints and constraints, each of which is propagated incrementally.
+ * - full: removing one constraint and propagating, which is a full Bellman-Ford and bound propagation.
+ * - incremental: adding further constraints, propagating after each one.
+ * - queries: exact distances between random pairs of timepoints.
+ *
+ * The bounds of all timepoints and the query results are summed into a checksum, which must be the
+ * same for every configuration. Exits with 1 if it is not.
+ *
+ * The timepoints may be split into components, which are only connected through the origin, and
+ * full propagation may use several threads for them.
+ *
+ * Usage: tn-benchmark [-n timepoints] [-c constraints per timepoint] [-i incremental constraints]
+ *                     [-q queries] [-s seed] [-g components] [-t threads]
+ */
+
+#include "TemporalNetwork.hh"
+#include "DataTypes.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <sys/time.h>
+
+using namespace EUROPA;
+
+namespace {
+
+  double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+  }
+
+  /**
+   * @brief A small linear congruential generator, so that every configuration sees the same network
+   * whatever the platform's rand().
+   */
+  class Random {
+  public:
+    Random(unsigned long seed) : m_state(seed) {}
+    unsigned long next(unsigned long bound) {
+      m_state = m_state * 6364136223846793005UL + 1442695040888963407UL;
+      return (m_state >> 33) % bound;
+    }
+  private:
+    unsigned long m_state;
+  };
+
+  struct Parameters {
+    unsigned long timepoints;
+    unsigned long constraintsPerTimepoint;
+    unsigned long incremental;
+    unsigned long queries;
+    unsigned long seed;
+    unsigned long components;
+    unsigned long threads;
+  };
+
+  struct Result {
+    double build;
+    double full;
+    double incremental;
+    double queries;
+    Time checksum;
+  };
+
+  const Time HORIZON = 1000000;
+
+  /**
+   * @brief A constraint from tps[i] to tps[j] which admits the schedule.
+   */
+  TemporalConstraint* addConstraint(TemporalNetwork& tn, Random& random, std::vector<Timepoint*>& tps,
+                                    const std::vector<Time>& schedule, unsigned long i, unsigned long j) {
+    Time distance = schedule[j] - schedule[i];
+    Time lb = distance - static_cast<Time>(random.next(100));
+    Time ub = distance + static_cast<Time>(random.next(100));
+    return tn.addTemporalConstraint(*tps[i], *tps[j], lb, ub);
+  }
+
+  Result run(const Parameters& parameters, bool flatAdjacency, QueueImplementation queue) {
+    Result result;
+    Random random(parameters.seed);
+    TemporalNetwork tn(flatAdjacency);
+    tn.setQueueImplementation(queue);
+    tn.setThreads(static_cast<unsigned int>(parameters.threads));
+
+    double start = now();
+    std::vector<Timepoint*> tps;
+    std::vector<Time> schedule;
+    std::vector<TemporalConstraint*> constraints;
+    for (unsigned long i = 0; i < parameters.timepoints; i++) {
+      tps.push_back(&tn.addTimepoint());
+      schedule.push_back(static_cast<Time>(random.next(HORIZON)));
+      constraints.push_back(tn.addTemporalConstraint(tn.getOrigin(), *tps.back(), 0, HORIZON));
+    }
+    // Mostly local constraints, as between the timepoints of neighbouring tokens, with some long ones,
+    // all within the component of the timepoint
+    unsigned long size = parameters.timepoints / parameters.components;
+    for (unsigned long i = 0; i < parameters.timepoints; i++) {
+      unsigned long first = std::min(i / size, parameters.components - 1) * size;
+      unsigned long count = (first + 2 * size > parameters.timepoints) ? parameters.timepoints - first : size;
+      for (unsigned long k = 0; k < parameters.constraintsPerTimepoint; k++) {
+        unsigned long j = first + ((k == 0 && random.next(10) == 0) ? random.next(count) :
+                                   (i - first + 1 + random.next(20)) % count);
+        if (j != i)
+          constraints.push_back(addConstraint(tn, random, tps, schedule, i, j));
+      }
+    }
+    result.build = now() - start;
+
+    start = now();
+    tn.removeTemporalConstraint(*constraints.back());
+    constraints.pop_back();
+    bool consistent = tn.propagate();
+    result.full = now() - start;
+
+    start = now();
+    for (unsigned long k = 0; k < parameters.incremental; k++) {
+      unsigned long i = random.next(parameters.timepoints);
+      unsigned long first = std::min(i / size, parameters.components - 1) * size;
+      unsigned long count = (first + 2 * size > parameters.timepoints) ? parameters.timepoints - first : size;
+      unsigned long j = first + random.next(count);
+      if (j != i)
+        constraints.push_back(addConstraint(tn, random, tps, schedule, i, j));
+      consistent = tn.propagate() && consistent;
+    }
+    result.incremental = now() - start;
+    if (!consistent)
+      std::cerr << "Random network is inconsistent" << std::endl;
+
+    result.checksum = 0;
+    start = now();
+    for (unsigned long k = 0; k < parameters.queries; k++) {
+      Timepoint& src = *tps[random.next(parameters.timepoints)];
+      Timepoint& targ = *tps[random.next(parameters.timepoints)];
+      result.checksum += tn.calcDistance(src, targ);
+    }
+    result.queries = now() - start;
+
+    for (unsigned long i = 0; i < parameters.timepoints; i++) {
+      Time lb, ub;
+      tn.getTimepointBounds(*tps[i], lb, ub);
+      result.checksum += lb + ub;
+    }
+    // The network is freed as a whole, since removing constraints one at a time searches them all
+    return result;
+  }
+
+  int usage() {
+    std::cout << "usage: tn-benchmark [-n timepoints] [-c constraints per timepoint] "
+              << "[-i incremental constraints] [-q queries] [-s seed] [-g components] [-t threads]"
+              << std::endl;
+    return 1;
+  }
+}
+
+int main(int argc, const char** argv)
+{
+  Parameters parameters;
+  parameters.timepoints = 100000;
+  parameters.constraintsPerTimepoint = 3;
+  parameters.incremental = 1000;
+  parameters.queries = 1000;
+  parameters.seed = 1;
+  parameters.components = 1;
+  parameters.threads = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 == argc || argv[i][0] != '-' || strlen(argv[i]) != 2)
+      return usage();
+    unsigned long value = strtoul(argv[++i], NULL, 10);
+    switch (argv[i - 1][1]) {
+    case 'n': parameters.timepoints = value; break;
+    case 'c': parameters.constraintsPerTimepoint = value; break;
+    case 'i': parameters.incremental = value; break;
+    case 'q': parameters.queries = value; break;
+    case 's': parameters.seed = value; break;
+    case 'g': parameters.components = value; break;
+    case 't': parameters.threads = value; break;
+    default: return usage();
+    }
+  }
+  if (parameters.components < 1 || parameters.threads < 1 ||
+      parameters.timepoints < 2 * parameters.components)
+    return usage();
+
+  // Init data types so that id counts don't fail
+  VoidDT::instance();
+  BoolDT::instance();
+  IntDT::instance();
+  FloatDT::instance();
+  StringDT::instance();
+  SymbolDT::instance();
+
+  std::cout << parameters.timepoints << " timepoints, " << parameters.constraintsPerTimepoint
+            << " constraints per timepoint, " << parameters.components << " components, "
+            << parameters.threads << " threads, seed " << parameters.seed << std::endl
+            << std::setw(8) << std::left << "queue" << std::setw(10) << "layout" << std::right
+            << std::setw(10) << "build" << std::setw(10) << "full"
+            << std::setw(14) << "incremental" << std::setw(10) << "queries"
+            << std::setw(20) << "checksum" << std::endl;
+
+  bool agree = true;
+  Time checksum = 0;
+  for (int layout = 0; layout < 2; layout++) {
+    for (int queue = 0; queue < 2; queue++) {
+      Result result = run(parameters, layout == 1, queue == 0 ? BINARY_HEAP_QUEUE : RADIX_HEAP_QUEUE);
+      std::cout << std::setw(8) << std::left << (queue == 0 ? "heap" : "radix")
+                << std::setw(10) << (layout == 0 ? "pointers" : "flat") << std::right
+                << std::fixed << std::setprecision(3)
+                << std::setw(10) << result.build << std::setw(10) << result.full
+                << std::setw(14) << result.incremental << std::setw(10) << result.queries
+                << std::setw(20) << result.checksum << std::endl;
+      if (layout == 0 && queue == 0)
+        checksum = result.checksum;
+      agree = agree && result.checksum == checksum;
+    }
+  }
+  if (!agree)
+    std::cout << "Configurations disagree" << std::endl;
+  return (agree ? 0 : 1);
+}
@@ -110,6 +110,11 @@ public:
     EUROPA_runTest(testFixForReversingEndpoints);
     EUROPA_runTest(testMemoryCleanups);
     EUROPA_runTest(testMemoryCleanupSimple);
+    EUROPA_runTest(testDistanceCache);
+    EUROPA_runTest(testFlatAdjacency);
+    EUROPA_runTest(testRadixQueue);
+    EUROPA_runTest(testParallelComponents);
+    EUROPA_runTest(testBatch);
     return true;
   }
 
@@ -228,6 +233,369 @@ private:
     tn.calcDistanceBounds(x, y, delta, epsilon);
     return true;
   }
+
+  static bool testDistanceCache() {
+    TemporalNetwork tn;
+    Timepoint& a = tn.addTimepoint();
+    Timepoint& b = tn.addTimepoint();
+    Timepoint& c = tn.addTimepoint();
+    TemporalConstraint* a_b = tn.addTemporalConstraint(a, b, 1, 10);
+    TemporalConstraint* b_c = tn.addTemporalConstraint(b, c, 2, 20);
+    CPPUNIT_ASSERT(tn.propagate());
+
+    CPPUNIT_ASSERT(tn.calcDistance(a, c) == 30);
+    CPPUNIT_ASSERT(tn.calcDistance(c, a) == -3);
+    CPPUNIT_ASSERT(tn.calcDistance(a, c) == 30);
+
+    // Batched queries agree with single ones, whether cached or not
+    std::vector<Timepoint*> targs;
+    targs.push_back(&b);
+    targs.push_back(&c);
+    targs.push_back(&a);
+    std::vector<Time> distances;
+    tn.calcDistancesFrom(a, targs, distances);
+    CPPUNIT_ASSERT(distances.size() == 3);
+    CPPUNIT_ASSERT(distances[0] == 10 && distances[1] == 30 && distances[2] == 0);
+    tn.calcDistancesTo(a, targs, distances);
+    CPPUNIT_ASSERT(distances[0] == -1 && distances[1] == -3 && distances[2] == 0);
+    std::vector<Time> lbs, ubs;
+    tn.calcDistanceBounds(b, targs, lbs, ubs);
+    CPPUNIT_ASSERT(lbs[1] == 2 && ubs[1] == 20);
+    CPPUNIT_ASSERT(lbs[2] == -10 && ubs[2] == -1);
+
+    // Changing an edge discards cached distances
+    tn.narrowTemporalConstraint(*b_c, 5, 8);
+    CPPUNIT_ASSERT(tn.propagate());
+    CPPUNIT_ASSERT(tn.calcDistance(a, c) == 18);
+    CPPUNIT_ASSERT(tn.calcDistance(c, a) == -6);
+    tn.removeTemporalConstraint(*b_c);
+    CPPUNIT_ASSERT(tn.propagate());
+    CPPUNIT_ASSERT(tn.calcDistance(a, c) == POS_INFINITY);
+    tn.calcDistancesFrom(a, targs, distances);
+    CPPUNIT_ASSERT(distances[0] == 10 && distances[1] == POS_INFINITY);
+
+    tn.removeTemporalConstraint(*a_b);
+    tn.deleteTimepoint(c);
+    tn.deleteTimepoint(b);
+    tn.deleteTimepoint(a);
+    return true;
+  }
+
+  static bool testFlatAdjacency() {
+    TemporalNetwork pointers;
+    TemporalNetwork flat(true);
+    CPPUNIT_ASSERT(!pointers.hasFlatAdjacency() && flat.hasFlatAdjacency());
+    CPPUNIT_ASSERT(sameBehaviour(pointers, flat));
+    return true;
+  }
+
+  static bool testRadixQueue() {
+    // Keys come out in order, negative or not, while they are popped in order
+    BucketQueue queue(100, RADIX_HEAP_QUEUE);
+    Dnode nodes[6];
+    Time keys[6] = {5, -3, 1000000000000L, 0, -7, 5};
+    queue.reset();
+    for (int i = 0; i < 6; i++)
+      queue.insertInQueue(&nodes[i], keys[i]);
+    queue.insertInQueue(&nodes[2], 4); // Improves the key of nodes[2]
+    Time expected[7] = {-7, -3, 0, 4, 4, 5, 5};
+    for (int i = 0; i < 7; i++) {
+      Dnode* node = queue.popMinFromQueue();
+      CPPUNIT_ASSERT(node != NULL && -node->getKey() == expected[i]);
+      if (i == 3) {
+        CPPUNIT_ASSERT(node == &nodes[2]);
+        queue.insertInQueue(&nodes[3], 4);  // The same as the last key popped
+      }
+      if (i == 4)
+        CPPUNIT_ASSERT(node == &nodes[3]);
+    }
+    // The entry for the old key of nodes[2] is skipped
+    CPPUNIT_ASSERT(queue.popMinFromQueue() == NULL);
+
+    TemporalNetwork heap;
+    TemporalNetwork radix;
+    radix.setQueueImplementation(RADIX_HEAP_QUEUE);
+    CPPUNIT_ASSERT(heap.getQueueImplementation() == BINARY_HEAP_QUEUE &&
+                   radix.getQueueImplementation() == RADIX_HEAP_QUEUE);
+    CPPUNIT_ASSERT(sameBehaviour(heap, radix));
+
+    TemporalNetwork flatHeap(true);
+    TemporalNetwork flatRadix(true);
+    flatRadix.setQueueImplementation(RADIX_HEAP_QUEUE);
+    CPPUNIT_ASSERT(sameBehaviour(flatHeap, flatRadix));
+    return true;
+  }
+
+  static bool testParallelComponents() {
+    TemporalNetwork sequential;
+    TemporalNetwork parallel;
+    parallel.setThreads(4);
+    CPPUNIT_ASSERT(sequential.getThreads() == 1 && parallel.getThreads() == 4);
+    CPPUNIT_ASSERT(sameBehaviour(sequential, parallel));
+
+    // Groups of timepoints connected only through the origin, and some connected to nothing else
+    const int groups = 8, size = 20, isolated = 5;
+    std::vector<Timepoint*> tps1, tps2;
+    std::vector<TemporalConstraint*> c1, c2;
+    srand(2);
+    std::vector<Time> schedule;
+    for (int i = 0; i < groups * size + isolated; i++) {
+      tps1.push_back(&sequential.addTimepoint());
+      tps2.push_back(&parallel.addTimepoint());
+      schedule.push_back(100 + rand() % 10000);
+      Time lb = schedule[i] - rand() % 50;
+      Time ub = schedule[i] + rand() % 50;
+      c1.push_back(sequential.addTemporalConstraint(sequential.getOrigin(), *tps1[i], lb, ub));
+      c2.push_back(parallel.addTemporalConstraint(parallel.getOrigin(), *tps2[i], lb, ub));
+    }
+    for (int g = 0; g < groups; g++) {
+      for (int k = 0; k < 3 * size; k++) {
+        int i = g * size + rand() % size;
+        int j = g * size + rand() % size;
+        if (i == j)
+          continue;
+        Time distance = schedule[j] - schedule[i];
+        Time lb = distance - rand() % 20;
+        Time ub = distance + rand() % 20;
+        c1.push_back(sequential.addTemporalConstraint(*tps1[i], *tps1[j], lb, ub));
+        c2.push_back(parallel.addTemporalConstraint(*tps2[i], *tps2[j], lb, ub));
+      }
+    }
+    // Removing a constraint forces a full propagation
+    sequential.removeTemporalConstraint(*c1.back());
+    parallel.removeTemporalConstraint(*c2.back());
+    c1.pop_back();
+    c2.pop_back();
+    CPPUNIT_ASSERT(sequential.propagate() && parallel.propagate());
+    CPPUNIT_ASSERT(sameNetworks(sequential, tps1, parallel, tps2));
+
+    // Join two groups, then split them again
+    TemporalConstraint* join1 = sequential.addTemporalConstraint(*tps1[0], *tps1[size], -20000, 20000);
+    TemporalConstraint* join2 = parallel.addTemporalConstraint(*tps2[0], *tps2[size], -20000, 20000);
+    sequential.removeTemporalConstraint(*c1[1]);
+    parallel.removeTemporalConstraint(*c2[1]);
+    c1[1] = c2[1] = NULL;
+    CPPUNIT_ASSERT(sequential.propagate() && parallel.propagate());
+    CPPUNIT_ASSERT(sameNetworks(sequential, tps1, parallel, tps2));
+    sequential.removeTemporalConstraint(*join1);
+    parallel.removeTemporalConstraint(*join2);
+    CPPUNIT_ASSERT(sequential.propagate() && parallel.propagate());
+    CPPUNIT_ASSERT(sameNetworks(sequential, tps1, parallel, tps2));
+
+    // An inconsistency within one group is found, and recovered from
+    TemporalConstraint* cycle1 = sequential.addTemporalConstraint(*tps1[2 * size], *tps1[2 * size + 1],
+                                                                  20000, 20001, false);
+    TemporalConstraint* cycle2 = parallel.addTemporalConstraint(*tps2[2 * size], *tps2[2 * size + 1],
+                                                                20000, 20001, false);
+    sequential.removeTemporalConstraint(*c1[2]);
+    parallel.removeTemporalConstraint(*c2[2]);
+    c1[2] = c2[2] = NULL;
+    CPPUNIT_ASSERT(!sequential.propagate() && !parallel.propagate());
+    CPPUNIT_ASSERT(!parallel.getInconsistencyReason().empty());
+    sequential.removeTemporalConstraint(*cycle1);
+    parallel.removeTemporalConstraint(*cycle2);
+    CPPUNIT_ASSERT(sequential.propagate() && parallel.propagate());
+    CPPUNIT_ASSERT(sameNetworks(sequential, tps1, parallel, tps2));
+
+    for (unsigned int i = 0; i < c1.size(); i++) {
+      if (c1[i] != NULL) {
+        sequential.removeTemporalConstraint(*c1[i]);
+        parallel.removeTemporalConstraint(*c2[i]);
+      }
+    }
+    for (unsigned int i = 0; i < tps1.size(); i++) {
+      sequential.deleteTimepoint(*tps1[i]);
+      parallel.deleteTimepoint(*tps2[i]);
+    }
+    return true;
+  }
+
+  static bool testBatch() {
+    TemporalNetwork eager;
+    TemporalNetwork batched;
+    const int n = 200;
+    std::vector<Timepoint*> tps1, tps2;
+    std::vector<TemporalConstraint*> c1, c2;
+    srand(3);
+    std::vector<Time> schedule;
+    batched.beginBatch();
+    for (int i = 0; i < n; i++) {
+      tps1.push_back(&eager.addTimepoint());
+      tps2.push_back(&batched.addTimepoint());
+      schedule.push_back(rand() % 10000);
+      c1.push_back(eager.addTemporalConstraint(eager.getOrigin(), *tps1[i], 0, 20000));
+      c2.push_back(batched.addTemporalConstraint(batched.getOrigin(), *tps2[i], 0, 20000));
+    }
+    // Batches nest
+    batched.beginBatch();
+    for (int i = 0; i < 4 * n; i++) {
+      int a = rand() % n, b = rand() % n;
+      if (a == b)
+        continue;
+      Time distance = schedule[b] - schedule[a];
+      Time lb = distance - rand() % 50;
+      Time ub = distance + rand() % 50;
+      c1.push_back(eager.addTemporalConstraint(*tps1[a], *tps1[b], lb, ub));
+      c2.push_back(batched.addTemporalConstraint(*tps2[a], *tps2[b], lb, ub));
+    }
+    batched.commitBatch();
+    CPPUNIT_ASSERT(batched.isBatching() && batched.updateRequired());
+    batched.commitBatch();
+    CPPUNIT_ASSERT(!batched.isBatching() && !batched.updateRequired());
+    CPPUNIT_ASSERT(eager.propagate() && batched.propagate());
+    CPPUNIT_ASSERT(sameNetworks(eager, tps1, batched, tps2));
+
+    // Narrowing is batched too, and asking for bounds propagates the batch so far
+    batched.beginBatch();
+    for (unsigned int i = n; i < c1.size(); i += 5) {
+      Timepoint* source;
+      Timepoint* target;
+      eager.getConstraintScope(*c1[i], source, target);
+      Time distance = schedule[std::find(tps1.begin(), tps1.end(), target) - tps1.begin()] -
+          schedule[std::find(tps1.begin(), tps1.end(), source) - tps1.begin()];
+      eager.narrowTemporalConstraint(*c1[i], distance, distance);
+      batched.narrowTemporalConstraint(*c2[i], distance, distance);
+    }
+    CPPUNIT_ASSERT(sameNetworks(eager, tps1, batched, tps2));
+    batched.commitBatch();
+
+    // A batch with an inconsistency is found inconsistent
+    batched.beginBatch();
+    TemporalConstraint* cycle1 = eager.addTemporalConstraint(*tps1[0], *tps1[1], 30000, 30001);
+    TemporalConstraint* cycle2 = batched.addTemporalConstraint(*tps2[0], *tps2[1], 30000, 30001);
+    batched.commitBatch();
+    CPPUNIT_ASSERT(!eager.propagate() && !batched.propagate());
+    CPPUNIT_ASSERT(!batched.getInconsistencyReason().empty());
+    eager.removeTemporalConstraint(*cycle1);
+    batched.removeTemporalConstraint(*cycle2);
+    CPPUNIT_ASSERT(eager.propagate() && batched.propagate());
+    CPPUNIT_ASSERT(sameNetworks(eager, tps1, batched, tps2));
+
+    for (unsigned int i = 0; i < c1.size(); i++) {
+      eager.removeTemporalConstraint(*c1[i]);
+      batched.removeTemporalConstraint(*c2[i]);
+    }
+    for (int i = 0; i < n; i++) {
+      eager.deleteTimepoint(*tps1[i]);
+      batched.deleteTimepoint(*tps2[i]);
+    }
+    return true;
+  }
+
+  /**
+   * Apply the same changes to two networks, and check that they always agree.
+   */
+  static bool sameBehaviour(TemporalNetwork& tn1, TemporalNetwork& tn2) {
+    const int n = 100;
+    std::vector<Timepoint*> tps1, tps2;
+    std::vector<TemporalConstraint*> c1, c2;
+    for (int i = 0; i < n; i++) {
+      tps1.push_back(&tn1.addTimepoint());
+      tps2.push_back(&tn2.addTimepoint());
+    }
+    // Enough constraints on each timepoint to outgrow and move its edge blocks,
+    // all admitting a random schedule, so that the networks stay consistent
+    srand(1);
+    std::vector<Time> schedule, distances;
+    for (int i = 0; i < n; i++)
+      schedule.push_back(rand() % 10000);
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < 8; k++) {
+        int j = (k == 0) ? rand() % n : (i + 1 + rand() % 20) % n;
+        if (j == i)
+          continue;
+        Time distance = schedule[j] - schedule[i];
+        Time lb = distance - rand() % 100;
+        Time ub = distance + rand() % 100;
+        c1.push_back(tn1.addTemporalConstraint(*tps1[i], *tps1[j], lb, ub));
+        c2.push_back(tn2.addTemporalConstraint(*tps2[i], *tps2[j], lb, ub));
+        distances.push_back(distance);
+      }
+    }
+    CPPUNIT_ASSERT(tn1.propagate() && tn2.propagate());
+    CPPUNIT_ASSERT(sameNetworks(tn1, tps1, tn2, tps2));
+
+    // Remove every third constraint, leaving tombstones, and narrow others
+    for (unsigned int i = 0; i < c1.size(); i += 3) {
+      tn1.removeTemporalConstraint(*c1[i]);
+      tn2.removeTemporalConstraint(*c2[i]);
+      c1[i] = c2[i] = NULL;
+    }
+    for (unsigned int i = 1; i < c1.size(); i += 3) {
+      tn1.narrowTemporalConstraint(*c1[i], distances[i], distances[i]);
+      tn2.narrowTemporalConstraint(*c2[i], distances[i], distances[i]);
+    }
+    CPPUNIT_ASSERT(tn1.propagate() && tn2.propagate());
+    CPPUNIT_ASSERT(sameNetworks(tn1, tps1, tn2, tps2));
+
+    // Delete a timepoint, and reuse its slot
+    for (unsigned int i = 0; i < c1.size(); i++) {
+      if (c1[i] == NULL)
+        continue;
+      Timepoint* source;
+      Timepoint* target;
+      tn1.getConstraintScope(*c1[i], source, target);
+      if (source == tps1[5] || target == tps1[5]) {
+        tn1.removeTemporalConstraint(*c1[i]);
+        tn2.removeTemporalConstraint(*c2[i]);
+        c1[i] = c2[i] = NULL;
+      }
+    }
+    tn1.deleteTimepoint(*tps1[5]);
+    tn2.deleteTimepoint(*tps2[5]);
+    tps1[5] = &tn1.addTimepoint();
+    tps2[5] = &tn2.addTimepoint();
+    c1.push_back(tn1.addTemporalConstraint(*tps1[4], *tps1[5], 2, 3));
+    c2.push_back(tn2.addTemporalConstraint(*tps2[4], *tps2[5], 2, 3));
+    CPPUNIT_ASSERT(tn1.propagate() && tn2.propagate());
+    CPPUNIT_ASSERT(sameNetworks(tn1, tps1, tn2, tps2));
+
+    // Both detect the same inconsistency, and recover from it
+    TemporalConstraint* cycle1 = tn1.addTemporalConstraint(*tps1[n - 1], *tps1[0], 100000, 100001);
+    TemporalConstraint* cycle2 = tn2.addTemporalConstraint(*tps2[n - 1], *tps2[0], 100000, 100001);
+    CPPUNIT_ASSERT(!tn1.propagate() && !tn2.propagate());
+    tn1.removeTemporalConstraint(*cycle1);
+    tn2.removeTemporalConstraint(*cycle2);
+    CPPUNIT_ASSERT(tn1.propagate() && tn2.propagate());
+    CPPUNIT_ASSERT(sameNetworks(tn1, tps1, tn2, tps2));
+
+    for (unsigned int i = 0; i < c1.size(); i++) {
+      if (c1[i] != NULL) {
+        tn1.removeTemporalConstraint(*c1[i]);
+        tn2.removeTemporalConstraint(*c2[i]);
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      tn1.deleteTimepoint(*tps1[i]);
+      tn2.deleteTimepoint(*tps2[i]);
+    }
+    return true;
+  }
+
+  static bool sameNetworks(TemporalNetwork& tn1, const std::vector<Timepoint*>& tps1,
+                           TemporalNetwork& tn2, const std::vector<Timepoint*>& tps2) {
+    std::vector<Time> d1, d2;
+    for (unsigned int i = 0; i < tps1.size(); i++) {
+      Time lb1, ub1, lb2, ub2;
+      tn1.getTimepointBounds(*tps1[i], lb1, ub1);
+      tn2.getTimepointBounds(*tps2[i], lb2, ub2);
+      if (lb1 != lb2 || ub1 != ub2)
+        return false;
+      tn1.calcDistancesFrom(*tps1[i], tps1, d1);
+      tn2.calcDistancesFrom(*tps2[i], tps2, d2);
+      if (d1 != d2)
+        return false;
+      tn1.calcDistancesTo(*tps1[i], tps1, d1);
+      tn2.calcDistancesTo(*tps2[i], tps2, d2);
+      if (d1 != d2)
+        return false;
+      // Single pair distances stop the search at the target, so depend on the potentials
+      for (unsigned int j = 0; j < tps1.size(); j++)
+        if (tn1.calcDistance(*tps1[j], *tps1[i]) != tn2.calcDistance(*tps2[j], *tps2[i]))
+          return false;
+    }
+    return true;
+  }
 };
 
 class TemporalPropagatorTest {
@@ -1,95 +1,256 @@
 #include "Entity.hh"
 #include "Debug.hh"
-#include "Mutex.hh"
+#include "Error.hh"
 
 #include <sstream>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
 
-#include <boost/ref.hpp>
+#include <boost/atomic.hpp>
 
 //TODO: figure out how to handle notification of dependent entities
 
 namespace EUROPA {
+
+/**
+ * @class EntityInternals
+ * @brief Registry mapping entity keys to entities.
+ *
+ * Keys are handed out to threads in blocks of KEY_BLOCK_SIZE, so the shared
+ * block counter is only touched once per block and keys allocated by a single
+ * thread stay monotonic.  Each block owns a page of slots, and pages are
+ * reached through a fixed two-level directory indexed by the high bits of the
+ * key, so registration, removal and lookup are O(1) array accesses with no
+ * global lock.  A page is retired once its block has been exhausted and every
+ * entity registered in it has been destroyed.  Retired pages are recycled for
+ * new blocks rather than freed, since a concurrent lookup of another key may
+ * still be reading one; a lookup checks the page still holds its block after
+ * reading the slot.
+ *
+ * Lookups are safe against concurrent registration in other threads.  As
+ * before, looking up an entity while another thread deletes it is not.
+ */
 class EntityInternals {
  public:
-  EntityInternals(): m_entitiesByKey(), m_purgeStatus(false), m_key(0) {}
+  static const unsigned long KEY_BLOCK_BITS = 10;
+  static const unsigned long KEY_BLOCK_SIZE = 1UL << KEY_BLOCK_BITS;
+  static const unsigned long PAGE_BITS = 11;
+  static const unsigned long PAGES_PER_CHUNK = 1UL << PAGE_BITS;
+  static const unsigned long CHUNK_BITS = 10;
+  static const unsigned long CHUNK_COUNT = 1UL << CHUNK_BITS;
+  static const unsigned long MAX_BLOCKS = CHUNK_COUNT * PAGES_PER_CHUNK;
+
+  /**
+   * @brief Slots for one block of keys.  m_refs counts registered entities
+   * plus one for the thread still allocating out of the block.
+   */
+  struct Page {
+    Page() : m_refs(1), m_block(MAX_BLOCKS) {
+      for(unsigned long i = 0; i < KEY_BLOCK_SIZE; ++i)
+        m_slots[i].store(NULL, boost::memory_order_relaxed);
+    }
+    boost::atomic<Entity*> m_slots[KEY_BLOCK_SIZE];
+    boost::atomic<unsigned long> m_refs;
+    boost::atomic<unsigned long> m_block; /**< The block the page holds slots for */
+  };
+
+  struct Chunk {
+    Chunk() {
+      for(unsigned long i = 0; i < PAGES_PER_CHUNK; ++i)
+        m_pages[i].store(NULL, boost::memory_order_relaxed);
+    }
+    boost::atomic<Page*> m_pages[PAGES_PER_CHUNK];
+  };
+
+  /**
+   * @brief The block a thread is currently allocating keys from.
+   */
+  struct ThreadBlock {
+    ThreadBlock() : m_next(0), m_end(0), m_page(NULL) {}
+    unsigned long m_next;
+    unsigned long m_end;
+    Page* m_page;
+  };
+
+  EntityInternals(): m_nextBlock(0), m_purgeStatus(false) {
+    for(unsigned long i = 0; i < CHUNK_COUNT; ++i)
+      m_chunks[i].store(NULL, boost::memory_order_relaxed);
+    pthread_key_create(&m_threadBlockKey, &EntityInternals::threadExit);
+    pthread_mutex_init(&m_retiredLock, NULL);
+  }
 
-  eint allocateKey(const Entity* const e){
-    eint retval = m_key++;
-    m_entitiesByKey.insert(std::make_pair(retval, 
-                                          reinterpret_cast<unsigned long int>(e)));
-    return retval;
+  unsigned long allocateKey(Entity* const e) {
+    ThreadBlock* block = threadBlock();
+    if(block->m_next == block->m_end)
+      claimBlock(block);
+    unsigned long key = block->m_next++;
+    block->m_page->m_refs.fetch_add(1, boost::memory_order_relaxed);
+    block->m_page->m_slots[key & (KEY_BLOCK_SIZE - 1)].store(e, boost::memory_order_release);
+    return key;
   }
-  
-  void erase(const eint key) {
-    m_entitiesByKey.erase(key);
+
+  void erase(const unsigned long key) {
+    Page* page = getPage(key);
+    check_error(page != NULL);
+    page->m_slots[key & (KEY_BLOCK_SIZE - 1)].store(NULL, boost::memory_order_release);
+    releasePage(key, page);
   }
+
   EntityId getEntity(const eint key) const {
-    EntityId entity;
-    std::map<eint, unsigned long int>::const_iterator it = m_entitiesByKey.find(key);
-    if(it != m_entitiesByKey.end())
-      entity = static_cast<EntityId>(it->second);
-    return entity;
+    long k = cast_long(key);
+    if(k < 0 || static_cast<unsigned long>(k) >= MAX_BLOCKS * KEY_BLOCK_SIZE)
+      return EntityId::noId();
+    unsigned long b = static_cast<unsigned long>(k) >> KEY_BLOCK_BITS;
+    Page* page = getPage(static_cast<unsigned long>(k));
+    if(page == NULL || page->m_block.load(boost::memory_order_acquire) != b)
+      return EntityId::noId();
+    Entity* entity =
+        page->m_slots[static_cast<unsigned long>(k) & (KEY_BLOCK_SIZE - 1)].load(boost::memory_order_acquire);
+    // The page may have been retired and recycled for another block while we read it
+    if(entity == NULL || page->m_block.load(boost::memory_order_acquire) != b)
+      return EntityId::noId();
+    return static_cast<EntityId>(reinterpret_cast<unsigned long int>(entity));
   }
+
   void getEntities(std::set<EntityId>& resultSet) const {
-    for(std::map<eint, unsigned long int>::const_iterator it = m_entitiesByKey.begin();
-	it != m_entitiesByKey.end();
-	++it){
-      resultSet.insert(static_cast<EntityId>(it->second));
+    for(unsigned long c = 0; c < CHUNK_COUNT; ++c) {
+      Chunk* chunk = m_chunks[c].load(boost::memory_order_acquire);
+      if(chunk == NULL)
+        continue;
+      for(unsigned long p = 0; p < PAGES_PER_CHUNK; ++p) {
+        Page* page = chunk->m_pages[p].load(boost::memory_order_acquire);
+        if(page == NULL)
+          continue;
+        for(unsigned long s = 0; s < KEY_BLOCK_SIZE; ++s) {
+          Entity* entity = page->m_slots[s].load(boost::memory_order_acquire);
+          if(entity != NULL)
+            resultSet.insert(static_cast<EntityId>(reinterpret_cast<unsigned long int>(entity)));
+        }
+      }
     }
-
   }
+
   void purgeStarted() {
-    check_error(!m_purgeStatus);
-    m_purgeStatus = true;
+    check_error(!m_purgeStatus.load());
+    m_purgeStatus.store(true);
   }
   void purgeEnded() {
-    check_error(m_purgeStatus);
-    m_purgeStatus = false;
+    check_error(m_purgeStatus.load());
+    m_purgeStatus.store(false);
   }
   bool isPurging() const {
-    return m_purgeStatus;
+    return m_purgeStatus.load(boost::memory_order_relaxed);
   }
  private:
   EntityInternals(const EntityInternals& o);
 
-  std::map<eint, unsigned long int> m_entitiesByKey;
-  std::set<Entity*> m_discardedEntities;
-  bool m_purgeStatus;
-  int m_key;
-};
+  ThreadBlock* threadBlock() {
+    ThreadBlock* block = static_cast<ThreadBlock*>(pthread_getspecific(m_threadBlockKey));
+    if(block == NULL) {
+      block = new ThreadBlock();
+      pthread_setspecific(m_threadBlockKey, block);
+    }
+    return block;
+  }
 
+  /**
+   * @brief Retire the thread's current block, if any, and install a page for a fresh one.
+   */
+  void claimBlock(ThreadBlock* block) {
+    if(block->m_page != NULL)
+      releasePage(block->m_end - 1, block->m_page);
+
+    unsigned long b = m_nextBlock.fetch_add(1, boost::memory_order_relaxed);
+    check_runtime_error(b < MAX_BLOCKS, "Exhausted the entity key space.");
+
+    Chunk* chunk = m_chunks[b >> PAGE_BITS].load(boost::memory_order_acquire);
+    if(chunk == NULL) {
+      Chunk* newChunk = new Chunk();
+      if(m_chunks[b >> PAGE_BITS].compare_exchange_strong(chunk, newChunk,
+                                                           boost::memory_order_acq_rel))
+        chunk = newChunk;
+      else
+        delete newChunk; // chunk now holds the one another thread installed
+    }
+    block->m_page = recycledPage();
+    block->m_page->m_block.store(b, boost::memory_order_release);
+    chunk->m_pages[b & (PAGES_PER_CHUNK - 1)].store(block->m_page, boost::memory_order_release);
+    block->m_next = b << KEY_BLOCK_BITS;
+    block->m_end = block->m_next + KEY_BLOCK_SIZE;
+  }
+
+  Page* getPage(const unsigned long key) const {
+    unsigned long b = key >> KEY_BLOCK_BITS;
+    Chunk* chunk = m_chunks[b >> PAGE_BITS].load(boost::memory_order_acquire);
+    if(chunk == NULL)
+      return NULL;
+    return chunk->m_pages[b & (PAGES_PER_CHUNK - 1)].load(boost::memory_order_acquire);
+  }
+
+  void releasePage(const unsigned long key, Page* page) {
+    if(page->m_refs.fetch_sub(1, boost::memory_order_acq_rel) != 1)
+      return;
+    unsigned long b = key >> KEY_BLOCK_BITS;
+    m_chunks[b >> PAGE_BITS].load(boost::memory_order_acquire)->
+        m_pages[b & (PAGES_PER_CHUNK - 1)].store(NULL, boost::memory_order_release);
+    pthread_mutex_lock(&m_retiredLock);
+    m_retiredPages.push_back(page);
+    pthread_mutex_unlock(&m_retiredLock);
+  }
+
+  /**
+   * @brief A retired page, reset for a new block, or a new one if none are retired.
+   */
+  Page* recycledPage() {
+    Page* page = NULL;
+    pthread_mutex_lock(&m_retiredLock);
+    if(!m_retiredPages.empty()) {
+      page = m_retiredPages.back();
+      m_retiredPages.pop_back();
+    }
+    pthread_mutex_unlock(&m_retiredLock);
+    if(page == NULL)
+      return new Page();
+    page->m_refs.store(1, boost::memory_order_relaxed);
+    return page;
+  }
+
+  static void threadExit(void* data);
+
+  boost::atomic<Chunk*> m_chunks[CHUNK_COUNT];
+  boost::atomic<unsigned long> m_nextBlock;
+  boost::atomic<bool> m_purgeStatus;
+  pthread_key_t m_threadBlockKey;
+  pthread_mutex_t m_retiredLock;
+  std::vector<Page*> m_retiredPages;
+};
 
 namespace {
-static EntityInternals entityInternals;
-#ifdef __APPLE__
-static pthread_mutex_t entityMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
-#else
-static pthread_mutex_t entityMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-#endif
-
-typedef std::pair<MutexGrabber, boost::reference_wrapper<EntityInternals> >
-internals_accessor;
-internals_accessor internals() {
-  MutexGrabber grabber(entityMutex);
-  return std::make_pair(grabber, boost::ref(entityInternals));
+// Never deallocated, so entities destroyed during static destruction can still unregister.
+EntityInternals& internals() {
+  static EntityInternals* sl_internals = new EntityInternals();
+  return *sl_internals;
 }
 }
 
+void EntityInternals::threadExit(void* data) {
+  ThreadBlock* block = static_cast<ThreadBlock*>(data);
+  if(block->m_page != NULL)
+    internals().releasePage(block->m_end - 1, block->m_page);
+  delete block;
+}
 
 Entity::Entity(): m_key(0), m_refCount(1) {
-  internals_accessor i(internals());
-  m_key = i.second.get().allocateKey(this);
+  m_key = internals().allocateKey(this);
   debugMsg("Entity:Entity", "Allocating " << m_key);
 }
 
 Entity::~Entity(){
   check_runtime_error(decRefCount() || Entity::isPurging());
-  internals_accessor i = internals();
-  i.second.get().erase(m_key); //Is there a good way to RAII this?
+  internals().erase(static_cast<unsigned long>(cast_long(m_key)));
 }
 
-
-
 const std::string& Entity::getEntityType() const {
   static const std::string ENTITY_STR("Entity");
   return ENTITY_STR;
@@ -120,23 +281,23 @@ const std::string& Entity::getName() const {
   bool Entity::canBeCompared(const EntityId) const{ return true;}
 
   EntityId Entity::getEntity(const eint key){
-    return internals().second.get().getEntity(key);
+    return internals().getEntity(key);
   }
 
   void Entity::getEntities(std::set<EntityId>& resultSet){
-    return internals().second.get().getEntities(resultSet);
+    return internals().getEntities(resultSet);
   }
 
   void Entity::purgeStarted(){
-    internals().second.get().purgeStarted();
+    internals().purgeStarted();
   }
 
 void Entity::purgeEnded(){
-  internals().second.get().purgeEnded();
+  internals().purgeEnded();
 }
 
 bool Entity::isPurging(){
-  return internals().second.get().isPurging();
+  return internals().isPurging();
 }
 
   unsigned int Entity::refCount() const { return m_refCount; }
@@ -4,6 +4,7 @@
 #include "Id.hh"
 #include "LabelStr.hh"
 #include "PSEntity.hh"
+#include "SlabAllocator.hh"
 
 #include <map>
 #include <set>
@@ -39,6 +40,12 @@ namespace EUROPA{
 
     virtual ~Entity();
 
+    /**
+     * @brief Entities are allocated through the SlabAllocator, pooled when it is enabled.
+     */
+    static void* operator new(size_t size) {return SlabAllocator::allocate(size);}
+    static void operator delete(void* ptr, size_t size) {SlabAllocator::deallocate(ptr, size);}
+
     inline eint getKey() const {return m_key;}
     inline PSEntityKey getEntityKey() const {return static_cast<PSEntityKey>(cast_int(m_key));}
 
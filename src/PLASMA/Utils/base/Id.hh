@@ -26,6 +26,16 @@
  * @see IdTable
 */
 
+/**
+ * @def check_id_error
+ * @brief Id's own consistency checks. These stay on in checked-lite builds, where check_error is compiled out.
+ */
+#ifdef EUROPA_ID_CHECKED_LITE
+#define check_id_error(cond, msg, type) check_runtime_error(cond, msg, type)
+#else
+#define check_id_error(cond, msg, type) check_error(cond, msg, type)
+#endif
+
 namespace EUROPA {
 
   class IdErr {
@@ -108,6 +118,8 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
    * @li The API is fully backward compatible with previous Id template class.
    * @li The IdManager is no longer required, but can be used for backward compatibility without any problems.
    * @li Compilation as EUROPA_FAST gets rid of all access to IdTable and thus isValid and isNotValid are not effective.
+   * @li Compilation as EUROPA_FAST with EUROPA_ID_CHECKED_LITE keeps the key, which then packs a slot index and
+   * generation, so isValid is a lock-free O(1) check and copies between Ids of the same address skip the IdTable.
    * @see IdManager, IdTable
    */
   template<class T>
@@ -120,17 +132,17 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
      * @see Id::noId()
      */
     inline Id(T* ptr) : m_ptr(ptr) 
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
 		      , m_key(0)
 #endif
     {
-#ifndef EUROPA_FAST
-      check_error(ptr != 0,
+#ifdef EUROPA_ID_CHECKED
+      check_id_error(ptr != 0,
 		  std::string("Cannot generate an Id<") + typeid(T).name() + "> for 0 pointer.",
                   IdErr::IdMgrInvalidItemPtrError());
       m_key = IdTable::insert(reinterpret_cast<unsigned long int>(ptr),
 			      typeid(T).name());
-      check_error(m_key != 0, 
+      check_id_error(m_key != 0, 
 		  std::string("Cannot generate an Id<") + typeid(T).name() + "> for a pointer that has not been cleaned up.",
                   IdErr::IdMgrInvalidItemPtrError());
 #endif
@@ -141,7 +153,7 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
      * @param org The constant reference to original Id from which to copy.
      */
     inline Id(const Id& org) : m_ptr(org.m_ptr)
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
 			     , m_key(org.m_key)
 #endif
     {}
@@ -152,7 +164,7 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
        * @see Id::noId()
        */
       inline Id() : m_ptr(NULL)
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
 		  , m_key(0)
 #endif
     {}
@@ -163,11 +175,11 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
 	 * Must be 0, or an address for which an Id has already been allocated.
 	 */
 	inline Id(double val) : m_ptr(NULL)
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
 			    , m_key(0)
 #endif
     {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       if (val == 0)
         m_key = 0;
       else {
@@ -183,11 +195,11 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
 
 
 			       inline Id(const unsigned long int val) : m_ptr(reinterpret_cast<T*>(val))
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       , m_key(0)
 #endif
     {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
     if(val != 0) {
     m_key = IdTable::getKey(val);
     checkError(m_key != 0,
@@ -204,7 +216,7 @@ Baz* baz = (Baz*) fooId; // Will not compile.@endverbatim
      */
 template <class X>
 inline Id(const Id<X>& org) : m_ptr(NULL)
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
 			    , m_key(0)
 #endif
 {
@@ -226,7 +238,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      */
     inline Id& operator=(const Id org) {
       m_ptr = org.m_ptr;
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       m_key = org.m_key;
 #endif
       return(*this);
@@ -302,7 +314,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @brief Handy method to directly test for noId without requiring comparison with another object.
      */
     inline bool isNoId() const {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       return(m_ptr == 0 && m_key == 0);
 #else
       return(m_ptr == 0);
@@ -314,7 +326,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @see isNoId()
      */
     inline bool isId() const {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       return(m_ptr != 0 && m_key != 0);
 #else
       return(m_ptr != 0);
@@ -329,7 +341,10 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @see Id::isInvalid(), Id::isNoId()
      */
     inline bool isValid() const {
-#ifndef EUROPA_FAST
+#if defined(EUROPA_ID_CHECKED_LITE)
+      return(m_ptr != 0 && m_key != 0 &&
+             IdTable::isCurrent(m_key, reinterpret_cast<unsigned long>(m_ptr)));
+#elif defined(EUROPA_ID_CHECKED)
       return(m_ptr != 0 && m_key != 0 &&
              IdTable::getKey(reinterpret_cast<unsigned long>(m_ptr)) == m_key);
 #else
@@ -342,7 +357,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @see Id::isValid()
      */
     inline bool isInvalid() const {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       return(!isValid());
 #else
       return(m_ptr == 0);
@@ -356,7 +371,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @see Id::isValid()
      */
     inline bool operator==(const Id comp) const {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       return(m_ptr == comp.m_ptr && m_key == comp.m_key);
 #else
       return(m_ptr == comp.m_ptr);
@@ -369,7 +384,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @return false if ==, true otherwise.
      */
     inline bool operator!=(const Id comp) const {
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       return (!(operator==(comp)));
 #else
       return(m_ptr != comp.m_ptr);
@@ -402,7 +417,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
       if (isNoId())
         os << "noId";
       else
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
         os << "id_" << m_key;
 #else
       os << "ptr_" << m_ptr;
@@ -417,8 +432,8 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
       // Take local copy of pointer to delete since we will want to null m_ptr prior to deletion
       // as a safety measure for objects which embed id's and deallocate them on destruction.
       T* ptr = m_ptr;
-#ifndef EUROPA_FAST
-      check_error(isValid(), std::string("Cannot release an invalid Id<") + typeid(T).name() + ">.",
+#ifdef EUROPA_ID_CHECKED
+      check_id_error(isValid(), std::string("Cannot release an invalid Id<") + typeid(T).name() + ">.",
                   IdErr::IdMgrInvalidItemPtrError());
       m_key = 0;
       IdTable::remove(reinterpret_cast<unsigned long int>(ptr));
@@ -433,8 +448,8 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      * @see IdTable::release()
      */
     inline void remove() {
-#ifndef EUROPA_FAST
-      check_error(isValid(), std::string("Cannot remove an invalid Id<") + typeid(T).name() + ">.",
+#ifdef EUROPA_ID_CHECKED
+      check_id_error(isValid(), std::string("Cannot remove an invalid Id<") + typeid(T).name() + ">.",
                   IdErr::IdMgrInvalidItemPtrError());
       IdTable::remove(reinterpret_cast<unsigned long int>(m_ptr));
       m_key = 0;
@@ -443,19 +458,27 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
     }
 
   private:
+    template <class X> friend class Id;
 
     template <class X>
     inline void copyAndCastFromId(const Id<X>& org) {
       m_ptr = dynamic_cast<T*>(org.operator->());
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
       if (org.isNoId()) {
         m_key = 0;
         return;
       }
-      check_error(Id<T>::convertable(org), std::string("Invalid cast from Id<") + typeid(X).name() + "> to Id<" + typeid(T).name() + ">.",
+      check_id_error(Id<T>::convertable(org), std::string("Invalid cast from Id<") + typeid(X).name() + "> to Id<" + typeid(T).name() + ">.",
                   IdErr::IdMgrInvalidItemPtrError());
+#ifdef EUROPA_ID_CHECKED_LITE
+      // Same address, same slot: no need to go through the pointer map.
+      if (static_cast<const void*>(m_ptr) == static_cast<const void*>(org.m_ptr)) {
+        m_key = org.m_key;
+        return;
+      }
+#endif
       m_key = IdTable::getKey(reinterpret_cast<unsigned long int>(m_ptr));
-      check_error(m_key != 0, std::string("Cannot create an Id<") + typeid(X).name() + "> for this address since no instance is present.",
+      check_id_error(m_key != 0, std::string("Cannot create an Id<") + typeid(X).name() + "> for this address since no instance is present.",
                   IdErr::IdMgrInvalidItemPtrError());
 #endif
     }
@@ -465,7 +488,7 @@ inline Id(const Id<X>& org) : m_ptr(NULL)
      */
     T* m_ptr;
 
-#ifndef EUROPA_FAST
+#ifdef EUROPA_ID_CHECKED
     /**
      * Key within the IdTable.
      */
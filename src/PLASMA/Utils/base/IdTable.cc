@@ -18,6 +18,11 @@
 #include "Mutex.hh"
 #include "Entity.hh"
 
+#ifdef EUROPA_ID_CHECKED_LITE
+#include <vector>
+#include <boost/unordered_map.hpp>
+#endif
+
 /**
  * @file IdTable.cc
  * @author Conor McGann
@@ -28,12 +33,169 @@
  * @li Use the output function to display pointer address and key pairs that have not been deallocated.
  * @li Use debug messages this information in conjunction with the output.
  * @li A dangling pointer failure can be traced by looking for the removal event for a given <pointer, key> pair.
+ * @li Under EUROPA_ID_CHECKED_LITE the table is the slot table at the top of this file and the
+ * map based implementation below it is not compiled.
  * @date  July, 2003
  * @see Id<T>
  */
 
 namespace EUROPA {
 
+#ifdef EUROPA_ID_CHECKED_LITE
+
+namespace {
+const unsigned long SHARD_COUNT = 16;
+
+/**
+ * @brief One stripe of the pointer to key map, with the slots it has released.
+ */
+struct IdShard {
+  IdShard() : m_keys(), m_freeSlots() {pthread_mutex_init(&m_mutex, NULL);}
+  pthread_mutex_t m_mutex;
+  boost::unordered_map<unsigned long int, unsigned long int> m_keys;
+  std::vector<unsigned long> m_freeSlots;
+};
+
+struct IdTableState {
+  IdTableState() : m_nextSlot(0), m_size(0) {}
+  IdShard m_shards[SHARD_COUNT];
+  boost::atomic<unsigned long> m_nextSlot;
+  boost::atomic<unsigned long> m_size;
+};
+
+// Never deallocated, so Ids released during static destruction still find it.
+IdTableState& state() {
+  static IdTableState* sl_state = new IdTableState();
+  return *sl_state;
+}
+
+IdShard& shardFor(unsigned long int id) {
+  return state().m_shards[((id >> 4) ^ (id >> 12)) & (SHARD_COUNT - 1)];
+}
+}
+
+boost::atomic<IdSlot*> IdTable::s_pages[IdTable::PAGE_COUNT];
+
+IdTable::IdTable() {}
+
+IdTable::~IdTable() {}
+
+IdTable& IdTable::getInstance() {
+  static IdTable sl_instance;
+  return(sl_instance);
+}
+
+IdSlot* IdTable::getSlot(unsigned long index) {
+  check_runtime_error((index >> PAGE_BITS) < PAGE_COUNT, "Exhausted the IdTable slot space.");
+  boost::atomic<IdSlot*>& entry = s_pages[index >> PAGE_BITS];
+  IdSlot* page = entry.load(boost::memory_order_acquire);
+  if(page == NULL) {
+    IdSlot* newPage = new IdSlot[PAGE_SIZE];
+    for(unsigned long i = 0; i < PAGE_SIZE; ++i) {
+      newPage[i].m_ptr.store(0, boost::memory_order_relaxed);
+      newPage[i].m_generation.store(1, boost::memory_order_relaxed);
+      newPage[i].m_type = NULL;
+    }
+    if(entry.compare_exchange_strong(page, newPage, boost::memory_order_acq_rel))
+      page = newPage;
+    else
+      delete [] newPage; // page now holds the one installed by another thread
+  }
+  return page + (index & (PAGE_SIZE - 1));
+}
+
+unsigned long IdTable::size() {
+  return state().m_size.load(boost::memory_order_relaxed);
+}
+
+bool IdTable::allocated(unsigned long int id) {
+  return getKey(id) != 0;
+}
+
+unsigned long int IdTable::getKey(unsigned long int id) {
+  IdShard& shard = shardFor(id);
+  MutexGrabber mg(shard.m_mutex);
+  boost::unordered_map<unsigned long int, unsigned long int>::const_iterator it =
+      shard.m_keys.find(id);
+  return (it == shard.m_keys.end() ? 0 : it->second);
+}
+
+unsigned long int IdTable::insert(unsigned long int id, const char* baseType) {
+  IdShard& shard = shardFor(id);
+  MutexGrabber mg(shard.m_mutex);
+  if(shard.m_keys.find(id) != shard.m_keys.end())
+    return(0); /* Already in table. */
+
+  unsigned long index;
+  if(shard.m_freeSlots.empty())
+    index = state().m_nextSlot.fetch_add(1, boost::memory_order_relaxed);
+  else {
+    index = shard.m_freeSlots.back();
+    shard.m_freeSlots.pop_back();
+  }
+
+  IdSlot* slot = getSlot(index);
+  slot->m_type = baseType;
+  slot->m_ptr.store(id, boost::memory_order_release);
+  unsigned long key = (index << GENERATION_BITS) |
+      slot->m_generation.load(boost::memory_order_relaxed);
+  shard.m_keys.insert(std::make_pair(id, key));
+  state().m_size.fetch_add(1, boost::memory_order_relaxed);
+  debugMsg("IdTable:insert", "id,key:" << std::hex << id << std::dec << ", " << key << ")");
+  return key;
+}
+
+void IdTable::remove(unsigned long int id) {
+  IdShard& shard = shardFor(id);
+  MutexGrabber mg(shard.m_mutex);
+  boost::unordered_map<unsigned long int, unsigned long int>::iterator it = shard.m_keys.find(id);
+  check_runtime_error(it != shard.m_keys.end());
+  unsigned long index = it->second >> GENERATION_BITS;
+  debugMsg("IdTable:remove", "<" << std::hex << id << std::dec << ", " << it->second << ">");
+  shard.m_keys.erase(it);
+
+  IdSlot* slot = getSlot(index);
+  unsigned long generation = (slot->m_generation.load(boost::memory_order_relaxed) + 1) & GENERATION_MASK;
+  slot->m_generation.store(generation == 0 ? 1 : generation, boost::memory_order_release);
+  slot->m_ptr.store(0, boost::memory_order_relaxed);
+  slot->m_type = NULL;
+  shard.m_freeSlots.push_back(index);
+  state().m_size.fetch_sub(1, boost::memory_order_relaxed);
+}
+
+void IdTable::printTypeCnts(std::ostream& os) {
+  std::map<std::string, unsigned int> typeCnts;
+  unsigned long slotCount = state().m_nextSlot.load(boost::memory_order_relaxed);
+  for(unsigned long i = 0; i < slotCount; ++i) {
+    IdSlot* slot = getSlot(i);
+    if(slot->m_ptr.load(boost::memory_order_relaxed) != 0 && slot->m_type != NULL)
+      typeCnts[slot->m_type]++;
+  }
+  os << "Id instances by type:\n";
+  for (std::map<std::string, unsigned int>::iterator it = typeCnts.begin();
+       it != typeCnts.end();
+       ++it)
+    os << "  " << it->second << "  " << it->first << '\n';
+  os << std::endl;
+}
+
+void IdTable::output(std::ostream& os) {
+  printTypeCnts(os);
+  os << "Id Contents:";
+  unsigned long slotCount = state().m_nextSlot.load(boost::memory_order_relaxed);
+  for(unsigned long i = 0; i < slotCount; ++i) {
+    IdSlot* slot = getSlot(i);
+    unsigned long id = slot->m_ptr.load(boost::memory_order_relaxed);
+    if(id != 0)
+      os << " (" << std::hex << id << std::dec << ", " <<
+        ((i << GENERATION_BITS) | slot->m_generation.load(boost::memory_order_relaxed)) << "," <<
+        (slot->m_type == NULL ? "" : slot->m_type) << ')';
+  }
+  os << std::endl;
+}
+
+#else
+
 namespace {
 unsigned int getEntryKey(std::pair<unsigned int,edouble>& entry) {
     return entry.first;
@@ -68,7 +230,7 @@ unsigned long IdTable::size() {
     return(getInstance().m_collection.find(id) != getInstance().m_collection.end());
   }
 
-  unsigned int IdTable::getKey(unsigned long int id) {
+  unsigned long int IdTable::getKey(unsigned long int id) {
     MutexGrabber mg(IdTableMutex());
     debugMsg("IdTable:getKey", "Searching for key for " << std::hex << id << std::dec);
     std::map<unsigned long int, std::pair<unsigned int,edouble> >::iterator it = getInstance().m_collection.find(id);
@@ -78,7 +240,7 @@ unsigned long IdTable::size() {
       return(0);
   }
 
-  unsigned int IdTable::insert(unsigned long int id, const char* baseType) {
+  unsigned long int IdTable::insert(unsigned long int id, const char* baseType) {
     MutexGrabber mg(IdTableMutex());
     static unsigned int sl_nextId(1);
     debugMsg("IdTable:insert", "id,key:" << std::hex << id << std::dec << ", " << sl_nextId << ")");
@@ -141,6 +303,8 @@ unsigned long IdTable::size() {
     os << std::endl;
   }
 
+#endif
+
 void IdTable::checkResult(bool result, unsigned long id_count) {
 
   if (result && IdTable::size() <= id_count) {
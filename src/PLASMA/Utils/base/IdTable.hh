@@ -19,6 +19,24 @@
 #include <string>
 #include "Number.hh"
 
+#ifdef EUROPA_ID_CHECKED_LITE
+#include <boost/atomic.hpp>
+#endif
+
+/**
+ * @def EUROPA_ID_CHECKED
+ * @brief Defined whenever Ids carry an IdTable key, so isValid() detects dangling pointers.
+ *
+ * There are three Id modes:
+ * @li The default (debug) build, where the IdTable is an ordered map from pointers to keys.
+ * @li EUROPA_FAST, where Ids are bare pointers and no checking is done.
+ * @li EUROPA_FAST with EUROPA_ID_CHECKED_LITE, where Ids carry a slot index and generation
+ * into a lock-free slot table so they can still be validated in O(1) in optimized builds.
+ */
+#if !defined(EUROPA_FAST) || defined(EUROPA_ID_CHECKED_LITE)
+#define EUROPA_ID_CHECKED
+#endif
+
 
 /**
  * @author Conor McGann
@@ -29,6 +47,19 @@
 
 namespace EUROPA {
 
+#ifdef EUROPA_ID_CHECKED_LITE
+  /**
+   * @class IdSlot
+   * @brief An entry in the checked-lite slot table. The generation is bumped every time
+   * the slot is released, invalidating all keys handed out for the previous occupant.
+   */
+  struct IdSlot {
+    boost::atomic<unsigned long> m_ptr;
+    boost::atomic<unsigned long> m_generation;
+    const char* m_type;
+  };
+#endif
+
   /**
    * @class IdTable
    * @brief Provides a singleton which manages <pointer,key> pairs.
@@ -37,6 +68,10 @@ namespace EUROPA {
    * by an integer which should be the address of an object managed by an Id. A key is used to
    * check for allocations of an Id to a previously allocated address. This is necessary so that dangling
    * Ids can be detected even if the address has been recycled.
+   *
+   * Under EUROPA_ID_CHECKED_LITE the key packs a slot index and a generation instead, and the
+   * pointer to key map is a set of independently locked hash shards. Validation then reads
+   * only the slot, without taking any lock.
    * @see Id
    */
   class IdTable {
@@ -45,12 +80,33 @@ namespace EUROPA {
 
     static unsigned long size();
 
-    static unsigned int insert(unsigned long int id, const char* baseType);
+    static unsigned long int insert(unsigned long int id, const char* baseType);
     static void remove(unsigned long int id);
 
-    static unsigned int getKey(unsigned long int id);
+    static unsigned long int getKey(unsigned long int id);
     static bool allocated(unsigned long int id);
 
+#ifdef EUROPA_ID_CHECKED_LITE
+    static const unsigned int GENERATION_BITS = (sizeof(unsigned long) >= 8 ? 32 : 8);
+    static const unsigned long GENERATION_MASK = (1UL << GENERATION_BITS) - 1;
+    static const unsigned int PAGE_BITS = 12;
+    static const unsigned long PAGE_SIZE = 1UL << PAGE_BITS;
+    static const unsigned long PAGE_COUNT = 1UL << 14;
+
+    /**
+     * @brief Test, without locking, that key still refers to the slot holding id.
+     */
+    static inline bool isCurrent(unsigned long int key, unsigned long int id) {
+      unsigned long index = key >> GENERATION_BITS;
+      IdSlot* page = s_pages[index >> PAGE_BITS].load(boost::memory_order_acquire);
+      if(page == NULL)
+        return false;
+      const IdSlot& slot = page[index & (PAGE_SIZE - 1)];
+      return slot.m_generation.load(boost::memory_order_acquire) == (key & GENERATION_MASK) &&
+        slot.m_ptr.load(boost::memory_order_relaxed) == id;
+    }
+#endif
+
     static void printTypeCnts(std::ostream& os);
     static void output(std::ostream& os);
 
@@ -61,8 +117,14 @@ namespace EUROPA {
     IdTable();
     static IdTable& getInstance();
     
+#ifdef EUROPA_ID_CHECKED_LITE
+    static IdSlot* getSlot(unsigned long index);
+
+    static boost::atomic<IdSlot*> s_pages[PAGE_COUNT]; /**< Slot pages, allocated on demand */
+#else
     std::map<unsigned long int, std::pair<unsigned int,edouble> > m_collection; /**< Map from pointers to keys */
     std::map<std::string, unsigned int> m_typeCnts;
+#endif
   };
 }
 
@@ -5,44 +5,165 @@
 #include "Utils.hh"
 #include <string.h>
 
+#include <boost/atomic.hpp>
+#include <boost/unordered_map.hpp>
+
 namespace EUROPA {
 
   DEFINE_GLOBAL_CONST(LabelStr, EMPTY_LABEL, "");
 
 
-//   std::map< std::string, double>& LabelStr::keysFromString() {
-//     static std::map< std::string, double> sl_keysFromString;
-//     return(sl_keysFromString);
-//   }
+namespace {
 
-//   std::map< double, std::string>& LabelStr::stringFromKeys() {
-//     static std::map< double, std::string> sl_stringFromKeys;
-//     return(sl_stringFromKeys);
-//   }
+/**
+ * @brief A view of a character range, used to probe the table without building a std::string.
+ */
+struct StringRef {
+  StringRef(const char* data, size_t length) : m_data(data), m_length(length) {}
+  const char* m_data;
+  size_t m_length;
+};
+
+struct StringRefHash {
+  size_t operator()(const StringRef& str) const {
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for(size_t i = 0; i < str.m_length; ++i) {
+      hash ^= static_cast<unsigned char>(str.m_data[i]);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+};
 
-  std::map<std::string, edouble>& LabelStr::keysFromString() {
-    static std::map<std::string, edouble> sl_keysFromString;
-    return sl_keysFromString;
+struct StringRefEqual {
+  bool operator()(const StringRef& a, const StringRef& b) const {
+    return a.m_length == b.m_length && memcmp(a.m_data, b.m_data, a.m_length) == 0;
+  }
+};
+
+/**
+ * @class LabelStrTable
+ * @brief The shared store of strings.
+ *
+ * Strings live in fixed size pages that are never moved or freed, so a key decodes to a
+ * (page, slot) pair and can be read without locking. The string to index map is split
+ * into stripes, each with its own mutex, and is keyed on views into the stored strings.
+ */
+class LabelStrTable {
+public:
+  static const unsigned long PAGE_BITS = 12;
+  static const unsigned long PAGE_SIZE = 1UL << PAGE_BITS;
+  static const unsigned long PAGE_COUNT = 1UL << 12;
+  static const unsigned long STRIPE_COUNT = 16;
+
+  struct Entry {
+    Entry() : m_string(), m_key(0) {m_ready.store(false, boost::memory_order_relaxed);}
+    std::string m_string;
+    edouble m_key;
+    boost::atomic<bool> m_ready;
+  };
+
+  typedef boost::unordered_map<StringRef, unsigned long, StringRefHash, StringRefEqual> IndexMap;
+
+  struct Stripe {
+    Stripe() : m_index() {pthread_mutex_init(&m_mutex, NULL);}
+    pthread_mutex_t m_mutex;
+    IndexMap m_index;
+  };
+
+  LabelStrTable() : m_size(0) {
+    for(unsigned long i = 0; i < PAGE_COUNT; ++i)
+      m_pages[i].store(NULL, boost::memory_order_relaxed);
   }
 
-  std::map< edouble, std::string>& LabelStr::stringFromKeys() {
-    static std::map<edouble, std::string> sl_stringFromKeys;
-    return(sl_stringFromKeys);
+  static edouble keyForIndex(unsigned long index) {
+    return edouble(static_cast<double>(2 * index + 1)) * EPSILON;
   }
 
-LabelStr::LabelStr() : m_key(0) {
-  std::string empty("");
-  m_key = getKey(empty);
-}
+  edouble getKey(const char* label, size_t length) {
+    StringRef ref(label, length);
+    size_t hash = StringRefHash()(ref);
+    Stripe& stripe = m_stripes[hash % STRIPE_COUNT];
+    MutexGrabber mg(stripe.m_mutex);
+    IndexMap::const_iterator it = stripe.m_index.find(ref);
+    if(it != stripe.m_index.end())
+      return getEntry(it->second)->m_key; // Found it; return the key.
 
-namespace {
-pthread_mutex_t& LabelStrMutex() {
-  static pthread_mutex_t sl_mutex = PTHREAD_MUTEX_INITIALIZER;
-  return sl_mutex;      
+    // Given label not found, so allocate it.
+    unsigned long index = m_size.fetch_add(1, boost::memory_order_relaxed);
+    check_runtime_error((index >> PAGE_BITS) < PAGE_COUNT, "Exhausted the LabelStr store.");
+    Entry* entry = getEntry(index);
+    entry->m_string.assign(label, length);
+    entry->m_key = keyForIndex(index);
+    entry->m_ready.store(true, boost::memory_order_release);
+    stripe.m_index.insert(std::make_pair(StringRef(entry->m_string.data(), length), index));
+    debugMsg("LabelStr:insert", " " << entry->m_key << " -> " << entry->m_string);
+    return entry->m_key;
+  }
+
+  bool contains(const char* label, size_t length) {
+    StringRef ref(label, length);
+    Stripe& stripe = m_stripes[StringRefHash()(ref) % STRIPE_COUNT];
+    MutexGrabber mg(stripe.m_mutex);
+    return stripe.m_index.find(ref) != stripe.m_index.end();
+  }
+
+  /**
+   * @brief Find the entry for a key, or NULL if the key was never handed out.
+   */
+  const Entry* lookup(edouble key) const {
+    if(!(key > 0))
+      return NULL;
+    edouble position = key / (2 * EPSILON);
+    if(position >= edouble(static_cast<double>(m_size.load(boost::memory_order_acquire))))
+      return NULL;
+    unsigned long index = static_cast<unsigned long>(cast_double(position));
+    const Entry* entry = findEntry(index);
+    if(entry == NULL || !entry->m_ready.load(boost::memory_order_acquire) || entry->m_key != key)
+      return NULL;
+    return entry;
+  }
+
+  unsigned long size() const {
+    return m_size.load(boost::memory_order_relaxed);
+  }
+
+private:
+  const Entry* findEntry(unsigned long index) const {
+    const Entry* page = m_pages[index >> PAGE_BITS].load(boost::memory_order_acquire);
+    return (page == NULL ? NULL : page + (index & (PAGE_SIZE - 1)));
+  }
+
+  Entry* getEntry(unsigned long index) {
+    boost::atomic<Entry*>& slot = m_pages[index >> PAGE_BITS];
+    Entry* page = slot.load(boost::memory_order_acquire);
+    if(page == NULL) {
+      Entry* newPage = new Entry[PAGE_SIZE];
+      if(slot.compare_exchange_strong(page, newPage, boost::memory_order_acq_rel))
+        page = newPage;
+      else
+        delete [] newPage; // page now holds the one installed by another thread
+    }
+    return page + (index & (PAGE_SIZE - 1));
+  }
+
+  boost::atomic<Entry*> m_pages[PAGE_COUNT];
+  boost::atomic<unsigned long> m_size;
+  Stripe m_stripes[STRIPE_COUNT];
+};
+
+// Never deallocated, since LabelStrs are used during static destruction.
+LabelStrTable& table() {
+  static LabelStrTable* sl_table = new LabelStrTable();
+  return *sl_table;
 }
 }
-  
-  
+
+LabelStr::LabelStr() : m_key(0) {
+  m_key = getKey("", 0);
+}
+
   /**
    * Construction must obtain a key that is efficient to use for later
    * calculations in the domain and must maintain the ordering defined
@@ -53,8 +174,11 @@ LabelStr::LabelStr(const std::string& label) : m_key(0) {
 }
 
 LabelStr::LabelStr(const char* label) : m_key(0) {
-  std::string str(label);
-  m_key = getKey(label);
+  m_key = getKey(label, strlen(label));
+}
+
+LabelStr::LabelStr(const char* label, size_t length) : m_key(0) {
+  m_key = getKey(label, length);
 }
 
 LabelStr::LabelStr(edouble key)
@@ -100,55 +224,33 @@ LabelStr::LabelStr(edouble key)
   }
 
   unsigned long LabelStr::getSize() {
-    check_error(keysFromString().size() == stringFromKeys().size());
-    return keysFromString().size();
+    return table().size();
   }
 
   edouble LabelStr::getKey(const std::string& label) {
-    MutexGrabber mg(LabelStrMutex());
-    
-    static edouble sl_counter = EPSILON;
-
-    std::map<std::string, edouble>::iterator it = 
-      keysFromString().find(label);
-
-    if (it != keysFromString().end()) {
-      edouble toRet = it->second;
-      return toRet; // Found it; return the key.
-    }
-
-    // Given label not found, so allocate it.
-    edouble key = sl_counter;
-    sl_counter = sl_counter + 2*EPSILON;
-
-    handleInsertion(key, label);
-    return(key);
+    return table().getKey(label.data(), label.size());
   }
 
-  void LabelStr::handleInsertion(edouble key, const std::string& label) {
-    debugMsg("LabelStr:insert", " " << key << " -> " << label);
-    keysFromString().insert(std::make_pair(label, key));
-    stringFromKeys().insert(std::make_pair(key, label));
+  edouble LabelStr::getKey(const char* label, size_t length) {
+    return table().getKey(label, length);
   }
 
   const std::string& LabelStr::getString(edouble key){
-    MutexGrabber mg(LabelStrMutex());
-    std::map< edouble, std::string >::const_iterator it = stringFromKeys().find(key);
-    check_error(it != stringFromKeys().end());
-    const std::string& toRet = it->second;
-    return toRet;
+    const LabelStrTable::Entry* entry = table().lookup(key);
+    check_error(entry != NULL);
+    return entry->m_string;
   }
 
   bool LabelStr::isString(edouble key) {
-    MutexGrabber mg(LabelStrMutex());
-    bool toRet = (stringFromKeys().find(key) != stringFromKeys().end());
-    return toRet;
+    return table().lookup(key) != NULL;
   }
 
   bool LabelStr::isString(const std::string& candidate){
-    MutexGrabber mg(LabelStrMutex());
-    bool toRet = (keysFromString().find(candidate) != keysFromString().end());
-    return toRet;
+    return table().contains(candidate.data(), candidate.size());
+  }
+
+  bool LabelStr::isString(const char* candidate){
+    return table().contains(candidate, strlen(candidate));
   }
 
   bool LabelStr::contains(const LabelStr& lblStr) const{
@@ -10,9 +10,9 @@
 
 #include "CommonDefs.hh"
 #include "Number.hh"
-#include <map>
+#include <boost/functional/hash.hpp>
+#include <cstddef>
 #include <string>
-//#include <boost/unordered_map.hpp>
 
 
 namespace EUROPA {
@@ -27,6 +27,11 @@ namespace EUROPA {
    * The reader should note that strings are stored in a static data structure so that they can be shared. Access to
    * the store is provided by a key value. This reduces operations on LabelStr to operations on double valued keys
    * which is considerable more efficient. This encoding is largely transparent to users.
+   *
+   * The i'th string interned gets the key (2i + 1) * EPSILON, so the key decodes directly to an index
+   * into the store and recovering a string from a key takes no lock. Finding the key for a string goes
+   * through a lock-striped hash table which can be probed with a character range, without building a
+   * std::string.
    */
   class LabelStr {
   public:
@@ -42,6 +47,13 @@ namespace EUROPA {
      */
     LabelStr(const char* str);
 
+    /**
+     * @brief Constructor
+     * @param str The characters of the string in question, which need not be null terminated
+     * @param length The number of characters in str
+     */
+    LabelStr(const char* str, size_t length);
+
     /**
      * @brief Constructor
      * @param label The symbolic value as a string
@@ -165,6 +177,13 @@ namespace EUROPA {
      */
     static edouble getKey(const std::string& label);
 
+    /**
+     * @brief Obtain the key for the given characters, possibly inserting them into the store.
+     * @param label The characters of the string, which need not be null terminated
+     * @param length The number of characters in label
+     */
+    static edouble getKey(const char* label, size_t length);
+
     /**
      * @brief Test if the given double valued key is actually a string.
      */
@@ -174,39 +193,34 @@ namespace EUROPA {
      * @brief Tests if the given candidate is actually stored already as a LabelStr
      */
     static bool isString(const std::string& candidate);
+
+    /**
+     * @brief Tests if the given null terminated candidate is actually stored already as a LabelStr
+     */
+    static bool isString(const char* candidate);
   private:
 
     /**
      * @brief The key value used as a proxy for the original string.
      * @note The only instance data.
-     * @see handleInsertion.
+     * @see getKey()
      */
     edouble m_key;
 
-    /**
-     * @brief Constructs an entry in stringFromKeys to allow lookup of strings from a key.
-     * @todo This optimization may not be that significant. Should explore storing the strings in the instance
-     * for such retrieval. It will increase the memeory per instance and hurt on copying or assignment but would provide
-     * faster access to implement toString().
-     * @param key The double value encoding for the given string
-     * @param label the string for which the key has been encoded.
-     * @see s_stringFromKeys, getString()
-     */
-    static void handleInsertion(edouble key, const std::string& label);
-
     /**
      * @brief Obtain the string from the key.
      * @param key The double valued encoding of the string
      * @return a reference to the original string held in the string store.
-     * @see s_stringFromKeys
      */
     static const std::string& getString(edouble key);
 
-    /*static std::map< std::string, double>& keysFromString();*/ /**< Map strings to keys for key allocation on construction. */
-    /*static std::map< double, std::string>& stringFromKeys();*/ /**< Map keys to strings for string retrieval - i.e. toString(). */
-    static std::map<std::string, edouble>& keysFromString();
-    static std::map<edouble, std::string>& stringFromKeys();
-
   };
+
+  /**
+   * @brief Hash a LabelStr by its key, so it can key boost::unordered containers.
+   */
+  inline std::size_t hash_value(const LabelStr& label) {
+    return boost::hash<double>()(cast_double(label.getKey()));
+  }
 }
 #endif
@@ -0,0 +1,136 @@
+#include "SlabAllocator.hh"
+#include "Error.hh"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace EUROPA {
+
+  namespace {
+    const std::size_t GRANULE = 16;
+    const std::size_t CLASS_COUNT = 32; // Up to 512 bytes
+    // Slabs are aligned to their size, so the slab of a block is found by masking its address
+    const std::size_t SLAB_SIZE = 64 * 1024;
+    // Slabs start with a SlabHeader, padded to keep blocks suitably aligned
+    const std::size_t SLAB_HEADER_SIZE = 16;
+
+    struct FreeBlock {
+      FreeBlock* next;
+    };
+
+    inline std::size_t sizeClass(std::size_t size) {
+      return (size == 0 ? 1 : (size + GRANULE - 1) / GRANULE);
+    }
+
+#ifdef __GNUC__
+    __thread FreeBlock* s_freeBlocks[CLASS_COUNT + 1];
+    __thread char* s_slabs; // The slab being carved from, linked to the earlier ones
+    __thread char* s_slabNext;
+    __thread char* s_slabEnd;
+    __thread unsigned long s_outstanding; // Blocks allocated and not yet released
+
+    struct SlabHeader {
+      char* previous; // The slab carved from before
+      const void* owner; // The thread that carves blocks from the slab
+    };
+
+    inline char*& previousSlab(char* slab) {
+      return reinterpret_cast<SlabHeader*>(slab)->previous;
+    }
+
+    inline const SlabHeader* slabOf(const void* block) {
+      return reinterpret_cast<const SlabHeader*>(reinterpret_cast<std::size_t>(block) & ~(SLAB_SIZE - 1));
+    }
+
+    /**
+     * @brief Identifies the calling thread while it runs, by the address of one of its thread locals.
+     */
+    inline const void* currentThread() {
+      return &s_outstanding;
+    }
+
+    /**
+     * @brief Return all but the current slab to the system, and start carving it afresh.
+     * Only called when none of the thread's blocks are in use.
+     */
+    void releaseSlabs() {
+      std::memset(s_freeBlocks, 0, sizeof(s_freeBlocks));
+      char* slab = previousSlab(s_slabs);
+      while (slab != NULL) {
+        char* previous = previousSlab(slab);
+        std::free(slab);
+        slab = previous;
+      }
+      previousSlab(s_slabs) = NULL;
+      s_slabNext = s_slabs + SLAB_HEADER_SIZE;
+    }
+#endif
+  }
+
+  SlabAllocator::Mode SlabAllocator::s_mode = SlabAllocator::UNDECIDED;
+
+  void* SlabAllocator::allocatePooled(std::size_t size) {
+#ifdef __GNUC__
+    std::size_t blockClass = sizeClass(size);
+    if (blockClass <= CLASS_COUNT) {
+      ++s_outstanding;
+      FreeBlock* block = s_freeBlocks[blockClass];
+      if (block != NULL) {
+        s_freeBlocks[blockClass] = block->next;
+        return block;
+      }
+      std::size_t blockSize = blockClass * GRANULE;
+      if (s_slabNext == NULL || static_cast<std::size_t>(s_slabEnd - s_slabNext) < blockSize) {
+        // The tail of the old slab is too small for this class, so it is left unused
+        void* memory = NULL;
+        if (posix_memalign(&memory, SLAB_SIZE, SLAB_SIZE) != 0)
+          throw std::bad_alloc();
+        char* slab = static_cast<char*>(memory);
+        reinterpret_cast<SlabHeader*>(slab)->owner = currentThread();
+        previousSlab(slab) = s_slabs;
+        s_slabs = slab;
+        s_slabNext = slab + SLAB_HEADER_SIZE;
+        s_slabEnd = slab + SLAB_SIZE;
+      }
+      char* slabBlock = s_slabNext;
+      s_slabNext += blockSize;
+      return slabBlock;
+    }
+#endif
+    return ::operator new(size);
+  }
+
+  void SlabAllocator::deallocatePooled(void* ptr, std::size_t size) {
+    if (ptr == NULL)
+      return;
+#ifdef __GNUC__
+    std::size_t blockClass = sizeClass(size);
+    if (blockClass <= CLASS_COUNT) {
+      checkError(slabOf(ptr)->owner == currentThread(),
+                 "Pooled block " << ptr << " released in a thread other than the one that allocated it.");
+      FreeBlock* freed = static_cast<FreeBlock*>(ptr);
+      freed->next = s_freeBlocks[blockClass];
+      s_freeBlocks[blockClass] = freed;
+      if (--s_outstanding == 0)
+        releaseSlabs();
+      return;
+    }
+#else
+    (void) size;
+#endif
+    ::operator delete(ptr);
+  }
+
+  void SlabAllocator::setEnabled(bool enabled) {
+    Mode mode = (enabled ? POOLED : UNPOOLED);
+    check_runtime_error(s_mode == UNDECIDED || s_mode == mode,
+                        "Pooled allocation can only be chosen before anything is allocated.");
+    s_mode = mode;
+  }
+
+  bool SlabAllocator::decideMode() {
+    const char* envStr = std::getenv("EUROPA_POOLED_ALLOCATION");
+    s_mode = (envStr != NULL && std::strcmp(envStr, "1") == 0 ? POOLED : UNPOOLED);
+    return s_mode == POOLED;
+  }
+}
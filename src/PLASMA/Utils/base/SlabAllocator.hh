@@ -0,0 +1,78 @@
+#ifndef H_SlabAllocator
+#define H_SlabAllocator
+
+/**
+ * @file SlabAllocator.hh
+ * @brief Pooled allocation of small, frequently created objects.
+ * @ingroup Utility
+ */
+
+#include <cstddef>
+#include <new>
+
+namespace EUROPA {
+
+  /**
+   * @class SlabAllocator
+   * @brief Allocates small blocks out of large slabs, grouped in size classes.
+   *
+   * Tokens, variables, domains and constraints are created and deleted in great numbers during
+   * planning. When pooling is enabled, blocks of each size class are carved consecutively out of
+   * slabs, so the parts of a token allocated together lie together in memory, and freed blocks are
+   * kept on a free list for the next allocation of that class rather than returned to the heap.
+   * Free lists and slabs belong to the allocating thread, so no locking is needed, and blocks must
+   * be released in the thread that allocated them, which is checked unless built with EUROPA_FAST. Once every block a thread allocated has been
+   * released, as when its engines have been shut down, its slabs are returned to the system, all
+   * but the one it is carving from.
+   *
+   * Blocks carry no header: they are released with the size they were allocated with, which the
+   * sized operator delete of a class with a virtual destructor supplies. So whether blocks are
+   * pooled is fixed for the process before the first allocation, by setting EUROPA_POOLED_ALLOCATION
+   * to 1 in the environment or by calling setEnabled(). When pooling is disabled, allocation goes
+   * straight to the global operator new.
+   */
+  class SlabAllocator {
+  public:
+    static void* allocate(std::size_t size) {
+      return isEnabled() ? allocatePooled(size) : ::operator new(size);
+    }
+
+    static void deallocate(void* ptr, std::size_t size) {
+      if (isEnabled())
+        deallocatePooled(ptr, size);
+      else
+        ::operator delete(ptr);
+    }
+
+    /**
+     * @brief Turn pooling on or off for the process. Fails once anything has been allocated
+     * under the other setting.
+     */
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled() {
+      return s_mode == UNDECIDED ? decideMode() : s_mode == POOLED;
+    }
+
+    /**
+     * @brief Allocate a block from the calling thread's slabs, whatever the setting.
+     */
+    static void* allocatePooled(std::size_t size);
+
+    /**
+     * @brief Release a block allocated with allocatePooled(), of the size it was allocated with.
+     */
+    static void deallocatePooled(void* ptr, std::size_t size);
+
+  private:
+    enum Mode {UNDECIDED = 0, UNPOOLED, POOLED};
+
+    static bool decideMode();
+
+    static Mode s_mode; /**< Zero initialized, so it is undecided for allocations made during static initialization */
+
+    SlabAllocator();
+  };
+}
+
+#endif
@@ -29,6 +29,7 @@
 #include "TestData.hh"
 #include "Id.hh"
 #include "Entity.hh"
+#include "SlabAllocator.hh"
 #include "XMLUtils.hh"
 #include "Number.hh"
 #include "Engine.hh"
@@ -344,6 +345,7 @@ private:
   static bool testBadIdUsage();
   static bool testIdConversion();
   static bool testConstId();
+  static bool testStaleIdDetection();
 };
 
 bool IdTests::test() {
@@ -357,9 +359,30 @@ bool IdTests::test() {
   EUROPA_runTest(testBadIdUsage);
   EUROPA_runTest(testIdConversion);
   EUROPA_runTest(testConstId);
+  EUROPA_runTest(testStaleIdDetection);
   return(true);
 }
 
+bool IdTests::testStaleIdDetection() {
+#ifdef EUROPA_ID_CHECKED
+  // Recycle addresses until one is reused, and check the old Id is still caught as dangling.
+  bool reused = false;
+  for(unsigned int i = 0; i < 100 && !reused; i++) {
+    Id<Foo> oldId(new Foo());
+    Foo* oldPtr = (Foo*) oldId;
+    Id<Foo> copy(oldId);
+    oldId.release();
+    CPPUNIT_ASSERT(copy.isInvalid());
+    Id<Foo> newId(new Foo());
+    CPPUNIT_ASSERT(newId.isValid());
+    reused = ((Foo*) newId == oldPtr);
+    CPPUNIT_ASSERT(copy.isInvalid());
+    newId.release();
+  }
+#endif
+  return true;
+}
+
 bool IdTests::testBasicAllocation() {
 #ifndef EUROPA_FAST
   unsigned long initialSize = IdTable::size();
@@ -594,6 +617,8 @@ public:
     EUROPA_runTest(testElementCounting);
     EUROPA_runTest(testElementAccess);
     EUROPA_runTest(testComparisons);
+    EUROPA_runTest(testCharacterRangeLookup);
+    EUROPA_runTest(testConcurrentInterning);
     return true;
   }
 
@@ -665,12 +690,71 @@ private:
     CPPUNIT_ASSERT(!lbl5.contains("I"));
     return true;
   }
+
+  static bool testCharacterRangeLookup(){
+    const char* chars = "prefix.suffix";
+    CPPUNIT_ASSERT(!LabelStr::isString("prefix.suff"));
+    LabelStr prefix(chars, 6);
+    CPPUNIT_ASSERT(prefix.toString() == "prefix");
+    CPPUNIT_ASSERT(prefix == LabelStr(std::string("prefix")));
+    CPPUNIT_ASSERT(LabelStr::getKey(chars, 6) == prefix.getKey());
+    CPPUNIT_ASSERT(LabelStr::isString("prefix"));
+
+    LabelStr whole(chars, strlen(chars));
+    CPPUNIT_ASSERT(whole == LabelStr(chars));
+    CPPUNIT_ASSERT(whole != prefix);
+
+    // Strings with embedded nulls are distinct from their prefixes
+    std::string withNull("abc");
+    withNull.push_back('\0');
+    withNull.append("def");
+    LabelStr nullLbl(withNull);
+    CPPUNIT_ASSERT(nullLbl != LabelStr("abc"));
+    CPPUNIT_ASSERT(nullLbl.toString() == withNull);
+    CPPUNIT_ASSERT(LabelStr(nullLbl.getKey()) == nullLbl);
+
+    CPPUNIT_ASSERT(!LabelStr::isString(prefix.getKey() + EPSILON));
+    CPPUNIT_ASSERT(!LabelStr::isString(-prefix.getKey()));
+    return true;
+  }
+
+  static void* internLabels(void* arg) {
+    std::vector<edouble>* keys = static_cast<std::vector<edouble>*>(arg);
+    for(unsigned int i = 0; i < 5000; i++) {
+      std::stringstream sstr;
+      sstr << "ConcurrentLabel" << i;
+      keys->push_back(LabelStr(sstr.str()).getKey());
+    }
+    return NULL;
+  }
+
+  static bool testConcurrentInterning(){
+    const unsigned int threadCount = 4;
+    pthread_t threads[threadCount];
+    std::vector<edouble> keys[threadCount];
+    for(unsigned int i = 0; i < threadCount; i++)
+      pthread_create(&threads[i], NULL, internLabels, &keys[i]);
+    for(unsigned int i = 0; i < threadCount; i++)
+      pthread_join(threads[i], NULL);
+
+    for(unsigned int i = 1; i < threadCount; i++)
+      CPPUNIT_ASSERT(keys[i] == keys[0]);
+    for(unsigned int j = 0; j < keys[0].size(); j++) {
+      std::stringstream sstr;
+      sstr << "ConcurrentLabel" << j;
+      CPPUNIT_ASSERT(LabelStr(keys[0][j]).toString() == sstr.str());
+    }
+    return true;
+  }
 };
 
 class EntityTest {
 public:
   static bool test(){
     EUROPA_runTest(testReferenceCounting);
+    EUROPA_runTest(testKeyRegistry);
+    EUROPA_runTest(testConcurrentKeyAllocation);
+    EUROPA_runTest(testPooledAllocation);
     return true;
   }
 
@@ -696,6 +780,172 @@ private:
     // CPPUNIT_ASSERT(Entity::garbageCollect() == 2);
     return true;
   }
+
+  static bool testKeyRegistry(){
+    // Enough entities to span several key blocks
+    std::vector<Id<TestEntity> > entities;
+    for(unsigned int i = 0; i < 3000; i++)
+      entities.push_back(Id<TestEntity>(new TestEntity()));
+
+    for(unsigned int i = 1; i < entities.size(); i++)
+      CPPUNIT_ASSERT(entities[i-1]->getKey() < entities[i]->getKey());
+
+    for(unsigned int i = 0; i < entities.size(); i++)
+      CPPUNIT_ASSERT(Entity::getEntity(entities[i]->getKey()) == entities[i]);
+
+    std::set<EntityId> allEntities;
+    Entity::getEntities(allEntities);
+    CPPUNIT_ASSERT(allEntities.size() >= entities.size());
+
+    eint key = entities[5]->getKey();
+    entities[5].release();
+    CPPUNIT_ASSERT(Entity::getEntity(key).isNoId());
+
+    for(unsigned int i = 0; i < entities.size(); i++)
+      if(i != 5)
+        entities[i].release();
+
+    CPPUNIT_ASSERT(Entity::getEntity(key + 1).isNoId());
+    CPPUNIT_ASSERT(Entity::getEntity(-1).isNoId());
+
+    // Pages of the exhausted blocks are recycled, without old keys finding the new entities
+    std::vector<Id<TestEntity> > recycled;
+    for(unsigned int i = 0; i < 3000; i++)
+      recycled.push_back(Id<TestEntity>(new TestEntity()));
+    CPPUNIT_ASSERT(Entity::getEntity(key).isNoId());
+    CPPUNIT_ASSERT(Entity::getEntity(key + 1).isNoId());
+    for(unsigned int i = 0; i < recycled.size(); i++)
+      CPPUNIT_ASSERT(Entity::getEntity(recycled[i]->getKey()) == recycled[i]);
+    for(unsigned int i = 0; i < recycled.size(); i++)
+      recycled[i].release();
+    return true;
+  }
+
+  static void* allocateEntities(void* arg) {
+    std::vector<eint>* keys = static_cast<std::vector<eint>*>(arg);
+    std::vector<TestEntity*> entities;
+    for(unsigned int i = 0; i < 2000; i++) {
+      entities.push_back(new TestEntity());
+      keys->push_back(entities.back()->getKey());
+    }
+    for(unsigned int i = 0; i < entities.size(); i++)
+      delete entities[i];
+    return NULL;
+  }
+
+  static bool testConcurrentKeyAllocation(){
+    const unsigned int threadCount = 4;
+    pthread_t threads[threadCount];
+    std::vector<eint> keys[threadCount];
+    for(unsigned int i = 0; i < threadCount; i++)
+      pthread_create(&threads[i], NULL, allocateEntities, &keys[i]);
+    for(unsigned int i = 0; i < threadCount; i++)
+      pthread_join(threads[i], NULL);
+
+    std::set<eint> allKeys;
+    for(unsigned int i = 0; i < threadCount; i++) {
+      for(unsigned int j = 0; j < keys[i].size(); j++) {
+        CPPUNIT_ASSERT(allKeys.insert(keys[i][j]).second);
+        CPPUNIT_ASSERT(j == 0 || keys[i][j-1] < keys[i][j]);
+      }
+    }
+    return true;
+  }
+
+  static bool testPooledAllocation(){
+    // Fixed by the first allocation, which has been made
+    bool enabled = SlabAllocator::isEnabled();
+    SlabAllocator::setEnabled(enabled);
+    Error::doThrowExceptions();
+    try {
+      Error::doNotDisplayErrors();
+      SlabAllocator::setEnabled(!enabled);
+      CPPUNIT_ASSERT_MESSAGE("Switched pooled allocation after allocating", false);
+    }
+    catch (Error e) {
+      Error::doDisplayErrors();
+    }
+    CPPUNIT_ASSERT(SlabAllocator::isEnabled() == enabled);
+
+    // Entities are released with the size they were allocated with, either way
+    TestEntity* entity = new TestEntity();
+    delete entity;
+
+    const std::size_t size = sizeof(TestEntity);
+    void* first = SlabAllocator::allocatePooled(size);
+    void* second = SlabAllocator::allocatePooled(size);
+    SlabAllocator::deallocatePooled(second, size);
+
+    // Freed blocks are reused by the next allocation of their size
+    void* reused = SlabAllocator::allocatePooled(size);
+    CPPUNIT_ASSERT(reused == second);
+
+    // Blocks of other sizes come from their own lists
+    void* larger = SlabAllocator::allocatePooled(size * 4);
+    CPPUNIT_ASSERT(larger != first && larger != reused);
+    SlabAllocator::deallocatePooled(larger, size * 4);
+    CPPUNIT_ASSERT(SlabAllocator::allocatePooled(size * 4) == larger);
+    SlabAllocator::deallocatePooled(larger, size * 4);
+
+    SlabAllocator::deallocatePooled(first, size);
+    SlabAllocator::deallocatePooled(reused, size);
+
+    // This thread may hold entities in pooled blocks, but a new thread starts with none
+    bool released = false;
+    pthread_t thread;
+    pthread_create(&thread, NULL, releasePooledBlocks, &released);
+    pthread_join(thread, NULL);
+    CPPUNIT_ASSERT(released);
+
+#ifndef EUROPA_FAST
+    // Blocks must be released in the thread that allocated them
+    void* foreign = NULL;
+    pthread_create(&thread, NULL, allocatePooledBlock, &foreign);
+    pthread_join(thread, NULL);
+    bool rejected = false;
+    try {
+      Error::doNotDisplayErrors();
+      SlabAllocator::deallocatePooled(foreign, size);
+    }
+    catch (Error e) {
+      rejected = true;
+    }
+    Error::doDisplayErrors();
+    CPPUNIT_ASSERT(rejected);
+#endif
+    return true;
+  }
+
+  static void* allocatePooledBlock(void* arg) {
+    *static_cast<void**>(arg) = SlabAllocator::allocatePooled(sizeof(TestEntity));
+    return NULL;
+  }
+
+  /**
+   * Once every block of a thread is released its free lists are dropped and its current slab is carved
+   * afresh, so the first block of that slab comes back rather than the last one freed.
+   */
+  static void* releasePooledBlocks(void* arg) {
+    const std::size_t size = sizeof(TestEntity);
+    const std::size_t slabSize = 64 * 1024;
+    std::vector<void*> blocks;
+    for (std::size_t i = 0; i < 3 * slabSize / size; i++)
+      blocks.push_back(SlabAllocator::allocatePooled(size));
+
+    std::size_t currentSlab = reinterpret_cast<std::size_t>(blocks.back()) & ~(slabSize - 1);
+    void* first = blocks.back();
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+      if ((reinterpret_cast<std::size_t>(blocks[i]) & ~(slabSize - 1)) == currentSlab && blocks[i] < first)
+        first = blocks[i];
+    }
+    for (std::size_t i = 0; i < blocks.size(); i++)
+      SlabAllocator::deallocatePooled(blocks[i], size);
+
+    void* fresh = SlabAllocator::allocatePooled(size);
+    *static_cast<bool*>(arg) = (fresh == first);
+    SlabAllocator::deallocatePooled(fresh, size);
+    return NULL;
+  }
 };
 
 //TODO: fill this out with more tests for XMLUtils